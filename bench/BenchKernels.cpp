@@ -0,0 +1,618 @@
+//===- BenchKernels.cpp -----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file BenchKernels.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Benchmark kernels - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "BenchKernels.h"
+#include "FapContext.h"
+#include "FapFft.h"
+#include "FapGemm.h"
+#include "FapMath.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+using ::fap::Complex;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::fap::bench::Kernel;
+
+/// @brief \p d rounded on \p prec with the rounding of the context
+FloatingPointType quantize(double d, FloatPrecTy prec) {
+  FloatingPointType val(d);
+  int exp2;
+  MantType sig = val.getSignificand(exp2);
+  return FloatingPointType::fromSignificand(
+      val.getSign(), sig, exp2, false, prec,
+      ::fap::ArithmeticContext::current().rounding);
+}
+
+/// @brief Operations which differ between the reference and the FAP runs,
+/// so that each kernel is written once for both
+template<typename T>
+struct Num;
+
+template<>
+struct Num<double> {
+  static double make(double d, FloatPrecTy) {
+    return d;
+  }
+  static double value(double d) {
+    return d;
+  }
+  static double sqrt(double d) {
+    return ::sqrt(d);
+  }
+};
+
+template<>
+struct Num<FloatingPointType> {
+  static FloatingPointType make(double d, FloatPrecTy prec) {
+    return quantize(d, prec);
+  }
+  static double value(const FloatingPointType& fp) {
+    return (double)fp;
+  }
+  static FloatingPointType sqrt(const FloatingPointType& fp) {
+    return ::fap::sqrt(fp);
+  }
+};
+
+template<typename T>
+::std::vector<T> makeAll(const ::std::vector<double>& vals, FloatPrecTy prec) {
+  ::std::vector<T> res;
+  res.reserve(vals.size());
+  for (size_t i = 0; i < vals.size(); ++i) {
+    res.push_back(Num<T>::make(vals[i], prec));
+  }
+  return res;
+}
+
+template<typename T>
+void values(const ::std::vector<T>& vals, ::std::vector<double>& out) {
+  out.resize(vals.size());
+  for (size_t i = 0; i < vals.size(); ++i) {
+    out[i] = Num<T>::value(vals[i]);
+  }
+}
+
+/// @brief Call fn(begin, end) on shares of [0, n), on \p threads workers
+template<typename FnTy>
+void parallelFor(size_t n, unsigned threads, FnTy fn) {
+  ::fap::parallelShares(::fap::evenShares(n, n, threads), fn);
+}
+
+::std::vector<double> uniform(size_t n, double lo, double hi,
+                              ::std::mt19937_64& gen) {
+  ::std::uniform_real_distribution<double> dist(lo, hi);
+  ::std::vector<double> res(n);
+  for (size_t i = 0; i < n; ++i) {
+    res[i] = dist(gen);
+  }
+  return res;
+}
+
+/// @brief Kernel written once as compute<T>(), for T double and
+/// FloatingPointType
+template<typename DerivedTy>
+class KernelBase : public Kernel {
+ public:
+  void reference(::std::vector<double>& out) const {
+    static_cast<const DerivedTy*>(this)->template compute<double>(
+        FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE), 1, out);
+  }
+
+  void run(FloatPrecTy prec, unsigned threads,
+           ::std::vector<double>& out) const {
+    static_cast<const DerivedTy*>(this)->template compute<FloatingPointType>(
+        prec, threads, out);
+  }
+};
+
+/// @brief c = a * b, multiplies of n x n matrices
+class GemmKernel : public KernelBase<GemmKernel> {
+ public:
+  const char* name() const {
+    return "gemm";
+  }
+
+  void setup(size_t scale, uint64_t seed) {
+    ::std::mt19937_64 gen(seed);
+    this->n = 64 * scale;
+    this->a = uniform(this->n * this->n, -1.0, 1.0, gen);
+    this->b = uniform(this->n * this->n, -1.0, 1.0, gen);
+  }
+
+  size_t elements() const {
+    return this->n * this->n;
+  }
+
+  template<typename T>
+  void compute(FloatPrecTy prec, unsigned threads,
+               ::std::vector<double>& out) const {
+    ::std::vector<T> qa = makeAll<T>(this->a, prec);
+    ::std::vector<T> qb = makeAll<T>(this->b, prec);
+    ::std::vector<T> c(this->n * this->n);
+    multiply(qa.data(), qb.data(), c.data(), threads);
+    values(c, out);
+  }
+
+ private:
+  void multiply(const double* qa, const double* qb, double* c,
+                unsigned) const {
+    size_t n = this->n;
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t k = 0; k < n; ++k) {
+        for (size_t j = 0; j < n; ++j) {
+          c[i * n + j] = k == 0 ? qa[i * n] * qb[j]
+                                : c[i * n + j] + qa[i * n + k] * qb[k * n + j];
+        }
+      }
+    }
+  }
+
+  void multiply(const FloatingPointType* qa, const FloatingPointType* qb,
+                FloatingPointType* c, unsigned threads) const {
+    ::fap::gemm(this->n, this->n, this->n, qa, this->n, qb, this->n, c,
+                this->n, FAP_GEMM_ACCUMULATE_ROUNDED, threads);
+  }
+
+  size_t n;
+  ::std::vector<double> a, b;
+};
+
+/// @brief 2D convolution with a 5 x 5 filter, valid outputs only
+class Conv2dKernel : public KernelBase<Conv2dKernel> {
+ public:
+  const char* name() const {
+    return "conv2d";
+  }
+
+  void setup(size_t scale, uint64_t seed) {
+    ::std::mt19937_64 gen(seed);
+    this->size = 128 * scale;
+    this->image = uniform(this->size * this->size, 0.0, 1.0, gen);
+    this->filter = uniform(FILTER * FILTER, -0.2, 0.2, gen);
+  }
+
+  size_t elements() const {
+    return (this->size - FILTER + 1) * (this->size - FILTER + 1);
+  }
+
+  template<typename T>
+  void compute(FloatPrecTy prec, unsigned threads,
+               ::std::vector<double>& out) const {
+    ::std::vector<T> img = makeAll<T>(this->image, prec);
+    ::std::vector<T> flt = makeAll<T>(this->filter, prec);
+    size_t side = this->size - FILTER + 1;
+    ::std::vector<T> res(side * side);
+    parallelFor(side, threads, [&](size_t begin, size_t end) {
+      for (size_t r = begin; r < end; ++r) {
+        for (size_t c = 0; c < side; ++c) {
+          T acc = img[r * this->size + c] * flt[0];
+          for (size_t i = 0; i < FILTER; ++i) {
+            for (size_t j = (i == 0 ? 1 : 0); j < FILTER; ++j) {
+              acc += img[(r + i) * this->size + c + j] * flt[i * FILTER + j];
+            }
+          }
+          res[r * side + c] = acc;
+        }
+      }
+    });
+    values(res, out);
+  }
+
+ private:
+  static const size_t FILTER = 5;
+  size_t size;
+  ::std::vector<double> image, filter;
+};
+
+/// @brief Sobel gradient magnitude of an image
+class SobelKernel : public KernelBase<SobelKernel> {
+ public:
+  const char* name() const {
+    return "sobel";
+  }
+
+  void setup(size_t scale, uint64_t seed) {
+    ::std::mt19937_64 gen(seed);
+    this->size = 128 * scale;
+    this->image = uniform(this->size * this->size, 0.0, 1.0, gen);
+  }
+
+  size_t elements() const {
+    return (this->size - 2) * (this->size - 2);
+  }
+
+  template<typename T>
+  void compute(FloatPrecTy prec, unsigned threads,
+               ::std::vector<double>& out) const {
+    ::std::vector<T> img = makeAll<T>(this->image, prec);
+    size_t side = this->size - 2, ld = this->size;
+    // Signed offsets of the neighbours
+    ptrdiff_t up = -(ptrdiff_t)ld, down = ld;
+    ::std::vector<T> res(side * side);
+    parallelFor(side, threads, [&](size_t begin, size_t end) {
+      for (size_t r = begin + 1; r < end + 1; ++r) {
+        for (size_t c = 1; c < side + 1; ++c) {
+          const T* p = &img[r * ld + c];
+          T gx = (p[up + 1] + (p[1] + p[1]) + p[down + 1]) -
+                 (p[up - 1] + (p[-1] + p[-1]) + p[down - 1]);
+          T gy = (p[down - 1] + (p[down] + p[down]) + p[down + 1]) -
+                 (p[up - 1] + (p[up] + p[up]) + p[up + 1]);
+          res[(r - 1) * side + c - 1] = Num<T>::sqrt(gx * gx + gy * gy);
+        }
+      }
+    });
+    values(res, out);
+  }
+
+ private:
+  size_t size;
+  ::std::vector<double> image;
+};
+
+/// @brief FIR filter of 32 taps on a signal
+class FirKernel : public KernelBase<FirKernel> {
+ public:
+  const char* name() const {
+    return "fir";
+  }
+
+  void setup(size_t scale, uint64_t seed) {
+    ::std::mt19937_64 gen(seed);
+    this->signal = uniform(16384 * scale + TAPS - 1, -1.0, 1.0, gen);
+    this->taps = uniform(TAPS, -0.1, 0.1, gen);
+  }
+
+  size_t elements() const {
+    return this->signal.size() - TAPS + 1;
+  }
+
+  template<typename T>
+  void compute(FloatPrecTy prec, unsigned threads,
+               ::std::vector<double>& out) const {
+    ::std::vector<T> x = makeAll<T>(this->signal, prec);
+    ::std::vector<T> h = makeAll<T>(this->taps, prec);
+    ::std::vector<T> y(this->elements());
+    parallelFor(y.size(), threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        T acc = h[0] * x[i];
+        for (size_t t = 1; t < TAPS; ++t) {
+          acc += h[t] * x[i + t];
+        }
+        y[i] = acc;
+      }
+    });
+    values(y, out);
+  }
+
+ private:
+  static const size_t TAPS = 32;
+  ::std::vector<double> signal, taps;
+};
+
+/// @brief Jacobi iterations of the 5 points stencil on a grid with fixed
+/// boundaries
+class JacobiKernel : public KernelBase<JacobiKernel> {
+ public:
+  const char* name() const {
+    return "jacobi";
+  }
+
+  void setup(size_t scale, uint64_t seed) {
+    ::std::mt19937_64 gen(seed);
+    this->size = 64 * scale;
+    this->grid = uniform(this->size * this->size, 0.0, 1.0, gen);
+  }
+
+  size_t elements() const {
+    return (this->size - 2) * (this->size - 2) * ITERATIONS;
+  }
+
+  template<typename T>
+  void compute(FloatPrecTy prec, unsigned threads,
+               ::std::vector<double>& out) const {
+    ::std::vector<T> cur = makeAll<T>(this->grid, prec);
+    ::std::vector<T> next = cur;
+    const T coeff = Num<T>::make(0.2, prec);
+    size_t ld = this->size;
+    ptrdiff_t up = -(ptrdiff_t)ld, down = ld;
+    for (int it = 0; it < ITERATIONS; ++it) {
+      parallelFor(ld - 2, threads, [&](size_t begin, size_t end) {
+        for (size_t r = begin + 1; r < end + 1; ++r) {
+          for (size_t c = 1; c < ld - 1; ++c) {
+            const T* p = &cur[r * ld + c];
+            next[r * ld + c] = coeff * ((((p[0] + p[-1]) + p[1]) + p[up]) +
+                                        p[down]);
+          }
+        }
+      });
+      cur.swap(next);
+    }
+    values(cur, out);
+  }
+
+ private:
+  static const int ITERATIONS = 8;
+  size_t size;
+  ::std::vector<double> grid;
+};
+
+/// @brief Lloyd iterations of k-means, the outputs are the centroids
+class KmeansKernel : public KernelBase<KmeansKernel> {
+ public:
+  const char* name() const {
+    return "kmeans";
+  }
+
+  void setup(size_t scale, uint64_t seed) {
+    ::std::mt19937_64 gen(seed);
+    this->count = 1024 * scale;
+    ::std::vector<double> centers = uniform(CLUSTERS * DIM, -4.0, 4.0, gen);
+    ::std::vector<double> noise = uniform(this->count * DIM, -1.0, 1.0, gen);
+    this->points.resize(this->count * DIM);
+    for (size_t i = 0; i < this->count; ++i) {
+      for (size_t d = 0; d < DIM; ++d) {
+        this->points[i * DIM + d] = centers[(i % CLUSTERS) * DIM + d] +
+                                    noise[i * DIM + d];
+      }
+    }
+  }
+
+  size_t elements() const {
+    return this->count * ITERATIONS;
+  }
+
+  template<typename T>
+  void compute(FloatPrecTy prec, unsigned threads,
+               ::std::vector<double>& out) const {
+    ::std::vector<T> pts = makeAll<T>(this->points, prec);
+    ::std::vector<T> cent(pts.begin(), pts.begin() + CLUSTERS * DIM);
+    ::std::vector<size_t> label(this->count);
+    for (int it = 0; it < ITERATIONS; ++it) {
+      parallelFor(this->count, threads, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          double best = 0.0;
+          for (size_t k = 0; k < CLUSTERS; ++k) {
+            T diff = pts[i * DIM] - cent[k * DIM];
+            T dist = diff * diff;
+            for (size_t d = 1; d < DIM; ++d) {
+              diff = pts[i * DIM + d] - cent[k * DIM + d];
+              dist += diff * diff;
+            }
+            // The distances enter in a double, the comparison is exact
+            double val = Num<T>::value(dist);
+            if (k == 0 || val < best) {
+              best = val;
+              label[i] = k;
+            }
+          }
+        }
+      });
+
+      // New centroids, the empty clusters keep the previous one
+      ::std::vector<T> sum(CLUSTERS * DIM);
+      ::std::vector<size_t> members(CLUSTERS, 0);
+      for (size_t i = 0; i < this->count; ++i) {
+        size_t k = label[i];
+        for (size_t d = 0; d < DIM; ++d) {
+          sum[k * DIM + d] = members[k] == 0 ? pts[i * DIM + d]
+                                             : sum[k * DIM + d] +
+                                               pts[i * DIM + d];
+        }
+        members[k]++;
+      }
+      for (size_t k = 0; k < CLUSTERS; ++k) {
+        if (members[k] == 0) {
+          continue;
+        }
+        T size = Num<T>::make((double)members[k], prec);
+        for (size_t d = 0; d < DIM; ++d) {
+          cent[k * DIM + d] = sum[k * DIM + d] / size;
+        }
+      }
+    }
+    values(cent, out);
+  }
+
+ private:
+  static const size_t CLUSTERS = 8;
+  static const size_t DIM = 4;
+  static const int ITERATIONS = 6;
+  size_t count;
+  ::std::vector<double> points;
+};
+
+/// @brief Batch of 256 points complex transforms
+class FftKernel : public KernelBase<FftKernel> {
+ public:
+  const char* name() const {
+    return "fft";
+  }
+
+  void setup(size_t scale, uint64_t seed) {
+    ::std::mt19937_64 gen(seed);
+    this->batch = 64 * scale;
+    this->signal = uniform(2 * this->batch * SIZE, -1.0, 1.0, gen);
+  }
+
+  size_t elements() const {
+    return this->batch * SIZE;
+  }
+
+  template<typename T>
+  void compute(FloatPrecTy prec, unsigned threads,
+               ::std::vector<double>& out) const {
+    ::std::vector<T> parts = makeAll<T>(this->signal, prec);
+    ::std::vector<Complex<T> > data(this->batch * SIZE);
+    for (size_t i = 0; i < data.size(); ++i) {
+      data[i] = Complex<T>(parts[2 * i], parts[2 * i + 1]);
+    }
+    transform(data.data(), threads);
+    out.resize(2 * data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+      out[2 * i] = Num<T>::value(data[i].real());
+      out[2 * i + 1] = Num<T>::value(data[i].imag());
+    }
+  }
+
+ private:
+  /// @brief Radix-2 reference transforms
+  void transform(Complex<double>* data, unsigned) const {
+    for (size_t b = 0; b < this->batch; ++b) {
+      Complex<double>* x = data + b * SIZE;
+      for (size_t i = 1, j = 0; i < SIZE; ++i) {
+        size_t bit = SIZE >> 1;
+        for (; j & bit; bit >>= 1) {
+          j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+          ::std::swap(x[i], x[j]);
+        }
+      }
+      for (size_t len = 2; len <= SIZE; len <<= 1) {
+        for (size_t k = 0; k < len / 2; ++k) {
+          double angle = -2.0 * M_PI * (double)k / (double)len;
+          Complex<double> w(cos(angle), sin(angle));
+          for (size_t base = 0; base < SIZE; base += len) {
+            Complex<double> u = x[base + k];
+            Complex<double> v = x[base + k + len / 2] * w;
+            x[base + k] = u + v;
+            x[base + k + len / 2] = u - v;
+          }
+        }
+      }
+    }
+  }
+
+  void transform(Complex<FloatingPointType>* data, unsigned threads) const {
+    ::fap::fft(data, SIZE, this->batch, false, threads);
+  }
+
+  static const size_t SIZE = 256;
+  size_t batch;
+  ::std::vector<double> signal;
+};
+
+/// @brief Inference of a 256-128-10 perceptron with ReLU on a batch
+class MlpKernel : public KernelBase<MlpKernel> {
+ public:
+  const char* name() const {
+    return "mlp";
+  }
+
+  void setup(size_t scale, uint64_t seed) {
+    ::std::mt19937_64 gen(seed);
+    this->batch = 64 * scale;
+    this->input = uniform(this->batch * IN, 0.0, 1.0, gen);
+    this->w1 = uniform(IN * HIDDEN, -1.0 / 16, 1.0 / 16, gen);
+    this->b1 = uniform(HIDDEN, -0.1, 0.1, gen);
+    this->w2 = uniform(HIDDEN * OUT, -1.0 / 11, 1.0 / 11, gen);
+    this->b2 = uniform(OUT, -0.1, 0.1, gen);
+  }
+
+  size_t elements() const {
+    return this->batch;
+  }
+
+  template<typename T>
+  void compute(FloatPrecTy prec, unsigned threads,
+               ::std::vector<double>& out) const {
+    ::std::vector<T> x = makeAll<T>(this->input, prec);
+    ::std::vector<T> hidden(this->batch * HIDDEN);
+    ::std::vector<T> res(this->batch * OUT);
+    layer(x, makeAll<T>(this->w1, prec), makeAll<T>(this->b1, prec), IN,
+          HIDDEN, true, prec, threads, hidden);
+    layer(hidden, makeAll<T>(this->w2, prec), makeAll<T>(this->b2, prec),
+          HIDDEN, OUT, false, prec, threads, res);
+    values(res, out);
+  }
+
+ private:
+  /// @brief res = relu(x * w + bias)
+  template<typename T>
+  void layer(const ::std::vector<T>& x, const ::std::vector<T>& w,
+             const ::std::vector<T>& bias, size_t in, size_t out, bool relu,
+             FloatPrecTy prec, unsigned threads, ::std::vector<T>& res) const {
+    multiply(x.data(), w.data(), res.data(), in, out, threads);
+    const T zero = Num<T>::make(0.0, prec);
+    for (size_t i = 0; i < this->batch; ++i) {
+      for (size_t j = 0; j < out; ++j) {
+        T& val = res[i * out + j];
+        val += bias[j];
+        if (relu && Num<T>::value(val) < 0.0) {
+          val = zero;
+        }
+      }
+    }
+  }
+
+  void multiply(const double* x, const double* w, double* res, size_t in,
+                size_t out, unsigned) const {
+    for (size_t i = 0; i < this->batch; ++i) {
+      for (size_t j = 0; j < out; ++j) {
+        double acc = x[i * in] * w[j];
+        for (size_t k = 1; k < in; ++k) {
+          acc += x[i * in + k] * w[k * out + j];
+        }
+        res[i * out + j] = acc;
+      }
+    }
+  }
+
+  void multiply(const FloatingPointType* x, const FloatingPointType* w,
+                FloatingPointType* res, size_t in, size_t out,
+                unsigned threads) const {
+    ::fap::gemm(this->batch, out, in, x, in, w, out, res, out,
+                FAP_GEMM_ACCUMULATE_ROUNDED, threads);
+  }
+
+  static const size_t IN = 256;
+  static const size_t HIDDEN = 128;
+  static const size_t OUT = 10;
+  size_t batch;
+  ::std::vector<double> input, w1, b1, w2, b2;
+};
+
+}  // end anonymous namespace
+
+::std::vector< ::std::unique_ptr<Kernel> > fap::bench::makeKernels() {
+  ::std::vector< ::std::unique_ptr<Kernel> > kernels;
+  kernels.push_back(::std::unique_ptr<Kernel>(new GemmKernel()));
+  kernels.push_back(::std::unique_ptr<Kernel>(new Conv2dKernel()));
+  kernels.push_back(::std::unique_ptr<Kernel>(new SobelKernel()));
+  kernels.push_back(::std::unique_ptr<Kernel>(new FirKernel()));
+  kernels.push_back(::std::unique_ptr<Kernel>(new JacobiKernel()));
+  kernels.push_back(::std::unique_ptr<Kernel>(new KmeansKernel()));
+  kernels.push_back(::std::unique_ptr<Kernel>(new FftKernel()));
+  kernels.push_back(::std::unique_ptr<Kernel>(new MlpKernel()));
+  return kernels;
+}
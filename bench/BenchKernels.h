@@ -0,0 +1,68 @@
+//===- BenchKernels.h -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file BenchKernels.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Benchmark kernels - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef BENCH_BENCHKERNELS_H_
+#define BENCH_BENCHKERNELS_H_
+
+#include "Fap.h"
+
+#include <memory>
+#include <vector>
+
+namespace fap {
+namespace bench {
+
+/// @brief Kernel of the benchmark suite, computed both on doubles, as the
+/// reference, and on FloatingPointType values of a given precision
+class Kernel {
+ public:
+  virtual ~Kernel() {
+  }
+
+  virtual const char* name() const = 0;
+
+  /// @brief Generate the inputs of a problem \p scale times the base size
+  virtual void setup(size_t scale, uint64_t seed) = 0;
+
+  /// @brief Elements computed by a run, for the throughput
+  virtual size_t elements() const = 0;
+
+  /// @brief Outputs computed on doubles
+  virtual void reference(::std::vector<double>& out) const = 0;
+
+  /// @brief Outputs computed with the inputs quantized on \p prec, in the
+  /// ArithmeticContext of the caller, converted to doubles
+  virtual void run(FloatPrecTy prec, unsigned threads,
+                   ::std::vector<double>& out) const = 0;
+};
+
+/// @brief gemm, conv2d, sobel, fir, jacobi, kmeans, fft and mlp
+::std::vector< ::std::unique_ptr<Kernel> > makeKernels();
+
+}  // end bench namespace
+}  // end fap namespace
+
+#endif /* BENCH_BENCHKERNELS_H_ */
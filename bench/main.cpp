@@ -0,0 +1,184 @@
+//===- main.cpp -------------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file main.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Benchmark suite main.
+///        Usage: fap_bench [--kernels gemm,fir,...] [--prec 11:52,8:23,...]
+///                         [--scale N] [--threads N] [--repeat N]
+///                         [--rounding nearest|zero|pinf|ninf|stochastic]
+///                         [--seed N] [--max-error E]
+///        Each kernel runs on each precision, the best time of the repeats
+///        gives the throughput and the outputs are compared to the double
+///        reference. With --max-error the exit status is 1 if a normwise
+///        relative error is above E, for the regression gates.
+//===----------------------------------------------------------------------===//
+
+#include "BenchKernels.h"
+#include "FapErrorStats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+/// @brief Parse "e:m,e:m,..."
+bool parsePrecs(const char* arg, vector< ::fap::FloatPrecTy>& precs) {
+  precs.clear();
+  string list(arg);
+  size_t pos = 0;
+  while (pos <= list.size()) {
+    size_t end = list.find(',', pos);
+    end = end == string::npos ? list.size() : end;
+    unsigned exp_size, mant_size;
+    if (sscanf(list.substr(pos, end - pos).c_str(), "%u:%u", &exp_size,
+               &mant_size) != 2 || exp_size < 2 ||
+        exp_size > DOUBLE_EXP_SIZE || mant_size > DOUBLE_MANT_SIZE) {
+      return false;
+    }
+    precs.push_back(::fap::FloatPrecTy(exp_size, mant_size));
+    pos = end + 1;
+  }
+  return true;
+}
+
+bool parseRounding(const char* arg, FAP_rounding_method& method) {
+  static const char* names[] = { "zero", "pinf", "ninf", "nearest",
+                                 "stochastic" };
+  static const FAP_rounding_method methods[] = { FAP_FP_ROUND_TOWARD_0,
+                                                 FAP_FP_ROUND_TOWARD_PINF,
+                                                 FAP_FP_ROUND_TOWARD_NINF,
+                                                 FAP_FP_ROUND_NEAREST,
+                                                 FAP_FP_ROUND_STOCHASTIC };
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    if (strcmp(arg, names[i]) == 0) {
+      method = methods[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+void usage(const char* prog) {
+  fprintf(stderr, "Usage: %s [--kernels gemm,conv2d,sobel,fir,jacobi,kmeans,"
+          "fft,mlp] [--prec e:m,...] [--scale N] [--threads N] [--repeat N] "
+          "[--rounding nearest|zero|pinf|ninf|stochastic] [--seed N] "
+          "[--max-error E]\n", prog);
+  exit(2);
+}
+
+}  // end anonymous namespace
+
+int main(int argc, const char *argv[]) {
+  string kernels = "gemm,conv2d,sobel,fir,jacobi,kmeans,fft,mlp";
+  vector< ::fap::FloatPrecTy> precs;
+  parsePrecs("11:52,8:23,8:7,5:10", precs);
+  size_t scale = 1;
+  unsigned threads = 0;
+  int repeat = 3;
+  FAP_rounding_method rounding = FAP_FP_ROUND_NEAREST;
+  uint64_t seed = 1;
+  double max_error = -1.0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+    }
+    const char* val = argv[i + 1];
+    if (strcmp(argv[i], "--kernels") == 0) {
+      kernels = val;
+    } else if (strcmp(argv[i], "--prec") == 0) {
+      if (!parsePrecs(val, precs)) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "--scale") == 0) {
+      scale = strtoul(val, NULL, 10);
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      threads = strtoul(val, NULL, 10);
+    } else if (strcmp(argv[i], "--repeat") == 0) {
+      repeat = atoi(val);
+    } else if (strcmp(argv[i], "--rounding") == 0) {
+      if (!parseRounding(val, rounding)) {
+        usage(argv[0]);
+      }
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      seed = strtoull(val, NULL, 10);
+    } else if (strcmp(argv[i], "--max-error") == 0) {
+      max_error = atof(val);
+    } else {
+      usage(argv[0]);
+    }
+    ++i;
+  }
+  if (scale == 0 || repeat <= 0) {
+    usage(argv[0]);
+  }
+
+  ::fap::ArithmeticContext ctx(rounding);
+  bool failed = false;
+  printf("%-8s %-6s %10s %10s %12s %11s %11s %11s %8s\n", "kernel", "prec",
+         "elements", "time[s]", "elements/s", "max abs", "norm rel", "rmse",
+         "snr[dB]");
+  vector< unique_ptr< ::fap::bench::Kernel> > all =
+      ::fap::bench::makeKernels();
+  for (size_t k = 0; k < all.size(); ++k) {
+    ::fap::bench::Kernel& kernel = *all[k];
+    if (("," + kernels + ",").find(string(",") + kernel.name() + ",") ==
+        string::npos) {
+      continue;
+    }
+    kernel.setup(scale, seed);
+    vector<double> ref, out;
+    kernel.reference(ref);
+
+    for (size_t p = 0; p < precs.size(); ++p) {
+      double best = INFINITY;
+      for (int r = 0; r < repeat; ++r) {
+        // Every repeat draws the same stochastic roundings
+        fap_stochastic_seed(seed);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        kernel.run(precs[p], threads, out);
+        chrono::duration<double> time = chrono::steady_clock::now() - start;
+        best = time.count() < best ? time.count() : best;
+      }
+      ::fap::ErrorStats err(precs[p]);
+      err.add(out.data(), ref.data(), ref.size());
+      char prec[16];
+      snprintf(prec, sizeof(prec), "%u:%u", precs[p].exp_size,
+               precs[p].mant_size);
+      printf("%-8s %-6s %10zu %10.4f %12.4g %11.3e %11.3e %11.3e %8.2f\n",
+             kernel.name(), prec, kernel.elements(), best,
+             kernel.elements() / best, err.getMaxAbs(), err.getNormRel(),
+             err.getRmse(), err.getSnr());
+      if (max_error >= 0.0 && !(err.getNormRel() <= max_error)) {
+        failed = true;
+      }
+    }
+  }
+  return failed ? 1 : 0;
+}
@@ -68,6 +68,16 @@ inline ::std::ostream& operator<<(::std::ostream& out, int128_t val) {
   out << (uint128_t)val;
   return out;
 }
+
+/// @brief Count leading zeros of a 128 bit value, 128 if it is 0
+inline int fap_clz_(uint128_t val) {
+  uint64_t high = (uint64_t) (val >> 64);
+  if (high != 0) {
+    return __builtin_clzll(high);
+  }
+  uint64_t low = (uint64_t) val;
+  return low != 0 ? 64 + __builtin_clzll(low) : 128;
+}
 #endif
 ///////////////////////////////////////////////////////////////////////////////
 //#define _FAP_DEBUG_
@@ -84,6 +94,11 @@ inline ::std::ostream& operator<<(::std::ostream& out, int128_t val) {
 #define DOUBLE_MANT_SIZE              52
 #define DOUBLE_SIZE                   DOUBLE_EXP_SIZE + DOUBLE_MANT_SIZE + DOUBLE_SIGN_SIZE
 
+/// @brief Widest precision of the FloatingPointType operators, the one of
+/// the IEEE 754 binary128
+#define FAP_MAX_EXP_SIZE              15
+#define FAP_MAX_MANT_SIZE             112
+
 #define GENERATE_RAND_FLOAT           (float)(((double)rand()/RAND_MAX) * 100)
 #define GENERATE_RAND_DOUBLE          (((double)rand()/RAND_MAX)*100)
 
@@ -104,17 +119,56 @@ typedef enum {
   FAP_FP_ROUND_TOWARD_0 = 0,
   FAP_FP_ROUND_TOWARD_PINF,
   FAP_FP_ROUND_TOWARD_NINF,
-  FAP_FP_ROUND_NEAREST
+  FAP_FP_ROUND_NEAREST,
+  FAP_FP_ROUND_STOCHASTIC  ///< Up with probability equal to the discarded fraction
 } FAP_rounding_method;
 
 ///@defgroup FAP_FP_SHIFTING_FUNCTIONS FAP Floating Point Shifting functions
 /// @{
 void fap_shift_right_(uint128_t*, int to_shift, uint8_t* grs);
 void fap_shift_left_(uint128_t*, int to_shift, uint8_t* grs);
+/// @brief True if the magnitude has to be incremented, rounding with
+/// \p method a value with least significant bit \p lsb and \p grs bits
+bool fap_round_up_(bool lsb, uint8_t grs, SignType sign,
+                   FAP_rounding_method method);
+/// @brief Shift right the magnitude \p mag of \p to_shift positions (left if
+/// negative), rounding it with \p method
+uint128_t fap_round_shift_(uint128_t mag, int to_shift, SignType sign,
+                           FAP_rounding_method method);
+/// @brief Product of the significands \p lhs and \p rhs, exact when it
+/// enters in 128 bits, the mantissas up to 63 bits. Otherwise it is taken
+/// from the 256 bits one, its lsb jamming the lower bits, and \p exp2 is
+/// increased by the bits dropped.
+uint128_t fap_mul_sig_(uint128_t lhs, uint128_t rhs, int *exp2);
+/// @brief Quotient of the significands \p lhs / \p rhs, \p rhs not zero,
+/// on 127 or 128 bits, its lsb jamming the remainder. It is the long
+/// division of Knuth's algorithm D of the dividend aligned on 256 bits by
+/// the divisor aligned on 128 bits, in two words of 64 bits. \p exp2 is
+/// decreased by the fraction bits of the quotient.
+uint128_t fap_div_sig_(uint128_t lhs, uint128_t rhs, int *exp2);
+/// @}
+
+///@defgroup FAP_FP_STOCHASTIC_FUNCTIONS FAP Stochastic rounding generator
+/// The generator is counter based, one for each thread: the n-th draw is a
+/// hash of the key of the thread and of n, so that the sequences are
+/// reproducible without any lock.
+/// @{
+/// @brief Seed the generator of the calling thread and reset its counter,
+/// \p stream selects an independent sequence, e.g. the thread index
+void fap_stochastic_seed(uint64_t seed, uint64_t stream = 0);
+/// @brief Reserve \p n draws of the calling thread, returning the first
+/// counter, so that a batch can compute them with fap_stochastic_draw_
+uint64_t fap_stochastic_reserve_(uint64_t n);
+/// @brief Draw \p counter of the calling thread
+uint64_t fap_stochastic_draw_(uint64_t counter);
+/// @brief Next 64 random bits of the calling thread
+uint64_t fap_stochastic_bits_();
 /// @}
 
 namespace fap {
 
+struct ArithmeticState;
+
 using IntegerPrecision = uint8_t;
 
 /// @brief Class for integer type
@@ -194,6 +248,7 @@ class IntegerType {
   IntegerType& operator+=(IntegerType);
   IntegerType& operator-=(IntegerType);
   IntegerType& operator*=(IntegerType);
+  /// @brief The division by zero saturates, 0/0 gives 0
   IntegerType& operator/=(IntegerType);
 
   friend IntegerType operator+(IntegerType lhs, const IntegerType& rhs) {
@@ -231,7 +286,7 @@ class IntegerType {
 /// @brief Precision type
 struct FloatPrecTy {
   /// @brief Ctor
-  FloatPrecTy(uint16_t e_size = 0, uint16_t m_size = 0)
+  constexpr FloatPrecTy(uint16_t e_size = 0, uint16_t m_size = 0)
       : exp_size(e_size),
         mant_size(m_size) {
   }
@@ -240,7 +295,13 @@ struct FloatPrecTy {
   uint16_t mant_size;  ///< Size of the mantissa
 };
 
-/// @brief Class for floating point type
+/// @brief Precision of the IEEE 754 binary128, a reference for the narrower
+/// ones
+constexpr FloatPrecTy PREC_BINARY128(FAP_MAX_EXP_SIZE, FAP_MAX_MANT_SIZE);
+
+/// @brief Class for floating point type, up to FAP_MAX_EXP_SIZE bits of
+/// exponent and FAP_MAX_MANT_SIZE bits of mantissa. The conversions to
+/// the native types round to nearest the values that do not enter in them.
 class FloatingPointType {
  public:
   /// \{
@@ -455,6 +516,17 @@ class FloatingPointType {
   void adaptPrec(FloatingPointType&);
   void changePrec(FloatPrecTy);
 
+  /// @brief Significand, with the hidden bit, and exponent of its least
+  /// significant bit, so that the value is (-1)^sign * sig * 2^exp2
+  MantType getSignificand(int& exp2) const;
+
+  /// @brief Build the value (-1)^sign * sig * 2^exp2 rounded on \p prec.
+  /// Subnormal results and overflows are handled as in IEEE 754.
+  /// @param sticky True if there are non-zero bits lower than \p sig
+  static FloatingPointType fromSignificand(
+      SignType sign, MantType sig, int exp2, bool sticky, FloatPrecTy prec,
+      FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+
   static void test(float op1, float op2);
   static void test(double op1, double op2);
 
@@ -463,10 +535,37 @@ class FloatingPointType {
   void round(FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
 
  private:
+  /// @brief The value on the precision \p native of a native type,
+  /// rounded to nearest as the native conversions
+  FloatingPointType toNativePrec(FloatPrecTy native) const;
+  /// @brief Set this to (-1)^sign * sig * 2^exp2 rounded on \p prec
+  void setSignificand(SignType sign, MantType sig, int exp2, bool sticky,
+                      FloatPrecTy prec, FAP_rounding_method method);
+  /// @brief Round the exact result (-1)^sign * sig * 2^exp2 of an operator,
+  /// following the arithmetic context \p ctx
+  template<uint8_t FastMath>
+  void setResult(const ArithmeticState& ctx, SignType sign, MantType sig,
+                 int exp2);
+  /// @brief Give the precision of the arithmetic context to a special result
+  void setSpecialResult(const ArithmeticState& ctx);
+
+  /// \{
+  /// @brief Operators on operands with adapted precisions, \p FastMath are
+  /// the FAP_fast_math_flags compiled in
+  template<uint8_t FastMath>
+  MantType getOperandSignificand(int& exp2) const;
+  template<uint8_t FastMath>
+  void addAdapted(FloatingPointType& rhs, const ArithmeticState& ctx);
+  template<uint8_t FastMath>
+  void mulAdapted(FloatingPointType& rhs, const ArithmeticState& ctx);
+  template<uint8_t FastMath>
+  void divAdapted(FloatingPointType& rhs, const ArithmeticState& ctx);
+  /// \}
+
   ::std::string name; ///< For debug purposes
   SignType sign;  ///< Sign used 1 bit
   ExpType exp;  ///< Exponent on max 16 bit
-  MantType mant;  ///< Mantissa on max 64 bit
+  MantType mant;  ///< Mantissa on max FAP_MAX_MANT_SIZE bits
   uint8_t grs;  ///< Guard, round and sticky bits of the mantissa
   FloatPrecTy prec;  ///< Information about the precision
 };
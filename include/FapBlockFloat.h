@@ -0,0 +1,146 @@
+//===- FapBlockFloat.h ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapBlockFloat.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Block floating point type - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPBLOCKFLOAT_H_
+#define INCLUDE_FAPBLOCKFLOAT_H_
+
+#include "Fap.h"
+
+#include <vector>
+
+/// @brief Shared exponent of the blocks with all the mantissas at zero
+#define FAP_BLOCK_ZERO_EXP            (-(1 << 30))
+
+namespace fap {
+
+/// @brief Block floating point array.
+/// The elements are split in blocks of blockSize values, each one with a
+/// signed integer mantissa of mantSize bits (plus the sign), sharing one
+/// exponent: element i is mant[i] * 2^exp[i / blockSize].
+/// \p MantTy is the storage type of the mantissas, instantiated for int8_t,
+/// int16_t and int32_t, mantSize must be lower than its bit-width.
+template<typename MantTy = int16_t>
+class BlockFloat {
+ public:
+  /// @brief Ctor, \p size elements all zeroes
+  BlockFloat(size_t size = 0, size_t block_size = 32,
+             uint16_t mant_size = sizeof(MantTy) * 8 - 1);
+
+  // Getters
+  size_t size() const {
+    return mants.size();
+  }
+
+  size_t getBlockSize() const {
+    return blockSize;
+  }
+
+  size_t getNumBlocks() const {
+    return exps.size();
+  }
+
+  uint16_t getMantSize() const {
+    return mantSize;
+  }
+
+  MantTy getMant(size_t i) const {
+    return mants[i];
+  }
+
+  int getBlockExp(size_t block) const {
+    return exps[block];
+  }
+
+  const MantTy* getMants() const {
+    return mants.data();
+  }
+
+  /// @brief Resize to \p size elements, setting all of them to zero
+  void resize(size_t size);
+
+  /// \{
+  /// @brief Quantize \p n values, resizing this array.
+  /// NaNs and infinities are not representable, they are quantized to a
+  /// zero that does not take part in the shared exponent.
+  void assign(const double* vals, size_t n,
+              FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+  void assign(const float* vals, size_t n,
+              FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+  void assign(const FloatingPointType* fps, size_t n,
+              FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+  /// \}
+
+  /// \{
+  /// @brief Conversion of all the elements
+  void toDouble(double* out) const;
+  void toFloat(float* out) const;
+  void toFloatingPoint(FloatingPointType* out, FloatPrecTy prec,
+                       FAP_rounding_method method =
+                           FAP_FP_ROUND_NEAREST) const;
+  /// \}
+
+  /// @brief Value of the element \p i, exact if it enters in a double
+  double getDouble(size_t i) const;
+  /// @brief Value of the element \p i rounded on \p prec
+  FloatingPointType get(size_t i, FloatPrecTy prec,
+                        FAP_rounding_method method =
+                            FAP_FP_ROUND_NEAREST) const;
+
+  /// \{
+  /// @brief Element-wise kernels, \p res takes the layout of \p a.
+  /// The mantissas are aligned once per block and the exact result of the
+  /// block is rounded once on the new shared exponent.
+  static void add(const BlockFloat& a, const BlockFloat& b, BlockFloat& res,
+                  FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+  static void sub(const BlockFloat& a, const BlockFloat& b, BlockFloat& res,
+                  FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+  static void mul(const BlockFloat& a, const BlockFloat& b, BlockFloat& res,
+                  FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+  /// \}
+
+  /// @brief Dot product, integer within the blocks and rounded once on
+  /// \p prec, as a LazyFloatingPointType sum
+  static FloatingPointType dot(const BlockFloat& a, const BlockFloat& b,
+                               FloatPrecTy prec);
+
+ private:
+  /// @brief Set the block \p block from exact values wide[j] * 2^exp,
+  /// rounding them on the new shared exponent
+  void setBlock(size_t block, const int64_t* wide, int exp,
+                FAP_rounding_method method);
+  /// @brief Set the block \p block from the values sig[j] * 2^exp2[j]
+  void quantizeBlock(size_t block, const SignType* sign, const MantType* sig,
+                     const int* exp2, FAP_rounding_method method);
+
+  size_t blockSize;  ///< Number of mantissas sharing an exponent
+  uint16_t mantSize;  ///< Size of the mantissas, without sign
+  ::std::vector<MantTy> mants;  ///< Signed mantissas
+  ::std::vector<int> exps;  ///< Shared exponents, one per block
+};
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPBLOCKFLOAT_H_ */
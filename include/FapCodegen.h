@@ -0,0 +1,97 @@
+//===- FapCodegen.h ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapCodegen.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Precision-specialized kernels - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPCODEGEN_H_
+#define INCLUDE_FAPCODEGEN_H_
+
+#include "FapTape.h"
+
+#include <string>
+
+namespace fap {
+
+/// @brief Kernel generated from a Tape of FloatingPointType operations, with
+/// the precisions of its slots and the rounding of the ArithmeticContext of
+/// the caller fixed at the construction. The C++ source has one statement
+/// per slot, calling helpers instantiated on the exponent and mantissa sizes,
+/// so that the biases, masks, shifts and rounding constants are folded by the
+/// compiler. It is compiled by the system compiler ($CXX, or c++) as a shared
+/// object and loaded. The results are the ones of Tape::replay(), with the
+/// values of a set passed as doubles.
+/// The slots have to share the exponent size and fit a double; the context
+/// can neither use the stochastic rounding, nor the fast math flags, nor the
+/// FAP_SPECIAL_SATURATE policy.
+class CompiledKernel {
+ public:
+  typedef Tape<FloatingPointType>::Slot Slot;
+
+  /// @brief Ctor, generate and load the kernel computing \p num_outputs
+  /// slots, \p flags are passed to the compiler
+  CompiledKernel(const Tape<FloatingPointType>& tape, const Slot* outputs,
+                 size_t num_outputs, const ::std::string& flags = "-O2");
+  ~CompiledKernel();
+
+  CompiledKernel(const CompiledKernel&) = delete;
+  CompiledKernel& operator=(const CompiledKernel&) = delete;
+
+  /// @brief C++ source of the kernel of \p tape, which defines
+  /// extern "C" void fap_kernel(const double*, size_t, double*)
+  static ::std::string generate(const Tape<FloatingPointType>& tape,
+                                const Slot* outputs, size_t num_outputs);
+
+  // Getters
+  const ::std::string& getSource() const {
+    return source;
+  }
+
+  size_t getNumInputs() const {
+    return numInputs;
+  }
+
+  size_t getNumOutputs() const {
+    return numOutputs;
+  }
+
+  /// @brief Evaluate \p batch sets, \p inputs holds getNumInputs() values
+  /// for each set, \p results gets getNumOutputs() values for each set. The
+  /// sets are split among \p threads workers (0 for one per core).
+  void run(const double* inputs, size_t batch, double* results,
+           unsigned threads = 0) const;
+
+ private:
+  typedef void (*KernelFnTy)(const double*, size_t, double*);
+
+  ::std::string source;  ///< Generated C++ source
+  size_t numInputs;  ///< Inputs of a set
+  size_t numOutputs;  ///< Outputs of a set
+  size_t numSlots;  ///< Operations of a set
+  void* handle;  ///< Loaded shared object
+  KernelFnTy kernel;  ///< Entry point of the shared object
+};
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPCODEGEN_H_ */
@@ -0,0 +1,132 @@
+//===- FapComplex.h ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapComplex.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Complex numbers - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPCOMPLEX_H_
+#define INCLUDE_FAPCOMPLEX_H_
+
+#include "Fap.h"
+#include "FapFixedPoint.h"
+
+namespace fap {
+
+/// @brief Complex number whose parts are FloatingPointType or FixedPoint.
+/// Each operation on the parts is one of their operators, so the results
+/// follow their precisions and roundings; the multiplication by i and the
+/// conjugate are exact.
+template<typename T>
+class Complex {
+ public:
+  Complex()
+      : re(),
+        im() {
+  }
+
+  Complex(const T& re, const T& im)
+      : re(re),
+        im(im) {
+  }
+
+  // Getters and Setters
+  const T& real() const {
+    return this->re;
+  }
+
+  const T& imag() const {
+    return this->im;
+  }
+
+  void setReal(const T& re) {
+    this->re = re;
+  }
+
+  void setImag(const T& im) {
+    this->im = im;
+  }
+
+  // Arithmetic operators
+  Complex& operator+=(const Complex& rhs) {
+    this->re += rhs.re;
+    this->im += rhs.im;
+    return *this;
+  }
+
+  Complex& operator-=(const Complex& rhs) {
+    this->re -= rhs.re;
+    this->im -= rhs.im;
+    return *this;
+  }
+
+  /// @brief (a + ib)(c + id) = (ac - bd) + i(ad + bc), four products
+  Complex& operator*=(const Complex& rhs) {
+    T re = this->re * rhs.re;
+    re -= this->im * rhs.im;
+    T im = this->re * rhs.im;
+    im += this->im * rhs.re;
+    this->re = re;
+    this->im = im;
+    return *this;
+  }
+
+  friend Complex operator+(Complex lhs, const Complex& rhs) {
+    lhs += rhs;
+    return lhs;
+  }
+  friend Complex operator-(Complex lhs, const Complex& rhs) {
+    lhs -= rhs;
+    return lhs;
+  }
+  friend Complex operator*(Complex lhs, const Complex& rhs) {
+    lhs *= rhs;
+    return lhs;
+  }
+
+  // Unary Operator
+  friend Complex operator-(const Complex& val) {
+    return Complex(-val.re, -val.im);
+  }
+
+  Complex conj() const {
+    return Complex(this->re, -this->im);
+  }
+
+  /// @brief Multiplication by i
+  Complex mulI() const {
+    return Complex(-this->im, this->re);
+  }
+
+  /// @brief Multiplication by -i
+  Complex mulMinusI() const {
+    return Complex(this->im, -this->re);
+  }
+
+ private:
+  T re;  ///< Real part
+  T im;  ///< Imaginary part
+};
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPCOMPLEX_H_ */
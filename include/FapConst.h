@@ -0,0 +1,702 @@
+//===- FapConst.h -----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapConst.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Compile time quantization and arithmetic - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPCONST_H_
+#define INCLUDE_FAPCONST_H_
+
+#include "Fap.h"
+
+#if __cplusplus < 201402L
+#error "FapConst.h requires C++14"
+#endif
+#ifdef __has_builtin
+#if !__has_builtin(__builtin_bit_cast)
+#error "FapConst.h requires __builtin_bit_cast"
+#endif
+#else
+#error "FapConst.h requires __builtin_bit_cast"
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+///@defgroup FAP_CONST_FUNCTIONS FAP Constant expression functions
+/// The shifting and rounding functions of the FloatingPointType, usable in
+/// constant expressions, for the deterministic rounding methods.
+/// @{
+/// @brief fap_clz_ in constant expressions
+constexpr int fap_const_clz_(uint128_t val) {
+  uint64_t high = (uint64_t)(val >> 64);
+  if (high != 0) {
+    return __builtin_clzll(high);
+  }
+  uint64_t low = (uint64_t)val;
+  return low != 0 ? 64 + __builtin_clzll(low) : 128;
+}
+
+/// @brief The stochastic rounding has no generator in constant expressions
+inline bool fap_const_stochastic_() {
+  ::std::cerr << "ConstFloat: the stochastic rounding is not supported";
+  exit(1);
+}
+
+/// @brief fap_shift_right_ in constant expressions
+constexpr void fap_const_shift_right_(uint128_t& bit_vector, int to_shift,
+                                      uint8_t& grs) {
+  bool sticky = (grs & MASK_LOWER_HIGH(uint8_t, to_shift)) != 0x00;
+  if (to_shift < 3) {
+    grs >>= to_shift;
+    grs |= (uint8_t)((bit_vector & MASK_LOWER_HIGH(uint128_t, to_shift))
+                     << (3 - to_shift));
+    grs |= sticky ? 0x01 : 0x00;
+  } else {
+    grs = (uint8_t)((bit_vector >> (to_shift - 3)) &
+                    MASK_LOWER_HIGH(uint8_t, 3));
+    if (((bit_vector & MASK_LOWER_HIGH(uint128_t, (to_shift - 3))) != 0 ||
+         sticky) &&
+        to_shift != 3) {
+      grs |= 0x1;
+    }
+  }
+  bit_vector >>= to_shift;
+}
+
+/// @brief fap_shift_left_ in constant expressions
+constexpr void fap_const_shift_left_(uint128_t& bit_vector, int to_shift,
+                                     uint8_t& grs) {
+  bit_vector <<= to_shift;
+  if (to_shift < 3) {
+    bit_vector |= (uint8_t)((grs & MASK_LOWER_HIGH(uint8_t, 3)) >>
+                            (3 - to_shift));
+  } else {
+    bit_vector |= ((MantType)grs & MASK_LOWER_HIGH(uint8_t, 3))
+                  << (to_shift - 3);
+  }
+  grs = (grs << to_shift) & MASK_LOWER_HIGH(uint8_t, 3);
+}
+
+/// @brief fap_round_up_ in constant expressions
+constexpr bool fap_const_round_up_(bool lsb, uint8_t grs, SignType sign,
+                                   FAP_rounding_method method) {
+  switch (method) {
+  case FAP_FP_ROUND_TOWARD_0:
+    grs = 0;
+    break;
+  case FAP_FP_ROUND_TOWARD_PINF:
+    grs = sign == 0x00 && grs != 0x00 ? 0x07 : 0x00;
+    break;
+  case FAP_FP_ROUND_TOWARD_NINF:
+    grs = sign == 0x01 && grs != 0x00 ? 0x07 : 0x00;
+    break;
+  case FAP_FP_ROUND_STOCHASTIC:
+    return fap_const_stochastic_();
+  default:
+    break;
+  }
+  return (grs == 0x4 && lsb) || grs >= 0x05;
+}
+/// @}
+
+namespace fap {
+
+/// @brief Literal floating point value, with the bit fields of a
+/// FloatingPointType, whose conversions, changes of precision, rounding and
+/// operators are usable in constant expressions, so that the constants can
+/// be quantized by the compiler. The results are the ones of
+/// FloatingPointType: the conversions and changePrec() take the rounding
+/// method the runtime one takes from the ArithmeticContext, and the
+/// operators are the ones of a default context, rounding to nearest. The
+/// stochastic rounding is not supported.
+class ConstFloat {
+ public:
+  /// \{
+  /// \brief Default ctor
+  constexpr ConstFloat()
+      : sign(0),
+        exp(0),
+        mant(0),
+        grs(0),
+        prec(FloatPrecTy()) {
+  }
+
+  /// @brief Conversion from float
+  constexpr ConstFloat(float f, FloatPrecTy n_prec = {FLOAT_EXP_SIZE,
+                           FLOAT_MANT_SIZE},
+                       FAP_rounding_method method = FAP_FP_ROUND_NEAREST)
+      : ConstFloat() {
+    uint32_t bits = __builtin_bit_cast(uint32_t, f);
+    this->prec = FloatPrecTy(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE);
+    this->setSign((SignType)(bits >> (FLOAT_SIZE - FLOAT_SIGN_SIZE)));
+    this->setExp((ExpType)(bits >> FLOAT_MANT_SIZE));
+    this->setMant(bits);
+    this->changePrec(n_prec, method);
+  }
+
+  /// @brief Conversion from double
+  constexpr ConstFloat(double d, FloatPrecTy n_prec = {DOUBLE_EXP_SIZE,
+                           DOUBLE_MANT_SIZE},
+                       FAP_rounding_method method = FAP_FP_ROUND_NEAREST)
+      : ConstFloat() {
+    uint64_t bits = __builtin_bit_cast(uint64_t, d);
+    this->prec = FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+    this->setSign((SignType)(bits >> (DOUBLE_SIZE - DOUBLE_SIGN_SIZE)));
+    this->setExp((ExpType)(bits >> DOUBLE_MANT_SIZE));
+    this->setMant(bits);
+    this->changePrec(n_prec, method);
+  }
+
+  /// @brief Conversion from int
+  constexpr ConstFloat(int i, FloatPrecTy n_prec = {DOUBLE_EXP_SIZE,
+                           DOUBLE_MANT_SIZE},
+                       FAP_rounding_method method = FAP_FP_ROUND_NEAREST)
+      : ConstFloat((double)i, n_prec, method) {
+  }
+  /// \}
+
+  /// \{
+  // Getters and Setters
+  constexpr SignType getSign() const {
+    return (this->sign & MASK_BIT_HIGH(SignType, 0));
+  }
+
+  constexpr void setSign(SignType sign) {
+    this->sign = (sign & MASK_BIT_HIGH(SignType, 0));
+  }
+
+  constexpr ExpType getExp() const {
+    return (this->exp & MASK_LOWER_HIGH(ExpType, this->prec.exp_size));
+  }
+
+  constexpr void setExp(ExpType exp) {
+    this->exp = (exp & MASK_LOWER_HIGH(ExpType, this->prec.exp_size));
+  }
+
+  constexpr MantType getMant() const {
+    return this->mant;
+  }
+
+  constexpr void setMant(MantType mant) {
+    this->mant = (mant & MASK_LOWER_HIGH(MantType, this->prec.mant_size));
+  }
+
+  constexpr uint8_t getGrs() const {
+    return grs;
+  }
+
+  constexpr FloatPrecTy getPrec() const {
+    return prec;
+  }
+  /// \}
+
+  /// @brief The FloatingPointType of the same bits
+  operator FloatingPointType() const {
+    FloatingPointType res;
+    res.setPrec(this->prec);
+    res.setSign(this->sign);
+    res.setExp(this->exp);
+    res.setMant(this->mant);
+    res.setGrs(this->grs);
+    return res;
+  }
+
+  /// \{
+  /// brief Conversions, as the ones of FloatingPointType
+  constexpr explicit operator float() const {
+    if (this->prec.exp_size != FLOAT_EXP_SIZE ||
+        this->prec.mant_size > FLOAT_MANT_SIZE) {
+      return (float)this->toNativePrec(
+          FloatPrecTy(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE));
+    }
+    uint32_t bits = ((uint32_t)this->getSign()
+                     << (FLOAT_SIZE - FLOAT_SIGN_SIZE)) |
+                    ((uint32_t)this->getExp() << FLOAT_MANT_SIZE) |
+                    ((uint32_t)this->getMant()
+                     << (FLOAT_MANT_SIZE - this->prec.mant_size));
+    return __builtin_bit_cast(float, bits);
+  }
+
+  constexpr explicit operator double() const {
+    if (this->prec.exp_size != DOUBLE_EXP_SIZE ||
+        this->prec.mant_size > DOUBLE_MANT_SIZE) {
+      return (double)this->toNativePrec(
+          FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE));
+    }
+    uint64_t bits = ((uint64_t)this->getSign()
+                     << (DOUBLE_SIZE - DOUBLE_SIGN_SIZE)) |
+                    ((uint64_t)this->getExp() << DOUBLE_MANT_SIZE) |
+                    ((uint64_t)this->getMant()
+                     << (DOUBLE_MANT_SIZE - this->prec.mant_size));
+    return __builtin_bit_cast(double, bits);
+  }
+  /// \}
+
+  /// \{
+  // Arithmetic operators, at the minimum precision between the operands
+  constexpr ConstFloat& operator+=(ConstFloat rhs) {
+    this->adaptPrec(rhs);
+    this->addAdapted(rhs);
+    return *this;
+  }
+
+  constexpr ConstFloat& operator-=(ConstFloat rhs) {
+    return *this += -rhs;
+  }
+
+  constexpr ConstFloat& operator*=(ConstFloat rhs) {
+    this->adaptPrec(rhs);
+    this->mulAdapted(rhs);
+    return *this;
+  }
+
+  constexpr ConstFloat& operator/=(ConstFloat rhs) {
+    this->adaptPrec(rhs);
+    this->divAdapted(rhs);
+    return *this;
+  }
+
+  friend constexpr ConstFloat operator+(ConstFloat lhs,
+                                        const ConstFloat& rhs) {
+    return lhs += rhs;
+  }
+
+  friend constexpr ConstFloat operator-(ConstFloat lhs,
+                                        const ConstFloat& rhs) {
+    return lhs -= rhs;
+  }
+
+  friend constexpr ConstFloat operator*(ConstFloat lhs,
+                                        const ConstFloat& rhs) {
+    return lhs *= rhs;
+  }
+
+  friend constexpr ConstFloat operator/(ConstFloat lhs,
+                                        const ConstFloat& rhs) {
+    return lhs /= rhs;
+  }
+
+  friend constexpr ConstFloat operator-(ConstFloat lhs) {
+    lhs.setSign(~lhs.getSign());
+    return lhs;
+  }
+  /// \}
+
+  constexpr bool isZero() const {
+    return (this->getMant() == 0 && this->getExp() == 0);
+  }
+  constexpr bool isInf() const {
+    return (this->getMant() == 0 &&
+            this->getExp() == MASK_LOWER_HIGH(ExpType, this->prec.exp_size));
+  }
+  constexpr bool isNaN() const {
+    return (this->getMant() != 0 &&
+            this->getExp() == MASK_LOWER_HIGH(ExpType, this->prec.exp_size));
+  }
+
+  constexpr void setZero() {
+    this->setExp(0);
+    this->setMant(0);
+  }
+  constexpr void setInf() {
+    this->setMant(0);
+    this->setExp(MASK_LOWER_HIGH(ExpType, this->prec.exp_size));
+  }
+  constexpr void setNaN() {
+    this->setInf();
+    this->setMant(1);
+  }
+
+  /// @brief As FloatingPointType::changePrec(), rounding with \p method
+  constexpr void changePrec(FloatPrecTy new_prec,
+                            FAP_rounding_method method =
+                                FAP_FP_ROUND_NEAREST) {
+    if (this->prec.exp_size < new_prec.exp_size) {
+      FloatPrecTy wide_prec(new_prec.exp_size, this->prec.mant_size);
+      if (this->exp == MASK_LOWER_HIGH(ExpType, this->prec.exp_size)) {
+        this->exp = MASK_LOWER_HIGH(ExpType, wide_prec.exp_size);
+      } else if (this->exp != 0) {
+        this->exp = (ExpType)((int)this->exp -
+                              (int)EXPONENT_BIAS(this->prec.exp_size) +
+                              (int)EXPONENT_BIAS(wide_prec.exp_size));
+      } else if (this->mant != 0) {
+        int exp2 = 0;
+        MantType sig = this->getSignificand(exp2);
+        this->setSignificand(this->getSign(), sig, exp2, this->grs != 0,
+                             wide_prec, FAP_FP_ROUND_NEAREST);
+      }
+      this->prec.exp_size = wide_prec.exp_size;
+    } else if (this->prec.exp_size != new_prec.exp_size) {
+      // The lower bits of the exponent are zeroed, on the same size
+      uint128_t expanded_exp = this->exp;
+      expanded_exp -= EXPONENT_BIAS(this->prec.exp_size);
+      int prec_diff = this->prec.exp_size - new_prec.exp_size;
+      expanded_exp &= MASK_LOWER_LOW(uint128_t, prec_diff);
+      expanded_exp += EXPONENT_BIAS(this->prec.exp_size);
+      this->exp = (ExpType)expanded_exp;
+    }
+
+    if (this->prec.mant_size != new_prec.mant_size) {
+      bool nan = this->isNaN();
+      int prec_diff = this->prec.mant_size - new_prec.mant_size;
+      if (method == FAP_FP_ROUND_STOCHASTIC) {
+        fap_const_stochastic_();
+      }
+      if (prec_diff > 0) {
+        fap_const_shift_right_(this->mant, prec_diff, this->grs);
+      } else if (prec_diff < 0) {
+        fap_const_shift_left_(this->mant, -prec_diff, this->grs);
+      }
+      this->prec.mant_size = new_prec.mant_size;
+      if (prec_diff > 0) {
+        this->round(method);
+        if (nan) {
+          this->setNaN();
+        }
+      }
+    }
+  }
+
+  /// @brief As FloatingPointType::round()
+  constexpr void round(FAP_rounding_method method = FAP_FP_ROUND_NEAREST) {
+    if (fap_const_round_up_((this->mant & MASK_BIT_HIGH(MantType, 0)) != 0,
+                            this->grs, this->getSign(), method)) {
+      this->mant += 0x1;
+    }
+    if ((this->mant & MASK_BIT_HIGH(MantType, this->prec.mant_size)) !=
+        (MantType)0) {
+      this->exp += 0x1;
+    }
+    this->grs = 0x00;
+    this->setMant(this->mant);
+  }
+
+ private:
+  constexpr void adaptPrec(ConstFloat& rhs) {
+    FloatPrecTy min_prec(
+        this->prec.exp_size < rhs.prec.exp_size ? this->prec.exp_size
+                                                : rhs.prec.exp_size,
+        this->prec.mant_size < rhs.prec.mant_size ? this->prec.mant_size
+                                                  : rhs.prec.mant_size);
+    this->changePrec(min_prec);
+    rhs.changePrec(min_prec);
+  }
+
+  constexpr MantType getSignificand(int& exp2) const {
+    int bias = EXPONENT_BIAS(this->prec.exp_size);
+    if (this->getExp() == 0) {
+      exp2 = 1 - bias - this->prec.mant_size;
+      return this->getMant();
+    }
+    exp2 = (int)this->getExp() - bias - this->prec.mant_size;
+    return MASK_BIT_HIGH(MantType, this->prec.mant_size) | this->getMant();
+  }
+
+  /// @brief As FloatingPointType::setSignificand()
+  constexpr void setSignificand(SignType sign, MantType sig, int exp2,
+                                bool sticky, FloatPrecTy prec,
+                                FAP_rounding_method method) {
+    this->prec = prec;
+    this->setSign(sign);
+    this->setExp(0);
+    if (sig == 0) {
+      this->mant = 0;
+      this->grs = sticky ? 0x01 : 0x00;
+      this->round(method);
+      return;
+    }
+
+    int bias = EXPONENT_BIAS(prec.exp_size);
+    int max_exp = MASK_LOWER_HIGH(ExpType, prec.exp_size);
+    int msb = (sizeof(MantType) * 8 - 1) - fap_const_clz_(sig);
+    int64_t biased_exp = (int64_t)exp2 + msb + bias;
+    int64_t to_shift = msb - prec.mant_size;
+    if (biased_exp < 1) {
+      to_shift = (int64_t)(1 - bias - prec.mant_size) - exp2;
+      biased_exp = 0;
+    }
+    if (method == FAP_FP_ROUND_STOCHASTIC) {
+      fap_const_stochastic_();
+    }
+
+    if (biased_exp >= max_exp) {
+      if (method == FAP_FP_ROUND_NEAREST ||
+          (method == FAP_FP_ROUND_TOWARD_PINF && this->getSign() == 0) ||
+          (method == FAP_FP_ROUND_TOWARD_NINF && this->getSign() != 0)) {
+        this->setInf();
+      } else {
+        this->setExp(max_exp - 1);
+        this->setMant(MASK_LOWER_HIGH(MantType, prec.mant_size));
+      }
+      this->grs = 0x00;
+      return;
+    }
+
+    uint8_t grs = 0x00;
+    if (to_shift >= (int64_t)(sizeof(MantType) * 8)) {
+      // Only the msb can be the guard bit, the others are sticky
+      int top = sizeof(MantType) * 8 - 1;
+      bool guard = to_shift == top + 1 && (sig >> top) != 0;
+      MantType rest = guard ? sig << 1 : sig;
+      grs = (guard ? 0x04 : 0x00) | (rest != 0 ? 0x01 : 0x00);
+      sig = 0;
+    } else if (to_shift > 0) {
+      fap_const_shift_right_(sig, to_shift, grs);
+    } else if (to_shift < 0) {
+      sig <<= -to_shift;
+    }
+    if (sticky) {
+      grs |= 0x01;
+    }
+    this->exp = (ExpType)biased_exp;
+    this->setMant(sig);
+    this->grs = grs;
+    this->round(method);
+  }
+
+  /// @brief The value on the precision \p native, rounded to nearest
+  constexpr ConstFloat toNativePrec(FloatPrecTy native) const {
+    ConstFloat res;
+    res.prec = native;
+    res.setSign(this->getSign());
+    if (this->isZero()) {
+      return res;
+    }
+    if (this->isNaN()) {
+      res.setNaN();
+    } else if (this->isInf()) {
+      res.setInf();
+    } else {
+      int exp2 = 0;
+      MantType sig = this->getSignificand(exp2);
+      res.setSignificand(this->getSign(), sig, exp2, false, native,
+                         FAP_FP_ROUND_NEAREST);
+    }
+    return res;
+  }
+
+  /// \{
+  /// @brief The operations on the adapted precisions, as the ones of
+  /// FloatingPointType without fast math flags
+  constexpr void addAdapted(const ConstFloat& rhs) {
+    if (this->isNaN() || rhs.isNaN()) {
+      this->setNaN();
+      return;
+    }
+    if (this->isInf() || rhs.isInf()) {
+      if (this->isInf() && rhs.isInf() &&
+          this->getSign() != rhs.getSign()) {
+        this->setNaN();
+      } else if (rhs.isInf()) {
+        this->setInf();
+        this->setSign(rhs.getSign());
+      }
+      return;
+    }
+
+    int lhs_exp2 = 0, rhs_exp2 = 0;
+    MantType lhs_sig = this->getSignificand(lhs_exp2);
+    MantType rhs_sig = rhs.getSignificand(rhs_exp2);
+    SignType lhs_sign = this->getSign(), rhs_sign = rhs.getSign();
+    if (lhs_exp2 < rhs_exp2) {
+      MantType sig = lhs_sig;
+      lhs_sig = rhs_sig;
+      rhs_sig = sig;
+      int exp2 = lhs_exp2;
+      lhs_exp2 = rhs_exp2;
+      rhs_exp2 = exp2;
+      SignType sign = lhs_sign;
+      lhs_sign = rhs_sign;
+      rhs_sign = sign;
+    }
+    int exp_diff = lhs_exp2 - rhs_exp2;
+    int room = (sizeof(MantType) * 8 - 2) - (this->prec.mant_size + 1);
+    int to_shift = exp_diff < room ? exp_diff : room;
+    lhs_sig <<= to_shift;
+    lhs_exp2 -= to_shift;
+    exp_diff -= to_shift;
+    if (exp_diff >= (int)(sizeof(MantType) * 8)) {
+      rhs_sig = rhs_sig != 0 ? 0x01 : 0x00;
+    } else if (exp_diff > 0) {
+      bool lost = (rhs_sig & MASK_LOWER_HIGH(MantType, exp_diff)) != 0;
+      rhs_sig = (rhs_sig >> exp_diff) | (lost ? 0x01 : 0x00);
+    }
+
+    MantType res_sig = 0;
+    SignType res_sign = lhs_sign;
+    if (lhs_sign == rhs_sign) {
+      res_sig = lhs_sig + rhs_sig;
+    } else if (lhs_sig >= rhs_sig) {
+      res_sig = lhs_sig - rhs_sig;
+    } else {
+      res_sign = rhs_sign;
+      res_sig = rhs_sig - lhs_sig;
+    }
+    if (res_sig == 0 && lhs_sign != rhs_sign) {
+      res_sign = 0;
+    }
+    this->setSignificand(res_sign, res_sig, lhs_exp2, false, this->prec,
+                         FAP_FP_ROUND_NEAREST);
+  }
+
+  constexpr void mulAdapted(const ConstFloat& rhs) {
+    if (this->isNaN() || rhs.isNaN()) {
+      this->setNaN();
+      return;
+    }
+    if (this->isInf() || rhs.isInf()) {
+      this->setSign(this->getSign() ^ rhs.getSign());
+      if (this->isZero() || rhs.isZero()) {
+        this->setNaN();
+      } else {
+        this->setInf();
+      }
+      return;
+    }
+
+    // The product on 256 bits, its lower half jammed in the lsb of the
+    // upper one
+    int lhs_exp2 = 0, rhs_exp2 = 0;
+    MantType lhs_sig = this->getSignificand(lhs_exp2);
+    MantType rhs_sig = rhs.getSignificand(rhs_exp2);
+    int exp2 = lhs_exp2 + rhs_exp2;
+    uint128_t lhs_hi = lhs_sig >> 64, rhs_hi = rhs_sig >> 64;
+    uint128_t lhs_lo = (uint64_t)lhs_sig, rhs_lo = (uint64_t)rhs_sig;
+    uint128_t lo = lhs_lo * rhs_lo;
+    uint128_t mid_1 = lhs_hi * rhs_lo, mid_2 = lhs_lo * rhs_hi;
+    uint128_t hi = lhs_hi * rhs_hi;
+    uint128_t mid = (lo >> 64) + (uint64_t)mid_1 + (uint64_t)mid_2;
+    hi += (mid_1 >> 64) + (mid_2 >> 64) + (mid >> 64);
+    lo = (mid << 64) | (uint64_t)lo;
+    MantType prod = lo;
+    if (hi != 0) {
+      int to_shift = (int)(sizeof(uint128_t) * 8) - fap_const_clz_(hi);
+      bool sticky = (lo & MASK_LOWER_HIGH(uint128_t, to_shift)) != 0;
+      prod = to_shift == (int)(sizeof(uint128_t) * 8)
+                 ? hi
+                 : (hi << (sizeof(uint128_t) * 8 - to_shift)) |
+                       (lo >> to_shift);
+      prod |= sticky ? 0x01 : 0x00;
+      exp2 += to_shift;
+    }
+    this->setSignificand(this->getSign() ^ rhs.getSign(), prod, exp2, false,
+                         this->prec, FAP_FP_ROUND_NEAREST);
+  }
+
+  constexpr void divAdapted(const ConstFloat& rhs) {
+    SignType sign = this->getSign() ^ rhs.getSign();
+    if (this->isNaN() || rhs.isNaN()) {
+      this->setNaN();
+      return;
+    }
+    if (this->isInf()) {
+      this->setSign(sign);
+      if (rhs.isInf()) {
+        this->setNaN();
+      }
+      return;
+    }
+    if (rhs.isInf()) {
+      this->setSign(sign);
+      this->setZero();
+      return;
+    }
+
+    int lhs_exp2 = 0, rhs_exp2 = 0;
+    MantType lhs_sig = this->getSignificand(lhs_exp2);
+    MantType rhs_sig = rhs.getSignificand(rhs_exp2);
+    if (rhs_sig == 0) {
+      this->setSign(sign);
+      if (lhs_sig == 0) {
+        this->setNaN();
+      } else {
+        this->setInf();
+      }
+      return;
+    }
+    if (lhs_sig == 0) {
+      this->setSignificand(sign, 0, 0, false, this->prec,
+                           FAP_FP_ROUND_NEAREST);
+      return;
+    }
+
+    // Restoring division on the significands aligned on the bit 125, the
+    // mantissa, the hidden bit and two more, the remainder gives the
+    // sticky bit
+    int lhs_shift = fap_const_clz_(lhs_sig) - 2;
+    int rhs_shift = fap_const_clz_(rhs_sig) - 2;
+    lhs_sig <<= lhs_shift;
+    rhs_sig <<= rhs_shift;
+    int bits = this->prec.mant_size + 4;
+    MantType quot = 0;
+    for (int b = 0; b < bits; ++b) {
+      quot <<= 1;
+      if (lhs_sig >= rhs_sig) {
+        lhs_sig -= rhs_sig;
+        quot |= 0x01;
+      }
+      lhs_sig <<= 1;
+    }
+    quot |= lhs_sig != 0 ? 0x01 : 0x00;
+    this->setSignificand(
+        sign, quot, lhs_exp2 - rhs_exp2 - lhs_shift + rhs_shift - (bits - 1),
+        false, this->prec, FAP_FP_ROUND_NEAREST);
+  }
+  /// \}
+
+  SignType sign;  ///< Sign used 1 bit
+  ExpType exp;  ///< Exponent on max 16 bit
+  MantType mant;  ///< Mantissa on max FAP_MAX_MANT_SIZE bits
+  uint8_t grs;  ///< Guard, round and sticky bits of the mantissa
+  FloatPrecTy prec;  ///< Information about the precision
+};
+
+/// @brief Table of N constants quantized by quantizeTable()
+template<size_t N>
+struct ConstFloatTable {
+  constexpr const ConstFloat& operator[](size_t i) const {
+    return vals[i];
+  }
+
+  constexpr size_t size() const {
+    return N;
+  }
+
+  ConstFloat vals[N];
+};
+
+/// @brief The values \p vals quantized on \p prec, at compile time when
+/// the result is constexpr, e.g. the coefficients of a filter
+template<size_t N>
+constexpr ConstFloatTable<N> quantizeTable(
+    const double (&vals)[N], FloatPrecTy prec,
+    FAP_rounding_method method = FAP_FP_ROUND_NEAREST) {
+  ConstFloatTable<N> table{};
+  for (size_t i = 0; i < N; ++i) {
+    table.vals[i] = ConstFloat(vals[i], prec, method);
+  }
+  return table;
+}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPCONST_H_ */
@@ -0,0 +1,179 @@
+//===- FapContext.h ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapContext.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Thread-local arithmetic context - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPCONTEXT_H_
+#define INCLUDE_FAPCONTEXT_H_
+
+#include "Fap.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+/// @brief Entries of the cache of each thread for
+/// ArithmeticContext::setMemoization()
+#ifndef FAP_MEMO_DEFAULT_ENTRIES
+#define FAP_MEMO_DEFAULT_ENTRIES      4096
+#endif
+
+/// @brief Special values policies
+typedef enum {
+  FAP_SPECIAL_IEEE = 0,  ///< Overflows give infinity, as IEEE 754
+  FAP_SPECIAL_SATURATE  ///< Overflows give the greatest finite value
+} FAP_special_policy;
+
+/// @brief Fast math flags, they can be combined
+typedef enum {
+  FAP_FAST_MATH_NONE = 0,
+  FAP_FAST_MATH_FTZ = 0x1,  ///< Subnormal results are flushed to zero
+  FAP_FAST_MATH_DAZ = 0x2,  ///< Subnormal operands are zeroes
+  /// Operands are finite, the NaN and infinity checks are skipped. The
+  /// results saturate on the greatest finite value, 0/0 gives 0
+  FAP_FAST_MATH_FINITE = 0x4,
+  FAP_FAST_MATH_ALL = 0x7
+} FAP_fast_math_flags;
+
+namespace fap {
+
+/// @brief Settings of the arithmetic of the FloatingPointType
+struct ArithmeticState {
+  FAP_rounding_method rounding;  ///< Rounding of the operations
+  FAP_special_policy special;  ///< Policy for the special values
+  uint8_t fastMath;  ///< FAP_fast_math_flags of the operations
+  bool hasResultPrec;  ///< If the results are rounded on resultPrec
+  FloatPrecTy resultPrec;  ///< Precision of the results
+  /// Entries of the memoization cache of each thread, 0 without
+  /// memoization, see FapMemo.h
+  uint32_t memoEntries;
+};
+
+/// @brief Scoped arithmetic context of the calling thread.
+/// While an object is alive the FloatingPointType operators and
+/// changePrec() of the thread use its rounding method and special values
+/// policy. With a result precision the exact result of the operators is
+/// rounded once on it, in place of the precision of the operands: the
+/// mantissa gets the result one, while the exponent is reduced as in
+/// changePrec(). The memoization does not change the results, a nested
+/// context keeps the one of the enclosing context. The previous context is
+/// restored by the destructor, so the contexts can be nested.
+class ArithmeticContext {
+ public:
+  /// @brief Ctor, results on the precision of the operands
+  explicit ArithmeticContext(FAP_rounding_method rounding,
+                             FAP_special_policy special = FAP_SPECIAL_IEEE);
+  /// @brief Ctor, results rounded on \p result_prec
+  ArithmeticContext(FAP_rounding_method rounding, FloatPrecTy result_prec,
+                    FAP_special_policy special = FAP_SPECIAL_IEEE);
+  /// @brief Ctor, the settings of another thread, fast math included
+  explicit ArithmeticContext(const ArithmeticState& settings);
+  ~ArithmeticContext();
+
+  ArithmeticContext(const ArithmeticContext&) = delete;
+  ArithmeticContext& operator=(const ArithmeticContext&) = delete;
+
+  /// @brief Settings in use by the calling thread
+  static const ArithmeticState& current() {
+    return state;
+  }
+
+  /// @brief Set the FAP_fast_math_flags while this context is alive
+  void setFastMath(uint8_t flags) {
+    state.fastMath = flags & FAP_FAST_MATH_ALL;
+  }
+
+  /// @brief Memoize the results of the operators in a cache of \p entries
+  /// entries for each thread while this context is alive, 0 to stop
+  void setMemoization(uint32_t entries = FAP_MEMO_DEFAULT_ENTRIES) {
+    state.memoEntries = entries;
+  }
+
+ private:
+  ArithmeticState saved;  ///< Settings of the enclosing context
+  static thread_local ArithmeticState state;  ///< Settings of the thread
+};
+
+/// @brief Number of workers for \p units of work: \p threads (0 for one
+/// per core), no more than the units and than \p max_workers, the ones the
+/// work is worth, at least one
+inline size_t shareWorkers(size_t units, size_t max_workers,
+                           unsigned threads) {
+  size_t workers = threads != 0 ? threads
+                                : ::std::thread::hardware_concurrency();
+  workers = ::std::min(workers, ::std::min(units, max_workers));
+  return ::std::max(workers, (size_t)1);
+}
+
+/// @brief Bounds of \p n units split evenly among shareWorkers() workers,
+/// for parallelShares()
+inline ::std::vector<size_t> evenShares(size_t n, size_t max_workers,
+                                        unsigned threads) {
+  size_t workers = shareWorkers(n, max_workers, threads);
+  ::std::vector<size_t> bounds(workers + 1);
+  for (size_t w = 0; w <= workers; ++w) {
+    bounds[w] = n * w / workers;
+  }
+  return bounds;
+}
+
+/// @brief Call fn(bounds[w], bounds[w + 1]) for each share w, on a worker
+/// thread each when there is more than one. The workers take the context of
+/// the caller and, with the stochastic rounding, a generator seeded from the
+/// one of the caller, so that the results do not depend on the scheduling
+template<typename FnTy>
+void parallelShares(const ::std::vector<size_t>& bounds, FnTy fn) {
+  size_t workers = bounds.size() - 1;
+  if (workers <= 1) {
+    fn(bounds.front(), bounds.back());
+    return;
+  }
+
+  const ArithmeticState& state = ArithmeticContext::current();
+  ::std::vector<uint64_t> seeds(workers);
+  if (state.rounding == FAP_FP_ROUND_STOCHASTIC) {
+    for (size_t w = 0; w < workers; ++w) {
+      seeds[w] = fap_stochastic_bits_();
+    }
+  }
+  ::std::vector< ::std::thread> pool;
+  for (size_t w = 0; w < workers; ++w) {
+    size_t begin = bounds[w], end = bounds[w + 1];
+    uint64_t seed = seeds[w];
+    pool.push_back(::std::thread([&state, &fn, begin, end, seed, w]() {
+      ArithmeticContext ctx(state);
+      if (state.rounding == FAP_FP_ROUND_STOCHASTIC) {
+        fap_stochastic_seed(seed, w);
+      }
+      fn(begin, end);
+    }));
+  }
+  for (size_t w = 0; w < pool.size(); ++w) {
+    pool[w].join();
+  }
+}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPCONTEXT_H_ */
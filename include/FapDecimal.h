@@ -0,0 +1,80 @@
+//===- FapDecimal.h ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapDecimal.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Decimal formatting and parsing of FloatingPointType - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPDECIMAL_H_
+#define INCLUDE_FAPDECIMAL_H_
+
+#include "Fap.h"
+
+#include <string>
+#include <vector>
+
+/// @brief Size of a buffer that can hold any formatted FloatingPointType
+#define FAP_DECIMAL_BUFFER_SIZE       64
+
+namespace fap {
+
+/// @defgroup FAP_DECIMAL Decimal conversions
+/// The conversions work directly on the precision of the FloatingPointType,
+/// without passing through double, so they support every FloatPrecTy.
+/// @{
+
+/// @brief Write in \p buf the shortest decimal string that is parsed back
+/// to \p fp (with the nearest rounding), returning its length.
+/// The string is null terminated, \p buf must have at least
+/// FAP_DECIMAL_BUFFER_SIZE bytes.
+size_t formatDecimal(const FloatingPointType& fp, char* buf);
+
+/// @brief Shortest round-trip decimal string of \p fp
+::std::string toDecimalString(const FloatingPointType& fp);
+
+/// @brief Append to \p out the decimal strings of the \p n values in \p fps,
+/// separated by \p sep
+void formatDecimal(const FloatingPointType* fps, size_t n, ::std::string& out,
+                   char sep = ',');
+
+/// @brief Parse a decimal string, correctly rounded on \p prec.
+/// Accepts an optional sign, digits with an optional radix point and
+/// exponent, "inf", "infinity" and "nan" (case insensitive).
+/// @param end If not null, it is set after the last parsed character, to
+///            \p str if nothing was parsed
+FloatingPointType parseDecimal(const char* str, FloatPrecTy prec,
+                               FAP_rounding_method method =
+                                   FAP_FP_ROUND_NEAREST,
+                               const char** end = nullptr);
+
+/// @brief Parse the values of the first \p len characters of \p str,
+/// separated by \p sep, new lines or spaces, appending them to \p out.
+/// It stops at the first malformed value.
+/// @return The number of parsed values
+size_t parseDecimal(const char* str, size_t len, FloatPrecTy prec,
+                    ::std::vector<FloatingPointType>& out, char sep = ',',
+                    FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+/// @}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPDECIMAL_H_ */
@@ -0,0 +1,66 @@
+//===- FapDispatch.h --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapDispatch.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Precision dispatch of the batch operations - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPDISPATCH_H_
+#define INCLUDE_FAPDISPATCH_H_
+
+#include "Fap.h"
+
+/// @brief Element-wise operations of the batches
+typedef enum {
+  FAP_BATCH_ADD = 0,
+  FAP_BATCH_SUB,
+  FAP_BATCH_MUL,
+  FAP_BATCH_DIV
+} FAP_batch_op;
+
+namespace fap {
+
+/// \{
+/// @brief res[i] = lhs[i] op rhs[i] for \p n elements, with the results of
+/// the operators in the ArithmeticContext of the caller; the names of \p res
+/// are kept. The precision of the elements selects, through a jump table,
+/// a kernel instantiated on it, with its constants folded: for the
+/// FloatingPointType the exponent sizes built in the library (5, 8 and 11 by
+/// default) with any mantissa up to 52 bits, for the IntegerType the
+/// neglected bits up to 64. The elements whose operands have other or
+/// different precisions, and the contexts with the stochastic rounding, the
+/// fast math flags, the FAP_SPECIAL_SATURATE policy or another result
+/// precision, use the operators. The elements are split among \p threads
+/// workers (0 for one per core).
+void batchOp(FAP_batch_op op, const FloatingPointType* lhs,
+             const FloatingPointType* rhs, FloatingPointType* res, size_t n,
+             unsigned threads = 0);
+void batchOp(FAP_batch_op op, const IntegerType* lhs, const IntegerType* rhs,
+             IntegerType* res, size_t n, unsigned threads = 0);
+/// \}
+
+/// @brief If the operations on \p prec have a specialized kernel
+bool hasSpecializedKernel(FloatPrecTy prec);
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPDISPATCH_H_ */
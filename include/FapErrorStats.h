@@ -0,0 +1,194 @@
+//===- FapErrorStats.h ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapErrorStats.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Streaming error statistics against a double reference - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPERRORSTATS_H_
+#define INCLUDE_FAPERRORSTATS_H_
+
+#include "FapContext.h"
+
+#include <algorithm>
+#include <vector>
+
+/// @brief Bins of the ULP histogram: the exact results, the errors up to
+/// 1/2 ULP, a bin for each following power of two and the greater or non
+/// finite errors
+#ifndef FAP_ERROR_ULP_BINS
+#define FAP_ERROR_ULP_BINS            64
+#endif
+
+/// @brief Samples evaluated by each call of the kernels of measureError()
+#ifndef FAP_ERROR_BLOCK
+#define FAP_ERROR_BLOCK               1024
+#endif
+
+/// @brief Minimum samples for each worker of measureError()
+#ifndef FAP_ERROR_THREAD_WORK
+#define FAP_ERROR_THREAD_WORK         (1 << 16)
+#endif
+
+namespace fap {
+
+/// @brief One-pass statistics of the errors out - ref of a stream of
+/// outputs against their double reference, on constant memory. The mean
+/// and the variance of the error are updated as in Welford's algorithm,
+/// the mean squares as running means, and the statistics of two streams
+/// are merged exactly, so that the shares of a stream can be processed
+/// apart. The ULPs are the ones of the reference on the precision given
+/// to the ctor.
+/// A NaN or infinite output with a different reference is a non finite
+/// error: it is left out of the moments, but it makes the maximum errors
+/// and the mean square error infinite. The same infinity or NaN as the
+/// reference is an exact result, out of the moments too.
+class ErrorStats {
+ public:
+  /// @brief Ctor, ULPs measured on \p prec
+  explicit ErrorStats(FloatPrecTy prec = FloatPrecTy(DOUBLE_EXP_SIZE,
+                                                     DOUBLE_MANT_SIZE));
+
+  /// @brief Account the output \p out of the reference \p ref
+  void add(double out, double ref);
+
+  /// @brief Account \p n outputs, summed apart and merged as a stream
+  void add(const double* out, const double* ref, size_t n);
+
+  /// @brief Account the samples of \p other, on the same precision
+  void merge(const ErrorStats& other);
+
+  /// \{
+  // Getters
+  FloatPrecTy getPrec() const {
+    return prec;
+  }
+
+  /// @brief Outputs accounted, non finite errors included
+  uint64_t getCount() const {
+    return count;
+  }
+
+  uint64_t getNonFinite() const {
+    return nonFinite;
+  }
+
+  /// @brief Mean of the signed finite errors, the bias
+  double getMeanError() const {
+    return meanErr;
+  }
+
+  /// @brief Variance of the signed finite errors
+  double getErrorVariance() const;
+
+  /// @brief Mean square error
+  double getMse() const;
+
+  double getRmse() const;
+
+  double getMaxAbs() const {
+    return maxAbs;
+  }
+
+  /// @brief Largest |out - ref| / |ref|, infinite for an error on a zero
+  /// reference
+  double getMaxRel() const {
+    return maxRel;
+  }
+
+  /// @brief ||out - ref||_2 / ||ref||_2, ||out - ref||_2 for a zero
+  /// reference
+  double getNormRel() const;
+
+  /// @brief 10 log10(||ref||^2 / ||out - ref||^2), in dB
+  double getSnr() const;
+
+  /// @brief Outputs in the ULP bin \p bin
+  uint64_t getUlpCount(int bin) const {
+    return ulpHist[bin];
+  }
+  /// \}
+
+  /// @brief Greatest error of the ULP bin \p bin, in ULPs: 0 for the exact
+  /// results, 2^(bin - 2) for the following ones, infinity for the last one
+  static double ulpBinBound(int bin);
+
+ private:
+  /// @brief Account the error \p err of \p out in the maximums and in the
+  /// ULP histogram, false if it does not enter the moments
+  bool account(double out, double ref, double err);
+
+  FloatPrecTy prec;  ///< Precision of the ULPs
+  uint64_t count;  ///< Outputs, non finite errors included
+  uint64_t nonFinite;  ///< Non finite errors
+  uint64_t momentCount;  ///< Finite errors, in the moments
+  double meanErr;  ///< Running mean of the finite errors
+  double m2Err;  ///< Sum of the squared deviations from meanErr
+  double meanSqErr;  ///< Running mean of the squared finite errors
+  double meanSqRef;  ///< Running mean of the squared references
+  double maxAbs;  ///< Largest absolute error
+  double maxRel;  ///< Largest relative error
+  uint64_t ulpHist[FAP_ERROR_ULP_BINS];  ///< Outputs in each ULP bin
+};
+
+/// @brief Error statistics of a kernel against its double reference over
+/// \p samples input samples, each giving \p outputs doubles.
+/// reference(first, n, out) and approx(first, n, out) fill out with the
+/// n * outputs outputs of the samples first ... first + n - 1, the former
+/// on doubles, the latter with the FAP types. The inputs have to be derived
+/// from the sample indexes, so that the stream is split among \p threads
+/// workers (0 for one per core), which evaluate FAP_ERROR_BLOCK samples at
+/// a time in their own statistics, merged at the end in the order of the
+/// shares. The workers take the context of the caller, as parallelShares().
+template<typename RefFnTy, typename ApproxFnTy>
+ErrorStats measureError(uint64_t samples, size_t outputs, FloatPrecTy prec,
+                        RefFnTy reference, ApproxFnTy approx,
+                        unsigned threads = 0) {
+  ::std::vector<size_t> bounds = evenShares(
+      (size_t)samples, (size_t)(samples / FAP_ERROR_THREAD_WORK), threads);
+  size_t workers = bounds.size() - 1;
+
+  ::std::vector<ErrorStats> shares(workers, ErrorStats(prec));
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    size_t share =
+        ::std::upper_bound(bounds.begin(), bounds.end() - 1, begin) -
+        bounds.begin() - 1;
+    ErrorStats& stats = shares[share];
+    ::std::vector<double> ref(FAP_ERROR_BLOCK * outputs);
+    ::std::vector<double> out(FAP_ERROR_BLOCK * outputs);
+    for (size_t first = begin; first < end; first += FAP_ERROR_BLOCK) {
+      size_t n = ::std::min((size_t)FAP_ERROR_BLOCK, end - first);
+      reference((uint64_t)first, n, ref.data());
+      approx((uint64_t)first, n, out.data());
+      stats.add(out.data(), ref.data(), n * outputs);
+    }
+  });
+
+  for (size_t w = 1; w < workers; ++w) {
+    shares[0].merge(shares[w]);
+  }
+  return shares[0];
+}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPERRORSTATS_H_ */
@@ -0,0 +1,109 @@
+//===- FapFft.h -------------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapFft.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Fast Fourier transform - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPFFT_H_
+#define INCLUDE_FAPFFT_H_
+
+#include "FapComplex.h"
+
+#include <memory>
+#include <vector>
+
+namespace fap {
+
+/// @brief Precision type of the parts of a Complex
+template<typename T>
+struct FftPrec;
+
+template<>
+struct FftPrec<FloatingPointType> {
+  typedef FloatPrecTy Ty;
+};
+
+template<>
+struct FftPrec<FixedPoint> {
+  typedef FixedPrecTy Ty;
+};
+
+/// @brief Fast Fourier transform of a power of two size, in place.
+/// The transform is iterative: a bit reversal, a radix-2 stage when the
+/// size is an odd power of two, then radix-4 stages. The twiddle factors are
+/// quantized once on the precision of the plan, by the nearest rounding; the
+/// butterflies use the operators of the parts, skipping the products by 1
+/// and by +-i, which are exact. The inverse transform is not scaled.
+template<typename T>
+class FftPlan {
+ public:
+  typedef typename FftPrec<T>::Ty PrecTy;
+
+  FftPlan(size_t n, PrecTy prec, bool inverse = false);
+
+  /// @brief Plan shared by all the threads, built at the first request of
+  /// a size, precision and direction
+  static ::std::shared_ptr<const FftPlan> get(size_t n, PrecTy prec,
+                                              bool inverse = false);
+
+  // Getters
+  size_t size() const {
+    return n;
+  }
+
+  PrecTy getPrec() const {
+    return prec;
+  }
+
+  bool isInverse() const {
+    return inverse;
+  }
+
+  /// @brief Transform of the \p n values of \p data
+  void execute(Complex<T>* data) const;
+  /// @brief Transform of \p batch contiguous arrays of \p n values, split
+  /// among \p threads workers (0 for one per core), which use the
+  /// ArithmeticContext of the caller
+  void execute(Complex<T>* data, size_t batch, unsigned threads = 0) const;
+
+ private:
+  size_t n;  ///< Size of the transform
+  int log2n;  ///< log2 of the size
+  PrecTy prec;  ///< Precision of the twiddle factors
+  bool inverse;  ///< If the transform is the inverse one
+  ::std::vector<Complex<T> > twiddles;  ///< exp(-+2 pi i j / n), j < 3n / 4
+  ::std::vector<uint32_t> swaps;  ///< Pairs of the bit reversal
+};
+
+/// \{
+/// @brief Transform of \p batch contiguous arrays of \p n values with the
+/// shared plan of the precision of data[0]
+void fft(Complex<FloatingPointType>* data, size_t n, size_t batch = 1,
+         bool inverse = false, unsigned threads = 0);
+void fft(Complex<FixedPoint>* data, size_t n, size_t batch = 1,
+         bool inverse = false, unsigned threads = 0);
+/// \}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPFFT_H_ */
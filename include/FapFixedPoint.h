@@ -0,0 +1,237 @@
+//===- FapFixedPoint.h ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapFixedPoint.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Fixed point (Q format) type - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPFIXEDPOINT_H_
+#define INCLUDE_FAPFIXEDPOINT_H_
+
+#include "Fap.h"
+
+/// @brief Maximum size of a fixed point value, sign included
+#define FIXED_MAX_SIZE                63
+
+/// @brief Overflow methods
+typedef enum {
+  FAP_FX_OVERFLOW_SATURATE = 0,
+  FAP_FX_OVERFLOW_WRAP
+} FAP_overflow_method;
+
+namespace fap {
+
+/// @brief Fixed point precision type, Qint_size.frac_size plus the sign bit
+struct FixedPrecTy {
+  /// @brief Ctor
+  FixedPrecTy(uint8_t i_size = 0, uint8_t f_size = 0)
+      : int_size(i_size),
+        frac_size(f_size) {
+  }
+
+  uint8_t int_size;  ///< Size of the integer part, without sign
+  uint8_t frac_size;  ///< Size of the fractional part
+};
+
+/// @brief Class for fixed point type.
+/// The value is bits * 2^-frac_size, stored on a native integer.
+/// As for IntegerType, the lowest neglected bits of the value can be
+/// zeroed, or considered at half value when the compensation is enabled.
+class FixedPoint {
+ public:
+  /// \{
+  /// \brief Default ctor
+  FixedPoint()
+      : bits(0),
+        prec(FixedPrecTy()),
+        neglectedBits(0),
+        neglectedBitsStatus(0),
+        compensate(false),
+        rounding(FAP_FP_ROUND_NEAREST),
+        overflow(FAP_FX_OVERFLOW_SATURATE) {
+  }
+
+  /// @brief Conversion from double
+  FixedPoint(double d, FixedPrecTy n_prec,
+             FAP_rounding_method r = FAP_FP_ROUND_NEAREST,
+             FAP_overflow_method o = FAP_FX_OVERFLOW_SATURATE);
+
+  /// @brief Conversion from FloatingPointType
+  FixedPoint(const FloatingPointType& fp, FixedPrecTy n_prec,
+             FAP_rounding_method r = FAP_FP_ROUND_NEAREST,
+             FAP_overflow_method o = FAP_FX_OVERFLOW_SATURATE);
+
+  /// @brief Build from the raw bits
+  static FixedPoint fromBits(int64_t bits, FixedPrecTy n_prec,
+                             FAP_rounding_method r = FAP_FP_ROUND_NEAREST,
+                             FAP_overflow_method o =
+                                 FAP_FX_OVERFLOW_SATURATE);
+  /// \}
+
+  /// \{
+  // Getters and Setters
+  int64_t getBits() const {
+    return this->bits;
+  }
+
+  /// @brief Bits with the half value of the neglected bits, if any
+  int64_t getActualBits() const;
+
+  FixedPrecTy getPrec() const {
+    return this->prec;
+  }
+
+  uint8_t getNeglectedBits() const {
+    return this->neglectedBits;
+  }
+
+  uint8_t getNeglectedBitsStatus() const {
+    return this->neglectedBitsStatus;
+  }
+
+  void setNeglectedBitsStatus(uint8_t neglectedBitsStatus) {
+    this->neglectedBitsStatus = neglectedBitsStatus;
+  }
+
+  bool isCompensate() const {
+    return this->compensate;
+  }
+
+  void setCompensate(bool compensate) {
+    this->compensate = compensate;
+  }
+
+  FAP_rounding_method getRounding() const {
+    return this->rounding;
+  }
+
+  void setRounding(FAP_rounding_method rounding) {
+    this->rounding = rounding;
+  }
+
+  FAP_overflow_method getOverflow() const {
+    return this->overflow;
+  }
+
+  void setOverflow(FAP_overflow_method overflow) {
+    this->overflow = overflow;
+  }
+  /// \}
+
+  // Overloaded operators
+  /// @brief Conversion to double
+  explicit operator double() const;
+  /// @brief Conversion to float
+  explicit operator float() const {
+    return (float) (double) *this;
+  }
+
+  // Arithmetic operators
+  // Each operations is done at the minimum precision between the operands
+  FixedPoint& operator+=(FixedPoint);
+  FixedPoint& operator-=(FixedPoint);
+  FixedPoint& operator*=(FixedPoint);
+  FixedPoint& operator/=(FixedPoint);
+
+  friend FixedPoint operator+(FixedPoint lhs, const FixedPoint& rhs) {
+    lhs += rhs;
+    return lhs;
+  }
+  friend FixedPoint operator-(FixedPoint lhs, const FixedPoint& rhs) {
+    lhs -= rhs;
+    return lhs;
+  }
+  friend FixedPoint operator*(FixedPoint lhs, const FixedPoint& rhs) {
+    lhs *= rhs;
+    return lhs;
+  }
+  friend FixedPoint operator/(FixedPoint lhs, const FixedPoint& rhs) {
+    lhs /= rhs;
+    return lhs;
+  }
+
+  // Unary Operator
+  friend FixedPoint operator-(FixedPoint lhs) {
+    lhs.setWideBits(-(int128_t)lhs.bits);
+    return lhs;
+  }
+
+  // Public methods
+  /// @brief Change the format, rounding the fractional part and applying
+  /// the overflow method on the integer part
+  void changePrec(FixedPrecTy);
+
+  /// @brief Neglect the \p n lowest bits, zeroing them as in
+  /// IntegerType::changePrec
+  void neglectBits(uint8_t n);
+
+  /// @brief Adapt the precision of this and \p fx FixedPoint to the lowest
+  void adaptPrec(FixedPoint& fx);
+
+ private:
+  /// @brief Set the bits from a wide value, applying the overflow method
+  void setWideBits(int128_t wide);
+
+  int64_t bits;  ///< Value scaled by 2^frac_size
+  FixedPrecTy prec;  ///< Information about the precision
+  uint8_t neglectedBits;  ///< Number of zeroed least significant bits
+  uint8_t neglectedBitsStatus;  ///< Information about the neglected bits
+  bool compensate;  ///< If the compensation is enabled
+  FAP_rounding_method rounding;  ///< Rounding of the fractional part
+  FAP_overflow_method overflow;  ///< Overflow of the integer part
+};
+
+/// @defgroup FAP_FIXED_BATCH Fixed point batch kernels
+/// The kernels work on arrays of raw bits with the same FixedPrecTy.
+/// @{
+void fixedQuantize(const double* in, int64_t* out, size_t n, FixedPrecTy prec,
+                   FAP_rounding_method r = FAP_FP_ROUND_NEAREST,
+                   FAP_overflow_method o = FAP_FX_OVERFLOW_SATURATE);
+void fixedToDouble(const int64_t* in, double* out, size_t n,
+                   FixedPrecTy prec);
+void fixedAdd(const int64_t* a, const int64_t* b, int64_t* res, size_t n,
+              FixedPrecTy prec,
+              FAP_overflow_method o = FAP_FX_OVERFLOW_SATURATE);
+void fixedSub(const int64_t* a, const int64_t* b, int64_t* res, size_t n,
+              FixedPrecTy prec,
+              FAP_overflow_method o = FAP_FX_OVERFLOW_SATURATE);
+void fixedMul(const int64_t* a, const int64_t* b, int64_t* res, size_t n,
+              FixedPrecTy prec, FAP_rounding_method r = FAP_FP_ROUND_NEAREST,
+              FAP_overflow_method o = FAP_FX_OVERFLOW_SATURATE);
+/// @brief Multiply-accumulate: res[i] += a[i] * b[i]
+void fixedMac(const int64_t* a, const int64_t* b, int64_t* res, size_t n,
+              FixedPrecTy prec, FAP_rounding_method r = FAP_FP_ROUND_NEAREST,
+              FAP_overflow_method o = FAP_FX_OVERFLOW_SATURATE);
+/// @brief Dot product, accumulated exactly and rounded once
+int64_t fixedDot(const int64_t* a, const int64_t* b, size_t n,
+                 FixedPrecTy prec, FAP_rounding_method r = FAP_FP_ROUND_NEAREST,
+                 FAP_overflow_method o = FAP_FX_OVERFLOW_SATURATE);
+/// @}
+
+}  // end fap namespace
+
+/// @defgroup OPERATOR_OVERLOAD_INPUT_OUTPUT Input/Output overloaded operators
+/// @{
+::std::ostream& operator<<(::std::ostream&, const ::fap::FixedPoint&);
+/// @}
+
+#endif /* INCLUDE_FAPFIXEDPOINT_H_ */
@@ -0,0 +1,102 @@
+//===- FapFormats.h ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapFormats.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Standard narrow formats - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPFORMATS_H_
+#define INCLUDE_FAPFORMATS_H_
+
+#include "FapSimd.h"
+
+/// @brief Standard narrow formats, stored as the packed values of
+/// packValue() on 16 or 8 bits. The FP8 formats follow the IEEE 754
+/// encoding of the other precisions, with the infinities and the NaNs on
+/// the greatest exponent.
+typedef enum {
+  FAP_FORMAT_FP16 = 0,  ///< IEEE 754 binary16, 5:10
+  FAP_FORMAT_BF16,  ///< bfloat16, 8:7
+  FAP_FORMAT_FP8_E4M3,  ///< FP8, 4:3
+  FAP_FORMAT_FP8_E5M2  ///< FP8, 5:2
+} FAP_format;
+
+namespace fap {
+
+/// \{
+/// @brief Precisions of the standard formats
+constexpr FloatPrecTy PREC_FP16(5, 10);
+constexpr FloatPrecTy PREC_BF16(8, 7);
+constexpr FloatPrecTy PREC_FP8_E4M3(4, 3);
+constexpr FloatPrecTy PREC_FP8_E5M2(5, 2);
+/// \}
+
+/// @brief Precision of \p format
+FloatPrecTy formatPrec(FAP_format format);
+
+/// @brief If \p prec is the one of a standard format, which is set in
+/// \p format
+bool findFormat(FloatPrecTy prec, FAP_format& format);
+
+/// \{
+/// @brief Conversion of \p n floats to \p format, rounded as
+/// FloatingPointType::fromSignificand() with the rounding of the
+/// ArithmeticContext of the caller; the NaNs give the NaN of setNaN(). The
+/// half precision uses the F16C conversions when the processor has them,
+/// the bfloat16 rounds adding to the float bits, the FP8 formats round the
+/// float bits on integers.
+void encode(FAP_format format, const float* in, uint16_t* out, size_t n);
+void encode(FAP_format format, const float* in, uint8_t* out, size_t n);
+/// \}
+
+/// \{
+/// @brief Exact conversion of \p n values of \p format to float, with the
+/// F16C conversions for the half precision when the processor has them, the
+/// float bits for the bfloat16 and a table of 256 entries for the FP8
+/// formats
+void decode(FAP_format format, const uint16_t* in, float* out, size_t n);
+void decode(FAP_format format, const uint8_t* in, float* out, size_t n);
+/// \}
+
+/// \{
+/// @brief res[i] = lhs[i] op rhs[i] for \p n values of \p format, with the
+/// results of the operators on formatPrec() in the ArithmeticContext of the
+/// caller, whose result precision is not used.
+/// The half precision and the bfloat16 operate on doubles, where the sums
+/// and the products are exact or have their error recovered, the quotients
+/// are checked on the product with the divisor, and round the results with
+/// integer operations. The FP8 formats look the results up in a table of
+/// the 65536 pairs of operands for each operation and rounding, filled by
+/// the operators at the first use. The stochastic rounding, the fast math
+/// flags and the FAP_SPECIAL_SATURATE policy use the operators. The values
+/// are split among \p threads workers (0 for one per core).
+void batchOp(FAP_batch_op op, FAP_format format, const uint16_t* lhs,
+             const uint16_t* rhs, uint16_t* res, size_t n,
+             unsigned threads = 0);
+void batchOp(FAP_batch_op op, FAP_format format, const uint8_t* lhs,
+             const uint8_t* rhs, uint8_t* res, size_t n,
+             unsigned threads = 0);
+/// \}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPFORMATS_H_ */
@@ -0,0 +1,78 @@
+//===- FapGemm.h ------------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapGemm.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Matrix multiply - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPGEMM_H_
+#define INCLUDE_FAPGEMM_H_
+
+#include "Fap.h"
+
+/// @brief Accumulation policies of the floating point matrix multiply
+typedef enum {
+  /// Each product and each sum is rounded, the results are the ones of the
+  /// operators: c = a0 * b0; c += a1 * b1; ...
+  FAP_GEMM_ACCUMULATE_ROUNDED = 0,
+  /// The exact products are summed on a 126 bits significand, the sum is
+  /// rounded once on the lowest precision of the operands
+  FAP_GEMM_ACCUMULATE_WIDE
+} FAP_gemm_accumulation;
+
+namespace fap {
+
+/// @defgroup FAP_GEMM Matrix multiply
+/// C = A * B, where A is m x k, B is k x n and C is m x n, all in row major
+/// order with the leading dimensions \p lda, \p ldb and \p ldc.
+/// The operands are unpacked once, then blocks of A and panels of B are
+/// packed for the cache and multiplied by a micro-kernel working on
+/// significands, on 64 bits words for the mantissas up to 29 bits. The
+/// rows of C are split among \p threads workers (0 for one per core), which
+/// use the ArithmeticContext of the caller.
+/// Operands with different precisions, special values or the stochastic
+/// rounding take the path of the operators.
+/// With k = 0 C is set to positive zeroes, on the precision of its
+/// elements for FloatingPointType.
+/// @{
+void gemm(size_t m, size_t n, size_t k, const FloatingPointType* a,
+          size_t lda, const FloatingPointType* b, size_t ldb,
+          FloatingPointType* c, size_t ldc,
+          FAP_gemm_accumulation acc = FAP_GEMM_ACCUMULATE_ROUNDED,
+          unsigned threads = 0);
+/// @brief Multiply of double matrices quantized on \p prec, which has to
+/// enter in a double
+void gemm(size_t m, size_t n, size_t k, const double* a, size_t lda,
+          const double* b, size_t ldb, double* c, size_t ldc,
+          FloatPrecTy prec,
+          FAP_gemm_accumulation acc = FAP_GEMM_ACCUMULATE_ROUNDED,
+          unsigned threads = 0);
+/// @brief Multiply of integers, with the results of the operators, the
+/// compensation included
+void gemm(size_t m, size_t n, size_t k, const IntegerType* a, size_t lda,
+          const IntegerType* b, size_t ldb, IntegerType* c, size_t ldc,
+          unsigned threads = 0);
+/// @}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPGEMM_H_ */
@@ -0,0 +1,142 @@
+//===- FapInterval.h --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapInterval.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Interval arithmetic with directed rounding - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPINTERVAL_H_
+#define INCLUDE_FAPINTERVAL_H_
+
+#include "Fap.h"
+
+#include <ostream>
+
+namespace fap {
+
+/// @brief Closed interval [lower, upper] of FloatingPointType bounds on a
+/// common precision, enclosing every value that the exact computation can
+/// take. The lower bounds are rounded toward -infinity and the upper ones
+/// toward +infinity: each operation computes the exact results of the
+/// pairs of bounds it needs once, and rounds the same result both ways when
+/// the two bounds come from the same pair, as with point operands.
+/// The operands are taken to the lower precision of the two, rounding their
+/// bounds outward, and the ArithmeticContext of the caller is not used.
+/// A NaN bound makes both bounds NaN, a divisor containing zero gives
+/// [-infinity, +infinity].
+class Interval {
+ public:
+  /// \{
+  /// @brief Ctor, the point 0 on the default precision
+  Interval() {
+  }
+
+  /// @brief Ctor, the point \p val on its precision
+  explicit Interval(const FloatingPointType& val)
+      : lower(val),
+        upper(val) {
+  }
+
+  /// @brief Ctor, [\p lower, \p upper] rounded outward on \p prec
+  Interval(const FloatingPointType& lower, const FloatingPointType& upper,
+           FloatPrecTy prec);
+
+  /// @brief Ctor, the smallest interval on \p prec containing \p val
+  Interval(double val, FloatPrecTy prec);
+  /// \}
+
+  /// \{
+  // Getters
+  const FloatingPointType& getLower() const {
+    return lower;
+  }
+
+  const FloatingPointType& getUpper() const {
+    return upper;
+  }
+
+  FloatPrecTy getPrec() const {
+    return lower.getPrec();
+  }
+  /// \}
+
+  /// @brief If the bounds are NaN
+  bool isNaN() const {
+    return lower.isNaN();
+  }
+
+  /// @brief If \p val lies between the bounds, compared exactly
+  bool contains(const FloatingPointType& val) const;
+
+  /// @brief Upper - lower rounded toward +infinity, the worst case error of
+  /// any value of the interval
+  FloatingPointType width() const;
+
+  // Arithmetic operators
+  Interval& operator+=(const Interval& rhs);
+  Interval& operator-=(const Interval& rhs);
+  Interval& operator*=(const Interval& rhs);
+  Interval& operator/=(const Interval& rhs);
+
+  friend Interval operator+(Interval lhs, const Interval& rhs) {
+    lhs += rhs;
+    return lhs;
+  }
+
+  friend Interval operator-(Interval lhs, const Interval& rhs) {
+    lhs -= rhs;
+    return lhs;
+  }
+
+  friend Interval operator*(Interval lhs, const Interval& rhs) {
+    lhs *= rhs;
+    return lhs;
+  }
+
+  friend Interval operator/(Interval lhs, const Interval& rhs) {
+    lhs /= rhs;
+    return lhs;
+  }
+
+  /// @brief Exact, the bounds are swapped and negated
+  friend Interval operator-(const Interval& val) {
+    Interval res;
+    res.lower = -val.upper;
+    res.upper = -val.lower;
+    return res;
+  }
+
+ private:
+  /// @brief Take this to the lower precision of the two, \p rhs is
+  /// returned as it is or rounded outward in \p tmp
+  const Interval& adaptPrec(const Interval& rhs, Interval& tmp);
+
+  FloatingPointType lower;  ///< Rounded toward -infinity
+  FloatingPointType upper;  ///< Rounded toward +infinity
+};
+
+}  // end fap namespace
+
+/// @brief Print as [lower, upper] in decimal
+::std::ostream& operator<<(::std::ostream&, const ::fap::Interval&);
+
+#endif /* INCLUDE_FAPINTERVAL_H_ */
@@ -0,0 +1,131 @@
+//===- FapLazy.h ------------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapLazy.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Lazily normalized chains of additions - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPLAZY_H_
+#define INCLUDE_FAPLAZY_H_
+
+#include "Fap.h"
+
+namespace fap {
+
+/// @brief Floating point value for chains of additions.
+/// In lazy mode the additions are accumulated on a wide unnormalized
+/// mantissa, keeping the pending sticky state, and the sum is normalized
+/// and rounded once, when the value is observed or mixed with another
+/// operation. In exact mode every addition is rounded as with
+/// FloatingPointType, giving bit-identical results.
+/// The precision is the one of the initial value, lowered as in
+/// FloatingPointType::adaptPrec when an operand has a lower one.
+class LazyFloatingPointType {
+ public:
+  /// @brief Ctor, \p init gives the precision of the sum
+  LazyFloatingPointType(const FloatingPointType& init = FloatingPointType(),
+                        bool exact = false)
+      : value(init),
+        prec(init.getPrec()),
+        acc(0),
+        acc_exp2(0),
+        sticky(false),
+        pending(false),
+        exact(exact) {
+  }
+
+  LazyFloatingPointType& operator=(const FloatingPointType& fp) {
+    this->value = fp;
+    this->prec = fp.getPrec();
+    this->pending = false;
+    return *this;
+  }
+
+  // Arithmetic operators
+  LazyFloatingPointType& operator+=(const FloatingPointType& fp);
+  LazyFloatingPointType& operator-=(const FloatingPointType& fp);
+  /// @brief Mixed operations flush the pending sum first
+  LazyFloatingPointType& operator*=(const FloatingPointType& fp) {
+    this->flush();
+    this->value *= fp;
+    return *this;
+  }
+  LazyFloatingPointType& operator/=(const FloatingPointType& fp) {
+    this->flush();
+    this->value /= fp;
+    return *this;
+  }
+
+  /// @brief Normalized and rounded value
+  const FloatingPointType& getValue() const {
+    this->flush();
+    return this->value;
+  }
+  operator const FloatingPointType&() const {
+    return this->getValue();
+  }
+  explicit operator double() const {
+    return (double) this->getValue();
+  }
+  explicit operator float() const {
+    return (float) this->getValue();
+  }
+
+  FloatPrecTy getPrec() const {
+    return this->prec;
+  }
+
+  bool isExact() const {
+    return exact;
+  }
+
+  /// @brief Switching mode flushes the pending sum
+  void setExact(bool exact) {
+    this->flush();
+    this->exact = exact;
+  }
+
+  /// @brief Add the exact value (-1)^sign * sig * 2^exp2, not representable
+  /// on the precision of the sum
+  void addSignificand(SignType sign, MantType sig, int exp2);
+
+  /// @brief Normalize and round the pending sum
+  void flush() const;
+
+ private:
+  /// @brief Accumulate (-1)^sign * sig * 2^exp2
+  void accumulate(SignType sign, MantType sig, int exp2) const;
+  /// @brief Arithmetic right shift, keeping track of the lost bits
+  int128_t shiftRight(int128_t val, int to_shift) const;
+
+  mutable FloatingPointType value;  ///< Last normalized value
+  FloatPrecTy prec;  ///< Precision of the sum, the lowest one seen
+  mutable int128_t acc;  ///< Wide unnormalized sum
+  mutable int acc_exp2;  ///< Exponent of the lsb of acc
+  mutable bool sticky;  ///< Positive bits lost below the lsb of acc
+  mutable bool pending;  ///< If acc holds the value
+  bool exact;  ///< Round each addition
+};
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPLAZY_H_ */
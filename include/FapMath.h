@@ -0,0 +1,73 @@
+//===- FapMath.h ------------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapMath.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Elementary functions - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPMATH_H_
+#define INCLUDE_FAPMATH_H_
+
+#include "Fap.h"
+
+/// @brief Maximum mantissa size of exp, log and rsqrt
+#define FAP_MATH_MAX_MANT_SIZE        DOUBLE_MANT_SIZE
+/// @brief Maximum mantissa size of sqrt and reciprocal
+#define FAP_MATH_EXACT_MAX_MANT_SIZE  61
+
+namespace fap {
+
+/// @defgroup FAP_MATH Elementary functions
+/// The results have the precision of the operand and are rounded with the
+/// ArithmeticContext of the thread, as the operators.
+/// sqrt, reciprocal and rsqrt are correctly rounded, from integer
+/// operations on the significand. exp and log use a table and a polynomial
+/// whose degree follows the mantissa size, evaluated in double or, for large
+/// mantissas and results too close to a rounding boundary, in long double:
+/// they are correctly rounded but in the rare hard cases, which are faithful
+/// and rounded with the method of the context.
+/// The batch forms on double arrays quantize the inputs on \p prec, which
+/// has to enter in a double, and give back the rounded results.
+/// @{
+FloatingPointType sqrt(const FloatingPointType& x);
+FloatingPointType exp(const FloatingPointType& x);
+FloatingPointType log(const FloatingPointType& x);
+FloatingPointType reciprocal(const FloatingPointType& x);
+FloatingPointType rsqrt(const FloatingPointType& x);
+
+void sqrt(const FloatingPointType* in, FloatingPointType* out, size_t n);
+void exp(const FloatingPointType* in, FloatingPointType* out, size_t n);
+void log(const FloatingPointType* in, FloatingPointType* out, size_t n);
+void reciprocal(const FloatingPointType* in, FloatingPointType* out,
+                size_t n);
+void rsqrt(const FloatingPointType* in, FloatingPointType* out, size_t n);
+
+void sqrt(const double* in, double* out, size_t n, FloatPrecTy prec);
+void exp(const double* in, double* out, size_t n, FloatPrecTy prec);
+void log(const double* in, double* out, size_t n, FloatPrecTy prec);
+void reciprocal(const double* in, double* out, size_t n, FloatPrecTy prec);
+void rsqrt(const double* in, double* out, size_t n, FloatPrecTy prec);
+/// @}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPMATH_H_ */
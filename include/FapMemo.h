@@ -0,0 +1,104 @@
+//===- FapMemo.h ------------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapMemo.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Memoization of the FloatingPointType operators - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPMEMO_H_
+#define INCLUDE_FAPMEMO_H_
+
+#include "FapContext.h"
+
+/// @brief Operations of the memoization cache, the subtraction is an
+/// addition of the negated operand
+typedef enum {
+  FAP_MEMO_ADD = 0,
+  FAP_MEMO_MUL,
+  FAP_MEMO_DIV
+} FAP_memo_op;
+
+namespace fap {
+
+/// @brief Words of a MemoKey
+#define FAP_MEMO_KEY_WORDS            7
+
+/// @brief Key of a memoized operation: the operator, the bit patterns and
+/// the precisions of the operands and the settings of the context that the
+/// result depends on, packed in words by fap_memo_key_() with their hash.
+struct MemoKey {
+  uint64_t words[FAP_MEMO_KEY_WORDS];
+  uint64_t hash;
+};
+
+/// @brief Lookups of the memoization caches
+struct MemoStats {
+  MemoStats()
+      : lookups(0),
+        hits(0),
+        evictions(0) {
+  }
+
+  /// @brief Hits over lookups, 0 without lookups
+  double getHitRate() const {
+    return lookups != 0 ? (double)hits / lookups : 0.0;
+  }
+
+  uint64_t lookups;
+  uint64_t hits;
+  uint64_t evictions;  ///< Valid entries replaced by a store
+};
+
+/// @brief Lookups of the caches of all the threads, the exited ones
+/// included. The memoization of a thread is enabled by
+/// ArithmeticContext::setMemoization(): each thread has its own bounded
+/// two-way set associative cache, with no lock, and the operators look the
+/// key of their operation up before computing it, storing the result on a
+/// miss. The stochastic rounding is never memoized.
+MemoStats memoStats();
+
+/// @brief Forget the lookups of all the threads, with no thread computing
+void resetMemoStats();
+
+/// @brief Drop the entries of the cache of the calling thread
+void clearMemoCache();
+
+}  // end fap namespace
+
+/// \{
+/// @brief Hooks of the FloatingPointType operators, with a non-zero
+/// ArithmeticState::memoEntries.
+/// Fill \p key for \p lhs op \p rhs, false if the operation is not
+/// memoized
+bool fap_memo_key_(FAP_memo_op op, const ::fap::FloatingPointType& lhs,
+                   const ::fap::FloatingPointType& rhs,
+                   const ::fap::ArithmeticState& ctx, ::fap::MemoKey* key);
+/// Result of \p key in the cache of the thread, false on a miss
+bool fap_memo_lookup_(const ::fap::MemoKey& key,
+                      const ::fap::ArithmeticState& ctx,
+                      ::fap::FloatingPointType* res);
+/// Store \p res as the result of \p key
+void fap_memo_store_(const ::fap::MemoKey& key,
+                     const ::fap::FloatingPointType& res);
+/// \}
+
+#endif /* INCLUDE_FAPMEMO_H_ */
@@ -0,0 +1,157 @@
+//===- FapProfile.h ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapProfile.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Value-range profiling - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPPROFILE_H_
+#define INCLUDE_FAPPROFILE_H_
+
+#include "Fap.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/// @brief Labelled sites a program can profile
+#ifndef FAP_PROFILE_MAX_SITES
+#define FAP_PROFILE_MAX_SITES         256
+#endif
+
+/// @brief Record \p val at the site \p label, registered at the first pass
+#define FAP_PROFILE(label, val)                                              \
+  do {                                                                       \
+    static const unsigned fap_profile_site_ =                                \
+        ::fap::RangeProfiler::site(label);                                   \
+    ::fap::RangeProfiler::record(fap_profile_site_, (val));                  \
+  } while (0)
+
+namespace fap {
+
+/// @brief Values observed at a site, merged over the threads
+struct RangeSummary {
+  RangeSummary();
+
+  /// @brief Smallest FloatPrecTy with \p mant_size bits of mantissa whose
+  /// exponent holds the observed values as normal ones, or as subnormal
+  /// ones if \p allow_subnormal. An overflow asks for a wider exponent than
+  /// the one of the overflowed values. When no exponent up to
+  /// FAP_MAX_EXP_SIZE bits holds them, the widest one is proposed and
+  /// \p fits, if given, is set to false.
+  FloatPrecTy proposeFloatPrec(uint16_t mant_size,
+                               bool allow_subnormal = false,
+                               bool* fits = NULL) const;
+
+  /// @brief Smallest IntegerPrecision, the high bits IntegerType::changePrec()
+  /// keeps, with which the observed integer values are exact: their
+  /// original precision less the trailing zeroes they all have
+  IntegerPrecision proposeIntPrec() const;
+
+  ::std::string label;
+  uint64_t count;  ///< Floating point values
+  uint64_t zeros;  ///< Zeroes among them
+  uint64_t subnormals;  ///< Subnormals on the precision they had
+  uint64_t overflows;  ///< Infinities
+  uint64_t nans;
+  int minExp;  ///< Smallest exponent of the finite non-zero values
+  int maxExp;  ///< Greatest exponent of the finite non-zero values
+  uint16_t overflowExpSize;  ///< Widest exponent of the infinities
+  uint64_t intCount;  ///< Integer values
+  int intBits;  ///< Bit length of the greatest integer magnitude
+  bool intNegative;  ///< If an integer value is negative
+  IntegerPrecision intOriPrecision;  ///< Widest original integer precision
+  int intLowBit;  ///< Lowest set bit of the non-zero integer values
+};
+
+/// @brief Profiler of the ranges of the values at labelled sites.
+/// While it is enabled, record() accounts the values of the calling thread
+/// in its own sketch of the site, with relaxed atomic loads and stores
+/// that no other thread writes, so that recording takes no lock; when it is
+/// disabled, record() is a relaxed load. The sketches of the exiting
+/// threads are merged in the profile, which summary() merges with the ones
+/// of the live threads.
+class RangeProfiler {
+ public:
+  /// @brief Site of \p label, registered at the first call
+  static unsigned site(const char* label);
+
+  static void setEnabled(bool on) {
+    enabled.store(on, ::std::memory_order_relaxed);
+  }
+
+  static bool isEnabled() {
+    return enabled.load(::std::memory_order_relaxed);
+  }
+
+  /// \{
+  /// @brief Account \p val at \p site
+  static void record(unsigned site, const FloatingPointType& val) {
+    if (isEnabled()) {
+      recordFloat(site, val);
+    }
+  }
+
+  static void record(unsigned site, double val) {
+    if (isEnabled()) {
+      recordDouble(site, val);
+    }
+  }
+
+  static void record(unsigned site, const IntegerType& val) {
+    if (isEnabled()) {
+      recordInt(site, val.getBits(), val.getOriPrecision());
+    }
+  }
+
+  static void record(unsigned site, int64_t val) {
+    if (isEnabled()) {
+      recordInt(site, val, sizeof(val) * 8);
+    }
+  }
+
+  static void record(unsigned site, int val) {
+    if (isEnabled()) {
+      recordInt(site, val, sizeof(val) * 8);
+    }
+  }
+  /// \}
+
+  /// @brief Summaries of the registered sites, in the order of
+  /// registration
+  static ::std::vector<RangeSummary> summary();
+
+  /// @brief Forget the recorded values, with no thread recording
+  static void reset();
+
+ private:
+  static void recordFloat(unsigned site, const FloatingPointType& val);
+  static void recordDouble(unsigned site, double val);
+  static void recordInt(unsigned site, int128_t val,
+                        IntegerPrecision ori_prec);
+
+  static ::std::atomic<bool> enabled;  ///< Profiling mode
+};
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPPROFILE_H_ */
@@ -0,0 +1,71 @@
+//===- FapReduce.h ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapReduce.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Reproducible parallel reductions - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPREDUCE_H_
+#define INCLUDE_FAPREDUCE_H_
+
+#include "Fap.h"
+
+/// @brief Values reduced in order in each leaf of the reduction tree, it
+/// fixes the results together with the values
+#ifndef FAP_REDUCE_CHUNK
+#define FAP_REDUCE_CHUNK              1024
+#endif
+
+/// @brief Minimum values for each worker of the reductions
+#ifndef FAP_REDUCE_THREAD_WORK
+#define FAP_REDUCE_THREAD_WORK        (1 << 14)
+#endif
+
+namespace fap {
+
+/// @defgroup FAP_REDUCE Reproducible reductions
+/// The values are cut in leaves of FAP_REDUCE_CHUNK values, each reduced
+/// in order with the operators, and the partial results of the leaves are
+/// added in pairs, level by level, by a tree that depends only on their
+/// number. The leaves are split among \p threads workers (0 for one per
+/// core), so that the results are bit identical for any number of threads
+/// and any scheduling. Each sum and each product is rounded with the
+/// ArithmeticContext of the caller, as by the operators; with the
+/// stochastic rounding the generator is seeded again for each leaf and for
+/// the tree from one draw of the caller, which continues from the seed of
+/// the tree. An empty reduction gives 0 on the default precision.
+/// @{
+/// @brief vals[0] + ... + vals[n - 1]
+FloatingPointType sum(const FloatingPointType* vals, size_t n,
+                      unsigned threads = 0);
+/// @brief x[0] * y[0] + ... + x[n - 1] * y[n - 1]
+FloatingPointType dot(const FloatingPointType* x, const FloatingPointType* y,
+                      size_t n, unsigned threads = 0);
+/// @brief The euclidean norm, the square root of dot(x, x, n) rounded as
+/// ::fap::sqrt()
+FloatingPointType norm(const FloatingPointType* x, size_t n,
+                       unsigned threads = 0);
+/// @}
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPREDUCE_H_ */
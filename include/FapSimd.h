@@ -0,0 +1,58 @@
+//===- FapSimd.h ------------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapSimd.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Vectorized operations on packed values - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPSIMD_H_
+#define INCLUDE_FAPSIMD_H_
+
+#include "FapDispatch.h"
+
+namespace fap {
+
+/// \{
+/// @brief Value of a precision up to 11:52 packed as sign, exponent and
+/// mantissa on 1 + exp_size + mant_size bits, as the IEEE 754 formats
+uint64_t packValue(const FloatingPointType& val);
+FloatingPointType unpackValue(uint64_t bits, FloatPrecTy prec);
+/// \}
+
+/// @brief res[i] = lhs[i] op rhs[i] for \p n packed values of \p prec, up to
+/// 11:52, with the results of the operators on \p prec in the
+/// ArithmeticContext of the caller, whose result precision is not used.
+/// The values are processed a vector of 64 bit lanes at a time, on the
+/// widest instruction set of the processor among AVX-512F, AVX2 and the
+/// baseline one: the operands are aligned collecting the guard, round and
+/// sticky bits, the significands are added, multiplied or divided on the
+/// lanes, normalized by a leading zero count and rounded. The stochastic
+/// rounding, the fast math flags and the FAP_SPECIAL_SATURATE policy use
+/// the operators. The values are split among \p threads workers (0 for one
+/// per core).
+void batchOp(FAP_batch_op op, FloatPrecTy prec, const uint64_t* lhs,
+             const uint64_t* rhs, uint64_t* res, size_t n,
+             unsigned threads = 0);
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPSIMD_H_ */
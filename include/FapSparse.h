@@ -0,0 +1,139 @@
+//===- FapSparse.h ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapSparse.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Sparse matrices with bit-packed values - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPSPARSE_H_
+#define INCLUDE_FAPSPARSE_H_
+
+#include "Fap.h"
+
+#include <vector>
+
+/// @brief Storage formats of the sparse matrices
+typedef enum {
+  /// Compressed sparse rows: the non-zeroes of each row are contiguous
+  FAP_SPARSE_CSR = 0,
+  /// ELLPACK: every row is padded to the longest one and the slots are
+  /// stored column by column, slot j of all the rows is contiguous
+  FAP_SPARSE_ELL
+} FAP_sparse_format;
+
+namespace fap {
+
+/// @brief Sparse matrix whose values are stored on the exact bit-width of
+/// their precision, 1 + exp_size + mant_size bits in the IEEE 754 layout,
+/// packed one after the other in 64 bits words and unpacked on the fly.
+/// The precision has to enter in a double.
+class SparseMatrix {
+ public:
+  /// @brief Ctor, empty matrix
+  SparseMatrix(FloatPrecTy prec = {FLOAT_EXP_SIZE, FLOAT_MANT_SIZE},
+               FAP_sparse_format format = FAP_SPARSE_CSR);
+
+  // Getters
+  size_t getRows() const {
+    return rows;
+  }
+
+  size_t getCols() const {
+    return cols;
+  }
+
+  size_t getNnz() const {
+    return nnz;
+  }
+
+  FloatPrecTy getPrec() const {
+    return prec;
+  }
+
+  FAP_sparse_format getFormat() const {
+    return format;
+  }
+
+  /// @brief Bits of a stored value
+  int getValueSize() const {
+    return 1 + prec.exp_size + prec.mant_size;
+  }
+
+  /// @brief Bytes of the values, the column indices and the row data
+  size_t getStorageSize() const;
+
+  size_t getRowSize(size_t row) const;
+  /// @brief Column of the \p j-th non-zero of \p row
+  uint32_t getCol(size_t row, size_t j) const;
+  /// @brief Value of the \p j-th non-zero of \p row
+  FloatingPointType get(size_t row, size_t j) const;
+
+  /// \{
+  /// @brief Build from CSR arrays: the non-zeroes of row i are at the
+  /// positions [row_ptr[i], row_ptr[i + 1]) of \p col_idx and \p vals,
+  /// which are rounded on the precision of the matrix
+  void assign(size_t rows, size_t cols, const size_t* row_ptr,
+              const uint32_t* col_idx, const double* vals,
+              FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+  void assign(size_t rows, size_t cols, const size_t* row_ptr,
+              const uint32_t* col_idx, const FloatingPointType* vals,
+              FAP_rounding_method method = FAP_FP_ROUND_NEAREST);
+  /// \}
+
+  /// \{
+  /// @brief y = A * x, with the rows split among \p threads workers (0 for
+  /// one per core), in balanced shares of non-zeroes.
+  /// On doubles the values are unpacked exactly and the products are summed
+  /// in double, from 0.0. On FloatingPointType the results are the ones of
+  /// the operators, y[i] = a0 * x[c0]; y[i] += a1 * x[c1]; ... in the
+  /// ArithmeticContext of the caller; the empty rows give zero on the
+  /// precision of the matrix.
+  void spmv(const double* x, double* y, unsigned threads = 0) const;
+  void spmv(const FloatingPointType* x, FloatingPointType* y,
+            unsigned threads = 0) const;
+  /// \}
+
+ private:
+  /// @brief Raw bits of the non-zero stored at \p pos
+  uint64_t getBits(size_t pos) const;
+  void setBits(size_t pos, uint64_t bits);
+  /// @brief Storage position of the \p j-th non-zero of \p row
+  size_t position(size_t row, size_t j) const;
+  /// @brief Build from CSR arrays of raw bits
+  void assignBits(size_t rows, size_t cols, const size_t* row_ptr,
+                  const uint32_t* col_idx, const uint64_t* bits);
+
+  FloatPrecTy prec;  ///< Precision of the values
+  FAP_sparse_format format;  ///< Storage format
+  size_t rows;  ///< Number of rows
+  size_t cols;  ///< Number of columns
+  size_t nnz;  ///< Number of non-zeroes
+  size_t ellWidth;  ///< Slots of every row in the ELL format
+  ::std::vector<size_t> rowPtr;  ///< CSR: start of the rows, rows + 1
+  ::std::vector<uint32_t> rowLen;  ///< ELL: non-zeroes of the rows
+  ::std::vector<uint32_t> colIdx;  ///< Columns, in storage order
+  ::std::vector<uint64_t> words;  ///< Packed values, plus a padding word
+};
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPSPARSE_H_ */
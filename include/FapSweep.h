@@ -0,0 +1,190 @@
+//===- FapSweep.h -----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapSweep.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Sharded design space sweeps - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPSWEEP_H_
+#define INCLUDE_FAPSWEEP_H_
+
+#include "Fap.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+/// @brief Configurations of a shard, the unit of work of the processes
+#ifndef FAP_SWEEP_SHARD
+#define FAP_SWEEP_SHARD               64
+#endif
+
+/// @brief Seconds without a checkpoint after which the claim of a shard by
+/// another worker is stale
+#ifndef FAP_SWEEP_LEASE
+#define FAP_SWEEP_LEASE               600
+#endif
+
+namespace fap {
+
+/// @brief Configuration of a sweep, a precision for each variable
+struct SweepConfig {
+  uint64_t index;  ///< Index in the SweepSpace
+  ::std::vector<FloatPrecTy> floatPrecs;
+  ::std::vector<IntegerPrecision> intPrecs;
+};
+
+/// @brief Cartesian product of the precisions of each variable. The
+/// configurations are numbered in mixed radix, the first floating point
+/// variable varying fastest and the integer ones after them.
+struct SweepSpace {
+  /// @brief Configurations, 0 with a variable without choices
+  uint64_t size() const;
+
+  /// @brief Configuration of \p index, less than size()
+  SweepConfig config(uint64_t index) const;
+
+  /// @brief Choices of each variable, in the manifest of a sweep
+  ::std::string describe() const;
+
+  ::std::vector< ::std::vector<FloatPrecTy> > floatChoices;
+  ::std::vector< ::std::vector<IntegerPrecision> > intChoices;
+};
+
+/// @brief Metrics of an evaluated configuration
+struct SweepResult {
+  SweepConfig config;
+  ::std::vector<double> metrics;
+};
+
+/// @brief Sweep of a SweepSpace shared by processes, on one machine or on
+/// a shared file system, through a work queue of files in a directory.
+/// The configurations are cut in shards of consecutive indexes, claimed by
+/// creating their claim file exclusively; the claim of a worker that
+/// makes no progress for the lease is taken over by another one, and a
+/// restarted worker with the same name takes its claims back at once. A
+/// worker whose claim was taken over leaves the shard to the new owner.
+/// Each evaluated configuration is appended to the checkpoint of its shard
+/// and synced, so that a worker resuming the shard evaluates only the
+/// missing ones, and the checkpoint of a complete shard is renamed as done.
+/// The directory holds a manifest of the space and of the shard size,
+/// which every process has to share.
+class Sweep {
+ public:
+  /// @brief Ctor, open or create the sweep of \p space in \p dir for the
+  /// worker \p worker, unique among the live processes
+  Sweep(const SweepSpace& space, const ::std::string& dir,
+        const ::std::string& worker, uint64_t shard_size = FAP_SWEEP_SHARD);
+  ~Sweep();
+
+  Sweep(const Sweep&) = delete;
+  Sweep& operator=(const Sweep&) = delete;
+
+  /// \{
+  // Getters
+  const SweepSpace& getSpace() const {
+    return space;
+  }
+
+  uint64_t getNumShards() const {
+    return numShards;
+  }
+
+  unsigned getLease() const {
+    return lease;
+  }
+  /// \}
+
+  /// @brief Seconds without a checkpoint after which a claim is stale
+  void setLease(unsigned seconds) {
+    lease = seconds;
+  }
+
+  /// @brief Evaluate the shards left, until none can be claimed.
+  /// eval(config) returns the metrics of the SweepConfig config as a
+  /// ::std::vector<double>. It returns the configurations evaluated by this
+  /// call.
+  template<typename EvalFnTy>
+  uint64_t run(EvalFnTy eval) {
+    uint64_t evaluated = 0;
+    uint64_t shard;
+    ::std::vector<bool> done;
+    while (claim(&shard, &done)) {
+      bool owned = true;
+      for (uint64_t i = 0; i < done.size() && owned; ++i) {
+        if (!done[i]) {
+          SweepConfig config = space.config(shard * shardSize + i);
+          owned = checkpoint(config.index, eval(config));
+          ++evaluated;
+        }
+      }
+      finish(shard);
+    }
+    return evaluated;
+  }
+
+  /// @brief Shards done by any worker
+  uint64_t getDoneShards() const;
+
+  bool isComplete() const {
+    return getDoneShards() == numShards;
+  }
+
+  /// @brief Results checkpointed by every worker, of the done and of the
+  /// partial shards, in the order of the indexes
+  ::std::vector<SweepResult> merge() const;
+
+  /// @brief Write the merged results as CSV in \p path, a row for each
+  /// configuration with its precisions (e:m or bits) and its metrics,
+  /// named by \p metric_names
+  void writeReport(const ::std::string& path,
+                   const ::std::vector< ::std::string>& metric_names) const;
+
+ private:
+  /// @brief Claim a shard not done, false if none is left. \p done gets the
+  /// configurations of the shard already checkpointed.
+  bool claim(uint64_t* shard, ::std::vector<bool>* done);
+  /// @brief If the claim of the claimed shard is still of this worker
+  bool ownsClaim() const;
+  /// @brief Append the metrics of \p index to the open checkpoint.
+  /// @return False, without appending, if the claim was taken over
+  bool checkpoint(uint64_t index, const ::std::vector<double>& metrics);
+  /// @brief Mark the claimed \p shard done and release it, unless the claim
+  /// was taken over: the new owner finishes the shard, or has finished it
+  void finish(uint64_t shard);
+  /// @brief Path of the file of \p shard with \p suffix
+  ::std::string shardPath(uint64_t shard, const char* suffix) const;
+
+  SweepSpace space;
+  ::std::string dir;  ///< Directory of the work queue
+  ::std::string worker;  ///< Name of this worker in the claims
+  uint64_t shardSize;  ///< Configurations of a shard
+  uint64_t numShards;
+  unsigned lease;  ///< Seconds of a claim without progress
+  FILE* part;  ///< Checkpoint of the claimed shard
+  ::std::string claimPath;  ///< Claim file of the claimed shard
+};
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPSWEEP_H_ */
@@ -0,0 +1,261 @@
+//===- FapTape.h ------------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapTape.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Operation tapes - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef INCLUDE_FAPTAPE_H_
+#define INCLUDE_FAPTAPE_H_
+
+#include "Fap.h"
+
+#include <vector>
+
+/// @brief Lanes of the batch replay, evaluated together for each operation
+#ifndef FAP_TAPE_LANES
+#define FAP_TAPE_LANES                16
+#endif
+
+/// @brief Operations of a tape
+typedef enum {
+  FAP_TAPE_INPUT = 0,  ///< Value given to the tape, replaced by the replays
+  FAP_TAPE_CONST,  ///< Value given to the tape, fixed
+  FAP_TAPE_ADD,
+  FAP_TAPE_SUB,
+  FAP_TAPE_MUL,
+  FAP_TAPE_DIV
+} FAP_tape_op;
+
+namespace fap {
+
+/// @brief Precision type of the values of a tape
+template<typename T>
+struct TapePrec;
+
+template<>
+struct TapePrec<FloatingPointType> {
+  typedef FloatPrecTy Ty;
+};
+
+template<>
+struct TapePrec<IntegerType> {
+  typedef IntegerPrecision Ty;
+};
+
+template<typename T>
+class Tape;
+
+/// @brief Value of a tape in recording mode: each operation is evaluated
+/// and appended to the tape of its operands
+template<typename T>
+class TapeVar {
+ public:
+  TapeVar()
+      : tape(NULL),
+        slot(0) {
+  }
+
+  // Getters
+  Tape<T>* getTape() const {
+    return tape;
+  }
+
+  uint32_t getSlot() const {
+    return slot;
+  }
+
+  const T& getValue() const {
+    return tape->getValue(slot);
+  }
+
+  // Arithmetic operators
+  TapeVar& operator+=(const TapeVar& rhs) {
+    *this = tape->record(FAP_TAPE_ADD, *this, rhs);
+    return *this;
+  }
+  TapeVar& operator-=(const TapeVar& rhs) {
+    *this = tape->record(FAP_TAPE_SUB, *this, rhs);
+    return *this;
+  }
+  TapeVar& operator*=(const TapeVar& rhs) {
+    *this = tape->record(FAP_TAPE_MUL, *this, rhs);
+    return *this;
+  }
+  TapeVar& operator/=(const TapeVar& rhs) {
+    *this = tape->record(FAP_TAPE_DIV, *this, rhs);
+    return *this;
+  }
+
+  friend TapeVar operator+(TapeVar lhs, const TapeVar& rhs) {
+    lhs += rhs;
+    return lhs;
+  }
+  friend TapeVar operator-(TapeVar lhs, const TapeVar& rhs) {
+    lhs -= rhs;
+    return lhs;
+  }
+  friend TapeVar operator*(TapeVar lhs, const TapeVar& rhs) {
+    lhs *= rhs;
+    return lhs;
+  }
+  friend TapeVar operator/(TapeVar lhs, const TapeVar& rhs) {
+    lhs /= rhs;
+    return lhs;
+  }
+
+ private:
+  friend class Tape<T>;
+
+  TapeVar(Tape<T>* tape, uint32_t slot)
+      : tape(tape),
+        slot(slot) {
+  }
+
+  Tape<T>* tape;  ///< Tape of the value
+  uint32_t slot;  ///< Slot of the value in the tape
+};
+
+/// @brief Dataflow of FloatingPointType or IntegerType operations.
+/// Each slot holds an operation, its operand slots, its precision and its
+/// last value. The operations are recorded in order, so each slot only
+/// depends on previous ones. The floating point results are rounded once on
+/// the precision of their slot, with the ArithmeticContext of the caller;
+/// the integer ones take it with changePrec(). The inputs and constants are
+/// rounded from the given values on the precision of their slot.
+/// Recording at the precisions of the operators, the values are the ones
+/// of the operators.
+template<typename T>
+class Tape {
+ public:
+  typedef typename TapePrec<T>::Ty PrecTy;
+  typedef uint32_t Slot;
+
+  Tape() {
+  }
+
+  Tape(const Tape&) = delete;
+  Tape& operator=(const Tape&) = delete;
+
+  /// \{
+  /// @brief Recording, the slot takes the precision of \p val
+  TapeVar<T> input(const T& val);
+  TapeVar<T> constant(const T& val);
+  /// @brief Evaluate lhs op rhs, the slot takes the precision of the result
+  TapeVar<T> record(FAP_tape_op op, const TapeVar<T>& lhs,
+                    const TapeVar<T>& rhs);
+  /// \}
+
+  // Getters
+  size_t size() const {
+    return nodes.size();
+  }
+
+  size_t getNumInputs() const {
+    return inputs.size();
+  }
+
+  /// @brief Slot of the \p input-th recorded input
+  Slot getInputSlot(size_t input) const {
+    return inputs[input];
+  }
+
+  FAP_tape_op getOp(Slot slot) const {
+    return (FAP_tape_op)nodes[slot].op;
+  }
+
+  /// \{
+  /// @brief Operands of an operation slot
+  Slot getLhs(Slot slot) const {
+    return nodes[slot].lhs;
+  }
+  Slot getRhs(Slot slot) const {
+    return nodes[slot].rhs;
+  }
+  /// \}
+
+  PrecTy getPrec(Slot slot) const {
+    return precs[slot];
+  }
+
+  /// @brief Value of the last evaluation
+  const T& getValue(Slot slot) const {
+    return values[slot];
+  }
+
+  /// @brief Given value of an input or constant slot, before the rounding
+  const T& getSource(Slot slot) const {
+    return sources[nodes[slot].lhs];
+  }
+
+  /// \{
+  /// @brief Configuration, the changed slots are evaluated by update()
+  void setPrec(Slot slot, PrecTy prec);
+  void setInput(size_t input, const T& val);
+  /// \}
+
+  /// @brief Evaluate the changed slots and the ones downstream, stopping
+  /// where a new value is equal to the previous one.
+  /// @return The number of evaluated slots
+  size_t update();
+
+  /// @brief Evaluate all the slots
+  void evaluate();
+
+  /// @brief Replay on \p batch sets of inputs, \p inputs holds
+  /// getNumInputs() values for each set, \p results gets \p num_outputs
+  /// values for each set. The sets are evaluated FAP_TAPE_LANES at a time,
+  /// operation by operation, and split among \p threads workers (0 for one
+  /// per core), which use the ArithmeticContext of the caller.
+  void replay(const T* inputs, size_t batch, const Slot* outputs,
+              size_t num_outputs, T* results, unsigned threads = 0) const;
+
+ private:
+  /// @brief Operation of a slot, the inputs and the constants have the
+  /// index of their given value in lhs
+  struct Node {
+    uint8_t op;
+    Slot lhs;
+    Slot rhs;
+  };
+
+  Slot append(FAP_tape_op op, Slot lhs, Slot rhs, PrecTy prec,
+              const T& value);
+  /// @brief Mark \p slot to be evaluated by update()
+  void touch(Slot slot);
+  /// @brief Slots using each slot, rebuilt when the tape grows
+  void buildUsers();
+
+  ::std::vector<Node> nodes;  ///< Operations
+  ::std::vector<PrecTy> precs;  ///< Precisions of the slots
+  ::std::vector<T> values;  ///< Last values of the slots
+  ::std::vector<T> sources;  ///< Given values of inputs and constants
+  ::std::vector<Slot> inputs;  ///< Slots of the inputs
+  ::std::vector<uint8_t> changed;  ///< Slots to evaluate
+  ::std::vector<Slot> pending;  ///< Slots marked in changed
+  ::std::vector<size_t> userPtr;  ///< Start of the users of each slot
+  ::std::vector<Slot> users;  ///< Users, by slot
+};
+
+}  // end fap namespace
+
+#endif /* INCLUDE_FAPTAPE_H_ */
@@ -24,15 +24,24 @@
 ///        Implementation File
 //===----------------------------------------------------------------------===//
 
-#include "fap.h"
+#include "Fap.h"
+#include "FapContext.h"
+#include "FapMemo.h"
 
 #include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <iomanip>
+#include <utility>
 
 using namespace std;
 
+/// @brief Largest mantissa whose quotient is computed by one division of
+/// 128 bits words, the wider ones are divided on 64 bits words
+#ifndef FAP_DIV_WORD_MANT_SIZE
+#define FAP_DIV_WORD_MANT_SIZE        62
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 /// @defgroup FAP_PRIVATE_FUNCTIONS
 /// @{
@@ -99,6 +108,196 @@ void fap_shift_left_(uint128_t *bit_vector, int to_shift, uint8_t *grs) {
   printf("FAP_FP_LSHIFT - grs=%02x\n", *grs);
 #endif
 }
+bool fap_round_up_(bool lsb, uint8_t grs, SignType sign,
+                   FAP_rounding_method method) {
+  // Modify the grs to match the proper rounding method
+  switch (method) {
+  case FAP_FP_ROUND_TOWARD_0: {
+    grs = 0;
+  } break;
+  case FAP_FP_ROUND_TOWARD_PINF: {
+    if (sign == 0x00 && grs != 0x00) {
+      grs = 0x07;
+    } else {
+      grs = 0x00;
+    }
+  } break;
+  case FAP_FP_ROUND_TOWARD_NINF: {
+    if (sign == 0x01 && grs != 0x00) {
+      grs = 0x07;
+    } else {
+      grs = 0x00;
+    }
+  } break;
+  case FAP_FP_ROUND_STOCHASTIC: {
+    // Only the grs are known, the fraction is taken on 3 bits
+    return (fap_stochastic_bits_() & 0x07) < grs;
+  }
+  default:
+    break;
+  }
+
+  // Apply nearest rounding method with grs updated
+  return (grs == 0x4 && lsb) || grs >= 0x05;
+}
+
+/// @brief Stochastic rounding of \p mag shifted right of \p to_shift > 0
+/// positions, the discarded bits, scaled on 64 bits, are compared with a
+/// random threshold
+static uint128_t fap_stochastic_shift_(uint128_t mag, int to_shift) {
+  uint64_t frac;
+  if (to_shift >= (int)(sizeof(uint128_t) * 8)) {
+    frac = to_shift - 64 < (int)(sizeof(uint128_t) * 8)
+               ? (uint64_t)(mag >> (to_shift - 64))
+               : 0;
+    mag = 0;
+  } else {
+    uint128_t discarded = mag & MASK_LOWER_HIGH(uint128_t, to_shift);
+    frac = to_shift <= 64 ? (uint64_t)(discarded << (64 - to_shift))
+                          : (uint64_t)(discarded >> (to_shift - 64));
+    mag >>= to_shift;
+  }
+  // frac + threshold carries with probability frac / 2^64
+  if (frac != 0 && frac > ~fap_stochastic_bits_()) {
+    mag += 0x1;
+  }
+  return mag;
+}
+
+uint128_t fap_round_shift_(uint128_t mag, int to_shift, SignType sign,
+                           FAP_rounding_method method) {
+  if (to_shift <= 0) {
+    return mag << -to_shift;
+  }
+  if (method == FAP_FP_ROUND_STOCHASTIC) {
+    return fap_stochastic_shift_(mag, to_shift);
+  }
+  uint8_t grs = 0x00;
+  if (to_shift >= (int)(sizeof(uint128_t) * 8)) {
+    grs = mag != 0 ? 0x01 : 0x00;
+    mag = 0;
+  } else {
+    fap_shift_right_(&mag, to_shift, &grs);
+  }
+  if (fap_round_up_((mag & MASK_BIT_HIGH(uint128_t, 0)) != 0, grs, sign,
+                    method)) {
+    mag += 0x1;
+  }
+  return mag;
+}
+
+uint128_t fap_mul_sig_(uint128_t lhs, uint128_t rhs, int *exp2) {
+  uint128_t lhs_hi = lhs >> 64, rhs_hi = rhs >> 64;
+  if (lhs_hi == 0 && rhs_hi == 0) {
+    return (uint128_t)(uint64_t)lhs * (uint64_t)rhs;
+  }
+  // Schoolbook on 64 bits words
+  uint128_t lhs_lo = (uint64_t)lhs, rhs_lo = (uint64_t)rhs;
+  uint128_t lo = lhs_lo * rhs_lo;
+  uint128_t mid_1 = lhs_hi * rhs_lo, mid_2 = lhs_lo * rhs_hi;
+  uint128_t hi = lhs_hi * rhs_hi;
+  uint128_t mid = (lo >> 64) + (uint64_t)mid_1 + (uint64_t)mid_2;
+  hi += (mid_1 >> 64) + (mid_2 >> 64) + (mid >> 64);
+  lo = (mid << 64) | (uint64_t)lo;
+  if (hi == 0) {
+    return lo;
+  }
+  int to_shift = (int)(sizeof(uint128_t) * 8) - fap_clz_(hi);
+  bool sticky = (lo & MASK_LOWER_HIGH(uint128_t, to_shift)) != 0;
+  uint128_t sig = to_shift == (int)(sizeof(uint128_t) * 8)
+                      ? hi
+                      : (hi << (sizeof(uint128_t) * 8 - to_shift)) |
+                            (lo >> to_shift);
+  *exp2 += to_shift;
+  return sig | (sticky ? 0x01 : 0x00);
+}
+
+uint128_t fap_div_sig_(uint128_t lhs, uint128_t rhs, int *exp2) {
+  if (lhs == 0) {
+    return 0;
+  }
+  int lhs_shift = fap_clz_(lhs), rhs_shift = fap_clz_(rhs);
+  lhs <<= lhs_shift;
+  rhs <<= rhs_shift;
+  // The dividend lhs * 2^127, whose highest words are less than the divisor
+  uint64_t num[4] = { 0, (uint64_t)(lhs << 63), (uint64_t)(lhs >> 1),
+                      (uint64_t)(lhs >> 65) };
+  uint64_t div_hi = (uint64_t)(rhs >> 64), div_lo = (uint64_t)rhs;
+  uint64_t quot[2];
+  for (int j = 1; j >= 0; --j) {
+    // Estimate of the quotient word from the highest words, too large at
+    // most by 2 and corrected on the lower word of the divisor
+    uint128_t top = ((uint128_t)num[j + 2] << 64) | num[j + 1];
+    uint128_t q_hat = num[j + 2] >= div_hi ? (uint128_t)UINT64_MAX
+                                           : top / div_hi;
+    uint128_t r_hat = top - q_hat * div_hi;
+    while ((r_hat >> 64) == 0 &&
+           q_hat * div_lo > ((r_hat << 64) | num[j])) {
+      --q_hat;
+      r_hat += div_hi;
+    }
+    // Multiply and subtract, adding back the divisor if it is negative
+    uint128_t prod_lo = q_hat * div_lo;
+    uint128_t prod_hi = q_hat * div_hi + (uint64_t)(prod_lo >> 64);
+    uint128_t low = (uint128_t)num[j] - (uint64_t)prod_lo;
+    uint64_t borrow = (uint64_t)(low >> 64) != 0 ? 1 : 0;
+    uint128_t sub = prod_hi + borrow;
+    bool negative = top < sub;
+    top -= sub;
+    num[j] = (uint64_t)low;
+    if (negative) {
+      --q_hat;
+      uint128_t sum = (uint128_t)num[j] + div_lo;
+      num[j] = (uint64_t)sum;
+      top += div_hi + (uint64_t)(sum >> 64);
+    }
+    num[j + 2] = (uint64_t)(top >> 64);
+    num[j + 1] = (uint64_t)top;
+    quot[j] = (uint64_t)q_hat;
+  }
+  *exp2 += rhs_shift - lhs_shift - 127;
+  uint128_t sig = ((uint128_t)quot[1] << 64) | quot[0];
+  return sig | ((num[0] | num[1]) != 0 ? 0x01 : 0x00);
+}
+
+namespace {
+
+/// @brief Generator of a thread, the key is derived from seed and stream
+struct StochasticState {
+  uint64_t key;
+  uint64_t counter;
+};
+
+thread_local StochasticState stochastic_state = { 0x9E3779B97F4A7C15ULL, 0 };
+
+/// @brief Finalizer of SplitMix64
+inline uint64_t mix64(uint64_t z) {
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+}  // end anonymous namespace
+
+void fap_stochastic_seed(uint64_t seed, uint64_t stream) {
+  stochastic_state.key = mix64(seed ^ mix64(stream + 0x9E3779B97F4A7C15ULL));
+  stochastic_state.counter = 0;
+}
+
+uint64_t fap_stochastic_reserve_(uint64_t n) {
+  uint64_t first = stochastic_state.counter;
+  stochastic_state.counter += n;
+  return first;
+}
+
+uint64_t fap_stochastic_draw_(uint64_t counter) {
+  // Weyl sequence on the counter, as SplitMix64
+  return mix64(stochastic_state.key + (counter + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+uint64_t fap_stochastic_bits_() {
+  return fap_stochastic_draw_(stochastic_state.counter++);
+}
 ///////////////////////////////////////////////////////////////////////////////
 // Fap Library - C++ Interface
 //::fap::FloatingPointType& ::fap::FloatingPointType::operator=(FAP_fp_t fp) {
@@ -113,7 +312,8 @@ void fap_shift_left_(uint128_t *bit_vector, int to_shift, uint8_t *grs) {
 ::fap::FloatingPointType & ::fap::FloatingPointType::operator=(float fp) {
   this->prec.mant_size = FLOAT_MANT_SIZE;
   this->prec.exp_size = FLOAT_EXP_SIZE;
-  uint32_t f_as_4_byte = *(uint32_t *)(&fp);
+  uint32_t f_as_4_byte;
+  memcpy(&f_as_4_byte, &fp, sizeof(f_as_4_byte));
   this->setSign(f_as_4_byte >> (FLOAT_SIZE - FLOAT_SIGN_SIZE));
   this->setExp(
       (f_as_4_byte >> (FLOAT_SIZE - FLOAT_SIGN_SIZE - FLOAT_EXP_SIZE)));
@@ -124,7 +324,8 @@ void fap_shift_left_(uint128_t *bit_vector, int to_shift, uint8_t *grs) {
 ::fap::FloatingPointType & ::fap::FloatingPointType::operator=(double fp) {
   this->prec.mant_size = DOUBLE_MANT_SIZE;
   this->prec.exp_size = DOUBLE_EXP_SIZE;
-  uint64_t d_as_8_byte = *(uint64_t *)(&fp);
+  uint64_t d_as_8_byte;
+  memcpy(&d_as_8_byte, &fp, sizeof(d_as_8_byte));
   this->setSign(d_as_8_byte >> (DOUBLE_SIZE - DOUBLE_SIGN_SIZE));
   this->setExp(
       (d_as_8_byte >> (DOUBLE_SIZE - DOUBLE_SIGN_SIZE - DOUBLE_EXP_SIZE)));
@@ -143,24 +344,41 @@ void fap_shift_left_(uint128_t *bit_vector, int to_shift, uint8_t *grs) {
 //  return temp;
 //}
 
+::fap::FloatingPointType fap::FloatingPointType::toNativePrec(
+    FloatPrecTy native) const {
+  FloatingPointType res;
+  res.setPrec(native);
+  res.setSign(this->getSign());
+  if (this->isZero()) {
+    // Before the specials, a precision without exponent bits is a zero
+    return res;
+  }
+  if (this->isNaN()) {
+    res.setNaN();
+  } else if (this->isInf()) {
+    res.setInf();
+  } else {
+    int exp2;
+    MantType sig = this->getSignificand(exp2);
+    res.setSignificand(this->getSign(), sig, exp2, false, native,
+                       FAP_FP_ROUND_NEAREST);
+  }
+  return res;
+}
+
 ::fap::FloatingPointType::operator float() const {
-  // Check precision to check that 'enters' in the float type
-  if (this->prec.exp_size > FLOAT_EXP_SIZE ||
+  // The other exponent sizes and the wider mantissas are taken on the float
+  // precision first
+  if (this->prec.exp_size != FLOAT_EXP_SIZE ||
       this->prec.mant_size > FLOAT_MANT_SIZE) {
-    ::std::cerr << "FloatingPointType precision is more than the float";
-    exit(1);
+    return (float)this->toNativePrec(
+        FloatPrecTy(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE));
   }
 
   uint32_t ext_sign = ((uint32_t) this->getSign())
                       << (FLOAT_SIZE - FLOAT_SIGN_SIZE);
-
-  // De-bias with exponent size
-  int64_t debiased_exp = this->getExp() - EXPONENT_BIAS(this->prec.exp_size);
-  // Re-bias with the float size
-  debiased_exp += EXPONENT_BIAS(FLOAT_EXP_SIZE);
-  uint32_t ext_exp = ((uint32_t)debiased_exp)
+  uint32_t ext_exp = ((uint32_t) this->getExp())
                      << (FLOAT_SIZE - FLOAT_SIGN_SIZE - FLOAT_EXP_SIZE);
-
   uint32_t ext_mant =
       ((uint32_t) this->getMant() << (FLOAT_MANT_SIZE - this->prec.mant_size));
 
@@ -169,22 +387,18 @@ void fap_shift_left_(uint128_t *bit_vector, int to_shift, uint8_t *grs) {
 }
 
 ::fap::FloatingPointType::operator double() const {
-  // Check precision to check that 'enters' in the double type
-  if (this->prec.exp_size > DOUBLE_EXP_SIZE ||
+  // The other exponent sizes and the wider mantissas are taken on the
+  // double precision first
+  if (this->prec.exp_size != DOUBLE_EXP_SIZE ||
       this->prec.mant_size > DOUBLE_MANT_SIZE) {
-    return 0.0;
+    return (double)this->toNativePrec(
+        FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE));
   }
 
   uint64_t ext_sign = ((uint64_t) this->getSign())
                       << (DOUBLE_SIZE - DOUBLE_SIGN_SIZE);
-
-  // De-bias with exponent size
-  ExpType debiased_exp = this->getExp() - EXPONENT_BIAS(this->prec.exp_size);
-  // Re-bias with the float size
-  debiased_exp += EXPONENT_BIAS(DOUBLE_EXP_SIZE);
-  uint64_t ext_exp = ((uint64_t)debiased_exp)
+  uint64_t ext_exp = ((uint64_t) this->getExp())
                      << (DOUBLE_SIZE - DOUBLE_SIGN_SIZE - DOUBLE_EXP_SIZE);
-
   uint64_t ext_mant =
       ((uint64_t) this->getMant() << (DOUBLE_MANT_SIZE - this->prec.mant_size));
 
@@ -217,311 +431,332 @@ void fap_shift_left_(uint128_t *bit_vector, int to_shift, uint8_t *grs) {
 }
 
 // Arithmetic operators
+// The operators adapt the precisions and then dispatch on the fast math
+// flags of the context, each combination is a different instantiation of
+// the operation, without the branches it does not need. With the
+// memoization the result is taken from the cache of the thread when the
+// operation has been computed before.
 ::fap::FloatingPointType & ::fap::FloatingPointType::
 operator+=(const FloatingPointType &fp) {
-  //  ::std::cout << "Custom Add";
-  FloatingPointType &lhs = *this;
+  typedef void (FloatingPointType::*AdaptedOpTy)(FloatingPointType &,
+                                                 const ArithmeticState &);
+  static const AdaptedOpTy impls[] = {
+      &FloatingPointType::addAdapted<0>, &FloatingPointType::addAdapted<1>,
+      &FloatingPointType::addAdapted<2>, &FloatingPointType::addAdapted<3>,
+      &FloatingPointType::addAdapted<4>, &FloatingPointType::addAdapted<5>,
+      &FloatingPointType::addAdapted<6>, &FloatingPointType::addAdapted<7> };
+  const ArithmeticState &ctx = ArithmeticContext::current();
+  MemoKey key;
+  bool memo = ctx.memoEntries != 0 &&
+              fap_memo_key_(FAP_MEMO_ADD, *this, fp, ctx, &key);
+  if (memo && fap_memo_lookup_(key, ctx, this)) {
+    return *this;
+  }
   FloatingPointType rhs = fp;
 
 #ifdef _FAP_DEBUG_
-  lhs.setName("Result");
+  this->setName("Result");
   rhs.setName("Operand 2");
 #endif
 
   this->adaptPrec(rhs);
-
-  // One of the operands is NaN
-  if (lhs.isNaN() || rhs.isNaN()) {
-    // Set the result NaN
-    lhs.setNaN();
-    return lhs;
-  }
-
-  // One of the operands is infinity
-  if (lhs.isInf() || rhs.isInf()) {
-    if ((lhs.isPinf() && rhs.isNinf()) || (rhs.isPinf() && lhs.isNinf())) {
-      // Set the result NaN
-      lhs.setNaN();
-    }
-    if ((lhs.isPinf() && rhs.isPinf())) {
-      // Set the result PINF
-      lhs.setPinf();
-    }
-    if ((lhs.isNinf() && rhs.isNinf())) {
-      // Set the result NINF
-      lhs.setNinf();
-    }
-    // Not both are infinity, the infinity dominates
-    if (lhs.isInf()) {
-    } else if (rhs.isInf()) {
-      lhs = rhs;
-    }
-    return lhs;
-  }
-
-  // Check special cases
-  if (lhs.isZero()) {
-    lhs = rhs;
-    return lhs;
-  } else if (rhs.isZero()) {
-    return lhs;
+  (this->*impls[ctx.fastMath & FAP_FAST_MATH_ALL])(rhs, ctx);
+  if (memo) {
+    fap_memo_store_(key, *this);
   }
+  return *this;
+}
 
-  ///////////////////////////////////////////////////////////////////////////////
-  // Always take the minor exponent and take it to the major
-  // Local vars
-  // Compute in double result precision
-  uint16_t op_prec = this->prec.mant_size + 1;
-  // When shift use the extended mantissa
-  lhs.setMantHb();
-  rhs.setMantHb();
-  lhs.shift(-op_prec);
-  rhs.shift(-op_prec);
-#ifdef _FAP_DEBUG_
-  printf("FAP_FP_ADD - exp_diff=%d\n", exp_diff);
-  fap_print_binary(&op1, "FAP_FP_ADD - op1");
-  fap_print_binary(&op2, "FAP_FP_ADD - op2");
-#endif
+::fap::FloatingPointType & ::fap::FloatingPointType::
+operator-=(const FloatingPointType &fp) {
+  //  ::std::cout << "Custom Sub";
+  *this += (-fp);
+  return *this;
+}
 
-  int exp_diff = lhs.getExp() - rhs.getExp();
-  FloatingPointType *less_exp_op = &lhs;
-  ExpType res_exp = lhs.getExp();
-  if (exp_diff > 0) {
-    less_exp_op = &rhs;
-  } else if (exp_diff < 0) {
-    exp_diff = -exp_diff;
-    res_exp = rhs.getExp();
+::fap::FloatingPointType & ::fap::FloatingPointType::
+operator*=(const FloatingPointType &fp) {
+  typedef void (FloatingPointType::*AdaptedOpTy)(FloatingPointType &,
+                                                 const ArithmeticState &);
+  static const AdaptedOpTy impls[] = {
+      &FloatingPointType::mulAdapted<0>, &FloatingPointType::mulAdapted<1>,
+      &FloatingPointType::mulAdapted<2>, &FloatingPointType::mulAdapted<3>,
+      &FloatingPointType::mulAdapted<4>, &FloatingPointType::mulAdapted<5>,
+      &FloatingPointType::mulAdapted<6>, &FloatingPointType::mulAdapted<7> };
+  const ArithmeticState &ctx = ArithmeticContext::current();
+  MemoKey key;
+  bool memo = ctx.memoEntries != 0 &&
+              fap_memo_key_(FAP_MEMO_MUL, *this, fp, ctx, &key);
+  if (memo && fap_memo_lookup_(key, ctx, this)) {
+    return *this;
   }
-
-  lhs.setExp(res_exp);
-  less_exp_op->shift(exp_diff);
-  lhs.setGrs(less_exp_op->getGrs()); // Set the result grs
-//  less_exp_op->exp += (exp_diff);
+  FloatingPointType rhs = fp;
 
 #ifdef _FAP_DEBUG_
-  fap_print_binary(&op1, "FAP_FP_ADD - op1_post_shift");
-  fap_print_binary(&op2, "FAP_FP_ADD - op2_post_shift");
-  fap_print_binary(fp_res, "FAP_FP_ADD - res_pre");
+  this->setName("Result");
+  rhs.setName("Operand 2");
 #endif
-  // Now the mantix are alligned on radix point
-  // Manage the mantissa and sign
-  // If the sign are egual remains that
-  if (lhs.getSign() == rhs.getSign()) {
-    this->mant = lhs.getMant() + rhs.getMant();
-  } else {
-    if (lhs.getMant() >= rhs.getMant()) {
-      //      this->sign = fap_fp_get_sign(&op1);
-      this->mant = lhs.getMant() - rhs.getMant();
-    } else {
-      this->sign = rhs.getSign();
-      this->mant = -lhs.getMant() + rhs.getMant();
-    }
-  }
 
-  // Case the SUM is 0
-  if (this->mant == 0) {
-    lhs.setExp(0);
+  this->adaptPrec(rhs);
+  (this->*impls[ctx.fastMath & FAP_FAST_MATH_ALL])(rhs, ctx);
+  if (memo) {
+    fap_memo_store_(key, *this);
   }
-#ifdef _FAP_DEBUG_
-  fap_print_binary(fp_res, "FAP_FP_ADD - res");
-#endif
-  // Normalize
-  lhs.normalize((sizeof(MantType) * 8), op_prec * 2);
-  // Shift
-  lhs.shift(op_prec);
-  // Mask
-  lhs.setMant(lhs.getMant());
-  // Round
-  lhs.round();
-  ///////////////////////////////////////////////////////////////////////////////
-
-  return lhs;
-}
-
-::fap::FloatingPointType & ::fap::FloatingPointType::
-operator-=(const FloatingPointType &fp) {
-  //  ::std::cout << "Custom Sub";
-  *this += (-fp);
   return *this;
 }
 
 ::fap::FloatingPointType & ::fap::FloatingPointType::
-operator*=(const FloatingPointType &fp) {
-  FloatingPointType &lhs = *this;
+operator/=(const FloatingPointType &fp) {
+  typedef void (FloatingPointType::*AdaptedOpTy)(FloatingPointType &,
+                                                 const ArithmeticState &);
+  static const AdaptedOpTy impls[] = {
+      &FloatingPointType::divAdapted<0>, &FloatingPointType::divAdapted<1>,
+      &FloatingPointType::divAdapted<2>, &FloatingPointType::divAdapted<3>,
+      &FloatingPointType::divAdapted<4>, &FloatingPointType::divAdapted<5>,
+      &FloatingPointType::divAdapted<6>, &FloatingPointType::divAdapted<7> };
+  const ArithmeticState &ctx = ArithmeticContext::current();
+  MemoKey key;
+  bool memo = ctx.memoEntries != 0 &&
+              fap_memo_key_(FAP_MEMO_DIV, *this, fp, ctx, &key);
+  if (memo && fap_memo_lookup_(key, ctx, this)) {
+    return *this;
+  }
   FloatingPointType rhs = fp;
 
 #ifdef _FAP_DEBUG_
-  lhs.setName("Result");
+  this->setName("Result");
   rhs.setName("Operand 2");
 #endif
 
   this->adaptPrec(rhs);
+  (this->*impls[ctx.fastMath & FAP_FAST_MATH_ALL])(rhs, ctx);
+  if (memo) {
+    fap_memo_store_(key, *this);
+  }
+  return *this;
+}
 
-  // One of the operands is NaN
-  // x * NaN or NaN * NaN
-  if (lhs.isNaN() || rhs.isNaN()) {
-    // Set the result NaN
-    lhs.isNaN();
-    return lhs;
+template<uint8_t FastMath>
+MantType fap::FloatingPointType::getOperandSignificand(int &exp2) const {
+  if ((FastMath & FAP_FAST_MATH_DAZ) && this->getExp() == 0) {
+    // Subnormal operands are zeroes
+    exp2 = 1 - EXPONENT_BIAS(this->prec.exp_size) - this->prec.mant_size;
+    return 0;
   }
+  return this->getSignificand(exp2);
+}
 
-  // Set the sign
-  lhs.setSign(lhs.getSign() ^ rhs.getSign());
-  // One of the operands is infinity
-  if (lhs.isInf() || rhs.isInf()) {
-    // Infinity * Infinity
-    if (lhs.isInf() && rhs.isInf()) {
+template<uint8_t FastMath>
+void ::fap::FloatingPointType::addAdapted(FloatingPointType &rhs,
+                                          const ArithmeticState &ctx) {
+  FloatingPointType &lhs = *this;
+
+  if (!(FastMath & FAP_FAST_MATH_FINITE)) {
+    // One of the operands is NaN
+    if (lhs.isNaN() || rhs.isNaN()) {
       // Set the result NaN
       lhs.setNaN();
-      return lhs;
+      lhs.setSpecialResult(ctx);
+      return;
     }
-    // Not both are infinity, the infinity dominates
-    // Infinity * 0
-    if (lhs.isZero() || rhs.isZero()) {
-      // Set the result NaN
-      lhs.setNaN();
-      return lhs;
+
+    // One of the operands is infinity
+    if (lhs.isInf() || rhs.isInf()) {
+      if ((lhs.isPinf() && rhs.isNinf()) || (rhs.isPinf() && lhs.isNinf())) {
+        // Set the result NaN
+        lhs.setNaN();
+      } else if (rhs.isInf()) {
+        // Not both are infinity, the infinity dominates
+        lhs.setInf();
+        lhs.setSign(rhs.getSign());
+      }
+      lhs.setSpecialResult(ctx);
+      return;
     }
-    lhs.setInf();
-    return lhs;
   }
 
-  // Check special cases
-  // x * 0
-  if (lhs.isZero() || rhs.isZero()) {
-    lhs.setZero();
-    return lhs;
+  ///////////////////////////////////////////////////////////////////////////////
+  // Always take the operand with the minor exponent to the major one
+  int lhs_exp2, rhs_exp2;
+  MantType lhs_sig = lhs.getOperandSignificand<FastMath>(lhs_exp2);
+  MantType rhs_sig = rhs.getOperandSignificand<FastMath>(rhs_exp2);
+  SignType lhs_sign = lhs.getSign(), rhs_sign = rhs.getSign();
+  if (lhs_exp2 < rhs_exp2) {
+    ::std::swap(lhs_sig, rhs_sig);
+    ::std::swap(lhs_exp2, rhs_exp2);
+    ::std::swap(lhs_sign, rhs_sign);
+  }
+  // The major one is shifted on the left while there is room, at least
+  // 3 bits as guard, round and sticky, the minor one is shifted on the
+  // right jamming the lost bits in its lsb
+  int exp_diff = lhs_exp2 - rhs_exp2;
+  int room = (sizeof(MantType) * 8 - 2) - (this->prec.mant_size + 1);
+  int to_shift = exp_diff < room ? exp_diff : room;
+  lhs_sig <<= to_shift;
+  lhs_exp2 -= to_shift;
+  exp_diff -= to_shift;
+  if (exp_diff >= (int)(sizeof(MantType) * 8)) {
+    rhs_sig = rhs_sig != 0 ? 0x01 : 0x00;
+  } else if (exp_diff > 0) {
+    bool lost = (rhs_sig & MASK_LOWER_HIGH(MantType, exp_diff)) != 0;
+    rhs_sig = (rhs_sig >> exp_diff) | (lost ? 0x01 : 0x00);
   }
 
-  lhs.setMantHb();
-  rhs.setMantHb();
-#ifdef _FAP_DEBUG_
-  fap_print_binary(&op1, "FAP_FP_MUL - op1_whb");
-  fap_print_binary(&op2, "FAP_FP_MUL - op2_whb");
-#endif
-
-  // MASK_BIT_HIGH of mant size create a mask with the mant_size + 1 bit high
-  // Create result product between mantissa and mask with mant_size * 2 mask
-  int mant_double_size = (lhs.getPrec().mant_size + 1) * 2;
-  this->mant = MASK_LOWER_HIGH(MantType, mant_double_size) &
-               (lhs.getMant() * rhs.getMant());
-  // Compute exponent subtracting the bias (exp + bias + exp + bias -> new_exp +
-  // 2bias -bias --> new_exp + bias
-  lhs.setExp(lhs.getExp() + rhs.getExp() -
-             EXPONENT_BIAS(lhs.getPrec().exp_size));
-#ifdef _FAP_DEBUG_
-  fap_print_binary(fp_res, "FAP_FP_MUL - res");
-#endif
-  // Multiplication of mantissas create a double sized mantissa
-  // Multiplying 2 number of the type 1.x * 1.x --> yy.xx so there are 2 bits
-  // after the radix,
-  // there are problems when yy = 01 because there is a shift more
-  // Manage this problem
-  int actual_mant_prec = mant_double_size - 1; // Covers 10/11
-  lhs.normalize((sizeof(MantType) * 8), actual_mant_prec);
-
-  // Re-shift to mant_size
-  int to_shift = actual_mant_prec - (lhs.getPrec().mant_size + 1);
-  lhs.shift(to_shift);
-#ifdef _FAP_DEBUG_
-  fap_print_binary(fp_res, "FAP_FP_MUL - res_post_shift");
-#endif
-  // Mask
-  lhs.setMant(lhs.getMant());
-  // Round
-  lhs.round();
+  // Now the mantissas are aligned on radix point
+  // Manage the mantissa and sign
+  // If the signs are equal remains that
+  MantType res_sig;
+  SignType res_sign = lhs_sign;
+  if (lhs_sign == rhs_sign) {
+    res_sig = lhs_sig + rhs_sig;
+  } else if (lhs_sig >= rhs_sig) {
+    res_sig = lhs_sig - rhs_sig;
+  } else {
+    res_sign = rhs_sign;
+    res_sig = rhs_sig - lhs_sig;
+  }
 
-  return lhs;
+  // Case the SUM is 0 with opposite signs, it is +0 but rounding toward
+  // -infinity, as the sum of opposite zeroes
+  if (res_sig == 0 && lhs_sign != rhs_sign) {
+    res_sign = ctx.rounding == FAP_FP_ROUND_TOWARD_NINF;
+  }
+  // Normalize and round
+  lhs.setResult<FastMath>(ctx, res_sign, res_sig, lhs_exp2);
+  ///////////////////////////////////////////////////////////////////////////////
 }
 
-::fap::FloatingPointType & ::fap::FloatingPointType::
-operator/=(const FloatingPointType &fp) {
+template<uint8_t FastMath>
+void ::fap::FloatingPointType::mulAdapted(FloatingPointType &rhs,
+                                          const ArithmeticState &ctx) {
   FloatingPointType &lhs = *this;
-  FloatingPointType rhs = fp;
 
-#ifdef _FAP_DEBUG_
-  lhs.setName("Result");
-  rhs.setName("Operand 2");
-#endif
-
-  this->adaptPrec(rhs);
+  if (!(FastMath & FAP_FAST_MATH_FINITE)) {
+    // One of the operands is NaN
+    // x * NaN or NaN * NaN
+    if (lhs.isNaN() || rhs.isNaN()) {
+      // Set the result NaN
+      lhs.setNaN();
+      lhs.setSpecialResult(ctx);
+      return;
+    }
 
-  // One of the operands is NaN
-  // x * NaN or NaN * NaN
-  if (lhs.isNaN() || rhs.isNaN()) {
-    // Set the result NaN
-    lhs.isNaN();
-    return lhs;
+    // One of the operands is infinity
+    if (lhs.isInf() || rhs.isInf()) {
+      lhs.setSign(lhs.getSign() ^ rhs.getSign());
+      // Infinity * 0, the subnormals are zeroes under DAZ
+      if (lhs.isZero() || rhs.isZero() ||
+          ((FastMath & FAP_FAST_MATH_DAZ) && (lhs.isSubN() || rhs.isSubN()))) {
+        // Set the result NaN
+        lhs.setNaN();
+      } else {
+        // The infinity dominates
+        lhs.setInf();
+      }
+      lhs.setSpecialResult(ctx);
+      return;
+    }
   }
 
-  // Set the sign
-  lhs.setSign(lhs.getSign() ^ rhs.getSign());
-  // Dividend is infinity
-  // - infinity/x
-  if (lhs.isInf()) {
-    // infinity/infinity
+  // The product of the significands is exact on a double sized mantissa,
+  // 1.x * 1.x --> yy.xx, the normalization is left to setResult, as x * 0.
+  // Over 63 bits of mantissa the lower bits are jammed in its lsb.
+  int lhs_exp2, rhs_exp2;
+  MantType lhs_sig = lhs.getOperandSignificand<FastMath>(lhs_exp2);
+  MantType rhs_sig = rhs.getOperandSignificand<FastMath>(rhs_exp2);
+  int exp2 = lhs_exp2 + rhs_exp2;
+  MantType prod = fap_mul_sig_(lhs_sig, rhs_sig, &exp2);
+  lhs.setResult<FastMath>(ctx, lhs.getSign() ^ rhs.getSign(), prod, exp2);
+}
+
+template<uint8_t FastMath>
+void ::fap::FloatingPointType::divAdapted(FloatingPointType &rhs,
+                                          const ArithmeticState &ctx) {
+  FloatingPointType &lhs = *this;
+
+  if (!(FastMath & FAP_FAST_MATH_FINITE)) {
+    // One of the operands is NaN
+    // x / NaN or NaN / NaN
+    if (lhs.isNaN() || rhs.isNaN()) {
+      // Set the result NaN
+      lhs.setNaN();
+      lhs.setSpecialResult(ctx);
+      return;
+    }
+
+    // Dividend is infinity
+    // - infinity/x
+    if (lhs.isInf()) {
+      lhs.setSign(lhs.getSign() ^ rhs.getSign());
+      // infinity/infinity
+      if (rhs.isInf()) {
+        lhs.setNaN();
+      }
+      lhs.setSpecialResult(ctx);
+      return;
+    }
+    // Divisor is infinity
     if (rhs.isInf()) {
-      lhs.isNaN();
-      return lhs;
+      // x/infinity
+      lhs.setSign(lhs.getSign() ^ rhs.getSign());
+      lhs.setZero();
+      lhs.setSpecialResult(ctx);
+      return;
     }
-    lhs.setInf();
-  }
-  // Divisor is infinity
-  if (rhs.isInf()) {
-    // x/infinity
-    lhs.setZero();
-    return lhs;
-  }
-  // Divisor is 0
-  if (rhs.isZero()) {
-    lhs.setInf();
-    return lhs;
   }
 
+  // Set the sign
+  SignType sign = lhs.getSign() ^ rhs.getSign();
+  int lhs_exp2, rhs_exp2;
+  MantType lhs_sig = lhs.getOperandSignificand<FastMath>(lhs_exp2);
+  MantType rhs_sig = rhs.getOperandSignificand<FastMath>(rhs_exp2);
+
   // Check special cases
-  // Dividend is 0
-  if (lhs.isZero()) {
-    return lhs;
+  // Divisor is 0
+  if (rhs_sig == 0) {
+    lhs.setSign(sign);
+    if (FastMath & FAP_FAST_MATH_FINITE) {
+      // Greatest finite value, 0/0 gives 0
+      if (lhs_sig == 0) {
+        lhs.setZero();
+      } else {
+        lhs.setExp(MASK_LOWER_HIGH(ExpType, lhs.prec.exp_size) - 1);
+        lhs.setMant(MASK_LOWER_HIGH(MantType, lhs.prec.mant_size));
+      }
+    } else if (lhs_sig == 0) {
+      // 0/0
+      lhs.setNaN();
+    } else {
+      lhs.setInf();
+    }
+    lhs.setSpecialResult(ctx);
+    return;
   }
 
-  // Normal cases
-  uint16_t precision = lhs.getPrec().mant_size + 1;
-  lhs.setMantHb();
-  rhs.setMantHb();
-#ifdef _FAP_DEBUG_
-  fap_print_binary(&op1, "FAP_FP_DIV - op1_whb");
-  fap_print_binary(&op2, "FAP_FP_DIV - op2_whb");
-#endif
-  // Shift dividend
-  int round_shift = (sizeof(MantType) * 8) - precision * 2;
-  int dividend_shift =
-      precision +
-      round_shift; // + round_shift for the guard,round and sticky bits
-  lhs.shift(-dividend_shift);
-
-#ifdef _FAP_DEBUG_
-  fap_print_binary(&op1, "FAP_FP_DIV - op1_whb_shift");
-#endif
-
-  // MASK_BIT_HIGH of mant size create a mask with the mant_size + 1 bit high
-  // Create result product between mantissa and mask with mant_size * 2 mask
-  this->mant = (lhs.getMant() / rhs.getMant());
-  lhs.shift(round_shift);
-
-  // Calculate exponent
-  lhs.setExp(lhs.getExp() - rhs.getExp() +
-             EXPONENT_BIAS(lhs.getPrec().exp_size) - 1);
-#ifdef _FAP_DEBUG_
-  fap_print_binary(fp_res, "FAP_FP_DIV - res");
-#endif
-  // Multiplication of mantissas create a double sized mantissa
-  lhs.normalize((sizeof(MantType) * 8), precision);
-  // Truncate to correct mant precision
-  lhs.setMant(this->mant);
-  // Round
-  lhs.round();
-
-  return lhs;
+  // Normal cases, the dividend 0 gives the quotient 0
+  if (lhs.prec.mant_size > FAP_DIV_WORD_MANT_SIZE) {
+    // The quotient is computed on 64 bits words, with the sticky bit
+    int exp2 = lhs_exp2 - rhs_exp2;
+    MantType quot = fap_div_sig_(lhs_sig, rhs_sig, &exp2);
+    lhs.setResult<FastMath>(ctx, sign, quot, exp2);
+    return;
+  }
+  // Shift the dividend on the msb and the divisor on the 64th bit, the
+  // quotient has at least 63 bits, 3 more are computed from the remainder
+  // for the guard, round and sticky bits
+  int lhs_shift = fap_clz_(lhs_sig) - 1;
+  int rhs_shift = fap_clz_(rhs_sig) - (sizeof(MantType) * 8 / 2);
+  lhs_sig <<= lhs_shift;
+  rhs_sig = rhs_shift >= 0 ? rhs_sig << rhs_shift : rhs_sig >> -rhs_shift;
+  MantType quot = lhs_sig / rhs_sig;
+  MantType rem = (lhs_sig % rhs_sig) << 3;
+  quot = (quot << 3) | (rem / rhs_sig);
+  // The remainder gives the sticky bit
+  if (rem % rhs_sig != 0) {
+    quot |= 0x01;
+  }
+  lhs.setResult<FastMath>(ctx, sign, quot,
+                          lhs_exp2 - lhs_shift - rhs_exp2 + rhs_shift - 3);
 }
 ///////////////////////////////////////////////////////////////////////////////
 void ::fap::FloatingPointType::changePrec(::fap::FloatPrecTy new_prec) {
@@ -534,7 +769,25 @@ void ::fap::FloatingPointType::changePrec(::fap::FloatPrecTy new_prec) {
          new_prec.exp_size, new_prec.mant_size);
   fap_print_binary(this, "FAP_FP_CHANGE_PREC - old");
 #endif
-  if (this->prec.exp_size != new_prec.exp_size) {
+  if (this->prec.exp_size < new_prec.exp_size) {
+    // A wider exponent holds the value exactly: the exponent is re-biased
+    // and the subnormals are normalized
+    FloatPrecTy wide_prec(new_prec.exp_size, this->prec.mant_size);
+    if (this->exp == MASK_LOWER_HIGH(ExpType, this->prec.exp_size)) {
+      // Infinity or NaN, the payload is kept
+      this->exp = MASK_LOWER_HIGH(ExpType, wide_prec.exp_size);
+    } else if (this->exp != 0) {
+      this->exp = (ExpType)((int)this->exp -
+                            (int)EXPONENT_BIAS(this->prec.exp_size) +
+                            (int)EXPONENT_BIAS(wide_prec.exp_size));
+    } else if (this->mant != 0) {
+      int exp2;
+      MantType sig = this->getSignificand(exp2);
+      this->setSignificand(this->getSign(), sig, exp2, this->grs != 0,
+                           wide_prec, FAP_FP_ROUND_NEAREST);
+    }
+    this->prec.exp_size = wide_prec.exp_size;
+  } else if (this->prec.exp_size != new_prec.exp_size) {
     // Re-bias and round, if necessary, the exponent
     uint128_t expanded_exp = this->exp;
     // De-bias the exponent
@@ -575,16 +828,30 @@ void ::fap::FloatingPointType::changePrec(::fap::FloatPrecTy new_prec) {
   fap_print_binary(this, "FAP_FP_CHANGE_PREC - after_exp");
 #endif
   if (this->prec.mant_size != new_prec.mant_size) {
+    bool nan = this->isNaN();
     // Shift the mantissa to fit the new precision
     prec_diff = this->prec.mant_size - new_prec.mant_size;
-    this->shift(prec_diff);
+    FAP_rounding_method method = ArithmeticContext::current().rounding;
+    if (method == FAP_FP_ROUND_STOCHASTIC && prec_diff > 0 &&
+        this->grs == 0x00) {
+      // Rounding with all the discarded bits, the carry is checked by
+      // round() with the grs at zero
+      this->mant = fap_round_shift_(this->mant, prec_diff, this->getSign(),
+                                    method);
+    } else {
+      this->shift(prec_diff);
+    }
 
     // Update mantissa size
     this->prec.mant_size = new_prec.mant_size;
     // Apply round if necessary
     if (prec_diff > 0) {
       // Round
-      this->round();
+      this->round(method);
+      if (nan) {
+        // The payload may be all in the discarded bits
+        this->setNaN();
+      }
     }
   }
 #ifdef _FAP_DEBUG_
@@ -617,6 +884,147 @@ void ::fap::FloatingPointType::adaptPrec(FloatingPointType &rhs) {
 #endif
 }
 
+MantType ::fap::FloatingPointType::getSignificand(int &exp2) const {
+  int bias = EXPONENT_BIAS(this->prec.exp_size);
+  if (this->getExp() == 0) {
+    // Subnormal (or zero), no hidden bit and minimum exponent
+    exp2 = 1 - bias - this->prec.mant_size;
+    return this->getMant();
+  }
+  exp2 = (int)this->getExp() - bias - this->prec.mant_size;
+  return MASK_BIT_HIGH(MantType, this->prec.mant_size) | this->getMant();
+}
+
+::fap::FloatingPointType fap::FloatingPointType::fromSignificand(
+    SignType sign, MantType sig, int exp2, bool sticky, FloatPrecTy prec,
+    FAP_rounding_method method) {
+  FloatingPointType res;
+  res.setSignificand(sign, sig, exp2, sticky, prec, method);
+  return res;
+}
+
+void ::fap::FloatingPointType::setSignificand(SignType sign, MantType sig,
+                                              int exp2, bool sticky,
+                                              FloatPrecTy prec,
+                                              FAP_rounding_method method) {
+  this->setPrec(prec);
+  this->setSign(sign);
+  this->setExp(0);
+  if (sig == 0) {
+    // Only the bits below can make a directed rounding leave the zero
+    this->mant = 0;
+    this->setGrs(sticky ? 0x01 : 0x00);
+    this->round(method);
+    return;
+  }
+
+  int bias = EXPONENT_BIAS(prec.exp_size);
+  int max_exp = MASK_LOWER_HIGH(ExpType, prec.exp_size);
+  int msb = (sizeof(MantType) * 8 - 1) - fap_clz_(sig);
+  int64_t biased_exp = (int64_t)exp2 + msb + bias;
+  // Right shift which aligns sig on the mantissa of the result
+  int64_t to_shift = msb - prec.mant_size;
+  if (biased_exp < 1) {
+    // Subnormal, the lsb has the weight of the minimum exponent
+    to_shift = (int64_t)(1 - bias - prec.mant_size) - exp2;
+    biased_exp = 0;
+  }
+
+  if (method == FAP_FP_ROUND_STOCHASTIC && to_shift > 0 &&
+      biased_exp < max_exp) {
+    // All the discarded bits give the probability, the sticky ones are
+    // folded in the lsb
+    sig = fap_round_shift_(sig | (sticky ? 0x01 : 0x00), to_shift, sign,
+                           method);
+    // Carry on the hidden bit, or from subnormal to normal
+    if (sig >> (prec.mant_size + (biased_exp != 0 ? 1 : 0)) != 0) {
+      biased_exp += 1;
+    }
+    // The greatest exponent with the zero mantissa is the infinity
+    this->setExp((ExpType)biased_exp);
+    this->setMant(sig);
+    this->setGrs(0x00);
+    return;
+  }
+
+  // Overflow
+  if (biased_exp >= max_exp) {
+    if (method == FAP_FP_ROUND_NEAREST || method == FAP_FP_ROUND_STOCHASTIC ||
+        (method == FAP_FP_ROUND_TOWARD_PINF && this->getSign() == 0) ||
+        (method == FAP_FP_ROUND_TOWARD_NINF && this->getSign() != 0)) {
+      this->setInf();
+    } else {
+      // Greatest finite value
+      this->setExp(max_exp - 1);
+      this->setMant(MASK_LOWER_HIGH(MantType, prec.mant_size));
+    }
+    this->setGrs(0x00);
+    return;
+  }
+
+  uint8_t grs = 0x00;
+  if (to_shift >= (int64_t)(sizeof(MantType) * 8)) {
+    // Only the msb can be the guard bit, the others are sticky
+    int top = sizeof(MantType) * 8 - 1;
+    bool guard = to_shift == top + 1 && (sig >> top) != 0;
+    MantType rest = guard ? sig << 1 : sig;
+    grs = (guard ? 0x04 : 0x00) | (rest != 0 ? 0x01 : 0x00);
+    sig = 0;
+  } else if (to_shift > 0) {
+    fap_shift_right_(&sig, to_shift, &grs);
+  } else if (to_shift < 0) {
+    sig <<= -to_shift;
+  }
+  if (sticky) {
+    grs |= 0x01;
+  }
+
+  this->exp = (ExpType)biased_exp;
+  this->setMant(sig);
+  this->setGrs(grs);
+  this->round(method);
+}
+
+template<uint8_t FastMath>
+void ::fap::FloatingPointType::setResult(const ArithmeticState &ctx,
+                                         SignType sign, MantType sig,
+                                         int exp2) {
+  FloatPrecTy res_prec = this->prec;
+  if (ctx.hasResultPrec) {
+    // Round once on the mantissa of the result
+    res_prec.mant_size = ctx.resultPrec.mant_size;
+  }
+  this->setSignificand(sign, sig, exp2, false, res_prec, ctx.rounding);
+  if ((FastMath & FAP_FAST_MATH_FTZ) && this->exp == 0) {
+    // Subnormal results are zeroes, keeping the sign
+    this->mant = 0;
+  }
+  if (((FastMath & FAP_FAST_MATH_FINITE) ||
+       ctx.special == FAP_SPECIAL_SATURATE) &&
+      this->isInf()) {
+    // Greatest finite value
+    this->setExp(MASK_LOWER_HIGH(ExpType, res_prec.exp_size) - 1);
+    this->setMant(MASK_LOWER_HIGH(MantType, res_prec.mant_size));
+  }
+  if (ctx.hasResultPrec && ctx.resultPrec.exp_size != res_prec.exp_size) {
+    // Only the exponent has to be reduced
+    this->changePrec(ctx.resultPrec);
+  }
+}
+
+void ::fap::FloatingPointType::setSpecialResult(const ArithmeticState &ctx) {
+  if (!ctx.hasResultPrec) {
+    return;
+  }
+  if (this->isNaN()) {
+    // The payload would be lost by the rounding
+    this->prec.mant_size = ctx.resultPrec.mant_size;
+    this->setNaN();
+    return;
+  }
+  this->changePrec(ctx.resultPrec);
+}
+
 void ::fap::FloatingPointType::test(float op1, float op2) {
   float res;
   ::fap::FloatingPointType fop1 = op1, fop2 = op2, fp_res, fapf_res_to_0,
@@ -758,12 +1166,14 @@ void ::fap::FloatingPointType::shift(int to_shift) {
 }
 
 void ::fap::FloatingPointType::normalize(int max_prec, int actual_prec) {
-  // First bit high relative to prec
-  int first_bit_high = 0;
-  while (((MASK_BIT_HIGH(MantType, ((max_prec - 1) - first_bit_high)) &
-           this->mant) == 0) &&
-         (first_bit_high < max_prec))
-    first_bit_high++;
+  // First bit high relative to prec, counting the leading zeros of the
+  // lower max_prec bits
+  MantType window = this->mant;
+  if (max_prec < (int)(sizeof(MantType) * 8)) {
+    window &= MASK_LOWER_HIGH(MantType, max_prec);
+  }
+  int first_bit_high =
+      fap_clz_(window) - ((int)(sizeof(MantType) * 8) - max_prec);
   if (first_bit_high != max_prec) {
     // Have to shift on the left or on the right?
     // Check the first high bit position respect to actual_prec
@@ -787,34 +1197,8 @@ void ::fap::FloatingPointType::round(FAP_rounding_method method) {
   printf("\nFAP_FP_ROUND - round_m=%d\n", round_m);
   fap_print_binary(fp, "FAP_FP_ROUND - old");
 #endif
-  // Modify the grs to match the proper rounding method
-  switch (method) {
-  case FAP_FP_ROUND_TOWARD_0: {
-    this->grs = 0;
-  } break;
-  case FAP_FP_ROUND_TOWARD_PINF: {
-    if (this->getSign() == 0x00 && this->grs != 0x00) {
-      this->grs = 0x07;
-    } else {
-      this->grs = 0x00;
-    }
-  } break;
-  case FAP_FP_ROUND_TOWARD_NINF: {
-    if (this->getSign() == 0x01 && this->grs != 0x00) {
-      this->grs = 0x07;
-    } else {
-      this->grs = 0x00;
-    }
-  } break;
-  default:
-    break;
-  }
-
-  // Apply nearest rounding method with grs updated
-  if (this->grs == 0x4 &&
-      ((this->mant & MASK_BIT_HIGH(MantType, 0)) == (MantType)1)) {
-    this->mant += 0x1;
-  } else if (grs >= 0x05) {
+  if (fap_round_up_((this->mant & MASK_BIT_HIGH(MantType, 0)) != 0, this->grs,
+                    this->getSign(), method)) {
     this->mant += 0x1;
   }
   // Check if the mant is now all zeros, but the hidden bit, mant_size-nth bit
@@ -896,6 +1280,17 @@ int128_t ::fap::IntegerType::getActualBits() const {
 ::fap::IntegerType & ::fap::IntegerType::operator/=(::fap::IntegerType rhs) {
   // Adapt precisions
   this->adaptPrec(rhs);
+  if (rhs.getBits() == 0) {
+    // Division by zero saturates on the original precision, with the
+    // neglected bits cleared, 0/0 gives 0
+    if (this->bits != 0) {
+      int128_t max = MASK_LOWER_HIGH(int128_t, (this->oriPrecision - 1));
+      this->bits = (this->bits < 0 ? ~max : max) &
+                   MASK_LOWER_LOW(int128_t,
+                                  (this->oriPrecision - this->actualPrecision));
+    }
+    return *this;
+  }
   this->bits /= rhs.getBits();
   return *this;
 }
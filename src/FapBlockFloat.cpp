@@ -0,0 +1,404 @@
+//===- FapBlockFloat.cpp ----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapBlockFloat.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Block floating point type - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapBlockFloat.h"
+#include "FapLazy.h"
+
+#include <math.h>
+#include <string.h>
+
+/// @brief Bits of the exact block results, below the int64_t limit
+#define FAP_BLOCK_WIDE_SIZE           62
+
+namespace {
+
+inline uint64_t magnitude(int64_t val) {
+  return val < 0 ? -(uint64_t)val : (uint64_t)val;
+}
+
+inline int bitLength(uint64_t val) {
+  return val != 0 ? 64 - __builtin_clzll(val) : 0;
+}
+
+/// @brief Same as fap_round_shift_ on 64 bits, inlined in the block loops
+inline uint64_t roundShift(uint64_t mag, int to_shift, SignType sign,
+                           FAP_rounding_method method) {
+  if (to_shift <= 0) {
+    return mag << -to_shift;
+  }
+  if (to_shift >= 64) {
+    return (uint64_t)fap_round_shift_(mag, to_shift, sign, method);
+  }
+  uint64_t res = mag >> to_shift;
+  uint64_t rem = mag & MASK_LOWER_HIGH(uint64_t, to_shift);
+  uint64_t half = MASK_BIT_HIGH(uint64_t, (to_shift - 1));
+  switch (method) {
+  case FAP_FP_ROUND_NEAREST:
+    return res + (rem > half || (rem == half && (res & 0x1) != 0));
+  case FAP_FP_ROUND_TOWARD_0:
+    return res;
+  case FAP_FP_ROUND_TOWARD_PINF:
+    return res + (rem != 0 && sign == 0);
+  case FAP_FP_ROUND_TOWARD_NINF:
+    return res + (rem != 0 && sign != 0);
+  default:
+    return (uint64_t)fap_round_shift_(mag, to_shift, sign, method);
+  }
+}
+
+/// @brief Decompose a double as (-1)^sign * sig * 2^exp2, 0 if not finite
+void decompose(double d, SignType& sign, MantType& sig, int& exp2) {
+  sign = signbit(d) ? 1 : 0;
+  if (!isfinite(d) || d == 0.0) {
+    sig = 0;
+    exp2 = 0;
+    return;
+  }
+  int e;
+  double f = frexp(fabs(d), &e);
+  sig = (MantType)ldexp(f, DOUBLE_MANT_SIZE + 1);
+  exp2 = e - (DOUBLE_MANT_SIZE + 1);
+}
+
+}  // end anonymous namespace
+
+template<typename MantTy>
+::fap::BlockFloat<MantTy>::BlockFloat(size_t size, size_t block_size,
+                                      uint16_t mant_size)
+    : blockSize(block_size),
+      mantSize(mant_size) {
+  // The products of two mantissas have to enter in the wide results
+  if (block_size == 0 || mant_size == 0 ||
+      mant_size >= sizeof(MantTy) * 8 ||
+      2 * (mant_size + 1) > FAP_BLOCK_WIDE_SIZE) {
+    ::std::cerr << "BlockFloat mantissa size not supported by the storage";
+    exit(1);
+  }
+  this->resize(size);
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::resize(size_t size) {
+  this->mants.assign(size, 0);
+  this->exps.assign((size + this->blockSize - 1) / this->blockSize,
+                    FAP_BLOCK_ZERO_EXP);
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::quantizeBlock(size_t block,
+                                              const SignType *sign,
+                                              const MantType *sig,
+                                              const int *exp2,
+                                              FAP_rounding_method method) {
+  size_t begin = block * this->blockSize;
+  size_t n = ::std::min(this->blockSize, this->mants.size() - begin);
+  // Position of the highest bit of the block
+  bool is_zero = true;
+  int top = 0;
+  for (size_t j = 0; j < n; ++j) {
+    if (sig[j] != 0) {
+      int pos = exp2[j] + (sizeof(MantType) * 8 - 1) - fap_clz_(sig[j]);
+      top = (is_zero || pos > top) ? pos : top;
+      is_zero = false;
+    }
+  }
+  if (is_zero) {
+    memset(&this->mants[begin], 0, n * sizeof(MantTy));
+    this->exps[block] = FAP_BLOCK_ZERO_EXP;
+    return;
+  }
+
+  // Shared exponent, incremented if the rounding overflows the mantissa
+  int exp = top + 1 - this->mantSize;
+  for (bool overflow = true; overflow; exp++) {
+    overflow = false;
+    for (size_t j = 0; j < n && !overflow; ++j) {
+      // The zeroes need no alignment, their exponents are meaningless
+      uint128_t mag = sig[j] == 0 ? 0
+          : fap_round_shift_(sig[j], exp - exp2[j], sign[j], method);
+      overflow = (mag >> this->mantSize) != 0;
+      this->mants[begin + j] = sign[j] != 0 ? -(MantTy)mag : (MantTy)mag;
+    }
+    this->exps[block] = exp;
+  }
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::setBlock(size_t block, const int64_t *wide,
+                                         int exp,
+                                         FAP_rounding_method method) {
+  size_t begin = block * this->blockSize;
+  size_t n = ::std::min(this->blockSize, this->mants.size() - begin);
+  uint64_t max_mag = 0;
+  for (size_t j = 0; j < n; ++j) {
+    max_mag |= magnitude(wide[j]);
+  }
+  if (max_mag == 0) {
+    memset(&this->mants[begin], 0, n * sizeof(MantTy));
+    this->exps[block] = FAP_BLOCK_ZERO_EXP;
+    return;
+  }
+
+  // Normalize the block on the highest bit, rounding the lower ones
+  int to_shift = bitLength(max_mag) - this->mantSize;
+  for (bool overflow = true; overflow; to_shift++) {
+    overflow = false;
+    for (size_t j = 0; j < n && !overflow; ++j) {
+      SignType sign = wide[j] < 0 ? 1 : 0;
+      uint64_t mag = roundShift(magnitude(wide[j]), to_shift, sign, method);
+      overflow = (mag >> this->mantSize) != 0;
+      this->mants[begin + j] = sign != 0 ? -(MantTy)mag : (MantTy)mag;
+    }
+    this->exps[block] = exp + to_shift;
+  }
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::assign(const double *vals, size_t n,
+                                       FAP_rounding_method method) {
+  this->resize(n);
+  ::std::vector<SignType> sign(this->blockSize);
+  ::std::vector<MantType> sig(this->blockSize);
+  ::std::vector<int> exp2(this->blockSize);
+  for (size_t block = 0; block < this->exps.size(); ++block) {
+    size_t begin = block * this->blockSize;
+    for (size_t j = 0; j < this->blockSize && begin + j < n; ++j) {
+      decompose(vals[begin + j], sign[j], sig[j], exp2[j]);
+    }
+    this->quantizeBlock(block, sign.data(), sig.data(), exp2.data(), method);
+  }
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::assign(const float *vals, size_t n,
+                                       FAP_rounding_method method) {
+  ::std::vector<double> wide(vals, vals + n);
+  this->assign(wide.data(), n, method);
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::assign(const FloatingPointType *fps, size_t n,
+                                       FAP_rounding_method method) {
+  this->resize(n);
+  ::std::vector<SignType> sign(this->blockSize);
+  ::std::vector<MantType> sig(this->blockSize);
+  ::std::vector<int> exp2(this->blockSize);
+  for (size_t block = 0; block < this->exps.size(); ++block) {
+    size_t begin = block * this->blockSize;
+    for (size_t j = 0; j < this->blockSize && begin + j < n; ++j) {
+      const FloatingPointType &fp = fps[begin + j];
+      sign[j] = fp.getSign();
+      // Special values are not representable, they are quantized to zero
+      if (fp.isNaN() || fp.isInf()) {
+        sig[j] = 0;
+        exp2[j] = 0;
+      } else {
+        sig[j] = fp.getSignificand(exp2[j]);
+      }
+    }
+    this->quantizeBlock(block, sign.data(), sig.data(), exp2.data(), method);
+  }
+}
+
+template<typename MantTy>
+double ::fap::BlockFloat<MantTy>::getDouble(size_t i) const {
+  return ldexp((double)this->mants[i], this->exps[i / this->blockSize]);
+}
+
+template<typename MantTy>
+::fap::FloatingPointType fap::BlockFloat<MantTy>::get(
+    size_t i, FloatPrecTy prec, FAP_rounding_method method) const {
+  MantTy m = this->mants[i];
+  SignType sign = m < 0 ? 1 : 0;
+  return FloatingPointType::fromSignificand(
+      sign, magnitude(m), this->exps[i / this->blockSize], false, prec, method);
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::toDouble(double *out) const {
+  for (size_t block = 0; block < this->exps.size(); ++block) {
+    size_t begin = block * this->blockSize;
+    size_t n = ::std::min(this->blockSize, this->mants.size() - begin);
+    double scale = ldexp(1.0, this->exps[block]);
+    for (size_t j = 0; j < n; ++j) {
+      out[begin + j] = this->mants[begin + j] * scale;
+    }
+  }
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::toFloat(float *out) const {
+  for (size_t i = 0; i < this->mants.size(); ++i) {
+    out[i] = (float)this->getDouble(i);
+  }
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::toFloatingPoint(
+    FloatingPointType *out, FloatPrecTy prec,
+    FAP_rounding_method method) const {
+  for (size_t i = 0; i < this->mants.size(); ++i) {
+    out[i] = this->get(i, prec, method);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Kernels
+
+/// @brief Check that the operands have the same layout and prepare res
+template<typename MantTy>
+static void checkLayout(const ::fap::BlockFloat<MantTy> &a,
+                        const ::fap::BlockFloat<MantTy> &b,
+                        ::fap::BlockFloat<MantTy> &res) {
+  if (a.size() != b.size() || a.getBlockSize() != b.getBlockSize()) {
+    ::std::cerr << "BlockFloat operands with different layout";
+    exit(1);
+  }
+  if (res.size() != a.size() || res.getBlockSize() != a.getBlockSize()) {
+    res = ::fap::BlockFloat<MantTy>(a.size(), a.getBlockSize(),
+                                    res.getMantSize());
+  }
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::add(const BlockFloat &a, const BlockFloat &b,
+                                    BlockFloat &res,
+                                    FAP_rounding_method method) {
+  checkLayout(a, b, res);
+  ::std::vector<int64_t> wide(a.blockSize);
+  int mant_size = a.mantSize > b.mantSize ? a.mantSize : b.mantSize;
+  // Maximum alignment keeping the exact sum on the wide results
+  int max_shift = FAP_BLOCK_WIDE_SIZE - 1 - mant_size;
+  for (size_t block = 0; block < a.exps.size(); ++block) {
+    size_t begin = block * a.blockSize;
+    size_t n = ::std::min(a.blockSize, a.mants.size() - begin);
+    // The mantissas of the block with the higher exponent are shifted left
+    const MantTy *high = &a.mants[begin], *low = &b.mants[begin];
+    int high_exp = a.exps[block], low_exp = b.exps[block];
+    if (low_exp > high_exp) {
+      ::std::swap(high, low);
+      ::std::swap(high_exp, low_exp);
+    }
+    int diff = high_exp - low_exp;
+    if (diff <= max_shift) {
+      for (size_t j = 0; j < n; ++j) {
+        wide[j] = (int64_t)high[j] * ((int64_t)1 << diff) + low[j];
+      }
+      res.setBlock(block, wide.data(), low_exp, method);
+    } else {
+      // Only the rounding of the lower block is left
+      int low_shift = diff - max_shift;
+      for (size_t j = 0; j < n; ++j) {
+        SignType sign = low[j] < 0 ? 1 : 0;
+        int64_t low_mag =
+            (int64_t)roundShift(magnitude(low[j]), low_shift, sign, method);
+        wide[j] = (int64_t)high[j] * ((int64_t)1 << max_shift) +
+                  (sign != 0 ? -low_mag : low_mag);
+      }
+      res.setBlock(block, wide.data(), high_exp - max_shift, method);
+    }
+  }
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::sub(const BlockFloat &a, const BlockFloat &b,
+                                    BlockFloat &res,
+                                    FAP_rounding_method method) {
+  BlockFloat neg_b = b;
+  for (size_t i = 0; i < neg_b.mants.size(); ++i) {
+    neg_b.mants[i] = -neg_b.mants[i];
+  }
+  add(a, neg_b, res, method);
+}
+
+template<typename MantTy>
+void ::fap::BlockFloat<MantTy>::mul(const BlockFloat &a, const BlockFloat &b,
+                                    BlockFloat &res,
+                                    FAP_rounding_method method) {
+  checkLayout(a, b, res);
+  ::std::vector<int64_t> wide(a.blockSize);
+  for (size_t block = 0; block < a.exps.size(); ++block) {
+    size_t begin = block * a.blockSize;
+    size_t n = ::std::min(a.blockSize, a.mants.size() - begin);
+    if (a.exps[block] == FAP_BLOCK_ZERO_EXP ||
+        b.exps[block] == FAP_BLOCK_ZERO_EXP) {
+      memset(&wide[0], 0, n * sizeof(int64_t));
+      res.setBlock(block, wide.data(), 0, method);
+      continue;
+    }
+    const MantTy *ma = &a.mants[begin], *mb = &b.mants[begin];
+    for (size_t j = 0; j < n; ++j) {
+      wide[j] = (int64_t)ma[j] * mb[j];
+    }
+    res.setBlock(block, wide.data(), a.exps[block] + b.exps[block], method);
+  }
+}
+
+template<typename MantTy>
+::fap::FloatingPointType fap::BlockFloat<MantTy>::dot(const BlockFloat &a,
+                                                      const BlockFloat &b,
+                                                      FloatPrecTy prec) {
+  if (a.size() != b.size() || a.blockSize != b.blockSize) {
+    ::std::cerr << "BlockFloat operands with different layout";
+    exit(1);
+  }
+  FloatingPointType zero;
+  zero.setPrec(prec);
+  LazyFloatingPointType sum(zero);
+  // Partial sums of a block on 64 bits when they cannot overflow
+  int partial_size = a.mantSize + b.mantSize +
+                     bitLength(a.blockSize);
+  for (size_t block = 0; block < a.exps.size(); ++block) {
+    if (a.exps[block] == FAP_BLOCK_ZERO_EXP ||
+        b.exps[block] == FAP_BLOCK_ZERO_EXP) {
+      continue;
+    }
+    size_t begin = block * a.blockSize;
+    size_t n = ::std::min(a.blockSize, a.mants.size() - begin);
+    const MantTy *ma = &a.mants[begin], *mb = &b.mants[begin];
+    int128_t partial = 0;
+    if (partial_size < 63) {
+      int64_t partial64 = 0;
+      for (size_t j = 0; j < n; ++j) {
+        partial64 += (int64_t)ma[j] * mb[j];
+      }
+      partial = partial64;
+    } else {
+      for (size_t j = 0; j < n; ++j) {
+        partial += (int64_t)ma[j] * mb[j];
+      }
+    }
+    SignType sign = partial < 0 ? 1 : 0;
+    sum.addSignificand(sign, sign != 0 ? -(uint128_t)partial : partial,
+                       a.exps[block] + b.exps[block]);
+  }
+  return sum.getValue();
+}
+
+// Supported storages
+template class ::fap::BlockFloat<int8_t>;
+template class ::fap::BlockFloat<int16_t>;
+template class ::fap::BlockFloat<int32_t>;
@@ -0,0 +1,502 @@
+//===- FapCodegen.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapCodegen.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Precision-specialized kernels - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapCodegen.h"
+#include "FapContext.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+/// @brief Operations below which a worker is not worth a thread
+#ifndef FAP_CODEGEN_THREAD_WORK
+#define FAP_CODEGEN_THREAD_WORK       (1 << 16)
+#endif
+
+namespace {
+
+using ::fap::ArithmeticContext;
+using ::fap::ArithmeticState;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+/// @brief Helpers of the generated kernels. The values are doubles, exactly
+/// representable on the precision of their slot; the operations are exact
+/// on 128 bit significands and rounded once by fap_round, whose template
+/// arguments fold every constant of the format and of the rounding.
+const char* prelude = R"FAP(
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef unsigned __int128 fap_u128;
+
+namespace {
+
+const uint64_t fap_inf_bits = 0x7ff0000000000000ULL;
+
+inline double fap_bits(uint64_t bits) {
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+inline uint64_t fap_raw(double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  return bits;
+}
+
+inline bool fap_special(uint64_t bits) {
+  return (bits & fap_inf_bits) == fap_inf_bits;
+}
+
+inline bool fap_is_nan(uint64_t bits) {
+  return (bits << 1) > (fap_inf_bits << 1);
+}
+
+inline bool fap_is_zero(uint64_t bits) {
+  return (bits << 1) == 0;
+}
+
+// NaN and infinity as set by the operators
+inline double fap_nan(uint64_t sign) {
+  return fap_bits((sign << 63) | fap_inf_bits | 0x01);
+}
+
+inline double fap_inf(uint64_t sign) {
+  return fap_bits((sign << 63) | fap_inf_bits);
+}
+
+inline int fap_clz(fap_u128 x) {
+  uint64_t hi = (uint64_t)(x >> 64);
+  return hi != 0 ? __builtin_clzll(hi) : 64 + __builtin_clzll((uint64_t)x);
+}
+
+// Finite double as sign, sig * 2^exp2
+inline void fap_decode(uint64_t bits, uint64_t &sign, uint64_t &sig,
+                       int &exp2) {
+  int exp = (int)((bits >> 52) & 0x7ff);
+  sign = bits >> 63;
+  sig = bits & 0xfffffffffffffULL;
+  if (exp == 0) {
+    exp2 = -1074;
+  } else {
+    sig |= 1ULL << 52;
+    exp2 = exp - 1075;
+  }
+}
+
+// Exponent field and mantissa of the format E:M as a double
+template<int E, int M>
+inline double fap_encode(uint64_t sign, uint64_t enc) {
+  const int bias = (1 << (E - 1)) - 1;
+  const uint64_t max_exp = (1ULL << E) - 1;
+  uint64_t exp = enc >> M, mant = enc & ((1ULL << M) - 1);
+  if (exp == max_exp) {
+    return fap_inf(sign);
+  }
+  if (exp == 0 && E < 11) {
+    // Subnormal of the format, normal for the double
+    double lsb = fap_bits((uint64_t)(1 - bias - M + 1023) << 52);
+    double val = (double)mant * lsb;
+    return sign ? -val : val;
+  }
+  uint64_t dexp = exp == 0 ? 0 : exp - bias + 1023;
+  return fap_bits((sign << 63) | (dexp << 52) | (mant << (52 - M)));
+}
+
+// sign, sig * 2^exp2 rounded on E:M with the rounding R
+template<int E, int M, int R>
+inline double fap_round(uint64_t sign, fap_u128 sig, int exp2) {
+  const int bias = (1 << (E - 1)) - 1;
+  const int max_exp = (1 << E) - 1;
+  if (sig == 0) {
+    return fap_bits(sign << 63);
+  }
+  int msb = 127 - fap_clz(sig);
+  int biased = exp2 + msb + bias;
+  int shift = msb - M;
+  if (biased < 1) {
+    // Subnormal, the lsb has the weight of the minimum exponent
+    shift = 1 - bias - M - exp2;
+    biased = 0;
+  }
+  if (biased >= max_exp) {
+    if (R == FAP_FP_ROUND_NEAREST || (R == FAP_FP_ROUND_TOWARD_PINF && !sign) ||
+        (R == FAP_FP_ROUND_TOWARD_NINF && sign)) {
+      return fap_inf(sign);
+    }
+    return fap_encode<E, M>(sign, ((uint64_t)(max_exp - 1) << M) |
+                                      ((1ULL << M) - 1));
+  }
+
+  uint64_t kept;
+  bool up = false;
+  if (shift <= 0) {
+    kept = (uint64_t)sig << -shift;
+  } else {
+    // Discarded bits against the half of the lsb
+    fap_u128 rem;
+    int half;
+    if (shift > 128) {
+      kept = 0;
+      rem = sig;
+      half = -1;
+    } else {
+      kept = shift == 128 ? 0 : (uint64_t)(sig >> shift);
+      rem = shift == 128 ? sig : sig & (((fap_u128)1 << shift) - 1);
+      fap_u128 lsb_half = (fap_u128)1 << (shift - 1);
+      half = rem > lsb_half ? 1 : (rem == lsb_half ? 0 : -1);
+    }
+    if (R == FAP_FP_ROUND_NEAREST) {
+      up = half > 0 || (half == 0 && (kept & 0x01));
+    } else if (R == FAP_FP_ROUND_TOWARD_PINF) {
+      up = rem != 0 && !sign;
+    } else if (R == FAP_FP_ROUND_TOWARD_NINF) {
+      up = rem != 0 && sign;
+    }
+  }
+  // The carry goes on the exponent, up to the infinity
+  uint64_t enc = (biased == 0 ? 0 : (uint64_t)(biased - 1) << M) + kept;
+  return fap_encode<E, M>(sign, enc + (up ? 1 : 0));
+}
+
+template<int E, int M, int R>
+inline double fap_load(double val) {
+  uint64_t bits = fap_raw(val), sign, sig;
+  int exp2;
+  if (fap_special(bits)) {
+    return val;
+  }
+  fap_decode(bits, sign, sig, exp2);
+  return fap_round<E, M, R>(sign, sig, exp2);
+}
+
+template<int E, int M, int R>
+inline double fap_add(double lhs, double rhs) {
+  uint64_t lhs_bits = fap_raw(lhs), rhs_bits = fap_raw(rhs);
+  if (fap_special(lhs_bits) || fap_special(rhs_bits)) {
+    if (fap_is_nan(lhs_bits) || fap_is_nan(rhs_bits) ||
+        (fap_special(lhs_bits) && fap_special(rhs_bits) &&
+         (lhs_bits ^ rhs_bits) >> 63)) {
+      return fap_nan(lhs_bits >> 63);
+    }
+    return fap_special(rhs_bits) ? rhs : lhs;
+  }
+  uint64_t lhs_sign, rhs_sign, lhs_sig, rhs_sig;
+  int lhs_exp2, rhs_exp2;
+  fap_decode(lhs_bits, lhs_sign, lhs_sig, lhs_exp2);
+  fap_decode(rhs_bits, rhs_sign, rhs_sig, rhs_exp2);
+  if (lhs_exp2 < rhs_exp2) {
+    uint64_t sign = lhs_sign, sig = lhs_sig;
+    int exp2 = lhs_exp2;
+    lhs_sign = rhs_sign, lhs_sig = rhs_sig, lhs_exp2 = rhs_exp2;
+    rhs_sign = sign, rhs_sig = sig, rhs_exp2 = exp2;
+  }
+  // The major one goes on the left while there is room, the minor one on
+  // the right, jamming the lost bits in its lsb
+  int exp_diff = lhs_exp2 - rhs_exp2;
+  int to_shift = exp_diff < 73 ? exp_diff : 73;
+  fap_u128 lhs_wide = (fap_u128)lhs_sig << to_shift, rhs_wide = rhs_sig;
+  lhs_exp2 -= to_shift;
+  exp_diff -= to_shift;
+  if (exp_diff >= 64) {
+    rhs_wide = rhs_sig != 0 ? 1 : 0;
+  } else if (exp_diff > 0) {
+    rhs_wide = (rhs_sig >> exp_diff) |
+               ((rhs_sig & ((1ULL << exp_diff) - 1)) != 0 ? 1 : 0);
+  }
+
+  fap_u128 res_sig;
+  uint64_t res_sign = lhs_sign;
+  if (lhs_sign == rhs_sign) {
+    res_sig = lhs_wide + rhs_wide;
+  } else if (lhs_wide >= rhs_wide) {
+    res_sig = lhs_wide - rhs_wide;
+  } else {
+    res_sign = rhs_sign;
+    res_sig = rhs_wide - lhs_wide;
+  }
+  if (res_sig == 0 && lhs_sign != rhs_sign) {
+    res_sign = R == FAP_FP_ROUND_TOWARD_NINF;
+  }
+  return fap_round<E, M, R>(res_sign, res_sig, lhs_exp2);
+}
+
+template<int E, int M, int R>
+inline double fap_mul(double lhs, double rhs) {
+  uint64_t lhs_bits = fap_raw(lhs), rhs_bits = fap_raw(rhs);
+  uint64_t sign = (lhs_bits ^ rhs_bits) >> 63;
+  if (fap_special(lhs_bits) || fap_special(rhs_bits)) {
+    if (fap_is_nan(lhs_bits) || fap_is_nan(rhs_bits)) {
+      return fap_nan(lhs_bits >> 63);
+    }
+    return fap_is_zero(lhs_bits) || fap_is_zero(rhs_bits) ? fap_nan(sign)
+                                                          : fap_inf(sign);
+  }
+  uint64_t lhs_sign, rhs_sign, lhs_sig, rhs_sig;
+  int lhs_exp2, rhs_exp2;
+  fap_decode(lhs_bits, lhs_sign, lhs_sig, lhs_exp2);
+  fap_decode(rhs_bits, rhs_sign, rhs_sig, rhs_exp2);
+  return fap_round<E, M, R>(lhs_sign ^ rhs_sign,
+                            (fap_u128)lhs_sig * rhs_sig,
+                            lhs_exp2 + rhs_exp2);
+}
+
+template<int E, int M, int R>
+inline double fap_div(double lhs, double rhs) {
+  uint64_t lhs_bits = fap_raw(lhs), rhs_bits = fap_raw(rhs);
+  uint64_t sign = (lhs_bits ^ rhs_bits) >> 63;
+  if (fap_is_nan(lhs_bits) || fap_is_nan(rhs_bits)) {
+    return fap_nan(lhs_bits >> 63);
+  }
+  if (fap_special(lhs_bits)) {
+    return fap_special(rhs_bits) ? fap_nan(sign) : fap_inf(sign);
+  }
+  if (fap_special(rhs_bits)) {
+    return fap_bits(sign << 63);
+  }
+  if (fap_is_zero(rhs_bits)) {
+    return fap_is_zero(lhs_bits) ? fap_nan(sign) : fap_inf(sign);
+  }
+  uint64_t lhs_sign, rhs_sign, lhs_sig, rhs_sig;
+  int lhs_exp2, rhs_exp2;
+  fap_decode(lhs_bits, lhs_sign, lhs_sig, lhs_exp2);
+  fap_decode(rhs_bits, rhs_sign, rhs_sig, rhs_exp2);
+  if (lhs_sig == 0) {
+    return fap_bits((lhs_sign ^ rhs_sign) << 63);
+  }
+  // Dividend on the 126th bit, the quotient has at least 73 bits and the
+  // remainder gives the sticky one
+  int lhs_shift = fap_clz(lhs_sig) - 2;
+  fap_u128 dividend = (fap_u128)lhs_sig << lhs_shift;
+  fap_u128 quot = dividend / rhs_sig;
+  quot = (quot << 1) | (dividend % rhs_sig != 0 ? 1 : 0);
+  return fap_round<E, M, R>(lhs_sign ^ rhs_sign, quot,
+                            lhs_exp2 - lhs_shift - rhs_exp2 - 1);
+}
+
+}  // end anonymous namespace
+)FAP";
+
+/// @brief Literal of the double \p val, by its bits
+::std::string literal(double val) {
+  uint64_t bits;
+  memcpy(&bits, &val, sizeof(bits));
+  char buf[64];
+  snprintf(buf, sizeof(buf), "fap_bits(0x%016llxULL)",
+           (unsigned long long)bits);
+  return buf;
+}
+
+/// @brief Check that the kernels can be generated with the context of the
+/// caller
+void checkContext(const ArithmeticState& ctx) {
+  if (ctx.rounding == FAP_FP_ROUND_STOCHASTIC ||
+      ctx.fastMath != FAP_FAST_MATH_NONE ||
+      ctx.special != FAP_SPECIAL_IEEE) {
+    ::std::cerr << "CompiledKernel: the context has to use a deterministic "
+                   "rounding, with IEEE special values";
+    exit(1);
+  }
+}
+
+}  // end anonymous namespace
+
+::std::string fap::CompiledKernel::generate(
+    const Tape<FloatingPointType>& tape, const Slot* outputs,
+    size_t num_outputs) {
+  const ArithmeticState& ctx = ArithmeticContext::current();
+  checkContext(ctx);
+  if (tape.size() == 0) {
+    ::std::cerr << "CompiledKernel: the tape is empty";
+    exit(1);
+  }
+  int exp_size = tape.getPrec(0).exp_size;
+  for (Slot slot = 0; slot < tape.size(); ++slot) {
+    FloatPrecTy prec = tape.getPrec(slot);
+    if (prec.exp_size != exp_size || prec.exp_size < 2 ||
+        prec.exp_size > DOUBLE_EXP_SIZE || prec.mant_size < 1 ||
+        prec.mant_size > DOUBLE_MANT_SIZE) {
+      ::std::cerr << "CompiledKernel: the slots have to share an exponent "
+                     "size and fit a double";
+      exit(1);
+    }
+  }
+  for (size_t o = 0; o < num_outputs; ++o) {
+    if (outputs[o] >= tape.size()) {
+      ::std::cerr << "CompiledKernel: output out of the tape";
+      exit(1);
+    }
+  }
+
+  ::std::ostringstream src;
+  src << "// Generated by Fap: " << tape.size() << " slots, exponent size "
+      << exp_size << ", rounding " << (int)ctx.rounding << "\n";
+  src << "enum {\n"
+      << "  FAP_FP_ROUND_TOWARD_0 = " << FAP_FP_ROUND_TOWARD_0 << ",\n"
+      << "  FAP_FP_ROUND_TOWARD_PINF = " << FAP_FP_ROUND_TOWARD_PINF << ",\n"
+      << "  FAP_FP_ROUND_TOWARD_NINF = " << FAP_FP_ROUND_TOWARD_NINF << ",\n"
+      << "  FAP_FP_ROUND_NEAREST = " << FAP_FP_ROUND_NEAREST << "\n};\n";
+  src << prelude << "\n";
+  src << "extern \"C\" void fap_kernel(const double* in, size_t batch, "
+         "double* out) {\n";
+  src << "  for (size_t set = 0; set < batch; ++set) {\n";
+  src << "    const double* x = in + set * " << tape.getNumInputs() << ";\n";
+  src << "    double* y = out + set * " << num_outputs << ";\n";
+
+  size_t input = 0;
+  for (Slot slot = 0; slot < tape.size(); ++slot) {
+    FloatPrecTy prec = tape.getPrec(slot);
+    ::std::ostringstream fmt;
+    fmt << "<" << exp_size << ", " << (int)prec.mant_size << ", "
+        << (int)ctx.rounding << ">";
+    src << "    const double v" << slot << " = ";
+    FAP_tape_op op = tape.getOp(slot);
+    if (op == FAP_TAPE_INPUT) {
+      src << "fap_load" << fmt.str() << "(x[" << input++ << "]);\n";
+      continue;
+    }
+    if (op == FAP_TAPE_CONST) {
+      // Rounded as the tape does, at the generation
+      const FloatingPointType& source = tape.getSource(slot);
+      FloatingPointType val;
+      if (source.isNaN() || source.isInf()) {
+        val.setPrec(prec);
+        val.setSign(source.getSign());
+        val.setExp(MASK_LOWER_HIGH(ExpType, prec.exp_size));
+        val.setMant(source.isNaN() ? 1 : 0);
+      } else {
+        int exp2;
+        MantType sig = source.getSignificand(exp2);
+        val = FloatingPointType::fromSignificand(source.getSign(), sig, exp2,
+                                                 false, prec, ctx.rounding);
+      }
+      src << literal((double)val) << ";\n";
+      continue;
+    }
+
+    // The operands are rounded on the smaller of their mantissas, as by
+    // adaptPrec(), and the result once on the mantissa of the slot
+    Slot lhs_slot = tape.getLhs(slot), rhs_slot = tape.getRhs(slot);
+    int lhs_mant = tape.getPrec(lhs_slot).mant_size;
+    int rhs_mant = tape.getPrec(rhs_slot).mant_size;
+    int min_mant = ::std::min(lhs_mant, rhs_mant);
+    ::std::ostringstream lhs, rhs;
+    lhs << "v" << lhs_slot;
+    rhs << (op == FAP_TAPE_SUB ? "-v" : "v") << rhs_slot;
+    ::std::ostringstream adapt;
+    adapt << "fap_load<" << exp_size << ", " << min_mant << ", "
+          << (int)ctx.rounding << ">";
+    ::std::string lhs_expr = lhs_mant > min_mant
+        ? adapt.str() + "(" + lhs.str() + ")" : lhs.str();
+    ::std::string rhs_expr = rhs_mant > min_mant
+        ? adapt.str() + "(" + rhs.str() + ")" : rhs.str();
+    const char* fn = op == FAP_TAPE_MUL ? "fap_mul"
+                     : op == FAP_TAPE_DIV ? "fap_div" : "fap_add";
+    src << fn << fmt.str() << "(" << lhs_expr << ", " << rhs_expr << ");\n";
+  }
+  for (size_t o = 0; o < num_outputs; ++o) {
+    src << "    y[" << o << "] = v" << outputs[o] << ";\n";
+  }
+  src << "  }\n}\n";
+  return src.str();
+}
+
+::fap::CompiledKernel::CompiledKernel(const Tape<FloatingPointType>& tape,
+                                      const Slot* outputs,
+                                      size_t num_outputs,
+                                      const ::std::string& flags)
+    : source(generate(tape, outputs, num_outputs)),
+      numInputs(tape.getNumInputs()),
+      numOutputs(num_outputs),
+      numSlots(tape.size()),
+      handle(NULL),
+      kernel(NULL) {
+  // Private directory of the source and of the shared object
+  const char* tmp = getenv("TMPDIR");
+  ::std::string dir = ::std::string(tmp != NULL ? tmp : "/tmp") +
+                      "/fap_kernel_XXXXXX";
+  if (mkdtemp(&dir[0]) == NULL) {
+    ::std::cerr << "CompiledKernel: cannot create " << dir;
+    exit(1);
+  }
+  ::std::string cpp = dir + "/kernel.cpp", so = dir + "/kernel.so";
+  {
+    ::std::ofstream out(cpp.c_str());
+    out << this->source;
+    if (!out) {
+      ::std::cerr << "CompiledKernel: cannot write " << cpp;
+      exit(1);
+    }
+  }
+
+  const char* cxx = getenv("CXX");
+  ::std::string cmd = ::std::string(cxx != NULL ? cxx : "c++") +
+                      " -std=c++11 " + flags + " -fPIC -shared -o '" + so +
+                      "' '" + cpp + "'";
+  int status = system(cmd.c_str());
+  if (status == 0) {
+    this->handle = dlopen(so.c_str(), RTLD_NOW | RTLD_LOCAL);
+  }
+  unlink(cpp.c_str());
+  unlink(so.c_str());
+  rmdir(dir.c_str());
+  if (status != 0) {
+    ::std::cerr << "CompiledKernel: the compilation failed: " << cmd;
+    exit(1);
+  }
+  if (this->handle == NULL) {
+    ::std::cerr << "CompiledKernel: cannot load the kernel: " << dlerror();
+    exit(1);
+  }
+  this->kernel = (KernelFnTy)dlsym(this->handle, "fap_kernel");
+  if (this->kernel == NULL) {
+    ::std::cerr << "CompiledKernel: fap_kernel not found";
+    exit(1);
+  }
+}
+
+::fap::CompiledKernel::~CompiledKernel() {
+  dlclose(this->handle);
+}
+
+void ::fap::CompiledKernel::run(const double* inputs, size_t batch,
+                                double* results, unsigned threads) const {
+  ::std::vector<size_t> bounds = evenShares(
+      batch, batch * this->numSlots / FAP_CODEGEN_THREAD_WORK, threads);
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    this->kernel(inputs + begin * this->numInputs, end - begin,
+                 results + begin * this->numOutputs);
+  });
+}
@@ -0,0 +1,62 @@
+//===- FapContext.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapContext.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Thread-local arithmetic context - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapContext.h"
+
+// Default settings: round to nearest on the precision of the operands,
+// without memoization
+thread_local ::fap::ArithmeticState fap::ArithmeticContext::state = {
+    FAP_FP_ROUND_NEAREST, FAP_SPECIAL_IEEE, FAP_FAST_MATH_NONE, false,
+    ::fap::FloatPrecTy(), 0 };
+
+::fap::ArithmeticContext::ArithmeticContext(FAP_rounding_method rounding,
+                                            FAP_special_policy special)
+    : saved(state) {
+  state.rounding = rounding;
+  state.special = special;
+  state.fastMath = FAP_FAST_MATH_NONE;
+  state.hasResultPrec = false;
+}
+
+::fap::ArithmeticContext::ArithmeticContext(FAP_rounding_method rounding,
+                                            FloatPrecTy result_prec,
+                                            FAP_special_policy special)
+    : saved(state) {
+  state.rounding = rounding;
+  state.special = special;
+  state.fastMath = FAP_FAST_MATH_NONE;
+  state.hasResultPrec = true;
+  state.resultPrec = result_prec;
+}
+
+::fap::ArithmeticContext::ArithmeticContext(const ArithmeticState &settings)
+    : saved(state) {
+  state = settings;
+}
+
+::fap::ArithmeticContext::~ArithmeticContext() {
+  state = this->saved;
+}
@@ -0,0 +1,635 @@
+//===- FapDecimal.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapDecimal.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Decimal formatting and parsing - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapDecimal.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <math.h>
+
+using namespace std;
+
+///////////////////////////////////////////////////////////////////////////////
+/// @defgroup FAP_DECIMAL_PRIVATE_FUNCTIONS
+/// @{
+namespace {
+
+const uint32_t kPow10[10] = {1,      10,      100,      1000,      10000,
+                             100000, 1000000, 10000000, 100000000,
+                             1000000000};
+
+/// @brief Minimal unsigned big integer, 32 bit words in little endian order.
+/// The values involved are bounded by the exponent range of the precision,
+/// so they stay of few words for the common precisions.
+class BigUInt {
+ public:
+  void set(uint128_t val) {
+    words.clear();
+    while (val != 0) {
+      words.push_back((uint32_t)val);
+      val >>= 32;
+    }
+  }
+
+  bool isZero() const {
+    return words.empty();
+  }
+
+  int bitLength() const {
+    if (words.empty()) {
+      return 0;
+    }
+    return (int)words.size() * 32 - __builtin_clz(words.back());
+  }
+
+  void mulAddSmall(uint32_t mul, uint32_t add) {
+    uint64_t carry = add;
+    for (size_t i = 0; i < words.size(); ++i) {
+      uint64_t t = (uint64_t)words[i] * mul + carry;
+      words[i] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    if (carry != 0) {
+      words.push_back((uint32_t)carry);
+    }
+  }
+
+  void mulPow10(int n) {
+    for (; n >= 9; n -= 9) {
+      this->mulAddSmall(kPow10[9], 0);
+    }
+    if (n > 0) {
+      this->mulAddSmall(kPow10[n], 0);
+    }
+  }
+
+  void shiftLeft(int n) {
+    if (words.empty() || n == 0) {
+      return;
+    }
+    int word_shift = n / 32, bit_shift = n % 32;
+    if (bit_shift != 0) {
+      uint32_t carry = 0;
+      for (size_t i = 0; i < words.size(); ++i) {
+        uint32_t w = words[i];
+        words[i] = (w << bit_shift) | carry;
+        carry = w >> (32 - bit_shift);
+      }
+      if (carry != 0) {
+        words.push_back(carry);
+      }
+    }
+    words.insert(words.begin(), word_shift, 0);
+  }
+
+  void shiftRight1() {
+    for (size_t i = 0; i < words.size(); ++i) {
+      words[i] >>= 1;
+      if (i + 1 < words.size()) {
+        words[i] |= words[i + 1] << 31;
+      }
+    }
+    this->trim();
+  }
+
+  void add(const BigUInt& b) {
+    if (words.size() < b.words.size()) {
+      words.resize(b.words.size(), 0);
+    }
+    uint64_t carry = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+      uint64_t t = (uint64_t)words[i] + carry +
+                   (i < b.words.size() ? b.words[i] : 0);
+      words[i] = (uint32_t)t;
+      carry = t >> 32;
+      if (carry == 0 && i >= b.words.size()) {
+        break;
+      }
+    }
+    if (carry != 0) {
+      words.push_back((uint32_t)carry);
+    }
+  }
+
+  /// @brief Subtract \p b, it must be not greater than this
+  void sub(const BigUInt& b) {
+    int64_t borrow = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+      int64_t t = (int64_t)words[i] - borrow -
+                  (i < b.words.size() ? b.words[i] : 0);
+      borrow = t < 0 ? 1 : 0;
+      words[i] = (uint32_t)(t + (borrow << 32));
+      if (borrow == 0 && i >= b.words.size()) {
+        break;
+      }
+    }
+    this->trim();
+  }
+
+  static int compare(const BigUInt& a, const BigUInt& b) {
+    if (a.words.size() != b.words.size()) {
+      return a.words.size() < b.words.size() ? -1 : 1;
+    }
+    for (size_t i = a.words.size(); i-- > 0;) {
+      if (a.words[i] != b.words[i]) {
+        return a.words[i] < b.words[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  /// @brief The 128 most significant bits, their position and if some of
+  /// the lower bits are high
+  uint128_t top128(int& exp2, bool& sticky) const {
+    int len = this->bitLength();
+    exp2 = len > 128 ? len - 128 : 0;
+    uint128_t res = 0;
+    sticky = false;
+    for (size_t i = words.size(); i-- > 0;) {
+      int pos = (int)i * 32 - exp2; // Position of the word lsb in res
+      if (pos >= 0) {
+        res |= (uint128_t)words[i] << pos;
+      } else if (pos > -32) {
+        res |= (uint128_t)(words[i] >> -pos);
+        sticky |= (words[i] & MASK_LOWER_HIGH(uint32_t, -pos)) != 0;
+      } else {
+        sticky |= words[i] != 0;
+      }
+    }
+    return res;
+  }
+
+ private:
+  void trim() {
+    while (!words.empty() && words.back() == 0) {
+      words.pop_back();
+    }
+  }
+
+  ::std::vector<uint32_t> words;
+};
+
+/// @brief Big integers of a thread, kept between the calls to reuse their
+/// words
+struct Scratch {
+  BigUInt r, s, mp, mm, tmp;  ///< Of shortestDigits()
+  BigUInt num, den;  ///< Of parseRange()
+};
+
+void freeScratch(void* scratch) {
+  delete static_cast<Scratch*>(scratch);
+}
+
+pthread_key_t makeScratchKey() {
+  pthread_key_t key;
+  pthread_key_create(&key, &freeScratch);
+  return key;
+}
+
+/// @brief Scratch of the calling thread. The library is built with
+/// -fno-use-cxa-atexit, which leaves no way to destroy a thread_local
+/// object with a destructor, so it is freed by a pthread key
+Scratch& threadScratch() {
+  static thread_local Scratch* own = nullptr;
+  if (own == nullptr) {
+    static const pthread_key_t key = makeScratchKey();
+    own = new Scratch();
+    pthread_setspecific(key, own);
+  }
+  return *own;
+}
+
+/// @brief Compare \p a + \p b with \p c, \p tmp is a scratch value
+int compareSum(const BigUInt& a, const BigUInt& b, const BigUInt& c,
+               BigUInt& tmp) {
+  tmp = a;
+  tmp.add(b);
+  return BigUInt::compare(tmp, c);
+}
+
+size_t copyString(char* buf, const char* str) {
+  size_t len = strlen(str);
+  memcpy(buf, str, len + 1);
+  return len;
+}
+
+/// @brief Shortest digits of the positive finite value \p fp, with the
+/// free-format algorithm of Burger and Dybvig: v = r/s, the half gaps to
+/// the neighbours are m+/s and m-/s.
+/// @return The number of digits, the value is 0.digits * 10^k
+int shortestDigits(const ::fap::FloatingPointType& fp, char* digits, int& k) {
+  Scratch& scratch = threadScratch();
+  BigUInt &r = scratch.r, &s = scratch.s, &mp = scratch.mp, &mm = scratch.mm;
+  BigUInt& tmp = scratch.tmp;
+  int e;
+  MantType f = fp.getSignificand(e);
+  int mant_size = fp.getPrec().mant_size;
+  // The gap below is half the gap above for powers of two, but the lowest
+  bool lower_closer =
+      f == MASK_BIT_HIGH(MantType, mant_size) && fp.getExp() > 1;
+  // Ties go to the even mantissa, so the bounds are valid if it is even
+  bool bounds_ok = (f & 0x01) == 0;
+
+  r.set(f);
+  if (e >= 0) {
+    r.shiftLeft(e + (lower_closer ? 2 : 1));
+    s.set(lower_closer ? 4 : 2);
+    mp.set(1);
+    mp.shiftLeft(e + (lower_closer ? 1 : 0));
+    mm.set(1);
+    mm.shiftLeft(e);
+  } else {
+    r.shiftLeft(lower_closer ? 2 : 1);
+    s.set(1);
+    s.shiftLeft(-e + (lower_closer ? 2 : 1));
+    mp.set(lower_closer ? 2 : 1);
+    mm.set(1);
+  }
+
+  // Estimate never greater than the real position of the radix point
+  int msb = (sizeof(MantType) * 8 - 1) - fap_clz_(f);
+  k = (int)ceil((e + msb) * 0.30102999566398114 - 1e-10);
+  if (k >= 0) {
+    s.mulPow10(k);
+  } else {
+    r.mulPow10(-k);
+    mp.mulPow10(-k);
+    mm.mulPow10(-k);
+  }
+  // Fixup of the estimate
+  for (;;) {
+    int cmp = compareSum(r, mp, s, tmp);
+    if (cmp > 0 || (bounds_ok && cmp == 0)) {
+      s.mulAddSmall(10, 0);
+      k++;
+    } else {
+      break;
+    }
+  }
+
+  // Generation
+  int n = 0;
+  for (;;) {
+    r.mulAddSmall(10, 0);
+    mp.mulAddSmall(10, 0);
+    mm.mulAddSmall(10, 0);
+    int d = 0;
+    while (BigUInt::compare(r, s) >= 0) {
+      r.sub(s);
+      d++;
+    }
+    int cmp_low = BigUInt::compare(r, mm);
+    bool tc1 = cmp_low < 0 || (bounds_ok && cmp_low == 0);
+    int cmp_high = compareSum(r, mp, s, tmp);
+    bool tc2 = cmp_high > 0 || (bounds_ok && cmp_high == 0);
+    if (!tc1 && !tc2) {
+      digits[n++] = '0' + d;
+      continue;
+    }
+    if (tc1 && tc2) {
+      // Both the digits are valid, take the nearest one
+      tmp = r;
+      tmp.shiftLeft(1);
+      if (BigUInt::compare(tmp, s) >= 0) {
+        d++;
+      }
+    } else if (tc2) {
+      d++;
+    }
+    digits[n++] = '0' + d;
+    break;
+  }
+  return n;
+}
+
+inline bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+         c == '\f';
+}
+
+/// @brief Case insensitive match of the lowercase \p word
+bool matchWord(const char* p, const char* last, const char* word) {
+  for (; *word != '\0'; ++p, ++word) {
+    if (p == last || (*p | 0x20) != *word) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Parse a value in [begin, last)
+::fap::FloatingPointType parseRange(const char* begin, const char* last,
+                                    ::fap::FloatPrecTy prec,
+                                    FAP_rounding_method method,
+                                    const char** end) {
+  Scratch& scratch = threadScratch();
+  BigUInt &num = scratch.num, &den = scratch.den;
+  ::fap::FloatingPointType res;
+  res.setPrec(prec);
+  const char* p = begin;
+  if (end != nullptr) {
+    *end = begin;
+  }
+  while (p != last && isSpace(*p)) {
+    ++p;
+  }
+  SignType sign = 0;
+  if (p != last && (*p == '-' || *p == '+')) {
+    sign = (*p == '-') ? 1 : 0;
+    ++p;
+  }
+  res.setSign(sign);
+
+  // Special values
+  if (matchWord(p, last, "nan")) {
+    res.setNaN();
+    if (end != nullptr) {
+      *end = p + 3;
+    }
+    return res;
+  }
+  if (matchWord(p, last, "inf")) {
+    res.setInf();
+    if (end != nullptr) {
+      *end = p + (matchWord(p, last, "infinity") ? 8 : 3);
+    }
+    return res;
+  }
+
+  // Digits are kept up to the ones that can decide the rounding, the
+  // exact decimal expansions of the midpoints are shorter than this
+  int bias = EXPONENT_BIAS(prec.exp_size);
+  int64_t max_digits = bias + 2 * (int64_t)prec.mant_size + 16;
+  uint64_t small = 0;  // The first 19 significant digits
+  bool is_big = false;
+  bool truncated = false;  // Non-zero digits have been dropped
+  int64_t n_digits = 0, dec_exp = 0;
+  bool any_digit = false, after_point = false;
+  for (; p != last; ++p) {
+    if (*p == '.' && !after_point) {
+      after_point = true;
+      continue;
+    }
+    if (*p < '0' || *p > '9') {
+      break;
+    }
+    any_digit = true;
+    uint32_t d = *p - '0';
+    if (n_digits == 0 && d == 0) {
+      // Leading zero
+      if (after_point) {
+        dec_exp--;
+      }
+      continue;
+    }
+    if (n_digits < max_digits) {
+      if (n_digits < 19) {
+        small = small * 10 + d;
+      } else {
+        if (!is_big) {
+          num.set(small);
+          is_big = true;
+        }
+        num.mulAddSmall(10, d);
+      }
+      n_digits++;
+      if (after_point) {
+        dec_exp--;
+      }
+    } else {
+      truncated |= d != 0;
+      if (!after_point) {
+        dec_exp++;
+      }
+    }
+  }
+  if (!any_digit) {
+    res.setZero();
+    return res;
+  }
+
+  // Exponent, consumed only if well formed
+  if (p != last && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    bool neg_exp = false;
+    if (q != last && (*q == '-' || *q == '+')) {
+      neg_exp = *q == '-';
+      ++q;
+    }
+    if (q != last && *q >= '0' && *q <= '9') {
+      int64_t exp10 = 0;
+      for (; q != last && *q >= '0' && *q <= '9'; ++q) {
+        if (exp10 < 100000000) {
+          exp10 = exp10 * 10 + (*q - '0');
+        }
+      }
+      dec_exp += neg_exp ? -exp10 : exp10;
+      p = q;
+    }
+  }
+  if (end != nullptr) {
+    *end = p;
+  }
+
+  if (n_digits == 0) {
+    res.setZero();
+    return res;
+  }
+
+  // Out of range, the value is in [10^(dec_exp+n_digits-1),
+  // 10^(dec_exp+n_digits))
+  int64_t point = dec_exp + n_digits;
+  if ((point - 1) * 3.321928094887362 > bias + 1) {
+    return ::fap::FloatingPointType::fromSignificand(sign, 1, bias + 2, false,
+                                                     prec, method);
+  }
+  if (point * 3.321928094887362 < -(bias + prec.mant_size + 2)) {
+    return ::fap::FloatingPointType::fromSignificand(sign, 0, 0, true, prec,
+                                                     method);
+  }
+
+  // Fast paths, exactly computed on 128 bits
+  if (!is_big && dec_exp >= 0 && dec_exp <= 38) {
+    uint128_t pow10 = 1;
+    for (int i = 0; i < dec_exp; ++i) {
+      pow10 *= 10;
+    }
+    if (pow10 <= ~(uint128_t)0 / small) {
+      return ::fap::FloatingPointType::fromSignificand(
+          sign, (uint128_t)small * pow10, 0, false, prec, method);
+    }
+  }
+  if (!is_big && dec_exp < 0 && dec_exp >= -19 && prec.mant_size <= 60) {
+    uint64_t pow10 = 1;
+    for (int i = 0; i < -dec_exp; ++i) {
+      pow10 *= 10;
+    }
+    // At least 63 bits of quotient, enough for mantissa and guard bits
+    int to_shift = fap_clz_(small);
+    uint128_t scaled = (uint128_t)small << to_shift;
+    return ::fap::FloatingPointType::fromSignificand(
+        sign, scaled / pow10, -to_shift, (scaled % pow10) != 0, prec, method);
+  }
+
+  // General case on big integers
+  if (!is_big) {
+    num.set(small);
+  }
+  if (dec_exp >= 0) {
+    num.mulPow10(dec_exp);
+    int exp2;
+    bool sticky;
+    uint128_t sig = num.top128(exp2, sticky);
+    return ::fap::FloatingPointType::fromSignificand(
+        sign, sig, exp2, sticky || truncated, prec, method);
+  }
+  den.set(1);
+  den.mulPow10(-dec_exp);
+  // Scale the numerator to have a quotient of mant_size + 6 bits
+  int to_shift = den.bitLength() - num.bitLength() + prec.mant_size + 5;
+  if (to_shift >= 0) {
+    num.shiftLeft(to_shift);
+  } else {
+    den.shiftLeft(-to_shift);
+  }
+  int q_bits = num.bitLength() - den.bitLength();
+  den.shiftLeft(q_bits);
+  uint128_t q = 0;
+  for (int i = q_bits; i >= 0; --i) {
+    if (BigUInt::compare(num, den) >= 0) {
+      num.sub(den);
+      q |= MASK_BIT_HIGH(uint128_t, i);
+    }
+    den.shiftRight1();
+  }
+  return ::fap::FloatingPointType::fromSignificand(
+      sign, q, -to_shift, !num.isZero() || truncated, prec, method);
+}
+
+}  // end anonymous namespace
+/// @}
+///////////////////////////////////////////////////////////////////////////////
+
+size_t ::fap::formatDecimal(const FloatingPointType &fp, char *buf) {
+  if (fp.isNaN()) {
+    return copyString(buf, "nan");
+  }
+  char *p = buf;
+  if (fp.getSign() != 0) {
+    *p++ = '-';
+  }
+  if (fp.isInf()) {
+    return (p - buf) + copyString(p, "inf");
+  }
+  if (fp.isZero()) {
+    return (p - buf) + copyString(p, "0");
+  }
+
+  char digits[FAP_DECIMAL_BUFFER_SIZE];
+  int k;
+  int n = shortestDigits(fp, digits, k);
+  if (n <= k && k <= 21) {
+    // Integer
+    memcpy(p, digits, n);
+    p += n;
+    memset(p, '0', k - n);
+    p += k - n;
+  } else if (0 < k && k <= 21) {
+    memcpy(p, digits, k);
+    p += k;
+    *p++ = '.';
+    memcpy(p, digits + k, n - k);
+    p += n - k;
+  } else if (-6 < k && k <= 0) {
+    *p++ = '0';
+    *p++ = '.';
+    memset(p, '0', -k);
+    p += -k;
+    memcpy(p, digits, n);
+    p += n;
+  } else {
+    // Scientific notation
+    *p++ = digits[0];
+    if (n > 1) {
+      *p++ = '.';
+      memcpy(p, digits + 1, n - 1);
+      p += n - 1;
+    }
+    p += sprintf(p, "e%+d", k - 1);
+  }
+  *p = '\0';
+  return p - buf;
+}
+
+::std::string fap::toDecimalString(const FloatingPointType &fp) {
+  char buf[FAP_DECIMAL_BUFFER_SIZE];
+  size_t len = formatDecimal(fp, buf);
+  return ::std::string(buf, len);
+}
+
+void ::fap::formatDecimal(const FloatingPointType *fps, size_t n,
+                          ::std::string &out, char sep) {
+  char buf[FAP_DECIMAL_BUFFER_SIZE];
+  out.reserve(out.size() + n * 16);
+  for (size_t i = 0; i < n; ++i) {
+    if (i != 0) {
+      out.push_back(sep);
+    }
+    out.append(buf, formatDecimal(fps[i], buf));
+  }
+}
+
+::fap::FloatingPointType fap::parseDecimal(const char *str,
+                                             FloatPrecTy prec,
+                                             FAP_rounding_method method,
+                                             const char **end) {
+  return parseRange(str, str + strlen(str), prec, method, end);
+}
+
+size_t ::fap::parseDecimal(const char *str, size_t len, FloatPrecTy prec,
+                           ::std::vector<FloatingPointType> &out, char sep,
+                           FAP_rounding_method method) {
+  const char *p = str, *last = str + len;
+  size_t count = 0;
+  for (;;) {
+    while (p != last && (isSpace(*p) || *p == sep)) {
+      ++p;
+    }
+    if (p == last) {
+      break;
+    }
+    const char *end;
+    FloatingPointType fp = parseRange(p, last, prec, method, &end);
+    if (end == p) {
+      // Malformed value
+      break;
+    }
+    out.push_back(fp);
+    count++;
+    p = end;
+  }
+  return count;
+}
@@ -0,0 +1,587 @@
+//===- FapDispatch.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapDispatch.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Precision dispatch of the batch operations - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapDispatch.h"
+#include "FapContext.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+/// @brief Exponent sizes with a kernel for each mantissa size
+#ifndef FAP_DISPATCH_EXP_SIZES
+#define FAP_DISPATCH_EXP_SIZES        5, 8, 11
+#endif
+
+/// @brief Greatest neglected bits of the IntegerType kernels
+#ifndef FAP_DISPATCH_INT_NEGLECTED
+#define FAP_DISPATCH_INT_NEGLECTED    64
+#endif
+
+/// @brief Elements below which a worker is not worth a thread
+#ifndef FAP_DISPATCH_THREAD_WORK
+#define FAP_DISPATCH_THREAD_WORK      (1 << 14)
+#endif
+
+namespace {
+
+using ::fap::ArithmeticContext;
+using ::fap::ArithmeticState;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::fap::IntegerPrecision;
+using ::fap::IntegerType;
+
+typedef void (*FloatKernelTy)(const FloatingPointType*,
+                              const FloatingPointType*, FloatingPointType*,
+                              size_t, FAP_rounding_method);
+typedef void (*IntKernelTy)(const IntegerType*, const IntegerType*,
+                            IntegerType*, size_t);
+
+///////////////////////////////////////////////////////////////////////////////
+/// Generic kernels, the operators
+
+/// @brief \p res gets the value of \p val, keeping its name
+void store(FloatingPointType& res, const FloatingPointType& val) {
+  res.setPrec(val.getPrec());
+  res.setSign(val.getSign());
+  res.setExp(val.getExp());
+  res.setMant(val.getMant());
+  res.setGrs(val.getGrs());
+}
+
+template<FAP_batch_op Op, typename T>
+void applyOp(T& lhs, const T& rhs) {
+  switch (Op) {
+    case FAP_BATCH_ADD:
+      lhs += rhs;
+      break;
+    case FAP_BATCH_SUB:
+      lhs -= rhs;
+      break;
+    case FAP_BATCH_MUL:
+      lhs *= rhs;
+      break;
+    case FAP_BATCH_DIV:
+      lhs /= rhs;
+      break;
+  }
+}
+
+template<FAP_batch_op Op>
+void genericOp(const FloatingPointType& lhs, const FloatingPointType& rhs,
+               FloatingPointType& res) {
+  FloatingPointType val = lhs;
+  applyOp<Op>(val, rhs);
+  store(res, val);
+}
+
+template<FAP_batch_op Op>
+void genericOp(const IntegerType& lhs, const IntegerType& rhs,
+               IntegerType& res) {
+  IntegerType val = lhs;
+  applyOp<Op>(val, rhs);
+  res = val;
+}
+
+template<FAP_batch_op Op>
+void genericFloatKernel(const FloatingPointType* lhs,
+                        const FloatingPointType* rhs, FloatingPointType* res,
+                        size_t n, FAP_rounding_method) {
+  for (size_t i = 0; i < n; ++i) {
+    genericOp<Op>(lhs[i], rhs[i], res[i]);
+  }
+}
+
+template<FAP_batch_op Op>
+void genericIntKernel(const IntegerType* lhs, const IntegerType* rhs,
+                      IntegerType* res, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    genericOp<Op>(lhs[i], rhs[i], res[i]);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// FloatingPointType kernels of an exponent and mantissa size
+
+/// @brief Constants of the format E:M, the values are sign and exponent
+/// and mantissa packed as exp << M | mant
+template<int E, int M>
+struct Format {
+  static const int bias = (1 << (E - 1)) - 1;
+  static const uint64_t maxExp = (1ULL << E) - 1;
+  static const uint64_t mantMask = (1ULL << M) - 1;
+  static const uint64_t inf = maxExp << M;
+  static const uint64_t nan = inf | 0x01;
+  static const uint64_t maxFinite = inf - 1;
+
+  static bool isSpecial(uint64_t packed) {
+    return packed >= inf;
+  }
+
+  static bool isNaN(uint64_t packed) {
+    return packed > inf;
+  }
+
+  /// @brief Significand, with the hidden bit, and exponent of its lsb
+  static uint64_t significand(uint64_t packed, int& exp2) {
+    uint64_t exp = packed >> M;
+    exp2 = (exp == 0 ? 1 : (int)exp) - bias - M;
+    return exp == 0 ? packed : (packed & mantMask) | (1ULL << M);
+  }
+
+  /// @brief (-1)^sign * sig * 2^exp2 rounded, as setSignificand()
+  static uint64_t round(uint64_t sign, uint128_t sig, int exp2,
+                        FAP_rounding_method rounding) {
+    if (sig == 0) {
+      return 0;
+    }
+    int msb = (sizeof(uint128_t) * 8 - 1) - fap_clz_(sig);
+    int biased = exp2 + msb + bias;
+    int shift = msb - M;
+    if (biased < 1) {
+      // Subnormal, the lsb has the weight of the minimum exponent
+      shift = 1 - bias - M - exp2;
+      biased = 0;
+    }
+    if (biased >= (int)maxExp) {
+      bool to_inf = rounding == FAP_FP_ROUND_NEAREST ||
+                    (rounding == FAP_FP_ROUND_TOWARD_PINF && !sign) ||
+                    (rounding == FAP_FP_ROUND_TOWARD_NINF && sign);
+      return to_inf ? inf : maxFinite;
+    }
+
+    uint64_t kept;
+    bool up = false;
+    if (shift <= 0) {
+      kept = (uint64_t)sig << -shift;
+    } else {
+      // Discarded bits against the half of the lsb
+      uint128_t rem;
+      int half;
+      if (shift > 128) {
+        kept = 0;
+        rem = sig;
+        half = -1;
+      } else {
+        kept = shift == 128 ? 0 : (uint64_t)(sig >> shift);
+        rem = shift == 128 ? sig : sig & MASK_LOWER_HIGH(uint128_t, shift);
+        uint128_t lsb_half = MASK_BIT_HIGH(uint128_t, (shift - 1));
+        half = rem > lsb_half ? 1 : (rem == lsb_half ? 0 : -1);
+      }
+      switch (rounding) {
+        case FAP_FP_ROUND_NEAREST:
+          up = half > 0 || (half == 0 && (kept & 0x01));
+          break;
+        case FAP_FP_ROUND_TOWARD_PINF:
+          up = rem != 0 && !sign;
+          break;
+        case FAP_FP_ROUND_TOWARD_NINF:
+          up = rem != 0 && sign;
+          break;
+        default:
+          break;
+      }
+    }
+    // The carry goes on the exponent, up to the infinity
+    return (biased == 0 ? 0 : (uint64_t)(biased - 1) << M) + kept +
+           (up ? 1 : 0);
+  }
+
+  static uint64_t add(uint64_t& sign, uint64_t lhs, uint64_t rhs_sign,
+                      uint64_t rhs, FAP_rounding_method rounding) {
+    uint64_t lhs_sign = sign;
+    if (isSpecial(lhs) || isSpecial(rhs)) {
+      if (isNaN(lhs) || isNaN(rhs) ||
+          (isSpecial(lhs) && isSpecial(rhs) && lhs_sign != rhs_sign)) {
+        return nan;
+      }
+      if (isSpecial(rhs)) {
+        sign = rhs_sign;
+        return inf;
+      }
+      return lhs;
+    }
+    int lhs_exp2, rhs_exp2;
+    uint64_t lhs_sig = significand(lhs, lhs_exp2);
+    uint64_t rhs_sig = significand(rhs, rhs_exp2);
+    if (lhs_exp2 < rhs_exp2) {
+      ::std::swap(lhs_sig, rhs_sig);
+      ::std::swap(lhs_exp2, rhs_exp2);
+      ::std::swap(lhs_sign, rhs_sign);
+    }
+    // The major one goes on the left while there is room, the minor one on
+    // the right, jamming the lost bits in its lsb
+    int exp_diff = lhs_exp2 - rhs_exp2;
+    int room = (sizeof(uint128_t) * 8 - 2) - (M + 1);
+    int to_shift = exp_diff < room ? exp_diff : room;
+    uint128_t lhs_wide = (uint128_t)lhs_sig << to_shift, rhs_wide = rhs_sig;
+    lhs_exp2 -= to_shift;
+    exp_diff -= to_shift;
+    if (exp_diff >= 64) {
+      rhs_wide = rhs_sig != 0 ? 0x01 : 0x00;
+    } else if (exp_diff > 0) {
+      bool lost = (rhs_sig & MASK_LOWER_HIGH(uint64_t, exp_diff)) != 0;
+      rhs_wide = (rhs_sig >> exp_diff) | (lost ? 0x01 : 0x00);
+    }
+
+    uint128_t res_sig;
+    sign = lhs_sign;
+    if (lhs_sign == rhs_sign) {
+      res_sig = lhs_wide + rhs_wide;
+    } else if (lhs_wide >= rhs_wide) {
+      res_sig = lhs_wide - rhs_wide;
+    } else {
+      sign = rhs_sign;
+      res_sig = rhs_wide - lhs_wide;
+    }
+    if (res_sig == 0 && lhs_sign != rhs_sign) {
+      sign = rounding == FAP_FP_ROUND_TOWARD_NINF;
+    }
+    return round(sign, res_sig, lhs_exp2, rounding);
+  }
+
+  static uint64_t mul(uint64_t& sign, uint64_t lhs, uint64_t rhs_sign,
+                      uint64_t rhs, FAP_rounding_method rounding) {
+    if (isNaN(lhs) || isNaN(rhs)) {
+      return nan;
+    }
+    sign ^= rhs_sign;
+    if (isSpecial(lhs) || isSpecial(rhs)) {
+      return lhs == 0 || rhs == 0 ? nan : inf;
+    }
+    int lhs_exp2, rhs_exp2;
+    uint64_t lhs_sig = significand(lhs, lhs_exp2);
+    uint64_t rhs_sig = significand(rhs, rhs_exp2);
+    return round(sign, (uint128_t)lhs_sig * rhs_sig, lhs_exp2 + rhs_exp2,
+                 rounding);
+  }
+
+  static uint64_t div(uint64_t& sign, uint64_t lhs, uint64_t rhs_sign,
+                      uint64_t rhs, FAP_rounding_method rounding) {
+    if (isNaN(lhs) || isNaN(rhs)) {
+      return nan;
+    }
+    sign ^= rhs_sign;
+    if (isSpecial(lhs)) {
+      return isSpecial(rhs) ? nan : inf;
+    }
+    if (isSpecial(rhs)) {
+      return 0;
+    }
+    if (rhs == 0) {
+      return lhs == 0 ? nan : inf;
+    }
+    if (lhs == 0) {
+      return 0;
+    }
+    // Dividend on the 126th bit, the quotient has at least 73 bits and the
+    // remainder gives the sticky one
+    int lhs_exp2, rhs_exp2;
+    uint64_t lhs_sig = significand(lhs, lhs_exp2);
+    uint64_t rhs_sig = significand(rhs, rhs_exp2);
+    int lhs_shift = fap_clz_((uint128_t)lhs_sig) - 2;
+    uint128_t dividend = (uint128_t)lhs_sig << lhs_shift;
+    uint128_t quot = dividend / rhs_sig;
+    quot = (quot << 1) | (dividend % rhs_sig != 0 ? 0x01 : 0x00);
+    return round(sign, quot, lhs_exp2 - lhs_shift - rhs_exp2 - 1, rounding);
+  }
+};
+
+template<int E, int M, FAP_batch_op Op>
+void floatKernel(const FloatingPointType* lhs, const FloatingPointType* rhs,
+                 FloatingPointType* res, size_t n,
+                 FAP_rounding_method rounding) {
+  typedef Format<E, M> Fmt;
+  for (size_t i = 0; i < n; ++i) {
+    FloatPrecTy lhs_prec = lhs[i].getPrec(), rhs_prec = rhs[i].getPrec();
+    if (lhs_prec.exp_size != E || lhs_prec.mant_size != M ||
+        rhs_prec.exp_size != E || rhs_prec.mant_size != M) {
+      genericOp<Op>(lhs[i], rhs[i], res[i]);
+      continue;
+    }
+    uint64_t sign = lhs[i].getSign();
+    uint64_t rhs_sign = rhs[i].getSign();
+    uint64_t lhs_val = ((uint64_t)lhs[i].getExp() << M) |
+                       (uint64_t)lhs[i].getMant();
+    uint64_t rhs_val = ((uint64_t)rhs[i].getExp() << M) |
+                       (uint64_t)rhs[i].getMant();
+    uint64_t val;
+    switch (Op) {
+      case FAP_BATCH_ADD:
+        val = Fmt::add(sign, lhs_val, rhs_sign, rhs_val, rounding);
+        break;
+      case FAP_BATCH_SUB:
+        val = Fmt::add(sign, lhs_val, rhs_sign ^ 0x01, rhs_val, rounding);
+        break;
+      case FAP_BATCH_MUL:
+        val = Fmt::mul(sign, lhs_val, rhs_sign, rhs_val, rounding);
+        break;
+      default:
+        val = Fmt::div(sign, lhs_val, rhs_sign, rhs_val, rounding);
+        break;
+    }
+    FloatingPointType& out = res[i];
+    out.setPrec(FloatPrecTy(E, M));
+    out.setSign(sign);
+    out.setExp(val >> M);
+    out.setMant(val & Fmt::mantMask);
+    out.setGrs(0x00);
+  }
+}
+
+/// @brief Kernels of the FloatingPointType, by exponent size, mantissa size
+/// and operation; NULL where there is none
+struct FloatTable {
+  FloatKernelTy kernels[DOUBLE_EXP_SIZE + 1][DOUBLE_MANT_SIZE + 1][4];
+
+  FloatTable();
+};
+
+template<int E, int M>
+struct FillMants {
+  static void run(FloatKernelTy (*row)[4]) {
+    row[M][FAP_BATCH_ADD] = &floatKernel<E, M, FAP_BATCH_ADD>;
+    row[M][FAP_BATCH_SUB] = &floatKernel<E, M, FAP_BATCH_SUB>;
+    row[M][FAP_BATCH_MUL] = &floatKernel<E, M, FAP_BATCH_MUL>;
+    row[M][FAP_BATCH_DIV] = &floatKernel<E, M, FAP_BATCH_DIV>;
+    FillMants<E, M - 1>::run(row);
+  }
+};
+
+template<int E>
+struct FillMants<E, 0> {
+  static void run(FloatKernelTy (*)[4]) {
+  }
+};
+
+template<int... Es>
+struct FillExps;
+
+template<>
+struct FillExps<> {
+  static void run(FloatTable&) {
+  }
+};
+
+template<int E, int... Es>
+struct FillExps<E, Es...> {
+  static_assert(E >= 2 && E <= DOUBLE_EXP_SIZE,
+                "FAP_DISPATCH_EXP_SIZES out of [2, 11]");
+  static void run(FloatTable& table) {
+    FillMants<E, DOUBLE_MANT_SIZE>::run(table.kernels[E]);
+    FillExps<Es...>::run(table);
+  }
+};
+
+FloatTable::FloatTable() {
+  memset(this->kernels, 0, sizeof(this->kernels));
+  FillExps<FAP_DISPATCH_EXP_SIZES>::run(*this);
+}
+
+const FloatTable& floatTable() {
+  static const FloatTable table;
+  return table;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// IntegerType kernels of a number of neglected bits
+
+template<int D, FAP_batch_op Op>
+void intKernel(const IntegerType* lhs, const IntegerType* rhs,
+               IntegerType* res, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    IntegerPrecision ori = lhs[i].getOriPrecision();
+    IntegerPrecision prec = ori - D;
+    IntegerPrecision lhs_prec = lhs[i].getActualPrecision();
+    IntegerPrecision rhs_prec = rhs[i].getActualPrecision();
+    bool compensate = lhs[i].isCompensate() && rhs[i].isCompensate();
+    if (rhs[i].getOriPrecision() != ori ||
+        ::std::min(lhs_prec, rhs_prec) != prec ||
+        (Op == FAP_BATCH_MUL && D == 0 && compensate)) {
+      genericOp<Op>(lhs[i], rhs[i], res[i]);
+      continue;
+    }
+
+    // The operands on the lower precision, as by adaptPrec()
+    int128_t lhs_bits = lhs[i].getBits(), rhs_bits = rhs[i].getBits();
+    if (D > 0 && lhs_prec != prec) {
+      lhs_bits &= MASK_LOWER_LOW(int128_t, D);
+    }
+    if (D > 0 && rhs_prec != prec) {
+      rhs_bits &= MASK_LOWER_LOW(int128_t, D);
+    }
+    if (Op == FAP_BATCH_DIV && rhs_bits == 0) {
+      // The division by zero saturates, as the operator
+      genericOp<Op>(lhs[i], rhs[i], res[i]);
+      continue;
+    }
+    uint8_t lhs_status = lhs[i].getNeglectedBitsStatus();
+    uint8_t rhs_status = rhs[i].getNeglectedBitsStatus();
+    int128_t bits;
+    uint8_t status = lhs_status ^ rhs_status;
+    switch (Op) {
+      case FAP_BATCH_ADD:
+        bits = lhs_bits + rhs_bits;
+        if (compensate && lhs_status && rhs_status) {
+          bits += MASK_BIT_HIGH(int128_t, D);
+        }
+        break;
+      case FAP_BATCH_SUB:
+        bits = lhs_bits - rhs_bits;
+        break;
+      case FAP_BATCH_MUL:
+        bits = lhs_bits * rhs_bits;
+        if (compensate) {
+          const int shift = D > 0 ? D - 1 : 0;
+          if (lhs_status) {
+            bits += rhs_bits << shift;
+          }
+          if (rhs_status) {
+            bits += lhs_bits << shift;
+          }
+          if (lhs_status && rhs_status) {
+            bits += MASK_BIT_HIGH(int128_t, 2 * shift);
+          }
+        }
+        status = 0;
+        break;
+      default:
+        bits = lhs_bits / rhs_bits;
+        status = lhs_status;
+        break;
+    }
+    IntegerType& out = res[i];
+    out.setBits(bits);
+    out.setOriPrecision(ori);
+    out.setActualPrecision(prec);
+    out.setNeglectedBitsStatus(status);
+    out.setCompensate(lhs[i].isCompensate());
+  }
+}
+
+/// @brief Kernels of the IntegerType, by neglected bits and operation
+struct IntTable {
+  IntKernelTy kernels[FAP_DISPATCH_INT_NEGLECTED + 1][4];
+
+  IntTable();
+};
+
+template<int D>
+struct FillNeglected {
+  static void run(IntTable& table) {
+    table.kernels[D][FAP_BATCH_ADD] = &intKernel<D, FAP_BATCH_ADD>;
+    table.kernels[D][FAP_BATCH_SUB] = &intKernel<D, FAP_BATCH_SUB>;
+    table.kernels[D][FAP_BATCH_MUL] = &intKernel<D, FAP_BATCH_MUL>;
+    table.kernels[D][FAP_BATCH_DIV] = &intKernel<D, FAP_BATCH_DIV>;
+    FillNeglected<D - 1>::run(table);
+  }
+};
+
+template<>
+struct FillNeglected<-1> {
+  static void run(IntTable&) {
+  }
+};
+
+IntTable::IntTable() {
+  FillNeglected<FAP_DISPATCH_INT_NEGLECTED>::run(*this);
+}
+
+const IntTable& intTable() {
+  static const IntTable table;
+  return table;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+/// @brief If the operators in \p ctx round the results on the precision of
+/// the operands, with a deterministic rounding
+bool plainContext(const ArithmeticState& ctx, FloatPrecTy prec) {
+  return ctx.rounding != FAP_FP_ROUND_STOCHASTIC &&
+         ctx.fastMath == FAP_FAST_MATH_NONE &&
+         ctx.special == FAP_SPECIAL_IEEE &&
+         (!ctx.hasResultPrec ||
+          (ctx.resultPrec.exp_size == prec.exp_size &&
+           ctx.resultPrec.mant_size == prec.mant_size));
+}
+
+}  // end anonymous namespace
+
+bool fap::hasSpecializedKernel(FloatPrecTy prec) {
+  return prec.exp_size <= DOUBLE_EXP_SIZE &&
+         prec.mant_size <= DOUBLE_MANT_SIZE &&
+         floatTable().kernels[prec.exp_size][prec.mant_size][0] != NULL;
+}
+
+void fap::batchOp(FAP_batch_op op, const FloatingPointType* lhs,
+                  const FloatingPointType* rhs, FloatingPointType* res,
+                  size_t n, unsigned threads) {
+  static const FloatKernelTy generic[] = {
+      &genericFloatKernel<FAP_BATCH_ADD>, &genericFloatKernel<FAP_BATCH_SUB>,
+      &genericFloatKernel<FAP_BATCH_MUL>, &genericFloatKernel<FAP_BATCH_DIV> };
+  if (n == 0) {
+    return;
+  }
+  const ArithmeticState& ctx = ArithmeticContext::current();
+  FloatPrecTy prec = lhs[0].getPrec();
+  FloatKernelTy kernel = NULL;
+  if (plainContext(ctx, prec) && hasSpecializedKernel(prec)) {
+    kernel = floatTable().kernels[prec.exp_size][prec.mant_size][op];
+  }
+  kernel = kernel != NULL ? kernel : generic[op];
+
+  FAP_rounding_method rounding = ctx.rounding;
+  ::std::vector<size_t> bounds =
+      evenShares(n, n / FAP_DISPATCH_THREAD_WORK, threads);
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    kernel(lhs + begin, rhs + begin, res + begin, end - begin, rounding);
+  });
+}
+
+void fap::batchOp(FAP_batch_op op, const IntegerType* lhs,
+                  const IntegerType* rhs, IntegerType* res, size_t n,
+                  unsigned threads) {
+  static const IntKernelTy generic[] = {
+      &genericIntKernel<FAP_BATCH_ADD>, &genericIntKernel<FAP_BATCH_SUB>,
+      &genericIntKernel<FAP_BATCH_MUL>, &genericIntKernel<FAP_BATCH_DIV> };
+  if (n == 0) {
+    return;
+  }
+  int neglected = lhs[0].getOriPrecision() -
+                  ::std::min(lhs[0].getActualPrecision(),
+                             rhs[0].getActualPrecision());
+  IntKernelTy kernel = generic[op];
+  if (neglected >= 0 && neglected <= FAP_DISPATCH_INT_NEGLECTED) {
+    kernel = intTable().kernels[neglected][op];
+  }
+
+  ::std::vector<size_t> bounds =
+      evenShares(n, n / FAP_DISPATCH_THREAD_WORK, threads);
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    kernel(lhs + begin, rhs + begin, res + begin, end - begin);
+  });
+}
@@ -0,0 +1,209 @@
+//===- FapErrorStats.cpp ----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapErrorStats.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Streaming error statistics against a double reference -
+///        Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapErrorStats.h"
+
+#include <math.h>
+
+namespace {
+
+/// @brief Bin of an error of \p ulps ULPs, not zero: bin b holds the errors
+/// in (2^(b - 3), 2^(b - 2)], the first one the errors up to 1/2
+int ulpBin(double ulps) {
+  int exp2;
+  double frac = frexp(ulps, &exp2);
+  // ulps is 2^(exp2 - 1) when frac is 1/2, in (2^(exp2 - 1), 2^exp2)
+  // otherwise
+  int bin = frac == 0.5 ? exp2 + 1 : exp2 + 2;
+  bin = bin < 1 ? 1 : bin;
+  return bin < FAP_ERROR_ULP_BINS - 1 ? bin : FAP_ERROR_ULP_BINS - 1;
+}
+
+}  // end anonymous namespace
+
+::fap::ErrorStats::ErrorStats(FloatPrecTy prec)
+    : prec(prec),
+      count(0),
+      nonFinite(0),
+      momentCount(0),
+      meanErr(0.0),
+      m2Err(0.0),
+      meanSqErr(0.0),
+      meanSqRef(0.0),
+      maxAbs(0.0),
+      maxRel(0.0) {
+  for (int bin = 0; bin < FAP_ERROR_ULP_BINS; ++bin) {
+    this->ulpHist[bin] = 0;
+  }
+}
+
+bool ::fap::ErrorStats::account(double out, double ref, double err) {
+  if (!isfinite(err)) {
+    if (out == ref || (isnan(out) && isnan(ref))) {
+      // The same infinity or NaN
+      ++this->ulpHist[0];
+      return false;
+    }
+    ++this->nonFinite;
+    ++this->ulpHist[FAP_ERROR_ULP_BINS - 1];
+    this->maxAbs = INFINITY;
+    this->maxRel = INFINITY;
+    return false;
+  }
+
+  double abs_err = fabs(err), abs_ref = fabs(ref);
+  this->maxAbs = abs_err > this->maxAbs ? abs_err : this->maxAbs;
+  double rel = abs_err == 0.0 ? 0.0
+                              : (abs_ref != 0.0 ? abs_err / abs_ref
+                                                : INFINITY);
+  this->maxRel = rel > this->maxRel ? rel : this->maxRel;
+  if (abs_err == 0.0) {
+    ++this->ulpHist[0];
+    return true;
+  }
+  // ULP of the reference, the one of the subnormals below the minimum
+  // exponent
+  int min_exp = 2 - (int)EXPONENT_BIAS(this->prec.exp_size);
+  int exp2 = min_exp;
+  if (abs_ref != 0.0) {
+    frexp(abs_ref, &exp2);
+    exp2 = exp2 > min_exp ? exp2 : min_exp;
+  }
+  double ulp = ldexp(1.0, exp2 - 1 - this->prec.mant_size);
+  ++this->ulpHist[ulpBin(abs_err / ulp)];
+  return true;
+}
+
+void ::fap::ErrorStats::add(double out, double ref) {
+  double err = out - ref;
+  ++this->count;
+  if (!this->account(out, ref, err)) {
+    return;
+  }
+  // Welford's update
+  double finite = (double)++this->momentCount;
+  double delta = err - this->meanErr;
+  this->meanErr += delta / finite;
+  this->m2Err += delta * (err - this->meanErr);
+  this->meanSqErr += (err * err - this->meanSqErr) / finite;
+  this->meanSqRef += (ref * ref - this->meanSqRef) / finite;
+}
+
+void ::fap::ErrorStats::add(const double *out, const double *ref, size_t n) {
+  // The block is summed apart, the errors shifted on the first one to keep
+  // the squared deviations accurate, and merged as a stream of its own
+  ErrorStats block(this->prec);
+  double shift = 0.0, sum = 0.0, sum_sq = 0.0, sum_err_sq = 0.0;
+  double sum_ref_sq = 0.0;
+  uint64_t finite = 0;
+  for (size_t i = 0; i < n; ++i) {
+    double err = out[i] - ref[i];
+    if (!block.account(out[i], ref[i], err)) {
+      continue;
+    }
+    if (finite == 0) {
+      shift = err;
+    }
+    ++finite;
+    double dev = err - shift;
+    sum += dev;
+    sum_sq += dev * dev;
+    sum_err_sq += err * err;
+    sum_ref_sq += ref[i] * ref[i];
+  }
+
+  block.count = n;
+  block.momentCount = finite;
+  if (finite != 0) {
+    double mean_dev = sum / finite;
+    block.meanErr = shift + mean_dev;
+    block.m2Err = sum_sq - sum * mean_dev;
+    block.m2Err = block.m2Err > 0.0 ? block.m2Err : 0.0;
+    block.meanSqErr = sum_err_sq / finite;
+    block.meanSqRef = sum_ref_sq / finite;
+  }
+  this->merge(block);
+}
+
+void ::fap::ErrorStats::merge(const ErrorStats &other) {
+  uint64_t lhs_finite = this->momentCount;
+  uint64_t rhs_finite = other.momentCount;
+  uint64_t finite = lhs_finite + rhs_finite;
+  if (rhs_finite != 0) {
+    // Parallel update of the moments, by Chan et al.
+    double lhs_weight = (double)lhs_finite / finite;
+    double rhs_weight = (double)rhs_finite / finite;
+    double delta = other.meanErr - this->meanErr;
+    this->meanErr += delta * rhs_weight;
+    this->m2Err += other.m2Err + delta * delta * lhs_finite * rhs_weight;
+    this->meanSqErr = this->meanSqErr * lhs_weight +
+                      other.meanSqErr * rhs_weight;
+    this->meanSqRef = this->meanSqRef * lhs_weight +
+                      other.meanSqRef * rhs_weight;
+  }
+  this->count += other.count;
+  this->nonFinite += other.nonFinite;
+  this->momentCount = finite;
+  this->maxAbs = other.maxAbs > this->maxAbs ? other.maxAbs : this->maxAbs;
+  this->maxRel = other.maxRel > this->maxRel ? other.maxRel : this->maxRel;
+  for (int bin = 0; bin < FAP_ERROR_ULP_BINS; ++bin) {
+    this->ulpHist[bin] += other.ulpHist[bin];
+  }
+}
+
+double fap::ErrorStats::getErrorVariance() const {
+  return this->momentCount > 1 ? this->m2Err / (this->momentCount - 1)
+                               : 0.0;
+}
+
+double fap::ErrorStats::getMse() const {
+  return this->nonFinite != 0 ? INFINITY : this->meanSqErr;
+}
+
+double fap::ErrorStats::getRmse() const {
+  return sqrt(this->getMse());
+}
+
+double fap::ErrorStats::getNormRel() const {
+  double mse = this->getMse();
+  if (this->meanSqRef > 0.0) {
+    return sqrt(mse / this->meanSqRef);
+  }
+  return sqrt(mse * this->count);
+}
+
+double fap::ErrorStats::getSnr() const {
+  double mse = this->getMse();
+  return mse > 0.0 ? 10.0 * log10(this->meanSqRef / mse) : INFINITY;
+}
+
+double fap::ErrorStats::ulpBinBound(int bin) {
+  if (bin == 0) {
+    return 0.0;
+  }
+  return bin < FAP_ERROR_ULP_BINS - 1 ? ldexp(1.0, bin - 2) : INFINITY;
+}
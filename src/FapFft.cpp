@@ -0,0 +1,223 @@
+//===- FapFft.cpp -----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapFft.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Fast Fourier transform - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapFft.h"
+#include "FapContext.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+/// @brief Butterfly operations below which a worker is not worth a thread
+#ifndef FAP_FFT_THREAD_WORK
+#define FAP_FFT_THREAD_WORK           (1 << 14)
+#endif
+
+namespace {
+
+using ::fap::Complex;
+using ::fap::FixedPoint;
+using ::fap::FixedPrecTy;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+/// @brief \p val rounded to the nearest on \p prec
+FloatingPointType quantize(long double val, FloatPrecTy prec) {
+  if (val == 0.0L) {
+    return FloatingPointType::fromSignificand(0, 0, 0, false, prec);
+  }
+  int e;
+  long double f = frexpl(fabsl(val), &e);
+  // The 64 bits significand of a long double
+  MantType sig = (MantType)ldexpl(f, 64);
+  return FloatingPointType::fromSignificand(val < 0.0L ? 1 : 0, sig, e - 64,
+                                            false, prec);
+}
+
+/// @brief \p val rounded to the nearest on \p prec, once: its 64 bits
+/// significand is exact on binary128
+FixedPoint quantize(long double val, FixedPrecTy prec) {
+  return FixedPoint(quantize(val, ::fap::PREC_BINARY128), prec);
+}
+
+/// \{
+/// @brief Key of a precision in the cache of the plans
+inline uint32_t precKey(FloatPrecTy prec) {
+  return ((uint32_t)prec.exp_size << 16) | prec.mant_size;
+}
+
+inline uint32_t precKey(FixedPrecTy prec) {
+  return ((uint32_t)prec.int_size << 16) | prec.frac_size;
+}
+/// \}
+
+}  // end anonymous namespace
+
+template<typename T>
+::fap::FftPlan<T>::FftPlan(size_t n, PrecTy prec, bool inverse)
+    : n(n),
+      log2n(0),
+      prec(prec),
+      inverse(inverse) {
+  if (n == 0 || (n & (n - 1)) != 0 || n > ((size_t)1 << 32)) {
+    ::std::cerr << "FftPlan size is not a power of two";
+    exit(1);
+  }
+  while (((size_t)1 << this->log2n) < n) {
+    this->log2n++;
+  }
+
+  // Twiddles up to the 3n / 4 ones used by the radix-4 stages, the
+  // multiples of pi / 2 are exact
+  size_t count = ::std::max((size_t)1, 3 * n / 4);
+  this->twiddles.reserve(count);
+  for (size_t j = 0; j < count; ++j) {
+    long double re, im;
+    if ((4 * j) % n == 0) {
+      static const long double quadrant_re[] = { 1.0L, 0.0L, -1.0L };
+      static const long double quadrant_im[] = { 0.0L, 1.0L, 0.0L };
+      re = quadrant_re[4 * j / n];
+      im = quadrant_im[4 * j / n];
+    } else {
+      long double angle = 2.0L * 3.141592653589793238462643383279502884L *
+                          (long double)j / (long double)n;
+      re = cosl(angle);
+      im = sinl(angle);
+    }
+    this->twiddles.push_back(
+        Complex<T>(quantize(re, prec), quantize(inverse ? im : -im, prec)));
+  }
+
+  // Pairs of the bit reversal, each swapped once
+  for (size_t i = 0; i < n; ++i) {
+    size_t rev = 0;
+    for (int b = 0; b < this->log2n; ++b) {
+      rev |= ((i >> b) & 0x1) << (this->log2n - 1 - b);
+    }
+    if (i < rev) {
+      this->swaps.push_back(i);
+      this->swaps.push_back(rev);
+    }
+  }
+}
+
+template<typename T>
+::std::shared_ptr<const fap::FftPlan<T> > fap::FftPlan<T>::get(size_t n,
+                                                               PrecTy prec,
+                                                               bool inverse) {
+  typedef ::std::pair<size_t, uint64_t> KeyTy;
+  static ::std::mutex lock;
+  static ::std::map<KeyTy, ::std::shared_ptr<const FftPlan> > plans;
+  KeyTy key(n, ((uint64_t)precKey(prec) << 1) | (inverse ? 1 : 0));
+  ::std::lock_guard< ::std::mutex> guard(lock);
+  ::std::shared_ptr<const FftPlan> &plan = plans[key];
+  if (!plan) {
+    plan = ::std::make_shared<const FftPlan>(n, prec, inverse);
+  }
+  return plan;
+}
+
+template<typename T>
+void ::fap::FftPlan<T>::execute(Complex<T> *data) const {
+  for (size_t s = 0; s < this->swaps.size(); s += 2) {
+    ::std::swap(data[this->swaps[s]], data[this->swaps[s + 1]]);
+  }
+
+  size_t m = 1;
+  if (this->log2n % 2 != 0) {
+    // Radix-2 stage, the twiddles are all 1
+    for (size_t i = 0; i < this->n; i += 2) {
+      Complex<T> lhs = data[i];
+      data[i] += data[i + 1];
+      lhs -= data[i + 1];
+      data[i + 1] = lhs;
+    }
+    m = 2;
+  }
+
+  // Radix-4 stages, from 4 transforms of size m to one of size 4m. After
+  // the bit reversal the transforms at the offsets 0, m, 2m and 3m are the
+  // ones of the inputs with index 0, 2, 1 and 3 modulo 4
+  for (; m < this->n; m *= 4) {
+    size_t stride = this->n / (4 * m);
+    for (size_t base = 0; base < this->n; base += 4 * m) {
+      for (size_t k = 0; k < m; ++k) {
+        Complex<T> *x = data + base + k;
+        Complex<T> c0 = x[0], c1 = x[2 * m], c2 = x[m], c3 = x[3 * m];
+        if (k != 0) {
+          c1 *= this->twiddles[k * stride];
+          c2 *= this->twiddles[2 * k * stride];
+          c3 *= this->twiddles[3 * k * stride];
+        }
+        Complex<T> s0 = c0 + c2;
+        Complex<T> s1 = c0 - c2;
+        Complex<T> s2 = c1 + c3;
+        Complex<T> s3 = this->inverse ? (c1 - c3).mulI()
+                                      : (c1 - c3).mulMinusI();
+        x[0] = s0 + s2;
+        x[m] = s1 + s3;
+        x[2 * m] = s0 - s2;
+        x[3 * m] = s1 - s3;
+      }
+    }
+  }
+}
+
+template<typename T>
+void ::fap::FftPlan<T>::execute(Complex<T> *data, size_t batch,
+                                unsigned threads) const {
+  ::std::vector<size_t> bounds = evenShares(
+      batch, batch * this->n * (this->log2n + 1) / FAP_FFT_THREAD_WORK,
+      threads);
+  parallelShares(bounds, [this, data](size_t begin, size_t end) {
+    for (size_t b = begin; b < end; ++b) {
+      this->execute(data + b * this->n);
+    }
+  });
+}
+
+template class ::fap::FftPlan<FloatingPointType>;
+template class ::fap::FftPlan<FixedPoint>;
+
+void ::fap::fft(Complex<FloatingPointType> *data, size_t n, size_t batch,
+                bool inverse, unsigned threads) {
+  if (n == 0 || batch == 0) {
+    return;
+  }
+  FftPlan<FloatingPointType>::get(n, data[0].real().getPrec(), inverse)
+      ->execute(data, batch, threads);
+}
+
+void ::fap::fft(Complex<FixedPoint> *data, size_t n, size_t batch,
+                bool inverse, unsigned threads) {
+  if (n == 0 || batch == 0) {
+    return;
+  }
+  FftPlan<FixedPoint>::get(n, data[0].real().getPrec(), inverse)
+      ->execute(data, batch, threads);
+}
@@ -0,0 +1,422 @@
+//===- FapFixedPoint.cpp ----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapFixedPoint.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Fixed point (Q format) type - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapFixedPoint.h"
+
+#include <math.h>
+#include <type_traits>
+
+///////////////////////////////////////////////////////////////////////////////
+/// @defgroup FAP_FIXED_PRIVATE_FUNCTIONS
+/// @{
+namespace {
+
+void checkPrec(::fap::FixedPrecTy prec) {
+  if (1 + prec.int_size + prec.frac_size > FIXED_MAX_SIZE) {
+    ::std::cerr << "FixedPoint precision is more than the native integer";
+    exit(1);
+  }
+}
+
+/// @brief Apply the overflow method to fit \p wide on \p prec
+template<typename WideTy>
+inline int64_t fitBits(WideTy wide, ::fap::FixedPrecTy prec,
+                       FAP_overflow_method overflow) {
+  int size = 1 + prec.int_size + prec.frac_size;
+  WideTy max = (WideTy)MASK_LOWER_HIGH(uint64_t, (size - 1));
+  if (wide >= -max - 1 && wide <= max) {
+    return (int64_t)wide;
+  }
+  if (overflow == FAP_FX_OVERFLOW_SATURATE) {
+    return wide > max ? (int64_t)max : (int64_t)(-max - 1);
+  }
+  // Wrap, sign extension of the lower size bits
+  int to_shift = sizeof(int64_t) * 8 - size;
+  return (int64_t)((uint64_t)wide << to_shift) >> to_shift;
+}
+
+/// @brief Arithmetic right shift of \p to_shift (left if negative), with
+/// the rounding \p method. The floor leaves a positive remainder so the
+/// decision is taken on the two's complement value.
+template<typename WideTy>
+inline WideTy roundShift(WideTy wide, int to_shift,
+                         FAP_rounding_method method) {
+  typedef typename ::std::make_unsigned<WideTy>::type UWideTy;
+  if (to_shift <= 0) {
+    return (WideTy)((UWideTy)wide << -to_shift);
+  }
+  if (to_shift >= (int)(sizeof(WideTy) * 8 - 1)) {
+    to_shift = sizeof(WideTy) * 8 - 1;
+  }
+  WideTy res = wide >> to_shift;
+  UWideTy rem = (UWideTy)wide & (((UWideTy)1 << to_shift) - 1);
+  UWideTy half = (UWideTy)1 << (to_shift - 1);
+  switch (method) {
+  case FAP_FP_ROUND_NEAREST:
+    return res + (rem > half || (rem == half && (res & 0x1) != 0));
+  case FAP_FP_ROUND_TOWARD_0:
+    return res + (rem != 0 && wide < 0);
+  case FAP_FP_ROUND_TOWARD_PINF:
+    return res + (rem != 0);
+  case FAP_FP_ROUND_TOWARD_NINF:
+    return res;
+  default: {
+    // Generic rounding of the magnitude
+    SignType sign = wide < 0 ? 1 : 0;
+    uint128_t mag = sign != 0 ? -(uint128_t)wide : (uint128_t)wide;
+    mag = fap_round_shift_(mag, to_shift, sign, method);
+    return sign != 0 ? -(WideTy)mag : (WideTy)mag;
+  }
+  }
+}
+
+/// @brief Scale (-1)^sign * sig * 2^exp2 by 2^frac_size, rounding it
+int64_t toBits(SignType sign, MantType sig, int exp2, ::fap::FixedPrecTy prec,
+               FAP_rounding_method rounding, FAP_overflow_method overflow) {
+  int to_shift = -(exp2 + prec.frac_size);
+  int sig_size = (sizeof(MantType) * 8) - fap_clz_(sig);
+  if (sig != 0 && sig_size - to_shift > FIXED_MAX_SIZE + 1) {
+    // Out of any format, the lower bits are zeroes if it wraps
+    if (overflow == FAP_FX_OVERFLOW_WRAP) {
+      return to_shift > -(int)(sizeof(MantType) * 8)
+                 ? fitBits((int128_t)(sig << -to_shift) *
+                               (sign != 0 ? -1 : 1),
+                           prec, overflow)
+                 : 0;
+    }
+    return fitBits(sign != 0 ? INT64_MIN : INT64_MAX, prec, overflow);
+  }
+  uint128_t mag = fap_round_shift_(sig, to_shift, sign, rounding);
+  return fitBits(sign != 0 ? -(int128_t)mag : (int128_t)mag, prec, overflow);
+}
+
+}  // end anonymous namespace
+/// @}
+///////////////////////////////////////////////////////////////////////////////
+
+::fap::FixedPoint::FixedPoint(double d, FixedPrecTy n_prec,
+                              FAP_rounding_method r, FAP_overflow_method o)
+    : bits(0),
+      prec(n_prec),
+      neglectedBits(0),
+      neglectedBitsStatus(1),
+      compensate(false),
+      rounding(r),
+      overflow(o) {
+  checkPrec(n_prec);
+  if (isnan(d) || d == 0.0) {
+    return;
+  }
+  SignType sign = signbit(d) ? 1 : 0;
+  if (isinf(d)) {
+    this->bits = fitBits(sign != 0 ? INT64_MIN : INT64_MAX, n_prec,
+                         FAP_FX_OVERFLOW_SATURATE);
+    return;
+  }
+  int e;
+  MantType sig = (MantType)ldexp(frexp(fabs(d), &e), DOUBLE_MANT_SIZE + 1);
+  this->bits =
+      toBits(sign, sig, e - (DOUBLE_MANT_SIZE + 1), n_prec, r, o);
+}
+
+::fap::FixedPoint::FixedPoint(const FloatingPointType &fp, FixedPrecTy n_prec,
+                              FAP_rounding_method r, FAP_overflow_method o)
+    : bits(0),
+      prec(n_prec),
+      neglectedBits(0),
+      neglectedBitsStatus(1),
+      compensate(false),
+      rounding(r),
+      overflow(o) {
+  checkPrec(n_prec);
+  if (fp.isNaN() || fp.isZero()) {
+    return;
+  }
+  if (fp.isInf()) {
+    this->bits = fitBits(fp.getSign() != 0 ? INT64_MIN : INT64_MAX, n_prec,
+                         FAP_FX_OVERFLOW_SATURATE);
+    return;
+  }
+  int exp2;
+  MantType sig = fp.getSignificand(exp2);
+  this->bits = toBits(fp.getSign(), sig, exp2, n_prec, r, o);
+}
+
+::fap::FixedPoint fap::FixedPoint::fromBits(int64_t bits, FixedPrecTy n_prec,
+                                            FAP_rounding_method r,
+                                            FAP_overflow_method o) {
+  FixedPoint fx(0.0, n_prec, r, o);
+  fx.bits = fitBits(bits, n_prec, o);
+  return fx;
+}
+
+int64_t ::fap::FixedPoint::getActualBits() const {
+  if (this->compensate && this->neglectedBitsStatus &&
+      this->neglectedBits > 0) {
+    return (this->bits | MASK_BIT_HIGH(int64_t, (this->neglectedBits - 1)));
+  }
+  return this->bits;
+}
+
+::fap::FixedPoint::operator double() const {
+  return ldexp((double)this->getActualBits(), -this->prec.frac_size);
+}
+
+void ::fap::FixedPoint::setWideBits(int128_t wide) {
+  this->bits = fitBits(wide, this->prec, this->overflow);
+}
+
+// Arithmetic Operators
+::fap::FixedPoint & ::fap::FixedPoint::operator+=(::fap::FixedPoint rhs) {
+  // Adapt precisions
+  this->adaptPrec(rhs);
+  int128_t wide = (int128_t)this->bits + rhs.getBits();
+  // Check the compensation
+  if (this->compensate && rhs.isCompensate() && this->neglectedBits > 0) {
+    // Both the neglected bits at half value give a unit on the first
+    // not neglected bit
+    if (this->neglectedBitsStatus && rhs.getNeglectedBitsStatus()) {
+      wide += MASK_BIT_HIGH(int128_t, this->neglectedBits);
+    }
+  }
+  this->neglectedBitsStatus ^= rhs.getNeglectedBitsStatus();
+  this->setWideBits(wide);
+  return *this;
+}
+
+::fap::FixedPoint & ::fap::FixedPoint::operator-=(::fap::FixedPoint rhs) {
+  // Adapt precisions
+  this->adaptPrec(rhs);
+  this->setWideBits((int128_t)this->bits - rhs.getBits());
+  this->neglectedBitsStatus ^= rhs.getNeglectedBitsStatus();
+  return *this;
+}
+
+::fap::FixedPoint & ::fap::FixedPoint::operator*=(::fap::FixedPoint rhs) {
+  // Adapt precisions
+  this->adaptPrec(rhs);
+  int128_t partial_mul = (int128_t)this->bits * rhs.getBits();
+  // Check the compensation, as IntegerType::operator*=
+  if (this->compensate && rhs.isCompensate() && this->neglectedBits > 0) {
+    int diff_prec = this->neglectedBits;
+    if (this->neglectedBitsStatus) {
+      partial_mul += (int128_t)rhs.getBits() * MASK_BIT_HIGH(int128_t,
+                                                             (diff_prec - 1));
+    }
+    if (rhs.getNeglectedBitsStatus()) {
+      partial_mul += (int128_t)this->bits * MASK_BIT_HIGH(int128_t,
+                                                          (diff_prec - 1));
+    }
+    if (this->neglectedBitsStatus && rhs.getNeglectedBitsStatus()) {
+      // Last term
+      partial_mul += MASK_BIT_HIGH(int128_t, 2 * (diff_prec - 1));
+    }
+  }
+  // Back to frac_size fractional bits
+  this->setWideBits(
+      roundShift(partial_mul, this->prec.frac_size, this->rounding));
+  this->neglectedBitsStatus = 0;
+  return *this;
+}
+
+::fap::FixedPoint & ::fap::FixedPoint::operator/=(::fap::FixedPoint rhs) {
+  // Adapt precisions
+  this->adaptPrec(rhs);
+  if (rhs.getBits() == 0) {
+    // Division by zero saturates, 0/0 gives 0
+    if (this->bits != 0) {
+      this->bits = fitBits(this->bits < 0 ? INT64_MIN : INT64_MAX, this->prec,
+                           FAP_FX_OVERFLOW_SATURATE);
+    }
+    return *this;
+  }
+  SignType sign = (this->bits < 0) != (rhs.getBits() < 0) ? 1 : 0;
+  uint128_t dividend = this->bits < 0 ? -(int128_t)this->bits : this->bits;
+  uint128_t divisor = rhs.getBits() < 0 ? -(int128_t)rhs.getBits()
+                                        : rhs.getBits();
+  // Three more bits for guard and round, the remainder gives the sticky
+  dividend <<= this->prec.frac_size + 3;
+  uint128_t quot = dividend / divisor;
+  if (dividend % divisor != 0) {
+    quot |= 0x01;
+  }
+  uint128_t mag = fap_round_shift_(quot, 3, sign, this->rounding);
+  this->setWideBits(sign != 0 ? -(int128_t)mag : (int128_t)mag);
+  return *this;
+}
+///////////////////////////////////////////////////////////////////////////////
+
+void ::fap::FixedPoint::changePrec(FixedPrecTy n_prec) {
+  checkPrec(n_prec);
+  int prec_diff = this->prec.frac_size - n_prec.frac_size;
+  int128_t wide = roundShift((int128_t)this->bits, prec_diff, this->rounding);
+  // The neglected bits keep their weight
+  int neglected = this->neglectedBits - prec_diff;
+  this->neglectedBits = neglected > 0 ? neglected : 0;
+  this->prec = n_prec;
+  this->setWideBits(wide);
+}
+
+void ::fap::FixedPoint::neglectBits(uint8_t n) {
+  int size = 1 + this->prec.int_size + this->prec.frac_size;
+  if (n >= size) {
+    n = size - 1;
+  }
+  // Clearing least significant bits
+  this->bits &= MASK_LOWER_LOW(int64_t, n);
+  this->neglectedBits = n;
+}
+
+void ::fap::FixedPoint::adaptPrec(FixedPoint &fx) {
+  // Find lowest precision
+  FixedPrecTy fx_prec = fx.getPrec(), lowest_prec;
+  lowest_prec.int_size = this->prec.int_size < fx_prec.int_size
+                             ? this->prec.int_size
+                             : fx_prec.int_size;
+  lowest_prec.frac_size = this->prec.frac_size < fx_prec.frac_size
+                              ? this->prec.frac_size
+                              : fx_prec.frac_size;
+  if (this->prec.int_size != lowest_prec.int_size ||
+      this->prec.frac_size != lowest_prec.frac_size) {
+    this->changePrec(lowest_prec);
+  }
+  if (fx_prec.int_size != lowest_prec.int_size ||
+      fx_prec.frac_size != lowest_prec.frac_size) {
+    fx.changePrec(lowest_prec);
+  }
+  // And the highest number of neglected bits
+  if (this->neglectedBits < fx.getNeglectedBits()) {
+    this->neglectBits(fx.getNeglectedBits());
+  } else if (fx.getNeglectedBits() < this->neglectedBits) {
+    fx.neglectBits(this->neglectedBits);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Batch kernels
+
+void ::fap::fixedQuantize(const double *in, int64_t *out, size_t n,
+                          FixedPrecTy prec, FAP_rounding_method r,
+                          FAP_overflow_method o) {
+  checkPrec(prec);
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = FixedPoint(in[i], prec, r, o).getBits();
+  }
+}
+
+void ::fap::fixedToDouble(const int64_t *in, double *out, size_t n,
+                          FixedPrecTy prec) {
+  double scale = ldexp(1.0, -prec.frac_size);
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = in[i] * scale;
+  }
+}
+
+void ::fap::fixedAdd(const int64_t *a, const int64_t *b, int64_t *res,
+                     size_t n, FixedPrecTy prec, FAP_overflow_method o) {
+  checkPrec(prec);
+  for (size_t i = 0; i < n; ++i) {
+    res[i] = fitBits(a[i] + b[i], prec, o);
+  }
+}
+
+void ::fap::fixedSub(const int64_t *a, const int64_t *b, int64_t *res,
+                     size_t n, FixedPrecTy prec, FAP_overflow_method o) {
+  checkPrec(prec);
+  for (size_t i = 0; i < n; ++i) {
+    res[i] = fitBits(a[i] - b[i], prec, o);
+  }
+}
+
+namespace {
+
+/// @brief Products on WideTy, which has to hold twice the format size
+template<typename WideTy>
+void mulKernel(const int64_t *a, const int64_t *b, int64_t *res, size_t n,
+               ::fap::FixedPrecTy prec, FAP_rounding_method r,
+               FAP_overflow_method o, bool accumulate) {
+  for (size_t i = 0; i < n; ++i) {
+    WideTy prod = roundShift((WideTy)a[i] * b[i], prec.frac_size, r);
+    res[i] = fitBits(accumulate ? prod + res[i] : prod, prec, o);
+  }
+}
+
+}  // end anonymous namespace
+
+void ::fap::fixedMul(const int64_t *a, const int64_t *b, int64_t *res,
+                     size_t n, FixedPrecTy prec, FAP_rounding_method r,
+                     FAP_overflow_method o) {
+  checkPrec(prec);
+  if (2 * (1 + prec.int_size + prec.frac_size) < 64) {
+    mulKernel<int64_t>(a, b, res, n, prec, r, o, false);
+  } else {
+    mulKernel<int128_t>(a, b, res, n, prec, r, o, false);
+  }
+}
+
+void ::fap::fixedMac(const int64_t *a, const int64_t *b, int64_t *res,
+                     size_t n, FixedPrecTy prec, FAP_rounding_method r,
+                     FAP_overflow_method o) {
+  checkPrec(prec);
+  if (2 * (1 + prec.int_size + prec.frac_size) < 63) {
+    mulKernel<int64_t>(a, b, res, n, prec, r, o, true);
+  } else {
+    mulKernel<int128_t>(a, b, res, n, prec, r, o, true);
+  }
+}
+
+int64_t fap::fixedDot(const int64_t *a, const int64_t *b, size_t n,
+                      FixedPrecTy prec, FAP_rounding_method r,
+                      FAP_overflow_method o) {
+  checkPrec(prec);
+  int128_t acc = 0;
+  if (2 * (1 + prec.int_size + prec.frac_size) < 64) {
+    // Partial sums on 64 bits, flushed before they can overflow
+    const size_t chunk = (size_t)1
+                         << (63 - 2 * (prec.int_size + prec.frac_size) - 1);
+    for (size_t begin = 0; begin < n; begin += chunk) {
+      size_t end = begin + chunk < n ? begin + chunk : n;
+      int64_t partial = 0;
+      for (size_t i = begin; i < end; ++i) {
+        partial += a[i] * b[i];
+      }
+      acc += partial;
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      acc += (int128_t)a[i] * b[i];
+    }
+  }
+  return fitBits(roundShift(acc, prec.frac_size, r), prec, o);
+}
+
+::std::ostream &operator<<(::std::ostream &out, const ::fap::FixedPoint &fx) {
+  out << "q[" << (int)fx.getPrec().int_size << "."
+      << (int)fx.getPrec().frac_size << "-" << (int)fx.getNeglectedBits()
+      << "][" << fx.getActualBits() << "][" << (int)fx.getNeglectedBitsStatus()
+      << "]";
+  return out;
+}
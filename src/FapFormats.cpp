@@ -0,0 +1,830 @@
+//===- FapFormats.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapFormats.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Standard narrow formats - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapFormats.h"
+#include "FapContext.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+/// @brief Conversions of the half precision on the F16C instructions, for
+/// the processors which have them
+#if defined(__GNUC__) && defined(__x86_64__)
+#define FAP_FORMATS_F16C              1
+#include <immintrin.h>
+#endif
+
+/// @brief Values below which a worker is not worth a thread
+#ifndef FAP_FORMATS_THREAD_WORK
+#define FAP_FORMATS_THREAD_WORK       (1 << 14)
+#endif
+
+/// @brief 64 bit lanes of a vector of the 16 bit formats
+#ifndef FAP_FORMATS_LANES
+#define FAP_FORMATS_LANES             8
+#endif
+
+/// @brief Versions of the kernels for each instruction set, selected at the
+/// loading by the processor
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define FAP_FORMATS_CLONES \
+  __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define FAP_FORMATS_CLONES
+#endif
+
+/// @brief The lane operations are inlined in the versions of the kernels
+#define FAP_FORMATS_INLINE            inline __attribute__((always_inline))
+
+// The vectors never cross a function boundary
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/// @brief Pairs of FP8 operands, indexes of the tables of the results
+#define FAP_FORMATS_FP8_PAIRS         (1 << 16)
+
+namespace {
+
+using ::fap::ArithmeticContext;
+using ::fap::ArithmeticState;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+typedef uint64_t LaneU __attribute__((vector_size(8 * FAP_FORMATS_LANES)));
+typedef int64_t LaneI __attribute__((vector_size(8 * FAP_FORMATS_LANES)));
+typedef double LaneD __attribute__((vector_size(8 * FAP_FORMATS_LANES)));
+
+/// @brief Double of the bits \p bits
+inline double bitsToDouble(uint64_t bits) {
+  double val;
+  memcpy(&val, &bits, sizeof(val));
+  return val;
+}
+
+/// @brief Packed values of exponent size E and mantissa size M
+template<int E, int M>
+struct Format {
+  static const int bias = (1 << (E - 1)) - 1;
+  static const uint32_t maxExp = (1u << E) - 1;
+  static const uint32_t mantMask = (1u << M) - 1;
+  static const uint32_t signBit = 1u << (E + M);
+  static const uint32_t inf = maxExp << M;
+  static const uint32_t nan = inf | 0x01;
+  static const uint32_t maxFinite = inf - 1;
+
+  static bool isSpecial(uint32_t bits) {
+    return (bits & inf) == inf;
+  }
+
+  static bool isNaN(uint32_t bits) {
+    return (bits & (signBit - 1)) > inf;
+  }
+
+  static bool isZero(uint32_t bits) {
+    return (bits & (signBit - 1)) == 0;
+  }
+
+  /// @brief Exact value of finite bits
+  static double toDouble(uint32_t bits) {
+    uint32_t exp = (bits >> M) & maxExp;
+    uint32_t sig = (bits & mantMask) | (exp != 0 ? mantMask + 1 : 0);
+    int64_t exp2 = (int64_t)(exp != 0 ? exp : 1) - bias - M;
+    double val = (double)sig * bitsToDouble((uint64_t)(exp2 + 1023) << 52);
+    return (bits & signBit) != 0 ? -val : val;
+  }
+
+  /// @brief Float of the bits, the NaNs are quiet with the payload of
+  /// the F16C conversions
+  static float toFloat(uint32_t bits) {
+    if (isSpecial(bits)) {
+      uint32_t mant = bits & mantMask;
+      uint32_t val = ((bits & signBit) != 0 ? 0x80000000u : 0) | 0x7f800000u |
+                     (mant << (FLOAT_MANT_SIZE - M)) |
+                     (mant != 0 ? 0x400000u : 0);
+      float res;
+      memcpy(&res, &val, sizeof(res));
+      return res;
+    }
+    return (float)toDouble(bits);
+  }
+
+  template<int R>
+  static uint32_t overflow(uint32_t sign) {
+    switch (R) {
+      case FAP_FP_ROUND_NEAREST:
+        return inf;
+      case FAP_FP_ROUND_TOWARD_PINF:
+        return sign != 0 ? maxFinite : inf;
+      case FAP_FP_ROUND_TOWARD_NINF:
+        return sign != 0 ? inf : maxFinite;
+      default:
+        return maxFinite;
+    }
+  }
+
+  /// @brief \p val + \p err rounded as setSignificand(), where \p err is
+  /// below the last bit of \p val; only its sign is used
+  template<int R>
+  static uint32_t round(double val, double err) {
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    uint32_t sign = (uint32_t)(bits >> 63);
+    uint64_t mag = bits & 0x7fffffffffffffffULL;
+    if (mag == 0) {
+      return sign << (E + M);
+    }
+    // Below the magnitude of val, the bits of the one before it and sticky
+    bool sticky = err != 0.0;
+    if (sticky && (err < 0.0) != (sign != 0)) {
+      mag -= 1;
+    }
+
+    int64_t exp = (int64_t)(mag >> DOUBLE_MANT_SIZE) - 1023 + bias;
+    uint64_t sig = (mag & MASK_LOWER_HIGH(uint64_t, DOUBLE_MANT_SIZE)) |
+                   MASK_BIT_HIGH(uint64_t, DOUBLE_MANT_SIZE);
+    int64_t shift = DOUBLE_MANT_SIZE - M;
+    if (exp < 1) {
+      // Subnormal, the lsb has the weight of the minimum exponent
+      shift = ::std::min(shift + 1 - exp, (int64_t)60);
+      exp = 0;
+    }
+    uint64_t kept = sig >> shift;
+    uint64_t rem = sig & (((uint64_t)1 << shift) - 1);
+    uint64_t half = (uint64_t)1 << (shift - 1);
+    bool up = false;
+    if (R == FAP_FP_ROUND_NEAREST) {
+      up = rem > half || (rem == half && (sticky || (kept & 0x01) != 0));
+    } else if (R == FAP_FP_ROUND_TOWARD_PINF) {
+      up = (rem != 0 || sticky) && sign == 0;
+    } else if (R == FAP_FP_ROUND_TOWARD_NINF) {
+      up = (rem != 0 || sticky) && sign != 0;
+    }
+    // The carry goes on the exponent, up to the infinity
+    uint64_t fields = (exp != 0 ? (uint64_t)(exp - 1) << M : 0) + kept +
+                      (up ? 1 : 0);
+    if (fields >= inf) {
+      fields = overflow<R>(sign);
+    }
+    return (sign << (E + M)) | (uint32_t)fields;
+  }
+
+  template<int R>
+  static uint32_t fromFloat(float val) {
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    if ((bits & 0x7f800000u) == 0x7f800000u) {
+      return ((bits >> 31) << (E + M)) |
+             ((bits & 0x7fffffu) != 0 ? nan : inf);
+    }
+    return round<R>((double)val, 0.0);
+  }
+};
+
+template<int E, int M> const uint32_t Format<E, M>::mantMask;
+template<int E, int M> const uint32_t Format<E, M>::signBit;
+template<int E, int M> const uint32_t Format<E, M>::inf;
+template<int E, int M> const uint32_t Format<E, M>::nan;
+template<int E, int M> const uint32_t Format<E, M>::maxFinite;
+
+typedef Format<5, 10> Fp16;
+typedef Format<8, 7> Bf16;
+typedef Format<4, 3> Fp8E4M3;
+typedef Format<5, 2> Fp8E5M2;
+
+/// @brief Lanes of the arithmetic of a format, on doubles: the sums and the
+/// products of the format are exact or have the error of the sum
+/// recovered, the quotients are away from the rounding boundaries unless
+/// their product with the divisor, exact in that case, gives back the
+/// dividend. The masks have the bits of a lane all set or all clear and the
+/// comparisons are signed, which AVX2 has on 64 bits.
+template<int E, int M>
+struct Lanes {
+  typedef Format<E, M> F;
+
+  static FAP_FORMATS_INLINE LaneU splat(uint64_t val) {
+    LaneU lanes = { };
+    return lanes + val;
+  }
+
+  static FAP_FORMATS_INLINE LaneU mask(LaneI cmp) {
+    return (LaneU)cmp;
+  }
+
+  static FAP_FORMATS_INLINE LaneU sel(LaneU m, LaneU lhs, LaneU rhs) {
+    return (lhs & m) | (rhs & ~m);
+  }
+
+  /// @brief Exact doubles of finite packed values
+  static FAP_FORMATS_INLINE LaneD toDouble(LaneU bits) {
+    LaneU exp = (bits >> M) & F::maxExp;
+    LaneU subnormal = mask((LaneI)exp == 0);
+    LaneU sig = (bits & F::mantMask) | (~subnormal & (F::mantMask + 1));
+    // The significand on the mantissa of 2^52, the scale on the exponent
+    LaneD val = (LaneD)(sig | 0x4330000000000000ULL) - 4503599627370496.0;
+    LaneU exp2 = sel(subnormal, splat(1), exp) - (F::bias + M) + 1023;
+    val *= (LaneD)(exp2 << DOUBLE_MANT_SIZE);
+    return (LaneD)((LaneU)val | ((bits >> (E + M)) << 63));
+  }
+
+  /// @brief \p val + \p err rounded as setSignificand(), where \p err is
+  /// below the last bit of \p val; only its sign is used
+  template<int R>
+  static FAP_FORMATS_INLINE LaneU round(LaneD val, LaneD err) {
+    LaneU bits = (LaneU)val;
+    LaneU sign = bits >> 63;
+    LaneU mag = bits & 0x7fffffffffffffffULL;
+    LaneU zero = mask((LaneI)mag == 0);
+    // Below the magnitude of val, the bits of the one before it and sticky
+    LaneU sticky = mask(err != 0.0);
+    mag += sticky & mask((LaneI)(((LaneU)err >> 63) ^ sign) != 0);
+
+    LaneI exp = (LaneI)(mag >> DOUBLE_MANT_SIZE) - 1023 + F::bias;
+    LaneU sig = (mag & MASK_LOWER_HIGH(uint64_t, DOUBLE_MANT_SIZE)) |
+                MASK_BIT_HIGH(uint64_t, DOUBLE_MANT_SIZE);
+    // Subnormal, the lsb has the weight of the minimum exponent
+    LaneU subnormal = mask(exp < 1);
+    LaneI sub_shift = DOUBLE_MANT_SIZE - M + 1 - exp;
+    sub_shift = (LaneI)sel(mask(sub_shift > 60), splat(60),
+                           (LaneU)sub_shift);
+    LaneU shift = sel(subnormal, (LaneU)sub_shift,
+                      splat(DOUBLE_MANT_SIZE - M));
+    exp = (LaneI)(~subnormal & (LaneU)exp);
+
+    LaneU kept = sig >> shift;
+    LaneI rem = (LaneI)(sig & (((uint64_t)1 << shift) - 1));
+    LaneI half = (LaneI)((uint64_t)1 << (shift - 1));
+    LaneU inexact = mask(rem != 0) | sticky;
+    LaneU up = { };
+    if (R == FAP_FP_ROUND_NEAREST) {
+      up = mask(rem > half) |
+           (mask(rem == half) & (sticky | mask((LaneI)(kept & 0x01) != 0)));
+    } else if (R == FAP_FP_ROUND_TOWARD_PINF) {
+      up = inexact & mask((LaneI)sign == 0);
+    } else if (R == FAP_FP_ROUND_TOWARD_NINF) {
+      up = inexact & mask((LaneI)sign != 0);
+    }
+    // The carry goes on the exponent, up to the infinity
+    LaneU fields = (~mask(exp == 0) & ((LaneU)(exp - 1) << M)) + kept +
+                   (up & 0x01);
+
+    LaneU overflow;
+    if (R == FAP_FP_ROUND_NEAREST) {
+      overflow = splat(F::inf);
+    } else if (R == FAP_FP_ROUND_TOWARD_PINF) {
+      overflow = sel(mask((LaneI)sign != 0), splat(F::maxFinite),
+                     splat(F::inf));
+    } else if (R == FAP_FP_ROUND_TOWARD_NINF) {
+      overflow = sel(mask((LaneI)sign != 0), splat(F::inf),
+                     splat(F::maxFinite));
+    } else {
+      overflow = splat(F::maxFinite);
+    }
+    fields = sel(mask((LaneI)fields >= (int64_t)F::inf), overflow, fields);
+    fields &= ~zero;
+    return (sign << (E + M)) | fields;
+  }
+
+  template<FAP_batch_op Op, int R>
+  static FAP_FORMATS_INLINE LaneU apply(LaneU lhs, LaneU rhs) {
+    if (Op == FAP_BATCH_SUB) {
+      rhs ^= F::signBit;
+    }
+    LaneD x = toDouble(lhs), y = toDouble(rhs);
+    LaneU lhs_sign = lhs & F::signBit;
+    LaneU sign = (lhs ^ rhs) & F::signBit;
+    LaneD exact = { };
+    LaneU res;
+    switch (Op) {
+      case FAP_BATCH_ADD:
+      case FAP_BATCH_SUB: {
+        LaneD sum = x + y;
+        LaneD virt = sum - x;
+        LaneD err = (x - (sum - virt)) + (y - virt);
+        res = round<R>(sum, err);
+        // The sum of opposite values is +0, but rounding toward -infinity
+        LaneU zero_sign = splat(R == FAP_FP_ROUND_TOWARD_NINF ? F::signBit
+                                                              : 0);
+        res = sel(mask(sum == 0.0),
+                  sel(mask((LaneI)sign == 0), lhs_sign, zero_sign), res);
+        break;
+      }
+      case FAP_BATCH_MUL:
+        res = round<R>(x * y, exact);
+        break;
+      default: {
+        LaneD quot = x / y;
+        LaneD rem = quot * y - x;
+        res = round<R>(quot, -rem * y);
+        break;
+      }
+    }
+
+    // Special values, a zero divisor too
+    LaneU lhs_fields = lhs & (F::signBit - 1);
+    LaneU rhs_fields = rhs & (F::signBit - 1);
+    LaneU lhs_special = mask((LaneI)lhs_fields >= (int64_t)F::inf);
+    LaneU rhs_special = mask((LaneI)rhs_fields >= (int64_t)F::inf);
+    LaneU lhs_zero = mask((LaneI)lhs_fields == 0);
+    LaneU rhs_zero = mask((LaneI)rhs_fields == 0);
+    LaneU nan = mask((LaneI)lhs_fields > (int64_t)F::inf) |
+                mask((LaneI)rhs_fields > (int64_t)F::inf);
+    switch (Op) {
+      case FAP_BATCH_ADD:
+      case FAP_BATCH_SUB:
+        nan |= lhs_special & rhs_special & mask((LaneI)sign != 0);
+        res = sel(rhs_special, rhs, res);
+        res = sel(lhs_special & ~rhs_special, lhs, res);
+        break;
+      case FAP_BATCH_MUL:
+        res = sel(lhs_special | rhs_special,
+                  sign | sel(lhs_zero | rhs_zero, splat(F::nan),
+                             splat(F::inf)), res);
+        break;
+      default:
+        res = sel(lhs_zero, sign, res);
+        res = sel(rhs_zero,
+                  sign | sel(lhs_zero, splat(F::nan), splat(F::inf)), res);
+        res = sel(rhs_special, sign, res);
+        res = sel(lhs_special,
+                  sign | sel(rhs_special, splat(F::nan), splat(F::inf)),
+                  res);
+        break;
+    }
+    return sel(nan, lhs_sign | F::nan, res);
+  }
+
+  template<FAP_batch_op Op, int R>
+  static FAP_FORMATS_INLINE void loop(const uint16_t* lhs,
+                                      const uint16_t* rhs, uint16_t* res,
+                                      size_t n) {
+    LaneU lhs_lanes, rhs_lanes, res_lanes;
+    size_t i = 0;
+    for (; i + FAP_FORMATS_LANES <= n; i += FAP_FORMATS_LANES) {
+      for (int j = 0; j < FAP_FORMATS_LANES; ++j) {
+        lhs_lanes[j] = lhs[i + j];
+        rhs_lanes[j] = rhs[i + j];
+      }
+      res_lanes = apply<Op, R>(lhs_lanes, rhs_lanes);
+      for (int j = 0; j < FAP_FORMATS_LANES; ++j) {
+        res[i + j] = (uint16_t)res_lanes[j];
+      }
+    }
+    if (i < n) {
+      // Last values on zeroed lanes
+      lhs_lanes = splat(0);
+      rhs_lanes = splat(0);
+      for (size_t j = 0; i + j < n; ++j) {
+        lhs_lanes[j] = lhs[i + j];
+        rhs_lanes[j] = rhs[i + j];
+      }
+      res_lanes = apply<Op, R>(lhs_lanes, rhs_lanes);
+      for (size_t j = 0; i + j < n; ++j) {
+        res[i + j] = (uint16_t)res_lanes[j];
+      }
+    }
+  }
+
+  template<FAP_batch_op Op>
+  static FAP_FORMATS_INLINE void loopRounding(FAP_rounding_method rounding,
+                                              const uint16_t* lhs,
+                                              const uint16_t* rhs,
+                                              uint16_t* res, size_t n) {
+    switch (rounding) {
+      case FAP_FP_ROUND_TOWARD_0:
+        loop<Op, FAP_FP_ROUND_TOWARD_0>(lhs, rhs, res, n);
+        break;
+      case FAP_FP_ROUND_TOWARD_PINF:
+        loop<Op, FAP_FP_ROUND_TOWARD_PINF>(lhs, rhs, res, n);
+        break;
+      case FAP_FP_ROUND_TOWARD_NINF:
+        loop<Op, FAP_FP_ROUND_TOWARD_NINF>(lhs, rhs, res, n);
+        break;
+      default:
+        loop<Op, FAP_FP_ROUND_NEAREST>(lhs, rhs, res, n);
+        break;
+    }
+  }
+
+  static FAP_FORMATS_INLINE void run(FAP_batch_op op,
+                                     FAP_rounding_method rounding,
+                                     const uint16_t* lhs, const uint16_t* rhs,
+                                     uint16_t* res, size_t n) {
+    switch (op) {
+      case FAP_BATCH_ADD:
+        loopRounding<FAP_BATCH_ADD>(rounding, lhs, rhs, res, n);
+        break;
+      case FAP_BATCH_SUB:
+        loopRounding<FAP_BATCH_SUB>(rounding, lhs, rhs, res, n);
+        break;
+      case FAP_BATCH_MUL:
+        loopRounding<FAP_BATCH_MUL>(rounding, lhs, rhs, res, n);
+        break;
+      case FAP_BATCH_DIV:
+        loopRounding<FAP_BATCH_DIV>(rounding, lhs, rhs, res, n);
+        break;
+    }
+  }
+};
+
+/// @brief Conversion of \p val as fromSignificand()
+uint32_t encodeGeneric(float val, FloatPrecTy prec,
+                       FAP_rounding_method method) {
+  FloatingPointType fp = val;
+  FloatingPointType res;
+  if (fp.isNaN() || fp.isInf()) {
+    res.setPrec(prec);
+    res.setSign(fp.getSign());
+    if (fp.isNaN()) {
+      res.setNaN();
+    } else {
+      res.setInf();
+    }
+  } else {
+    int exp2 = 0;
+    MantType sig = fp.getSignificand(exp2);
+    res = FloatingPointType::fromSignificand(fp.getSign(), sig, exp2, false,
+                                             prec, method);
+  }
+  return (uint32_t)::fap::packValue(res);
+}
+
+template<typename FormatTy, int R, typename StorageTy>
+void encodeLoop(const float* in, StorageTy* out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = (StorageTy)FormatTy::template fromFloat<R>(in[i]);
+  }
+}
+
+template<typename FormatTy, typename StorageTy>
+void encodeFormat(FAP_rounding_method rounding, const float* in,
+                  StorageTy* out, size_t n) {
+  switch (rounding) {
+    case FAP_FP_ROUND_TOWARD_0:
+      encodeLoop<FormatTy, FAP_FP_ROUND_TOWARD_0>(in, out, n);
+      break;
+    case FAP_FP_ROUND_TOWARD_PINF:
+      encodeLoop<FormatTy, FAP_FP_ROUND_TOWARD_PINF>(in, out, n);
+      break;
+    case FAP_FP_ROUND_TOWARD_NINF:
+      encodeLoop<FormatTy, FAP_FP_ROUND_TOWARD_NINF>(in, out, n);
+      break;
+    default:
+      encodeLoop<FormatTy, FAP_FP_ROUND_NEAREST>(in, out, n);
+      break;
+  }
+}
+
+/// @brief bfloat16 of the float bits, adding below the kept ones what
+/// makes the rounding carry on them
+void encodeBf16(FAP_rounding_method rounding, const float* in,
+                uint16_t* out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    uint32_t bits;
+    memcpy(&bits, &in[i], sizeof(bits));
+    if ((bits & 0x7fffffffu) > 0x7f800000u) {
+      out[i] = (uint16_t)(((bits >> 16) & Bf16::signBit) | Bf16::nan);
+      continue;
+    }
+    uint32_t sign = bits >> 31, add = 0;
+    switch (rounding) {
+      case FAP_FP_ROUND_TOWARD_PINF:
+        add = sign != 0 ? 0 : 0xffff;
+        break;
+      case FAP_FP_ROUND_TOWARD_NINF:
+        add = sign != 0 ? 0xffff : 0;
+        break;
+      case FAP_FP_ROUND_NEAREST:
+        add = 0x7fff + ((bits >> 16) & 0x01);
+        break;
+      default:
+        break;
+    }
+    out[i] = (uint16_t)((bits + add) >> 16);
+  }
+}
+
+#ifdef FAP_FORMATS_F16C
+/// @brief Half precision of the floats on the F16C conversions, \p Imm
+/// is their rounding; the NaNs get the one of setNaN()
+template<int Imm>
+__attribute__((target("f16c"))) void encodeF16c(const float* in,
+                                                uint16_t* out, size_t n) {
+  const __m128i mag_mask = _mm_set1_epi16(0x7fff);
+  const __m128i inf = _mm_set1_epi16(Fp16::inf);
+  const __m128i nan = _mm_set1_epi16(Fp16::nan);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), Imm);
+    __m128i is_nan = _mm_cmpgt_epi16(_mm_and_si128(half, mag_mask), inf);
+    __m128i fixed = _mm_or_si128(_mm_andnot_si128(mag_mask, half), nan);
+    half = _mm_or_si128(_mm_andnot_si128(is_nan, half),
+                        _mm_and_si128(is_nan, fixed));
+    _mm_storeu_si128((__m128i*)(out + i), half);
+  }
+  for (; i < n; ++i) {
+    uint16_t half = _cvtss_sh(in[i], Imm);
+    if ((half & 0x7fff) > Fp16::inf) {
+      half = (half & Fp16::signBit) | Fp16::nan;
+    }
+    out[i] = half;
+  }
+}
+
+__attribute__((target("f16c"))) void decodeF16c(const uint16_t* in,
+                                                float* out, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i half = _mm_loadu_si128((const __m128i*)(in + i));
+    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(half));
+  }
+  for (; i < n; ++i) {
+    out[i] = _cvtsh_ss(in[i]);
+  }
+}
+#endif
+
+/// @brief Floats of the 256 values of an FP8 format
+template<typename FormatTy>
+struct DecodeTable {
+  float values[256];
+
+  DecodeTable() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      values[i] = FormatTy::toFloat(i);
+    }
+  }
+
+  static const DecodeTable& get() {
+    static const DecodeTable table;
+    return table;
+  }
+};
+
+/// @brief Vectorized kernel of the 16 bit formats, a version for each
+/// instruction set
+FAP_FORMATS_CLONES
+void laneKernel(FAP_format format, FAP_batch_op op,
+                FAP_rounding_method rounding, const uint16_t* lhs,
+                const uint16_t* rhs, uint16_t* res, size_t n) {
+  if (format == FAP_FORMAT_FP16) {
+    Lanes<5, 10>::run(op, rounding, lhs, rhs, res, n);
+  } else {
+    Lanes<8, 7>::run(op, rounding, lhs, rhs, res, n);
+  }
+}
+
+/// @brief Kernel of the operators, for the contexts the fast paths do not
+/// cover and the tables of the FP8 results
+template<typename StorageTy>
+void genericKernel(FAP_batch_op op, FloatPrecTy prec, const StorageTy* lhs,
+                   const StorageTy* rhs, StorageTy* res, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    FloatingPointType val = ::fap::unpackValue(lhs[i], prec);
+    FloatingPointType rhs_val = ::fap::unpackValue(rhs[i], prec);
+    switch (op) {
+      case FAP_BATCH_ADD:
+        val += rhs_val;
+        break;
+      case FAP_BATCH_SUB:
+        val -= rhs_val;
+        break;
+      case FAP_BATCH_MUL:
+        val *= rhs_val;
+        break;
+      case FAP_BATCH_DIV:
+        val /= rhs_val;
+        break;
+    }
+    res[i] = (StorageTy)::fap::packValue(val);
+  }
+}
+
+/// @brief Results of \p op on the pairs of operands of an FP8 format, at
+/// index lhs << 8 | rhs, filled at the first use in the ArithmeticContext
+/// of the caller, whose rounding is \p rounding
+const uint8_t* resultTable(FAP_format format, FAP_batch_op op,
+                           FAP_rounding_method rounding) {
+  static ::std::mutex lock;
+  static ::std::unique_ptr<uint8_t[]> tables[2][4][4];
+  ::std::lock_guard< ::std::mutex> guard(lock);
+  ::std::unique_ptr<uint8_t[]>& table =
+      tables[format - FAP_FORMAT_FP8_E4M3][op][rounding];
+  if (!table) {
+    ::std::vector<uint8_t> lhs(FAP_FORMATS_FP8_PAIRS),
+        rhs(FAP_FORMATS_FP8_PAIRS);
+    for (uint32_t i = 0; i < FAP_FORMATS_FP8_PAIRS; ++i) {
+      lhs[i] = (uint8_t)(i >> 8);
+      rhs[i] = (uint8_t)i;
+    }
+    table.reset(new uint8_t[FAP_FORMATS_FP8_PAIRS]);
+    genericKernel(op, ::fap::formatPrec(format), lhs.data(), rhs.data(),
+                  table.get(), FAP_FORMATS_FP8_PAIRS);
+  }
+  return table.get();
+}
+
+/// @brief If the fast paths give the results of the operators in \p state
+bool fastContext(const ArithmeticState& state) {
+  return state.rounding != FAP_FP_ROUND_STOCHASTIC &&
+         state.fastMath == FAP_FAST_MATH_NONE &&
+         state.special == FAP_SPECIAL_IEEE;
+}
+
+/// @brief Exit if \p format is not stored on \p bytes
+void checkStorage(const char* fn, FAP_format format, size_t bytes) {
+  bool wide = format == FAP_FORMAT_FP16 || format == FAP_FORMAT_BF16;
+  if (wide != (bytes == sizeof(uint16_t))) {
+    ::std::cerr << fn << ": the format is not stored on " << bytes * 8
+                << " bits";
+    exit(1);
+  }
+}
+
+}  // end anonymous namespace
+
+::fap::FloatPrecTy fap::formatPrec(FAP_format format) {
+  switch (format) {
+    case FAP_FORMAT_FP16:
+      return PREC_FP16;
+    case FAP_FORMAT_BF16:
+      return PREC_BF16;
+    case FAP_FORMAT_FP8_E4M3:
+      return PREC_FP8_E4M3;
+    default:
+      return PREC_FP8_E5M2;
+  }
+}
+
+bool fap::findFormat(FloatPrecTy prec, FAP_format& format) {
+  for (int f = FAP_FORMAT_FP16; f <= FAP_FORMAT_FP8_E5M2; ++f) {
+    FloatPrecTy candidate = formatPrec((FAP_format)f);
+    if (candidate.exp_size == prec.exp_size &&
+        candidate.mant_size == prec.mant_size) {
+      format = (FAP_format)f;
+      return true;
+    }
+  }
+  return false;
+}
+
+void fap::encode(FAP_format format, const float* in, uint16_t* out,
+                 size_t n) {
+  checkStorage("encode", format, sizeof(uint16_t));
+  FAP_rounding_method rounding = ArithmeticContext::current().rounding;
+  if (rounding == FAP_FP_ROUND_STOCHASTIC) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = (uint16_t)encodeGeneric(in[i], formatPrec(format), rounding);
+    }
+    return;
+  }
+  if (format == FAP_FORMAT_BF16) {
+    encodeBf16(rounding, in, out, n);
+    return;
+  }
+#ifdef FAP_FORMATS_F16C
+  if (__builtin_cpu_supports("f16c")) {
+    switch (rounding) {
+      case FAP_FP_ROUND_TOWARD_0:
+        encodeF16c<_MM_FROUND_TO_ZERO>(in, out, n);
+        break;
+      case FAP_FP_ROUND_TOWARD_PINF:
+        encodeF16c<_MM_FROUND_TO_POS_INF>(in, out, n);
+        break;
+      case FAP_FP_ROUND_TOWARD_NINF:
+        encodeF16c<_MM_FROUND_TO_NEG_INF>(in, out, n);
+        break;
+      default:
+        encodeF16c<_MM_FROUND_TO_NEAREST_INT>(in, out, n);
+        break;
+    }
+    return;
+  }
+#endif
+  encodeFormat<Fp16>(rounding, in, out, n);
+}
+
+void fap::encode(FAP_format format, const float* in, uint8_t* out,
+                 size_t n) {
+  checkStorage("encode", format, sizeof(uint8_t));
+  FAP_rounding_method rounding = ArithmeticContext::current().rounding;
+  if (rounding == FAP_FP_ROUND_STOCHASTIC) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = (uint8_t)encodeGeneric(in[i], formatPrec(format), rounding);
+    }
+  } else if (format == FAP_FORMAT_FP8_E4M3) {
+    encodeFormat<Fp8E4M3>(rounding, in, out, n);
+  } else {
+    encodeFormat<Fp8E5M2>(rounding, in, out, n);
+  }
+}
+
+void fap::decode(FAP_format format, const uint16_t* in, float* out,
+                 size_t n) {
+  checkStorage("decode", format, sizeof(uint16_t));
+  if (format == FAP_FORMAT_BF16) {
+    for (size_t i = 0; i < n; ++i) {
+      uint32_t bits = (uint32_t)in[i] << 16;
+      memcpy(&out[i], &bits, sizeof(bits));
+    }
+    return;
+  }
+#ifdef FAP_FORMATS_F16C
+  if (__builtin_cpu_supports("f16c")) {
+    decodeF16c(in, out, n);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = Fp16::toFloat(in[i]);
+  }
+}
+
+void fap::decode(FAP_format format, const uint8_t* in, float* out,
+                 size_t n) {
+  checkStorage("decode", format, sizeof(uint8_t));
+  const float* values = format == FAP_FORMAT_FP8_E4M3
+                            ? DecodeTable<Fp8E4M3>::get().values
+                            : DecodeTable<Fp8E5M2>::get().values;
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = values[in[i]];
+  }
+}
+
+void fap::batchOp(FAP_batch_op op, FAP_format format, const uint16_t* lhs,
+                  const uint16_t* rhs, uint16_t* res, size_t n,
+                  unsigned threads) {
+  checkStorage("batchOp", format, sizeof(uint16_t));
+  ::std::vector<size_t> bounds =
+      evenShares(n, n / FAP_FORMATS_THREAD_WORK, threads);
+
+  // The results are on the precision of the values
+  ArithmeticState state = ArithmeticContext::current();
+  state.hasResultPrec = false;
+  ArithmeticContext ctx(state);
+  if (!fastContext(state)) {
+    FloatPrecTy prec = formatPrec(format);
+    parallelShares(bounds, [&](size_t begin, size_t end) {
+      genericKernel(op, prec, lhs + begin, rhs + begin, res + begin,
+                    end - begin);
+    });
+    return;
+  }
+
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    laneKernel(format, op, state.rounding, lhs + begin, rhs + begin,
+               res + begin, end - begin);
+  });
+}
+
+void fap::batchOp(FAP_batch_op op, FAP_format format, const uint8_t* lhs,
+                  const uint8_t* rhs, uint8_t* res, size_t n,
+                  unsigned threads) {
+  checkStorage("batchOp", format, sizeof(uint8_t));
+  ::std::vector<size_t> bounds =
+      evenShares(n, n / FAP_FORMATS_THREAD_WORK, threads);
+
+  // The results are on the precision of the values
+  ArithmeticState state = ArithmeticContext::current();
+  state.hasResultPrec = false;
+  ArithmeticContext ctx(state);
+  if (!fastContext(state)) {
+    FloatPrecTy prec = formatPrec(format);
+    parallelShares(bounds, [&](size_t begin, size_t end) {
+      genericKernel(op, prec, lhs + begin, rhs + begin, res + begin,
+                    end - begin);
+    });
+    return;
+  }
+
+  const uint8_t* table = resultTable(format, op, state.rounding);
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      res[i] = table[((uint32_t)lhs[i] << 8) | rhs[i]];
+    }
+  });
+}
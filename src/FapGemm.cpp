@@ -0,0 +1,1041 @@
+//===- FapGemm.cpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapGemm.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Matrix multiply - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapGemm.h"
+#include "FapContext.h"
+
+#include <algorithm>
+#include <vector>
+
+/// @defgroup FAP_GEMM_BLOCKING Blocking of the matrix multiply
+/// @{
+#ifndef FAP_GEMM_MR
+#define FAP_GEMM_MR                   4  ///< Rows of the micro-kernel
+#endif
+#ifndef FAP_GEMM_NR
+#define FAP_GEMM_NR                   4  ///< Columns of the micro-kernel
+#endif
+#ifndef FAP_GEMM_MC
+#define FAP_GEMM_MC                   64  ///< Rows of the packed A blocks
+#endif
+#ifndef FAP_GEMM_KC
+#define FAP_GEMM_KC                   256  ///< Depth of the packed blocks
+#endif
+#ifndef FAP_GEMM_NC
+#define FAP_GEMM_NC                   1024  ///< Columns of the B panels
+#endif
+/// @brief Multiply-accumulates below which a worker is not worth a thread
+#ifndef FAP_GEMM_THREAD_WORK
+#define FAP_GEMM_THREAD_WORK          (1 << 18)
+#endif
+/// @}
+
+/// @brief Largest mantissa of the micro-kernel on 64 bits words
+#define FAP_GEMM_WORD_MANT_SIZE       29
+/// @brief Msb of the wide accumulator, 2 bits below the top for the sums
+#define FAP_GEMM_WIDE_MSB             125
+
+namespace {
+
+using ::fap::ArithmeticContext;
+using ::fap::ArithmeticState;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::fap::IntegerType;
+
+typedef enum {
+  KIND_FINITE = 0,
+  KIND_INF,
+  KIND_NAN
+} KindTy;
+
+/// @brief Unpacked operand, (-1)^sign * sig * 2^exp2 as getSignificand()
+struct Operand {
+  uint64_t sig;
+  int32_t exp2;
+  uint8_t sign;
+  uint8_t kind;
+};
+
+inline int leadingZeros(uint64_t val) {
+  return __builtin_clzll(val);
+}
+
+inline int leadingZeros(uint128_t val) {
+  return fap_clz_(val);
+}
+
+/// @brief Shift right \p sig jamming the lost bits in its lsb
+inline uint128_t jamShift(uint128_t sig, int to_shift) {
+  if (to_shift <= 0) {
+    return sig;
+  }
+  if (to_shift >= (int)(sizeof(uint128_t) * 8)) {
+    return sig != 0 ? 0x01 : 0x00;
+  }
+  bool lost = (sig & MASK_LOWER_HIGH(uint128_t, to_shift)) != 0;
+  return (sig >> to_shift) | (lost ? 0x01 : 0x00);
+}
+
+/// @brief Precision and context of the results
+struct RoundingParams {
+  FAP_rounding_method method;
+  uint8_t fastMath;
+  bool saturate;  ///< Overflows give the greatest finite value
+  int bias;
+  int maxExp;
+  int mantSize;
+  int minExp2;  ///< Exponent of the lsb of the subnormals
+};
+
+RoundingParams makeParams(FloatPrecTy prec, const ArithmeticState &ctx) {
+  RoundingParams params;
+  params.method = ctx.rounding;
+  params.fastMath = ctx.fastMath;
+  params.saturate = (ctx.fastMath & FAP_FAST_MATH_FINITE) ||
+                    ctx.special == FAP_SPECIAL_SATURATE;
+  params.bias = EXPONENT_BIAS(prec.exp_size);
+  params.maxExp = MASK_LOWER_HIGH(ExpType, prec.exp_size);
+  params.mantSize = prec.mant_size;
+  params.minExp2 = 1 - params.bias - prec.mant_size;
+  return params;
+}
+
+/// @brief Rounded value of the micro-kernel, as getSignificand() of the
+/// result of an operator
+template<typename WordTy>
+struct RoundedAcc {
+  WordTy sig;
+  int32_t exp2;
+  uint8_t sign;
+  uint8_t kind;
+};
+
+template<typename WordTy>
+inline void setOverflow(RoundedAcc<WordTy> &res, const RoundingParams &p) {
+  if (!p.saturate &&
+      (p.method == FAP_FP_ROUND_NEAREST ||
+       (p.method == FAP_FP_ROUND_TOWARD_PINF && res.sign == 0) ||
+       (p.method == FAP_FP_ROUND_TOWARD_NINF && res.sign != 0))) {
+    res.kind = KIND_INF;
+    return;
+  }
+  res.sig = MASK_LOWER_HIGH(WordTy, (p.mantSize + 1));
+  res.exp2 = (p.maxExp - 1) - p.bias - p.mantSize;
+}
+
+/// @brief Round (-1)^sign * sig * 2^exp2 as setSignificand(), then apply
+/// the fast math flags and the special policy as the operators
+template<typename WordTy>
+void roundToSlow(RoundedAcc<WordTy> &res, uint8_t sign, WordTy sig, int exp2,
+                 const RoundingParams &p) {
+  const int width = sizeof(WordTy) * 8;
+  res.sign = sign;
+  res.kind = KIND_FINITE;
+  if (sig == 0) {
+    res.sig = 0;
+    res.exp2 = p.minExp2;
+    return;
+  }
+  int msb = (width - 1) - leadingZeros(sig);
+  int biased_exp = exp2 + msb + p.bias;
+  int to_shift = msb - p.mantSize;
+  if (biased_exp < 1) {
+    to_shift = p.minExp2 - exp2;
+    biased_exp = 0;
+  }
+  if (biased_exp >= p.maxExp) {
+    setOverflow(res, p);
+    return;
+  }
+  if (to_shift > 0) {
+    WordTy rounded = to_shift < width ? sig >> to_shift : 0;
+    WordTy rem = to_shift < width ? sig & MASK_LOWER_HIGH(WordTy, to_shift)
+                                  : sig;
+    // Compare the discarded bits with the half of the lsb
+    int cmp = -1;
+    if (to_shift <= width) {
+      WordTy half = MASK_BIT_HIGH(WordTy, (to_shift - 1));
+      cmp = rem > half ? 1 : (rem == half ? 0 : -1);
+    }
+    bool up = false;
+    switch (p.method) {
+    case FAP_FP_ROUND_NEAREST:
+      up = cmp > 0 || (cmp == 0 && (rounded & 0x1) != 0);
+      break;
+    case FAP_FP_ROUND_TOWARD_PINF:
+      up = rem != 0 && sign == 0;
+      break;
+    case FAP_FP_ROUND_TOWARD_NINF:
+      up = rem != 0 && sign != 0;
+      break;
+    default:
+      break;
+    }
+    rounded += up ? 0x1 : 0x0;
+    if (biased_exp == 0) {
+      // From subnormal to normal, the significand is the hidden bit
+      biased_exp = (rounded >> p.mantSize) != 0 ? 1 : 0;
+    } else if ((rounded >> (p.mantSize + 1)) != 0) {
+      rounded >>= 1;
+      if (++biased_exp >= p.maxExp) {
+        setOverflow(res, p);
+        return;
+      }
+    }
+    sig = rounded;
+  } else {
+    sig <<= -to_shift;
+  }
+  if ((p.fastMath & FAP_FAST_MATH_FTZ) && biased_exp == 0) {
+    // Subnormal results are zeroes, keeping the sign
+    sig = 0;
+  }
+  res.sig = sig;
+  res.exp2 = (biased_exp != 0 ? biased_exp : 1) - p.bias - p.mantSize;
+}
+
+/// @brief Same as roundToSlow(), without branches on the rounding for the
+/// normal results
+template<typename WordTy>
+inline void roundTo(RoundedAcc<WordTy> &res, uint8_t sign, WordTy sig,
+                    int exp2, const RoundingParams &p) {
+  const int width = sizeof(WordTy) * 8;
+  int msb = (width - 1) - leadingZeros(sig | 0x1);
+  int biased_exp = exp2 + msb + p.bias;
+  int to_shift = msb - p.mantSize;
+  if (sig == 0 || biased_exp < 1 || biased_exp >= p.maxExp - 1 ||
+      to_shift <= 0) {
+    roundToSlow(res, sign, sig, exp2, p);
+    return;
+  }
+  // The increment carries into the kept bits when the rounding is up
+  WordTy mask = MASK_LOWER_HIGH(WordTy, to_shift);
+  WordTy inc;
+  if (p.method == FAP_FP_ROUND_NEAREST) {
+    inc = (mask >> 1) + ((sig >> to_shift) & 0x1);
+  } else {
+    bool up = (p.method == FAP_FP_ROUND_TOWARD_PINF && sign == 0) ||
+              (p.method == FAP_FP_ROUND_TOWARD_NINF && sign != 0);
+    inc = up ? mask : 0;
+  }
+  WordTy rounded = (sig + inc) >> to_shift;
+  int carry = (int)(rounded >> (p.mantSize + 1));
+  res.sig = rounded >> carry;
+  res.exp2 = biased_exp + carry - p.bias - p.mantSize;
+  res.sign = sign;
+  res.kind = KIND_FINITE;
+}
+
+template<typename WordTy>
+struct SignedWord;
+
+template<>
+struct SignedWord<uint64_t> {
+  typedef int64_t Ty;
+};
+
+template<>
+struct SignedWord<uint128_t> {
+  typedef int128_t Ty;
+};
+
+/// @brief Product of two operands, as FloatingPointType::operator*=()
+template<typename WordTy>
+inline void mulTo(RoundedAcc<WordTy> &res, const Operand &lhs,
+                  const Operand &rhs, const RoundingParams &p) {
+  roundTo(res, lhs.sign ^ rhs.sign, (WordTy)lhs.sig * rhs.sig,
+          lhs.exp2 + rhs.exp2, p);
+}
+
+/// @brief lhs += rhs, as FloatingPointType::operator+=()
+template<typename WordTy>
+inline void addTo(RoundedAcc<WordTy> &lhs, const RoundedAcc<WordTy> &rhs,
+                  const RoundingParams &p) {
+  if (lhs.kind != KIND_FINITE || rhs.kind != KIND_FINITE) {
+    if (lhs.kind == KIND_NAN || rhs.kind == KIND_NAN) {
+      lhs.kind = KIND_NAN;
+    } else if (lhs.kind == KIND_INF && rhs.kind == KIND_INF) {
+      if (lhs.sign != rhs.sign) {
+        lhs.kind = KIND_NAN;
+      }
+    } else if (rhs.kind == KIND_INF) {
+      lhs.kind = KIND_INF;
+      lhs.sign = rhs.sign;
+    }
+    return;
+  }
+
+  const int width = sizeof(WordTy) * 8;
+  WordTy hidden = MASK_BIT_HIGH(WordTy, p.mantSize);
+  WordTy lhs_sig = lhs.sig, rhs_sig = rhs.sig;
+  if (p.fastMath & FAP_FAST_MATH_DAZ) {
+    // Subnormal operands are zeroes
+    lhs_sig = lhs_sig < hidden ? 0 : lhs_sig;
+    rhs_sig = rhs_sig < hidden ? 0 : rhs_sig;
+  }
+  // The operand with the major exponent, selected without branches
+  typedef typename SignedWord<WordTy>::Ty SignedTy;
+  bool swap = lhs.exp2 < rhs.exp2;
+  WordTy major_sig = swap ? rhs_sig : lhs_sig;
+  WordTy minor_sig = swap ? lhs_sig : rhs_sig;
+  int major_exp2 = swap ? rhs.exp2 : lhs.exp2;
+  int minor_exp2 = swap ? lhs.exp2 : rhs.exp2;
+  uint8_t major_sign = swap ? rhs.sign : lhs.sign;
+  uint8_t minor_sign = swap ? lhs.sign : rhs.sign;
+  // Alignment as in the operator, the room is the one of the word: the
+  // lost bits are jammed far below the rounding position all the same
+  int exp_diff = major_exp2 - minor_exp2;
+  int room = (width - 2) - (p.mantSize + 1);
+  int to_shift = exp_diff < room ? exp_diff : room;
+  major_sig <<= to_shift;
+  major_exp2 -= to_shift;
+  exp_diff -= to_shift;
+  if (exp_diff >= width) {
+    minor_sig = minor_sig != 0 ? 0x01 : 0x00;
+  } else if (exp_diff > 0) {
+    bool lost = (minor_sig & MASK_LOWER_HIGH(WordTy, exp_diff)) != 0;
+    minor_sig = (minor_sig >> exp_diff) | (lost ? 0x01 : 0x00);
+  }
+
+  // Signed sum, both magnitudes are below 2^(width - 2)
+  SignedTy major_val = major_sign ? -(SignedTy)major_sig : (SignedTy)major_sig;
+  SignedTy minor_val = minor_sign ? -(SignedTy)minor_sig : (SignedTy)minor_sig;
+  SignedTy sum = major_val + minor_val;
+  uint8_t res_sign = sum < 0;
+  WordTy res_sig = sum < 0 ? -(WordTy)sum : (WordTy)sum;
+  if (res_sig == 0) {
+    // Zeroes keep the common sign, opposite ones give +0 but rounding
+    // toward -infinity
+    res_sign = major_sign == minor_sign ? major_sign
+                                        : p.method == FAP_FP_ROUND_TOWARD_NINF;
+  }
+  roundTo(lhs, res_sign, res_sig, major_exp2, p);
+}
+
+/// @brief Exact sum of the products, with the lost bits jammed in the lsb
+struct WideAcc {
+  uint128_t sig;
+  int32_t exp2;
+  uint8_t sign;
+  uint8_t kind;
+};
+
+inline void narrow(WideAcc &val) {
+  int msb = (sizeof(uint128_t) * 8 - 1) - fap_clz_(val.sig);
+  if (val.sig != 0 && msb > FAP_GEMM_WIDE_MSB) {
+    val.sig = jamShift(val.sig, msb - FAP_GEMM_WIDE_MSB);
+    val.exp2 += msb - FAP_GEMM_WIDE_MSB;
+  }
+}
+
+inline void wideMul(WideAcc &res, const Operand &lhs, const Operand &rhs) {
+  res.sign = lhs.sign ^ rhs.sign;
+  res.kind = KIND_FINITE;
+  if (lhs.kind != KIND_FINITE || rhs.kind != KIND_FINITE) {
+    if (lhs.kind == KIND_NAN || rhs.kind == KIND_NAN ||
+        (lhs.kind == KIND_FINITE && lhs.sig == 0) ||
+        (rhs.kind == KIND_FINITE && rhs.sig == 0)) {
+      res.kind = KIND_NAN;
+    } else {
+      res.kind = KIND_INF;
+    }
+    return;
+  }
+  res.sig = (uint128_t)lhs.sig * rhs.sig;
+  res.exp2 = lhs.exp2 + rhs.exp2;
+  narrow(res);
+}
+
+inline void wideAdd(WideAcc &lhs, const WideAcc &rhs,
+                    FAP_rounding_method method) {
+  if (lhs.kind != KIND_FINITE || rhs.kind != KIND_FINITE) {
+    if (lhs.kind == KIND_NAN || rhs.kind == KIND_NAN) {
+      lhs.kind = KIND_NAN;
+    } else if (lhs.kind == KIND_INF && rhs.kind == KIND_INF) {
+      if (lhs.sign != rhs.sign) {
+        lhs.kind = KIND_NAN;
+      }
+    } else if (rhs.kind == KIND_INF) {
+      lhs = rhs;
+    }
+    return;
+  }
+  if (rhs.sig == 0) {
+    // Sum of opposite zeroes
+    if (lhs.sig == 0 && lhs.sign != rhs.sign) {
+      lhs.sign = method == FAP_FP_ROUND_TOWARD_NINF;
+    }
+    return;
+  }
+  if (lhs.sig == 0) {
+    lhs = rhs;
+    return;
+  }
+
+  WideAcc major = lhs, minor = rhs;
+  if (major.exp2 < minor.exp2) {
+    ::std::swap(major, minor);
+  }
+  int exp_diff = major.exp2 - minor.exp2;
+  int room = FAP_GEMM_WIDE_MSB -
+             ((sizeof(uint128_t) * 8 - 1) - fap_clz_(major.sig));
+  int to_shift = exp_diff < room ? exp_diff : room;
+  major.sig <<= to_shift;
+  major.exp2 -= to_shift;
+  minor.sig = jamShift(minor.sig, exp_diff - to_shift);
+
+  lhs.exp2 = major.exp2;
+  if (major.sign == minor.sign) {
+    lhs.sign = major.sign;
+    lhs.sig = major.sig + minor.sig;
+  } else if (major.sig >= minor.sig) {
+    lhs.sign = major.sign;
+    lhs.sig = major.sig - minor.sig;
+  } else {
+    lhs.sign = minor.sign;
+    lhs.sig = minor.sig - major.sig;
+  }
+  if (lhs.sig == 0) {
+    lhs.sign = method == FAP_FP_ROUND_TOWARD_NINF;
+  }
+  narrow(lhs);
+}
+
+/// @brief Result with the precision of the context, as setResult()
+FloatingPointType finishResult(FloatingPointType res, FloatPrecTy prec,
+                               const ArithmeticState &ctx) {
+  if ((ctx.fastMath & FAP_FAST_MATH_FTZ) && res.getExp() == 0) {
+    res.setMant(0);
+  }
+  if (((ctx.fastMath & FAP_FAST_MATH_FINITE) ||
+       ctx.special == FAP_SPECIAL_SATURATE) &&
+      res.isInf()) {
+    res.setExp(MASK_LOWER_HIGH(ExpType, prec.exp_size) - 1);
+    res.setMant(MASK_LOWER_HIGH(MantType, prec.mant_size));
+  }
+  if (ctx.hasResultPrec && ctx.resultPrec.exp_size != prec.exp_size) {
+    res.changePrec(ctx.resultPrec);
+  }
+  return res;
+}
+
+/// @brief Special value, as setSpecialResult()
+FloatingPointType specialResult(KindTy kind, uint8_t sign, FloatPrecTy prec,
+                                const ArithmeticState &ctx) {
+  FloatingPointType res;
+  res.setPrec(prec);
+  res.setSign(sign);
+  if (kind == KIND_NAN) {
+    res.setNaN();
+    return res;
+  }
+  res.setInf();
+  if (ctx.hasResultPrec && ctx.resultPrec.exp_size != prec.exp_size) {
+    res.changePrec(ctx.resultPrec);
+  }
+  return res;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @defgroup FAP_GEMM_POLICIES Packing and micro-kernels
+/// A policy gives the packed form of the elements of A and B and the
+/// micro-kernel, which updates a FAP_GEMM_MR x FAP_GEMM_NR tile of
+/// accumulators from packed slivers of depth kc, starting it if \p first.
+/// @{
+
+template<typename WordTy>
+struct RoundedPolicy {
+  typedef Operand PackedTy;
+  typedef RoundedAcc<WordTy> AccTy;
+
+  const Operand *a;
+  const Operand *b;
+  size_t k;
+  size_t n;
+  RoundingParams params;
+
+  PackedTy packA(size_t i, size_t kk) const {
+    return a[i * k + kk];
+  }
+  PackedTy packB(size_t kk, size_t j) const {
+    return b[kk * n + j];
+  }
+  static PackedTy zero() {
+    Operand op = { 0, 0, 0, KIND_FINITE };
+    return op;
+  }
+
+  void kernel(size_t kc, const PackedTy *pa, const PackedTy *pb, AccTy *acc,
+              size_t ldacc, bool first) const {
+    // The tile is kept local, the chains of the accumulators interleave
+    AccTy tile[FAP_GEMM_MR * FAP_GEMM_NR];
+    size_t kk = 0;
+    if (first) {
+      for (int i = 0; i < FAP_GEMM_MR; ++i) {
+        for (int j = 0; j < FAP_GEMM_NR; ++j) {
+          mulTo(tile[i * FAP_GEMM_NR + j], pa[i], pb[j], params);
+        }
+      }
+      kk = 1;
+    } else {
+      for (int i = 0; i < FAP_GEMM_MR; ++i) {
+        for (int j = 0; j < FAP_GEMM_NR; ++j) {
+          tile[i * FAP_GEMM_NR + j] = acc[i * ldacc + j];
+        }
+      }
+    }
+    for (; kk < kc; ++kk) {
+      const Operand *ak = pa + kk * FAP_GEMM_MR;
+      const Operand *bk = pb + kk * FAP_GEMM_NR;
+      for (int i = 0; i < FAP_GEMM_MR; ++i) {
+        for (int j = 0; j < FAP_GEMM_NR; ++j) {
+          AccTy prod;
+          mulTo(prod, ak[i], bk[j], params);
+          addTo(tile[i * FAP_GEMM_NR + j], prod, params);
+        }
+      }
+    }
+    for (int i = 0; i < FAP_GEMM_MR; ++i) {
+      for (int j = 0; j < FAP_GEMM_NR; ++j) {
+        acc[i * ldacc + j] = tile[i * FAP_GEMM_NR + j];
+      }
+    }
+  }
+};
+
+struct WidePolicy {
+  typedef Operand PackedTy;
+  typedef WideAcc AccTy;
+
+  const Operand *a;
+  const Operand *b;
+  size_t k;
+  size_t n;
+  FAP_rounding_method method;
+
+  PackedTy packA(size_t i, size_t kk) const {
+    return a[i * k + kk];
+  }
+  PackedTy packB(size_t kk, size_t j) const {
+    return b[kk * n + j];
+  }
+  static PackedTy zero() {
+    Operand op = { 0, 0, 0, KIND_FINITE };
+    return op;
+  }
+
+  void kernel(size_t kc, const PackedTy *pa, const PackedTy *pb, AccTy *acc,
+              size_t ldacc, bool first) const {
+    for (size_t kk = 0; kk < kc; ++kk) {
+      const Operand *ak = pa + kk * FAP_GEMM_MR;
+      const Operand *bk = pb + kk * FAP_GEMM_NR;
+      for (int i = 0; i < FAP_GEMM_MR; ++i) {
+        for (int j = 0; j < FAP_GEMM_NR; ++j) {
+          AccTy prod;
+          wideMul(prod, ak[i], bk[j]);
+          if (first && kk == 0) {
+            acc[i * ldacc + j] = prod;
+          } else {
+            wideAdd(acc[i * ldacc + j], prod, method);
+          }
+        }
+      }
+    }
+  }
+};
+
+/// @brief Products wrapping around on 128 bits
+inline uint128_t wrapMul(int64_t lhs, int64_t rhs) {
+  return (uint128_t)((int128_t)lhs * rhs);
+}
+
+inline uint128_t wrapMul(int128_t lhs, int128_t rhs) {
+  return (uint128_t)lhs * (uint128_t)rhs;
+}
+
+/// @brief Integers with the compensation folded in the operands, the sums
+/// wrap around as the int128_t of the operators
+template<typename IntTy>
+struct IntegerPolicy {
+  typedef IntTy PackedTy;
+  typedef uint128_t AccTy;
+
+  const IntegerType *a;
+  size_t lda;
+  const IntegerType *b;
+  size_t ldb;
+  int128_t compensation;  ///< Half of the neglected bits, 0 if disabled
+
+  PackedTy pack(const IntegerType &val) const {
+    return (IntTy)(val.getBits() +
+                   (val.getNeglectedBitsStatus() ? compensation : 0));
+  }
+  PackedTy packA(size_t i, size_t kk) const {
+    return pack(a[i * lda + kk]);
+  }
+  PackedTy packB(size_t kk, size_t j) const {
+    return pack(b[kk * ldb + j]);
+  }
+  static PackedTy zero() {
+    return 0;
+  }
+
+  void kernel(size_t kc, const PackedTy *pa, const PackedTy *pb, AccTy *acc,
+              size_t ldacc, bool first) const {
+    if (first) {
+      for (int i = 0; i < FAP_GEMM_MR; ++i) {
+        for (int j = 0; j < FAP_GEMM_NR; ++j) {
+          acc[i * ldacc + j] = 0;
+        }
+      }
+    }
+    for (size_t kk = 0; kk < kc; ++kk) {
+      const PackedTy *ak = pa + kk * FAP_GEMM_MR;
+      const PackedTy *bk = pb + kk * FAP_GEMM_NR;
+      for (int i = 0; i < FAP_GEMM_MR; ++i) {
+        for (int j = 0; j < FAP_GEMM_NR; ++j) {
+          acc[i * ldacc + j] += wrapMul(ak[i], bk[j]);
+        }
+      }
+    }
+  }
+};
+/// @}
+///////////////////////////////////////////////////////////////////////////////
+
+/// @brief Rows of the accumulators of a worker, padded on the micro-kernel
+inline size_t paddedRows(size_t rows) {
+  return (rows + FAP_GEMM_MR - 1) / FAP_GEMM_MR * FAP_GEMM_MR;
+}
+
+inline size_t paddedColumns(size_t n) {
+  return (n + FAP_GEMM_NR - 1) / FAP_GEMM_NR * FAP_GEMM_NR;
+}
+
+/// @brief Blocked multiply of the rows [row_begin, row_end) into \p acc,
+/// k-blocks in order so that each accumulator sees the products in order
+template<typename PolicyTy>
+void blockedRows(const PolicyTy &policy, size_t row_begin, size_t row_end,
+                 size_t n, size_t k, typename PolicyTy::AccTy *acc) {
+  typedef typename PolicyTy::PackedTy PackedTy;
+  size_t ldacc = paddedColumns(n);
+  ::std::vector<PackedTy> packed_a(FAP_GEMM_MC * FAP_GEMM_KC);
+  ::std::vector<PackedTy> packed_b(
+      paddedColumns(::std::min(n, (size_t)FAP_GEMM_NC)) * FAP_GEMM_KC);
+
+  for (size_t jc = 0; jc < n; jc += FAP_GEMM_NC) {
+    size_t nc = ::std::min(n - jc, (size_t)FAP_GEMM_NC);
+    for (size_t pc = 0; pc < k; pc += FAP_GEMM_KC) {
+      size_t kc = ::std::min(k - pc, (size_t)FAP_GEMM_KC);
+      // Panel of B, in slivers of FAP_GEMM_NR columns
+      PackedTy *pb = packed_b.data();
+      for (size_t jr = 0; jr < nc; jr += FAP_GEMM_NR) {
+        for (size_t kk = 0; kk < kc; ++kk) {
+          for (size_t c = 0; c < FAP_GEMM_NR; ++c) {
+            size_t j = jc + jr + c;
+            *pb++ = j < n ? policy.packB(pc + kk, j) : PolicyTy::zero();
+          }
+        }
+      }
+      for (size_t ic = row_begin; ic < row_end; ic += FAP_GEMM_MC) {
+        size_t mc = ::std::min(row_end - ic, (size_t)FAP_GEMM_MC);
+        // Block of A, in slivers of FAP_GEMM_MR rows
+        PackedTy *pa = packed_a.data();
+        for (size_t ir = 0; ir < mc; ir += FAP_GEMM_MR) {
+          for (size_t kk = 0; kk < kc; ++kk) {
+            for (size_t r = 0; r < FAP_GEMM_MR; ++r) {
+              size_t i = ic + ir + r;
+              *pa++ = i < row_end ? policy.packA(i, pc + kk)
+                                  : PolicyTy::zero();
+            }
+          }
+        }
+        for (size_t jr = 0; jr < nc; jr += FAP_GEMM_NR) {
+          for (size_t ir = 0; ir < mc; ir += FAP_GEMM_MR) {
+            policy.kernel(kc, &packed_a[ir * kc], &packed_b[jr * kc],
+                          &acc[(ic - row_begin + ir) * ldacc + jc + jr],
+                          ldacc, pc == 0);
+          }
+        }
+      }
+    }
+  }
+}
+
+/// @brief Split the \p m rows among the workers, calling fn(begin, end)
+template<typename FnTy>
+void parallelRows(size_t m, size_t work_per_row, unsigned threads, FnTy fn) {
+  size_t workers =
+      ::fap::shareWorkers((m + FAP_GEMM_MR - 1) / FAP_GEMM_MR,
+                          m * work_per_row / FAP_GEMM_THREAD_WORK, threads);
+  size_t rows = paddedRows((m + workers - 1) / workers);
+  ::std::vector<size_t> bounds(1, 0);
+  while (bounds.back() < m) {
+    bounds.push_back(::std::min(m, bounds.back() + rows));
+  }
+  if (bounds.size() == 1) {
+    bounds.push_back(0);
+  }
+  ::fap::parallelShares(bounds, fn);
+}
+
+/// @brief Multiply with a policy, \p store(i, j, acc) writes the results
+template<typename PolicyTy, typename StoreTy>
+void gemmPolicy(const PolicyTy &policy, size_t m, size_t n, size_t k,
+                unsigned threads, StoreTy store) {
+  parallelRows(m, n * k, threads, [&](size_t begin, size_t end) {
+    size_t ldacc = paddedColumns(n);
+    ::std::vector<typename PolicyTy::AccTy> acc(paddedRows(end - begin) *
+                                                ldacc);
+    blockedRows(policy, begin, end, n, k, acc.data());
+    for (size_t i = begin; i < end; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        store(i, j, acc[(i - begin) * ldacc + j]);
+      }
+    }
+  });
+}
+
+/// @brief Unpacked operands of a floating point multiply
+struct FloatOperands {
+  ::std::vector<Operand> a;  ///< m x k
+  ::std::vector<Operand> b;  ///< k x n
+  FloatPrecTy minPrec;  ///< Lowest exponent and mantissa sizes
+  int maxMantSize;  ///< Largest mantissa size
+  bool uniform;  ///< All the operands have the same precision
+  bool finite;  ///< No operand is NaN or infinity
+};
+
+Operand toOperand(const FloatingPointType &val, FloatOperands &ops,
+                  uint8_t fast_math) {
+  Operand op;
+  int exp2;
+  op.sig = (uint64_t)val.getSignificand(exp2);
+  op.exp2 = exp2;
+  op.sign = val.getSign();
+  op.kind = KIND_FINITE;
+  if (!(fast_math & FAP_FAST_MATH_FINITE)) {
+    if (val.isNaN()) {
+      op.kind = KIND_NAN;
+    } else if (val.isInf()) {
+      op.kind = KIND_INF;
+    }
+  }
+  if ((fast_math & FAP_FAST_MATH_DAZ) && val.getExp() == 0) {
+    // Subnormal operands are zeroes
+    op.sig = 0;
+  }
+  FloatPrecTy prec = val.getPrec();
+  ops.uniform = ops.uniform && prec.exp_size == ops.minPrec.exp_size &&
+                prec.mant_size == ops.minPrec.mant_size;
+  ops.minPrec.exp_size = ::std::min(ops.minPrec.exp_size, prec.exp_size);
+  ops.minPrec.mant_size = ::std::min(ops.minPrec.mant_size, prec.mant_size);
+  ops.maxMantSize = ::std::max(ops.maxMantSize, (int)prec.mant_size);
+  ops.finite = ops.finite && op.kind == KIND_FINITE;
+  return op;
+}
+
+/// @brief Unpack the operands, \p get(i) gives the FloatingPointType i of
+/// the row major m x n matrix
+template<typename GetTy>
+void unpack(::std::vector<Operand> &out, size_t rows, size_t cols,
+            FloatOperands &ops, uint8_t fast_math, GetTy get) {
+  out.resize(rows * cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      out[i * cols + j] = toOperand(get(i, j), ops, fast_math);
+    }
+  }
+}
+
+/// @brief The micro-kernels work on significands up to 64 bits
+bool fitsOperand(FloatPrecTy prec) {
+  return prec.mant_size < 64;
+}
+
+/// @brief Rounded accumulation on the micro-kernel, if the results are the
+/// ones of the operators
+bool canRoundOnKernel(const FloatOperands &ops, const ArithmeticState &ctx) {
+  return ops.uniform && (ops.finite || (ctx.fastMath & FAP_FAST_MATH_FINITE)) &&
+         ctx.rounding != FAP_FP_ROUND_STOCHASTIC &&
+         fitsOperand(ops.minPrec) &&
+         (!ctx.hasResultPrec ||
+          (ctx.resultPrec.exp_size == ops.minPrec.exp_size &&
+           fitsOperand(ctx.resultPrec)));
+}
+
+/// @brief Result precision, the operands one with the context mantissa
+FloatPrecTy resultPrec(FloatPrecTy prec, const ArithmeticState &ctx) {
+  if (ctx.hasResultPrec) {
+    prec.mant_size = ctx.resultPrec.mant_size;
+  }
+  return prec;
+}
+
+template<typename WordTy, typename StoreTy>
+void gemmRounded(const FloatOperands &ops, size_t m, size_t n, size_t k,
+                 const ArithmeticState &ctx, unsigned threads,
+                 StoreTy store) {
+  FloatPrecTy prec = resultPrec(ops.minPrec, ctx);
+  RoundedPolicy<WordTy> policy;
+  policy.a = ops.a.data();
+  policy.b = ops.b.data();
+  policy.k = k;
+  policy.n = n;
+  policy.params = makeParams(prec, ctx);
+  int bias = policy.params.bias;
+  gemmPolicy(policy, m, n, k, threads,
+             [&](size_t i, size_t j, const RoundedAcc<WordTy> &acc) {
+    if (acc.kind != KIND_FINITE) {
+      store(i, j, specialResult((KindTy)acc.kind, acc.sign, prec, ctx));
+      return;
+    }
+    FloatingPointType res;
+    res.setPrec(prec);
+    res.setSign(acc.sign);
+    bool normal = (acc.sig >> prec.mant_size) != 0;
+    res.setExp(normal ? acc.exp2 + bias + prec.mant_size : 0);
+    res.setMant((MantType)acc.sig);
+    store(i, j, res);
+  });
+}
+
+template<typename StoreTy>
+void gemmWide(const FloatOperands &ops, size_t m, size_t n, size_t k,
+              const ArithmeticState &ctx, unsigned threads, StoreTy store) {
+  if (ops.maxMantSize >= 64) {
+    ::std::cerr << "The mantissa is too large for the wide accumulation";
+    exit(1);
+  }
+  FloatPrecTy prec = resultPrec(ops.minPrec, ctx);
+  WidePolicy policy;
+  policy.a = ops.a.data();
+  policy.b = ops.b.data();
+  policy.k = k;
+  policy.n = n;
+  policy.method = ctx.rounding;
+  gemmPolicy(policy, m, n, k, threads,
+             [&](size_t i, size_t j, const WideAcc &acc) {
+    if (acc.kind != KIND_FINITE) {
+      store(i, j, specialResult((KindTy)acc.kind, acc.sign, prec, ctx));
+      return;
+    }
+    store(i, j, finishResult(FloatingPointType::fromSignificand(
+                                 acc.sign, acc.sig, acc.exp2, false, prec,
+                                 ctx.rounding),
+                             prec, ctx));
+  });
+}
+
+/// @brief Path of the operators, row by row so that B is read by rows
+template<typename GetATy, typename GetBTy, typename StoreTy>
+void gemmOperators(size_t m, size_t n, size_t k, unsigned threads,
+                   GetATy get_a, GetBTy get_b, StoreTy store) {
+  parallelRows(m, n * k, threads, [&](size_t begin, size_t end) {
+    ::std::vector<FloatingPointType> row(n);
+    for (size_t i = begin; i < end; ++i) {
+      for (size_t kk = 0; kk < k; ++kk) {
+        FloatingPointType lhs = get_a(i, kk);
+        for (size_t j = 0; j < n; ++j) {
+          if (kk == 0) {
+            row[j] = lhs;
+            row[j] *= get_b(kk, j);
+          } else {
+            FloatingPointType prod = lhs;
+            prod *= get_b(kk, j);
+            row[j] += prod;
+          }
+        }
+      }
+      for (size_t j = 0; j < n; ++j) {
+        store(i, j, row[j]);
+      }
+    }
+  });
+}
+
+/// @brief Multiply of the operands given by \p get_a and \p get_b, the
+/// empty sums of k = 0 are zeroes on the precision \p zero_prec(i, j)
+template<typename GetATy, typename GetBTy, typename StoreTy,
+         typename ZeroPrecTy>
+void gemmFloat(size_t m, size_t n, size_t k, FAP_gemm_accumulation acc_policy,
+               unsigned threads, GetATy get_a, GetBTy get_b, StoreTy store,
+               ZeroPrecTy zero_prec) {
+  const ArithmeticState &ctx = ArithmeticContext::current();
+  if (m == 0 || n == 0) {
+    return;
+  }
+  if (k == 0) {
+    // Empty sums, there are no operands to take the precision from
+    for (size_t i = 0; i < m; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        store(i, j, FloatingPointType::fromSignificand(0, 0, 0, false,
+                                                       zero_prec(i, j)));
+      }
+    }
+    return;
+  }
+  FloatOperands ops;
+  ops.minPrec = get_a(0, 0).getPrec();
+  ops.maxMantSize = 0;
+  ops.uniform = true;
+  ops.finite = true;
+  unpack(ops.a, m, k, ops, ctx.fastMath, get_a);
+  unpack(ops.b, k, n, ops, ctx.fastMath, get_b);
+
+  if (acc_policy == FAP_GEMM_ACCUMULATE_WIDE) {
+    gemmWide(ops, m, n, k, ctx, threads, store);
+  } else if (!canRoundOnKernel(ops, ctx)) {
+    ops.a.clear();
+    ops.b.clear();
+    gemmOperators(m, n, k, threads, get_a, get_b, store);
+  } else if (ops.minPrec.mant_size <= FAP_GEMM_WORD_MANT_SIZE &&
+             resultPrec(ops.minPrec, ctx).mant_size <=
+                 FAP_GEMM_WORD_MANT_SIZE) {
+    gemmRounded<uint64_t>(ops, m, n, k, ctx, threads, store);
+  } else {
+    gemmRounded<uint128_t>(ops, m, n, k, ctx, threads, store);
+  }
+}
+
+}  // end anonymous namespace
+
+void ::fap::gemm(size_t m, size_t n, size_t k, const FloatingPointType *a,
+                 size_t lda, const FloatingPointType *b, size_t ldb,
+                 FloatingPointType *c, size_t ldc, FAP_gemm_accumulation acc,
+                 unsigned threads) {
+  gemmFloat(m, n, k, acc, threads,
+            [a, lda](size_t i, size_t kk) -> const FloatingPointType & {
+              return a[i * lda + kk];
+            },
+            [b, ldb](size_t kk, size_t j) -> const FloatingPointType & {
+              return b[kk * ldb + j];
+            },
+            [c, ldc](size_t i, size_t j, const FloatingPointType &val) {
+              c[i * ldc + j] = val;
+            },
+            [c, ldc](size_t i, size_t j) {
+              return c[i * ldc + j].getPrec();
+            });
+}
+
+void ::fap::gemm(size_t m, size_t n, size_t k, const double *a, size_t lda,
+                 const double *b, size_t ldb, double *c, size_t ldc,
+                 FloatPrecTy prec, FAP_gemm_accumulation acc,
+                 unsigned threads) {
+  if (prec.exp_size > DOUBLE_EXP_SIZE || prec.mant_size > DOUBLE_MANT_SIZE) {
+    ::std::cerr << "The precision doesn't enter in a double";
+    exit(1);
+  }
+  gemmFloat(m, n, k, acc, threads,
+            [a, lda, prec](size_t i, size_t kk) {
+              return FloatingPointType(a[i * lda + kk], prec);
+            },
+            [b, ldb, prec](size_t kk, size_t j) {
+              return FloatingPointType(b[kk * ldb + j], prec);
+            },
+            [c, ldc](size_t i, size_t j, const FloatingPointType &val) {
+              c[i * ldc + j] = (double)val;
+            },
+            [prec](size_t, size_t) {
+              return prec;
+            });
+}
+
+void ::fap::gemm(size_t m, size_t n, size_t k, const IntegerType *a,
+                 size_t lda, const IntegerType *b, size_t ldb,
+                 IntegerType *c, size_t ldc, unsigned threads) {
+  if (m * k == 0 || k * n == 0) {
+    for (size_t i = 0; i < m; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+        c[i * ldc + j] = IntegerType();
+      }
+    }
+    return;
+  }
+
+  // The micro-kernel needs the same precision and compensation for all the
+  // operands, the operators adapt the precision of each pair otherwise
+  const IntegerType &first = a[0];
+  bool uniform = true;
+  for (size_t i = 0; i < m * k && uniform; ++i) {
+    const IntegerType &val = a[(i / k) * lda + i % k];
+    uniform = val.getOriPrecision() == first.getOriPrecision() &&
+              val.getActualPrecision() == first.getActualPrecision() &&
+              val.isCompensate() == first.isCompensate();
+  }
+  for (size_t i = 0; i < k * n && uniform; ++i) {
+    const IntegerType &val = b[(i / n) * ldb + i % n];
+    uniform = val.getOriPrecision() == first.getOriPrecision() &&
+              val.getActualPrecision() == first.getActualPrecision() &&
+              val.isCompensate() == first.isCompensate();
+  }
+  int diff_prec = first.getOriPrecision() - first.getActualPrecision();
+  if (!uniform || diff_prec < 0 || (first.isCompensate() && diff_prec == 0)) {
+    parallelRows(m, n * k, threads, [&](size_t begin, size_t end) {
+      ::std::vector<IntegerType> row(n);
+      for (size_t i = begin; i < end; ++i) {
+        for (size_t kk = 0; kk < k; ++kk) {
+          for (size_t j = 0; j < n; ++j) {
+            IntegerType prod = a[i * lda + kk];
+            prod *= b[kk * ldb + j];
+            if (kk == 0) {
+              row[j] = prod;
+            } else {
+              row[j] += prod;
+            }
+          }
+        }
+        for (size_t j = 0; j < n; ++j) {
+          c[i * ldc + j] = row[j];
+        }
+      }
+    });
+    return;
+  }
+
+  // The compensation terms of the products are the ones of the operands
+  // incremented by half of the neglected bits: (a + h) * (b + h)
+  int128_t compensation =
+      first.isCompensate() ? MASK_BIT_HIGH(int128_t, (diff_prec - 1)) : 0;
+  auto store = [&](size_t i, size_t j, uint128_t acc) {
+    IntegerType res;
+    res.setBits((int128_t)acc);
+    res.setOriPrecision(first.getOriPrecision());
+    res.setActualPrecision(first.getActualPrecision());
+    res.setNeglectedBitsStatus(0);
+    res.setCompensate(first.isCompensate());
+    c[i * ldc + j] = res;
+  };
+  if (first.getOriPrecision() <= 62) {
+    IntegerPolicy<int64_t> policy = { a, lda, b, ldb, compensation };
+    gemmPolicy(policy, m, n, k, threads, store);
+  } else {
+    IntegerPolicy<int128_t> policy = { a, lda, b, ldb, compensation };
+    gemmPolicy(policy, m, n, k, threads, store);
+  }
+}
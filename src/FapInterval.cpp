@@ -0,0 +1,520 @@
+//===- FapInterval.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapInterval.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Interval arithmetic with directed rounding - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapInterval.h"
+#include "FapContext.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+using ::fap::ArithmeticContext;
+using ::fap::FloatPrecTy;
+using ::fap::FloatingPointType;
+
+/// @brief Operations on the bounds, the subtraction adds the negated bounds
+typedef enum {
+  OP_ADD = 0,
+  OP_MUL,
+  OP_DIV
+} OpTy;
+
+/// @brief Exact result (-1)^sign * sig * 2^exp2 of an operation, the bits
+/// lost by the alignment are jammed in the lsb of sig, below the guard,
+/// round and sticky positions of the rounding
+struct ExactTy {
+  SignType sign;
+  MantType sig;
+  int exp2;
+  bool cancel;  ///< A zero from operands of opposite signs
+};
+
+bool isSpecial(const FloatingPointType& val) {
+  return val.isInf() || val.isNaN();
+}
+
+/// @brief Same sign, exponent and mantissa
+bool sameBits(const FloatingPointType& lhs, const FloatingPointType& rhs) {
+  return lhs.getSign() == rhs.getSign() && lhs.getExp() == rhs.getExp() &&
+         lhs.getMant() == rhs.getMant();
+}
+
+FloatingPointType nanOn(FloatPrecTy prec) {
+  FloatingPointType res;
+  res.setPrec(prec);
+  res.setNaN();
+  return res;
+}
+
+FloatingPointType infOn(FloatPrecTy prec, SignType sign) {
+  FloatingPointType res;
+  res.setPrec(prec);
+  res.setInf();
+  res.setSign(sign);
+  return res;
+}
+
+/// @brief Sum of finite values, aligned as the addition operator does
+ExactTy exactAdd(const FloatingPointType& lhs, const FloatingPointType& rhs) {
+  int lhs_exp2, rhs_exp2;
+  MantType lhs_sig = lhs.getSignificand(lhs_exp2);
+  MantType rhs_sig = rhs.getSignificand(rhs_exp2);
+  SignType lhs_sign = lhs.getSign(), rhs_sign = rhs.getSign();
+  if (lhs_exp2 < rhs_exp2) {
+    ::std::swap(lhs_sig, rhs_sig);
+    ::std::swap(lhs_exp2, rhs_exp2);
+    ::std::swap(lhs_sign, rhs_sign);
+  }
+  int mant_size =
+      ::std::max(lhs.getPrec().mant_size, rhs.getPrec().mant_size);
+  int exp_diff = lhs_exp2 - rhs_exp2;
+  int room = (sizeof(MantType) * 8 - 2) - (mant_size + 1);
+  int to_shift = exp_diff < room ? exp_diff : room;
+  lhs_sig <<= to_shift;
+  lhs_exp2 -= to_shift;
+  exp_diff -= to_shift;
+  if (exp_diff >= (int)(sizeof(MantType) * 8)) {
+    rhs_sig = rhs_sig != 0 ? 0x01 : 0x00;
+  } else if (exp_diff > 0) {
+    bool lost = (rhs_sig & MASK_LOWER_HIGH(MantType, exp_diff)) != 0;
+    rhs_sig = (rhs_sig >> exp_diff) | (lost ? 0x01 : 0x00);
+  }
+
+  ExactTy res = { lhs_sign, 0, lhs_exp2, lhs_sign != rhs_sign };
+  if (lhs_sign == rhs_sign) {
+    res.sig = lhs_sig + rhs_sig;
+  } else if (lhs_sig >= rhs_sig) {
+    res.sig = lhs_sig - rhs_sig;
+  } else {
+    res.sign = rhs_sign;
+    res.sig = rhs_sig - lhs_sig;
+  }
+  return res;
+}
+
+/// @brief Product of finite values, on the wide path of the multiplication
+/// operator: exact up to 63 bits mantissas, the lower bits of the 256 bits
+/// product jammed in the lsb otherwise
+ExactTy exactMul(const FloatingPointType& lhs, const FloatingPointType& rhs) {
+  int lhs_exp2, rhs_exp2;
+  MantType lhs_sig = lhs.getSignificand(lhs_exp2);
+  MantType rhs_sig = rhs.getSignificand(rhs_exp2);
+  int exp2 = lhs_exp2 + rhs_exp2;
+  MantType prod = fap_mul_sig_(lhs_sig, rhs_sig, &exp2);
+  ExactTy res = { (SignType)(lhs.getSign() ^ rhs.getSign()), prod, exp2,
+                  false };
+  return res;
+}
+
+/// @brief Quotient of finite values by a non-zero divisor, on the long
+/// division of the division operator: 127 or 128 bits, the remainder jammed
+/// in the lsb, for any mantissa size
+ExactTy exactDiv(const FloatingPointType& lhs, const FloatingPointType& rhs) {
+  int lhs_exp2, rhs_exp2;
+  MantType lhs_sig = lhs.getSignificand(lhs_exp2);
+  MantType rhs_sig = rhs.getSignificand(rhs_exp2);
+  int exp2 = lhs_exp2 - rhs_exp2;
+  MantType quot = fap_div_sig_(lhs_sig, rhs_sig, &exp2);
+  ExactTy res = { (SignType)(lhs.getSign() ^ rhs.getSign()), quot, exp2,
+                  false };
+  return res;
+}
+
+ExactTy exactOp(OpTy op, const FloatingPointType& lhs,
+                const FloatingPointType& rhs) {
+  switch (op) {
+    case OP_ADD:
+      return exactAdd(lhs, rhs);
+    case OP_MUL:
+      return exactMul(lhs, rhs);
+    default:
+      return exactDiv(lhs, rhs);
+  }
+}
+
+/// @brief Round the exact result on \p prec, an exact zero from a
+/// cancellation is -0 only toward -infinity
+FloatingPointType roundExact(const ExactTy& exact, FloatPrecTy prec,
+                             FAP_rounding_method method) {
+  SignType sign = exact.sign;
+  if (exact.sig == 0 && exact.cancel) {
+    sign = method == FAP_FP_ROUND_TOWARD_NINF;
+  }
+  return FloatingPointType::fromSignificand(sign, exact.sig, exact.exp2, false,
+                                            prec, method);
+}
+
+/// @brief If the exact result is not representable on \p prec, as the
+/// alignment of setSignificand() finds it
+bool isInexact(const ExactTy& exact, FloatPrecTy prec) {
+  if (exact.sig == 0) {
+    return false;
+  }
+  int bias = EXPONENT_BIAS(prec.exp_size);
+  int msb = (sizeof(MantType) * 8 - 1) - fap_clz_(exact.sig);
+  int64_t biased_exp = (int64_t)exact.exp2 + msb + bias;
+  if (biased_exp >= MASK_LOWER_HIGH(ExpType, prec.exp_size)) {
+    // Overflow
+    return true;
+  }
+  int64_t to_shift = msb - prec.mant_size;
+  if (biased_exp < 1) {
+    to_shift = (int64_t)(1 - bias - prec.mant_size) - exact.exp2;
+  }
+  if (to_shift <= 0) {
+    return false;
+  }
+  if (to_shift >= (int64_t)(sizeof(MantType) * 8)) {
+    return true;
+  }
+  return (exact.sig & MASK_LOWER_HIGH(MantType, to_shift)) != 0;
+}
+
+/// @brief Next value toward +infinity of a value which is not the greatest
+/// one, the carries and the borrows cross the exponent
+void stepUp(FloatingPointType& val) {
+  FloatPrecTy prec = val.getPrec();
+  MantType max_mant = MASK_LOWER_HIGH(MantType, prec.mant_size);
+  if (val.getSign() == 0) {
+    if (val.getMant() == max_mant) {
+      val.setMant(0);
+      val.setExp(val.getExp() + 1);
+    } else {
+      val.setMant(val.getMant() + 1);
+    }
+  } else if (val.getMant() == 0) {
+    val.setExp(val.getExp() - 1);
+    val.setMant(max_mant);
+  } else {
+    val.setMant(val.getMant() - 1);
+  }
+}
+
+/// @brief If the bound lhs op rhs is not computed on the significands: the
+/// infinities and the NaNs go through the operators, a zero factor gives a
+/// zero even with an infinite one, as the product of the sets does
+bool specialBound(OpTy op, const FloatingPointType& lhs,
+                  const FloatingPointType& rhs, FAP_rounding_method method,
+                  FloatingPointType& res) {
+  if (!isSpecial(lhs) && !isSpecial(rhs)) {
+    return false;
+  }
+  if (op == OP_MUL && (lhs.isZero() || rhs.isZero()) && !lhs.isNaN() &&
+      !rhs.isNaN()) {
+    res = lhs;
+    res.setZero();
+    res.setSign(lhs.getSign() ^ rhs.getSign());
+    return true;
+  }
+  ArithmeticContext ctx(method);
+  res = lhs;
+  switch (op) {
+    case OP_ADD:
+      res += rhs;
+      break;
+    case OP_MUL:
+      res *= rhs;
+      break;
+    default:
+      res /= rhs;
+      break;
+  }
+  return true;
+}
+
+/// @brief lower = lower_lhs op lower_rhs toward -infinity and
+/// upper = upper_lhs op upper_rhs toward +infinity, on the precision of the
+/// operands. When the two pairs are the same the exact result is computed
+/// and rounded once, the upper bound is the lower one or its next value
+void bounds(OpTy op, const FloatingPointType& lower_lhs,
+            const FloatingPointType& lower_rhs,
+            const FloatingPointType& upper_lhs,
+            const FloatingPointType& upper_rhs, FloatingPointType& lower,
+            FloatingPointType& upper) {
+  FloatPrecTy prec = lower_lhs.getPrec();
+  if (sameBits(lower_lhs, upper_lhs) && sameBits(lower_rhs, upper_rhs)) {
+    if (specialBound(op, lower_lhs, lower_rhs, FAP_FP_ROUND_TOWARD_NINF,
+                     lower)) {
+      specialBound(op, upper_lhs, upper_rhs, FAP_FP_ROUND_TOWARD_PINF, upper);
+      return;
+    }
+    ExactTy exact = exactOp(op, lower_lhs, lower_rhs);
+    lower = roundExact(exact, prec, FAP_FP_ROUND_TOWARD_NINF);
+    upper = lower;
+    if (isInexact(exact, prec)) {
+      stepUp(upper);
+    } else if (exact.sig == 0 && exact.cancel) {
+      upper.setSign(0);
+    }
+    return;
+  }
+  bool lower_done = specialBound(op, lower_lhs, lower_rhs,
+                                 FAP_FP_ROUND_TOWARD_NINF, lower);
+  bool upper_done = specialBound(op, upper_lhs, upper_rhs,
+                                 FAP_FP_ROUND_TOWARD_PINF, upper);
+  if (!lower_done) {
+    lower = roundExact(exactOp(op, lower_lhs, lower_rhs), prec,
+                       FAP_FP_ROUND_TOWARD_NINF);
+  }
+  if (!upper_done) {
+    upper = roundExact(exactOp(op, upper_lhs, upper_rhs), prec,
+                       FAP_FP_ROUND_TOWARD_PINF);
+  }
+}
+
+/// @brief \p val rounded with \p method on \p prec
+FloatingPointType outward(const FloatingPointType& val, FloatPrecTy prec,
+                          FAP_rounding_method method) {
+  if (val.isNaN()) {
+    return nanOn(prec);
+  }
+  if (val.isInf()) {
+    return infOn(prec, val.getSign());
+  }
+  int exp2;
+  MantType sig = val.getSignificand(exp2);
+  return FloatingPointType::fromSignificand(val.getSign(), sig, exp2, false,
+                                            prec, method);
+}
+
+/// @brief Sign of lhs - rhs, on non NaN values
+int compare(const FloatingPointType& lhs, const FloatingPointType& rhs) {
+  if (lhs.isInf() || rhs.isInf()) {
+    int lhs_rank = lhs.isInf() ? (lhs.getSign() != 0 ? -1 : 1) : 0;
+    int rhs_rank = rhs.isInf() ? (rhs.getSign() != 0 ? -1 : 1) : 0;
+    return lhs_rank - rhs_rank;
+  }
+  ExactTy diff = exactAdd(lhs, -rhs);
+  if (diff.sig == 0) {
+    return 0;
+  }
+  return diff.sign != 0 ? -1 : 1;
+}
+
+/// @brief The interval has no negative value
+bool nonNegative(const FloatingPointType& lower) {
+  return lower.isZero() || lower.getSign() == 0;
+}
+
+/// @brief The interval has no positive value
+bool nonPositive(const FloatingPointType& upper) {
+  return upper.isZero() || upper.getSign() != 0;
+}
+
+/// @brief Exact double of a value up to 11:52, for printing
+double toDouble(const FloatingPointType& val) {
+  if (val.isNaN()) {
+    return NAN;
+  }
+  if (val.isInf()) {
+    return val.getSign() != 0 ? -INFINITY : INFINITY;
+  }
+  int exp2;
+  MantType sig = val.getSignificand(exp2);
+  double mag = ::std::ldexp((double)sig, exp2);
+  return val.getSign() != 0 ? -mag : mag;
+}
+
+}  // end anonymous namespace
+
+::fap::Interval::Interval(const FloatingPointType &lower,
+                          const FloatingPointType &upper, FloatPrecTy prec)
+    : lower(outward(lower, prec, FAP_FP_ROUND_TOWARD_NINF)),
+      upper(outward(upper, prec, FAP_FP_ROUND_TOWARD_PINF)) {
+  if (this->lower.isNaN() || this->upper.isNaN()) {
+    this->lower = this->upper = nanOn(prec);
+  }
+}
+
+::fap::Interval::Interval(double val, FloatPrecTy prec) {
+  FloatingPointType exact(val);
+  this->lower = outward(exact, prec, FAP_FP_ROUND_TOWARD_NINF);
+  this->upper = outward(exact, prec, FAP_FP_ROUND_TOWARD_PINF);
+}
+
+const ::fap::Interval & ::fap::Interval::adaptPrec(const Interval &rhs,
+                                                   Interval &tmp) {
+  FloatPrecTy lhs_prec = this->getPrec(), rhs_prec = rhs.getPrec();
+  if (lhs_prec.exp_size == rhs_prec.exp_size &&
+      lhs_prec.mant_size == rhs_prec.mant_size) {
+    return rhs;
+  }
+  FloatPrecTy min_prec;
+  min_prec.exp_size = ::std::min(lhs_prec.exp_size, rhs_prec.exp_size);
+  min_prec.mant_size = ::std::min(lhs_prec.mant_size, rhs_prec.mant_size);
+  if (lhs_prec.exp_size != min_prec.exp_size ||
+      lhs_prec.mant_size != min_prec.mant_size) {
+    *this = Interval(this->lower, this->upper, min_prec);
+  }
+  if (rhs_prec.exp_size == min_prec.exp_size &&
+      rhs_prec.mant_size == min_prec.mant_size) {
+    return rhs;
+  }
+  tmp = Interval(rhs.lower, rhs.upper, min_prec);
+  return tmp;
+}
+
+bool ::fap::Interval::contains(const FloatingPointType &val) const {
+  if (this->isNaN() || val.isNaN()) {
+    return false;
+  }
+  return compare(this->lower, val) <= 0 && compare(val, this->upper) <= 0;
+}
+
+::fap::FloatingPointType fap::Interval::width() const {
+  FloatingPointType res;
+  if (!specialBound(OP_ADD, this->upper, -this->lower,
+                    FAP_FP_ROUND_TOWARD_PINF, res)) {
+    res = roundExact(exactAdd(this->upper, -this->lower), this->getPrec(),
+                     FAP_FP_ROUND_TOWARD_PINF);
+  }
+  return res;
+}
+
+::fap::Interval & ::fap::Interval::operator+=(const Interval &fp) {
+  Interval tmp;
+  const Interval &rhs = this->adaptPrec(fp, tmp);
+  if (this->isNaN() || rhs.isNaN()) {
+    this->lower = this->upper = nanOn(this->getPrec());
+    return *this;
+  }
+  FloatingPointType lower, upper;
+  bounds(OP_ADD, this->lower, rhs.lower, this->upper, rhs.upper, lower, upper);
+  if (lower.isNaN() || upper.isNaN()) {
+    // Opposite infinite bounds
+    lower = upper = nanOn(this->getPrec());
+  }
+  this->lower = ::std::move(lower);
+  this->upper = ::std::move(upper);
+  return *this;
+}
+
+::fap::Interval & ::fap::Interval::operator-=(const Interval &fp) {
+  *this += (-fp);
+  return *this;
+}
+
+::fap::Interval & ::fap::Interval::operator*=(const Interval &fp) {
+  Interval tmp;
+  const Interval &rhs = this->adaptPrec(fp, tmp);
+  if (this->isNaN() || rhs.isNaN()) {
+    this->lower = this->upper = nanOn(this->getPrec());
+    return *this;
+  }
+
+  // The bounds of the product come from the bounds of the operands chosen
+  // by their signs, both the pairs are needed only when both the
+  // operands contain the zero
+  const FloatingPointType &a = this->lower, &b = this->upper;
+  const FloatingPointType &c = rhs.lower, &d = rhs.upper;
+  FloatingPointType lower, upper;
+  if (nonNegative(a)) {
+    if (nonNegative(c)) {
+      bounds(OP_MUL, a, c, b, d, lower, upper);
+    } else if (nonPositive(d)) {
+      bounds(OP_MUL, b, c, a, d, lower, upper);
+    } else {
+      bounds(OP_MUL, b, c, b, d, lower, upper);
+    }
+  } else if (nonPositive(b)) {
+    if (nonNegative(c)) {
+      bounds(OP_MUL, a, d, b, c, lower, upper);
+    } else if (nonPositive(d)) {
+      bounds(OP_MUL, b, d, a, c, lower, upper);
+    } else {
+      bounds(OP_MUL, a, d, a, c, lower, upper);
+    }
+  } else if (nonNegative(c)) {
+    bounds(OP_MUL, a, d, b, d, lower, upper);
+  } else if (nonPositive(d)) {
+    bounds(OP_MUL, b, c, a, c, lower, upper);
+  } else {
+    FloatingPointType lower_alt, upper_alt;
+    bounds(OP_MUL, a, d, a, c, lower, upper);
+    bounds(OP_MUL, b, c, b, d, lower_alt, upper_alt);
+    if (compare(lower_alt, lower) < 0) {
+      lower = lower_alt;
+    }
+    if (compare(upper_alt, upper) > 0) {
+      upper = upper_alt;
+    }
+  }
+  this->lower = ::std::move(lower);
+  this->upper = ::std::move(upper);
+  return *this;
+}
+
+::fap::Interval & ::fap::Interval::operator/=(const Interval &fp) {
+  Interval tmp;
+  const Interval &rhs = this->adaptPrec(fp, tmp);
+  FloatPrecTy prec = this->getPrec();
+  if (this->isNaN() || rhs.isNaN()) {
+    this->lower = this->upper = nanOn(prec);
+    return *this;
+  }
+  const FloatingPointType &a = this->lower, &b = this->upper;
+  const FloatingPointType &c = rhs.lower, &d = rhs.upper;
+  if (nonPositive(c) && nonNegative(d)) {
+    // The divisor contains the zero
+    this->lower = infOn(prec, 1);
+    this->upper = infOn(prec, 0);
+    return *this;
+  }
+
+  FloatingPointType lower, upper;
+  if (nonNegative(c)) {
+    if (nonNegative(a)) {
+      bounds(OP_DIV, a, d, b, c, lower, upper);
+    } else if (nonPositive(b)) {
+      bounds(OP_DIV, a, c, b, d, lower, upper);
+    } else {
+      bounds(OP_DIV, a, c, b, c, lower, upper);
+    }
+  } else {
+    if (nonNegative(a)) {
+      bounds(OP_DIV, b, d, a, c, lower, upper);
+    } else if (nonPositive(b)) {
+      bounds(OP_DIV, b, c, a, d, lower, upper);
+    } else {
+      bounds(OP_DIV, b, d, a, d, lower, upper);
+    }
+  }
+  if (lower.isNaN() || upper.isNaN()) {
+    // Infinite bounds on both the sides
+    lower = upper = nanOn(prec);
+  }
+  this->lower = ::std::move(lower);
+  this->upper = ::std::move(upper);
+  return *this;
+}
+
+::std::ostream &operator<<(::std::ostream &out, const ::fap::Interval &val) {
+  out << "[" << toDouble(val.getLower()) << ", " << toDouble(val.getUpper())
+      << "]";
+  return out;
+}
@@ -0,0 +1,187 @@
+//===- FapLazy.cpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapLazy.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Lazily normalized chains of additions - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapLazy.h"
+#include "FapContext.h"
+
+/// @brief Bits of the wide accumulator, the headroom up to 127 bits keeps
+/// the sum of two aligned values from overflowing
+#define FAP_LAZY_ACC_SIZE             124
+
+namespace {
+
+int bitLength(int128_t val) {
+  uint128_t mag = val < 0 ? -(uint128_t)val : (uint128_t)val;
+  return (sizeof(MantType) * 8) - fap_clz_(mag);
+}
+
+}  // end anonymous namespace
+
+int128_t fap::LazyFloatingPointType::shiftRight(int128_t val,
+                                                int to_shift) const {
+  if (to_shift <= 0) {
+    return val;
+  }
+  if (to_shift >= (int)(sizeof(MantType) * 8 - 1)) {
+    this->sticky |= val != 0;
+    return val < 0 ? -1 : 0;
+  }
+  // The lost bits are the positive fraction left by the floor
+  this->sticky |= ((uint128_t)val & MASK_LOWER_HIGH(uint128_t, to_shift)) != 0;
+  return val >> to_shift;
+}
+
+void ::fap::LazyFloatingPointType::accumulate(SignType sign, MantType sig,
+                                              int exp2) const {
+  int128_t val = sign != 0 ? -(int128_t)sig : (int128_t)sig;
+  if (this->acc == 0 && !this->sticky) {
+    this->acc = val;
+    this->acc_exp2 = exp2;
+    return;
+  }
+
+  // Align on the lower exponent while there is headroom, then drop the
+  // lower bits of the operand. The lsb of acc doesn't move below the bits
+  // already lost, the sticky stays a fraction of it
+  if (exp2 < this->acc_exp2) {
+    int diff = this->acc_exp2 - exp2;
+    int room = this->sticky ? 0 : FAP_LAZY_ACC_SIZE - bitLength(this->acc);
+    int to_shift = diff < room ? diff : room;
+    this->acc = (int128_t)((uint128_t)this->acc << to_shift);
+    this->acc_exp2 -= to_shift;
+    val = this->shiftRight(val, diff - to_shift);
+  } else if (exp2 > this->acc_exp2) {
+    int diff = exp2 - this->acc_exp2;
+    int over = bitLength(val) + diff - FAP_LAZY_ACC_SIZE;
+    if (over > 0) {
+      this->acc = this->shiftRight(this->acc, over);
+      this->acc_exp2 += over;
+      diff -= over;
+    }
+    val = (int128_t)((uint128_t)val << diff);
+  }
+
+  this->acc += val;
+  if (bitLength(this->acc) > FAP_LAZY_ACC_SIZE) {
+    this->acc = this->shiftRight(this->acc, 1);
+    this->acc_exp2++;
+  }
+}
+
+::fap::LazyFloatingPointType & ::fap::LazyFloatingPointType::
+operator+=(const FloatingPointType &fp) {
+  FloatingPointType rhs = fp;
+  FloatPrecTy rhs_prec = rhs.getPrec();
+  if (rhs_prec.exp_size < this->prec.exp_size ||
+      rhs_prec.mant_size < this->prec.mant_size) {
+    // The precision lowers, the pending sum is rounded on the old one
+    this->flush();
+    this->prec.exp_size = rhs_prec.exp_size < this->prec.exp_size
+                              ? rhs_prec.exp_size
+                              : this->prec.exp_size;
+    this->prec.mant_size = rhs_prec.mant_size < this->prec.mant_size
+                               ? rhs_prec.mant_size
+                               : this->prec.mant_size;
+    this->value.changePrec(this->prec);
+  }
+  rhs.changePrec(this->prec);
+
+  if (this->exact) {
+    this->value += rhs;
+    return *this;
+  }
+
+  // Special values follow the rounded path
+  if (rhs.isNaN() || rhs.isInf() ||
+      (!this->pending && (this->value.isNaN() || this->value.isInf()))) {
+    this->flush();
+    this->value += rhs;
+    return *this;
+  }
+
+  if (!rhs.isZero()) {
+    int exp2;
+    MantType sig = rhs.getSignificand(exp2);
+    this->addSignificand(rhs.getSign(), sig, exp2);
+  }
+  return *this;
+}
+
+void ::fap::LazyFloatingPointType::addSignificand(SignType sign, MantType sig,
+                                                  int exp2) {
+  if (!this->pending) {
+    if (this->value.isNaN() || this->value.isInf()) {
+      return;
+    }
+    this->acc = 0;
+    this->sticky = false;
+    if (!this->value.isZero()) {
+      int value_exp2;
+      MantType value_sig = this->value.getSignificand(value_exp2);
+      this->accumulate(this->value.getSign(), value_sig, value_exp2);
+    }
+    this->pending = true;
+  }
+  this->accumulate(sign, sig, exp2);
+}
+
+::fap::LazyFloatingPointType & ::fap::LazyFloatingPointType::
+operator-=(const FloatingPointType &fp) {
+  *this += (-fp);
+  return *this;
+}
+
+void ::fap::LazyFloatingPointType::flush() const {
+  if (!this->pending) {
+    return;
+  }
+  this->pending = false;
+  // Rounded on the mantissa of the sum, the exponent keeps its size
+  FAP_rounding_method method = ArithmeticContext::current().rounding;
+  FloatPrecTy value_prec = this->value.getPrec();
+  value_prec.mant_size = this->prec.mant_size;
+  if (this->acc == 0 && !this->sticky) {
+    // Exact cancellation, the zero is negative only rounding toward -inf
+    this->value = FloatingPointType::fromSignificand(
+        method == FAP_FP_ROUND_TOWARD_NINF ? 1 : 0, 0, this->acc_exp2, false,
+        value_prec, method);
+  } else if (this->acc >= 0) {
+    this->value = FloatingPointType::fromSignificand(
+        0, (MantType)this->acc, this->acc_exp2, this->sticky, value_prec,
+        method);
+  } else {
+    // -(acc + fraction) = (-acc - 1) + (1 - fraction)
+    MantType mag = -(uint128_t)this->acc;
+    if (this->sticky) {
+      mag -= 1;
+    }
+    this->value = FloatingPointType::fromSignificand(
+        1, mag, this->acc_exp2, this->sticky, value_prec, method);
+  }
+  if (value_prec.exp_size != this->prec.exp_size) {
+    this->value.changePrec(this->prec);
+  }
+}
@@ -0,0 +1,575 @@
+//===- FapMath.cpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapMath.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Elementary functions - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapMath.h"
+#include "FapContext.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+/// @brief Bits of accuracy, over the mantissa, of the approximations
+#define FAP_MATH_GUARD_SIZE           10
+/// @brief Accuracy, in bits, up to which the approximations work on double
+#define FAP_MATH_DOUBLE_ACCURACY      46
+/// @brief Bits lost by the rounding errors of the approximations
+#define FAP_MATH_ROUNDING_LOSS        6
+/// @brief Maximum accuracy of the tables and polynomials
+#define FAP_MATH_MAX_ACCURACY         64
+
+namespace {
+
+using ::fap::ArithmeticState;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+const long double LN2 = 0.693147180559945309417232121458176568L;
+/// ln(2) = LN2_HI + LN2_LO, LN2_HI on 24 bits
+const long double LN2_HI = 11629080.0L / 16777216.0L;
+const long double LN2_LO = -1.90465429995776787854182343192449986564e-9L;
+
+///////////////////////////////////////////////////////////////////////////////
+/// @defgroup FAP_MATH_TABLES Tables and polynomial degrees
+/// @{
+template<typename RealTy>
+struct MathTables {
+  RealTy exp2j[64];  ///< 2^(j/64)
+  RealTy invc[128];  ///< 1 / (1 + (j + 1/2) / 128), rounded
+  RealTy logc[128];  ///< -log(invc[j])
+  RealTy ln2Hi;  ///< ln(2) on 24 bits, its multiples are exact
+  RealTy ln2Lo;  ///< ln(2) - ln2Hi
+  /// Number of terms of the polynomials for each accuracy
+  int expDegree[FAP_MATH_MAX_ACCURACY + 1];
+  int logTerms[FAP_MATH_MAX_ACCURACY + 1];
+  int log1pTerms[FAP_MATH_MAX_ACCURACY + 1];
+
+  MathTables() {
+    for (int j = 0; j < 64; ++j) {
+      exp2j[j] = (RealTy)exp2l(j / 64.0L);
+    }
+    for (int j = 0; j < 128; ++j) {
+      invc[j] = (RealTy)(1.0L / (1.0L + (j + 0.5L) / 128.0L));
+      logc[j] = (RealTy)-logl((long double)invc[j]);
+    }
+    ln2Hi = (RealTy)LN2_HI;
+    ln2Lo = (RealTy)LN2_LO;
+    for (int t = 0; t <= FAP_MATH_MAX_ACCURACY; ++t) {
+      // |r| <= ln(2)/128, error r^(d+1) / (d+1)!
+      int d = 1;
+      long double err = 0.0055L * 0.0055L / 2;
+      while (err > ldexpl(1.0L, -t)) {
+        ++d;
+        err *= 0.0055L / (d + 1);
+      }
+      expDegree[t] = d;
+      // |r| <= 2^-8, error r^(n+1) / (n+1) on a result not below 2^-4
+      logTerms[t] = (t + 4 + 7) / 8;
+      // |r| < 2^-4, relative error r^n / (n+1)
+      log1pTerms[t] = (t + 3) / 4 + 1;
+    }
+  }
+
+  static const MathTables& get() {
+    static const MathTables tables;
+    return tables;
+  }
+};
+/// @}
+///////////////////////////////////////////////////////////////////////////////
+
+/// @brief Precision of the results, following the context
+FloatPrecTy resultPrec(const FloatingPointType &x, const ArithmeticState &ctx) {
+  FloatPrecTy prec = x.getPrec();
+  if (ctx.hasResultPrec) {
+    prec.mant_size = ctx.resultPrec.mant_size;
+  }
+  return prec;
+}
+
+void checkPrec(const FloatingPointType &x, FloatPrecTy prec,
+               int max_mant_size) {
+  if (x.getPrec().mant_size > max_mant_size ||
+      prec.mant_size > max_mant_size) {
+    ::std::cerr << "The mantissa is too large for the elementary functions";
+    exit(1);
+  }
+}
+
+/// @brief Apply the fast math flags and the context precision to a rounded
+/// result, as the operators do
+FloatingPointType finishResult(FloatingPointType res, FloatPrecTy prec,
+                               const ArithmeticState &ctx) {
+  if ((ctx.fastMath & FAP_FAST_MATH_FTZ) && res.getExp() == 0) {
+    // Subnormal results are zeroes, keeping the sign
+    res.setMant(0);
+  }
+  if (((ctx.fastMath & FAP_FAST_MATH_FINITE) ||
+       ctx.special == FAP_SPECIAL_SATURATE) &&
+      res.isInf()) {
+    // Greatest finite value
+    res.setExp(MASK_LOWER_HIGH(ExpType, prec.exp_size) - 1);
+    res.setMant(MASK_LOWER_HIGH(MantType, prec.mant_size));
+  }
+  if (ctx.hasResultPrec && ctx.resultPrec.exp_size != prec.exp_size) {
+    // Only the exponent has to be reduced
+    res.changePrec(ctx.resultPrec);
+  }
+  return res;
+}
+
+/// @brief Round (-1)^sign * sig * 2^exp2, exact result or its truncation
+/// with the \p sticky bit
+FloatingPointType roundResult(SignType sign, MantType sig, int exp2,
+                              bool sticky, FloatPrecTy prec,
+                              const ArithmeticState &ctx) {
+  return finishResult(FloatingPointType::fromSignificand(
+                          sign, sig, exp2, sticky, prec, ctx.rounding),
+                      prec, ctx);
+}
+
+typedef enum {
+  SPECIAL_ZERO,
+  SPECIAL_INF,
+  SPECIAL_NAN
+} SpecialTy;
+
+/// @brief Special result with the precision of the context
+FloatingPointType specialResult(SpecialTy special, SignType sign,
+                                FloatPrecTy prec, const ArithmeticState &ctx) {
+  FloatingPointType res;
+  res.setPrec(prec);
+  res.setSign(sign);
+  switch (special) {
+  case SPECIAL_ZERO:
+    res.setZero();
+    break;
+  case SPECIAL_INF:
+    res.setInf();
+    break;
+  default:
+    res.setNaN();
+    break;
+  }
+  if (ctx.hasResultPrec && ctx.resultPrec.exp_size != prec.exp_size &&
+      special != SPECIAL_NAN) {
+    res.changePrec(ctx.resultPrec);
+  }
+  return res;
+}
+
+/// @brief Split \p sig * 2^exp2 into f in [1, 2) and its exponent
+template<typename RealTy>
+RealTy splitSignificand(MantType sig, int exp2, int &e) {
+  int msb = (sizeof(MantType) * 8 - 1) - fap_clz_(sig);
+  e = exp2 + msb;
+  return ldexp((RealTy)sig, -msb);
+}
+
+/// @brief Compare a * b with 2^p, a below 2^120 and b below 2^64
+int compareProductPow2(MantType a, MantType b, int p) {
+  MantType lo = (a & UINT64_MAX) * b;
+  MantType mid = (a >> 64) * b + (lo >> 64);
+  uint64_t low = (uint64_t)lo;
+  if (p >= 64) {
+    MantType pow2 = (MantType)1 << (p - 64);
+    if (mid != pow2) {
+      return mid > pow2 ? 1 : -1;
+    }
+    return low != 0 ? 1 : 0;
+  }
+  if (mid != 0) {
+    return 1;
+  }
+  uint64_t pow2 = (uint64_t)1 << p;
+  return low > pow2 ? 1 : (low < pow2 ? -1 : 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+/// @defgroup FAP_MATH_KERNELS Approximations on finite non-zero operands
+/// Each kernel returns y, with y * 2^scale within a relative error of
+/// 2^-t from the exact result.
+/// @{
+
+/// @brief exp(x) = 2^(k/64) * exp(r), |r| <= ln(2)/128
+template<typename RealTy>
+RealTy expKernel(const FloatingPointType &x, int t, int &scale) {
+  const MathTables<RealTy> &tables = MathTables<RealTy>::get();
+  int exp2;
+  MantType sig = x.getSignificand(exp2);
+  int e;
+  RealTy xr = splitSignificand<RealTy>(sig, exp2, e);
+  // Out of the range of every exponent, it saturates the scaled one
+  xr = e > 20 ? (RealTy)(1 << 20) : ldexp(xr, e);
+  if (x.getSign() != 0) {
+    xr = -xr;
+  }
+  long k = lrint(xr * (64 / (RealTy)LN2));
+  RealTy r = (xr - k * (tables.ln2Hi / 64)) - k * (tables.ln2Lo / 64);
+  int degree = tables.expDegree[t];
+  // Horner on the Taylor polynomial, 1/i! built backward
+  RealTy inv_fact = 1;
+  for (int i = 2; i <= degree; ++i) {
+    inv_fact /= i;
+  }
+  RealTy p = inv_fact;
+  for (int i = degree; i > 0; --i) {
+    inv_fact *= i;
+    p = p * r + inv_fact;
+  }
+  int j = (int)(k & 63);
+  scale = (int)((k - j) / 64);
+  return tables.exp2j[j] * p;
+}
+
+/// @brief log(x) = e ln(2) + log(c) + log(1 + r), r = f/c - 1
+template<typename RealTy>
+RealTy logKernel(const FloatingPointType &x, int t, int &scale) {
+  const MathTables<RealTy> &tables = MathTables<RealTy>::get();
+  int exp2;
+  MantType sig = x.getSignificand(exp2);
+  int e;
+  RealTy f = splitSignificand<RealTy>(sig, exp2, e);
+  scale = 0;
+  RealTy near_one = e == 0 ? f - 1 : (e == -1 ? f / 2 - 1 : 1);
+  if (near_one > (RealTy)-1 / 16 && near_one < (RealTy)1 / 16) {
+    // Close to 1 the series on the exact x - 1 avoids the cancellation
+    RealTy r = near_one, p = 0;
+    for (int i = tables.log1pTerms[t]; i > 0; --i) {
+      p = p * r + (RealTy)((i & 1) ? 1 : -1) / i;
+    }
+    return p * r;
+  }
+  int j = (int)((f - 1) * 128);
+  RealTy r = f * tables.invc[j] - 1;
+  RealTy p = 0;
+  for (int i = tables.logTerms[t]; i > 0; --i) {
+    p = p * r + (RealTy)((i & 1) ? 1 : -1) / i;
+  }
+  return (e * tables.ln2Hi + tables.logc[j]) + (p * r + e * tables.ln2Lo);
+}
+/// @}
+///////////////////////////////////////////////////////////////////////////////
+
+/// @brief Round the approximation \p val * 2^scale, within \p rel_err.
+/// The result is given only if both ends of the error interval round on it
+template<typename RealTy>
+bool roundApprox(RealTy val, int scale, RealTy rel_err, FloatPrecTy prec,
+                 const ArithmeticState &ctx, FloatingPointType &res) {
+  const int digits = ::std::numeric_limits<RealTy>::digits;
+  SignType sign = val < 0 ? 1 : 0;
+  int e;
+  RealTy frac = frexp(val < 0 ? -val : val, &e);
+  MantType sig = (MantType)ldexp(frac, digits);
+  int exp2 = scale + e - digits;
+  if (ctx.rounding == FAP_FP_ROUND_STOCHASTIC) {
+    // The probabilities are the ones of the approximation
+    res = FloatingPointType::fromSignificand(sign, sig, exp2, false, prec,
+                                             ctx.rounding);
+    return true;
+  }
+  MantType err = (MantType)ldexp(rel_err, digits) + 1;
+  FloatingPointType lower = FloatingPointType::fromSignificand(
+      sign, sig - err, exp2, true, prec, ctx.rounding);
+  FloatingPointType upper = FloatingPointType::fromSignificand(
+      sign, sig + err, exp2, true, prec, ctx.rounding);
+  if (lower.getExp() == upper.getExp() && lower.getMant() == upper.getMant()) {
+    res = lower;
+    return true;
+  }
+  // Too close to a rounding boundary, the approximation rounded with the
+  // method of the context is faithful
+  res = FloatingPointType::fromSignificand(sign, sig, exp2, false, prec,
+                                           ctx.rounding);
+  return false;
+}
+
+/// @brief Evaluate a kernel on the working precision, the double one if
+/// enough, or long double when the rounding is not decided. The retry is
+/// on the whole accuracy of long double, a tighter error interval
+template<template<typename> class KernelTy>
+FloatingPointType approxResult(const FloatingPointType &x, FloatPrecTy prec,
+                               const ArithmeticState &ctx) {
+  FloatingPointType res;
+  int scale;
+  int t = prec.mant_size + FAP_MATH_GUARD_SIZE;
+  if (t <= FAP_MATH_DOUBLE_ACCURACY) {
+    double val = KernelTy<double>::eval(x, t, scale);
+    double err = ldexp(1.0, -t) + ldexp(1.0, FAP_MATH_ROUNDING_LOSS - 53);
+    if (roundApprox(val, scale, err, prec, ctx, res)) {
+      return finishResult(res, prec, ctx);
+    }
+  }
+  const int digits = ::std::numeric_limits<long double>::digits;
+  t = ::std::min(digits - FAP_MATH_ROUNDING_LOSS, FAP_MATH_MAX_ACCURACY);
+  long double val = KernelTy<long double>::eval(x, t, scale);
+  long double err =
+      ldexpl(1.0L, -t) + ldexpl(1.0L, FAP_MATH_ROUNDING_LOSS - digits);
+  roundApprox(val, scale, err, prec, ctx, res);
+  return finishResult(res, prec, ctx);
+}
+
+template<typename RealTy>
+struct ExpKernel {
+  static RealTy eval(const FloatingPointType &x, int t, int &scale) {
+    return expKernel<RealTy>(x, t, scale);
+  }
+};
+
+template<typename RealTy>
+struct LogKernel {
+  static RealTy eval(const FloatingPointType &x, int t, int &scale) {
+    return logKernel<RealTy>(x, t, scale);
+  }
+};
+
+FloatingPointType sqrtImpl(const FloatingPointType &x,
+                           const ArithmeticState &ctx) {
+  FloatPrecTy prec = resultPrec(x, ctx);
+  checkPrec(x, prec, FAP_MATH_EXACT_MAX_MANT_SIZE);
+  if (x.isNaN() || (x.getSign() != 0 && !x.isZero())) {
+    return specialResult(SPECIAL_NAN, 0, prec, ctx);
+  }
+  if (x.isZero()) {
+    return specialResult(SPECIAL_ZERO, x.getSign(), prec, ctx);
+  }
+  if (x.isInf()) {
+    return specialResult(SPECIAL_INF, 0, prec, ctx);
+  }
+
+  // Integer square root of sig * 2^k, with an even exponent and at least
+  // mant_size + 2 bits, the remainder and the bits shifted out of a wider
+  // operand give the sticky bit
+  int exp2;
+  MantType sig = x.getSignificand(exp2);
+  int sig_size = (sizeof(MantType) * 8) - fap_clz_(sig);
+  int to_shift = 2 * (prec.mant_size + 2) - sig_size;
+  if ((exp2 - to_shift) % 2 != 0) {
+    ++to_shift;
+  }
+  bool lost = false;
+  if (to_shift >= 0) {
+    sig <<= to_shift;
+  } else {
+    lost = (sig & MASK_LOWER_HIGH(MantType, -to_shift)) != 0;
+    sig >>= -to_shift;
+  }
+  MantType root = (MantType)(uint64_t)sqrtl((long double)sig);
+  while (root * root > sig) {
+    --root;
+  }
+  while ((root + 1) * (root + 1) <= sig) {
+    ++root;
+  }
+  return roundResult(0, root, (exp2 - to_shift) / 2,
+                     root * root != sig || lost, prec, ctx);
+}
+
+FloatingPointType expImpl(const FloatingPointType &x,
+                          const ArithmeticState &ctx) {
+  FloatPrecTy prec = resultPrec(x, ctx);
+  checkPrec(x, prec, FAP_MATH_MAX_MANT_SIZE);
+  if (x.isNaN()) {
+    return specialResult(SPECIAL_NAN, 0, prec, ctx);
+  }
+  if (x.isInf()) {
+    return specialResult(x.getSign() != 0 ? SPECIAL_ZERO : SPECIAL_INF, 0,
+                         prec, ctx);
+  }
+  if (x.isZero()) {
+    return roundResult(0, 1, 0, false, prec, ctx);
+  }
+  return approxResult<ExpKernel>(x, prec, ctx);
+}
+
+FloatingPointType logImpl(const FloatingPointType &x,
+                          const ArithmeticState &ctx) {
+  FloatPrecTy prec = resultPrec(x, ctx);
+  checkPrec(x, prec, FAP_MATH_MAX_MANT_SIZE);
+  if (x.isZero()) {
+    return specialResult(SPECIAL_INF, 1, prec, ctx);
+  }
+  if (x.isNaN() || x.getSign() != 0) {
+    return specialResult(SPECIAL_NAN, 0, prec, ctx);
+  }
+  if (x.isInf()) {
+    return specialResult(SPECIAL_INF, 0, prec, ctx);
+  }
+  int exp2;
+  MantType sig = x.getSignificand(exp2);
+  if (exp2 <= 0 && exp2 > -128 && sig == ((MantType)1 << -exp2)) {
+    // log(1) = +0
+    return specialResult(SPECIAL_ZERO, 0, prec, ctx);
+  }
+  return approxResult<LogKernel>(x, prec, ctx);
+}
+
+FloatingPointType reciprocalImpl(const FloatingPointType &x,
+                                 const ArithmeticState &ctx) {
+  FloatPrecTy prec = resultPrec(x, ctx);
+  checkPrec(x, prec, FAP_MATH_EXACT_MAX_MANT_SIZE);
+  if (x.isNaN()) {
+    return specialResult(SPECIAL_NAN, 0, prec, ctx);
+  }
+  if (x.isZero()) {
+    return specialResult(SPECIAL_INF, x.getSign(), prec, ctx);
+  }
+  if (x.isInf()) {
+    return specialResult(SPECIAL_ZERO, x.getSign(), prec, ctx);
+  }
+  // 2^127 / sig keeps more than mant_size + 2 bits
+  int exp2;
+  MantType sig = x.getSignificand(exp2);
+  MantType dividend = (MantType)1 << 127;
+  return roundResult(x.getSign(), dividend / sig, -127 - exp2,
+                     dividend % sig != 0, prec, ctx);
+}
+
+FloatingPointType rsqrtImpl(const FloatingPointType &x,
+                            const ArithmeticState &ctx) {
+  FloatPrecTy prec = resultPrec(x, ctx);
+  checkPrec(x, prec, FAP_MATH_MAX_MANT_SIZE);
+  if (x.isZero()) {
+    return specialResult(SPECIAL_INF, x.getSign(), prec, ctx);
+  }
+  if (x.isNaN() || x.getSign() != 0) {
+    return specialResult(SPECIAL_NAN, 0, prec, ctx);
+  }
+  if (x.isInf()) {
+    return specialResult(SPECIAL_ZERO, 0, prec, ctx);
+  }
+
+  // root = floor(2^k / sqrt(sig)) on mant_size + 3 bits or more, from the
+  // long double seed corrected on the exact products, with an even exponent
+  int exp2;
+  MantType sig = x.getSignificand(exp2);
+  if (exp2 % 2 != 0) {
+    sig <<= 1;
+    --exp2;
+  }
+  int sig_size = (sizeof(MantType) * 8) - fap_clz_(sig);
+  int k = prec.mant_size + 3 + (sig_size + 1) / 2;
+  MantType root = (MantType)ldexpl(1.0L / sqrtl((long double)sig), k);
+  while (root > 0 && compareProductPow2(root * root, sig, 2 * k) > 0) {
+    --root;
+  }
+  while (compareProductPow2((root + 1) * (root + 1), sig, 2 * k) <= 0) {
+    ++root;
+  }
+  return roundResult(0, root, -k - exp2 / 2,
+                     compareProductPow2(root * root, sig, 2 * k) != 0, prec,
+                     ctx);
+}
+
+typedef FloatingPointType (*ImplTy)(const FloatingPointType &,
+                                    const ArithmeticState &);
+
+void batch(ImplTy impl, const FloatingPointType *in, FloatingPointType *out,
+           size_t n) {
+  const ArithmeticState &ctx = ::fap::ArithmeticContext::current();
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = impl(in[i], ctx);
+  }
+}
+
+void batch(ImplTy impl, const double *in, double *out, size_t n,
+           FloatPrecTy prec) {
+  if (prec.exp_size > DOUBLE_EXP_SIZE || prec.mant_size > DOUBLE_MANT_SIZE) {
+    ::std::cerr << "The precision doesn't enter in a double";
+    exit(1);
+  }
+  const ArithmeticState &ctx = ::fap::ArithmeticContext::current();
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = (double)impl(FloatingPointType(in[i], prec), ctx);
+  }
+}
+
+}  // end anonymous namespace
+
+::fap::FloatingPointType fap::sqrt(const FloatingPointType &x) {
+  return sqrtImpl(x, ArithmeticContext::current());
+}
+
+::fap::FloatingPointType fap::exp(const FloatingPointType &x) {
+  return expImpl(x, ArithmeticContext::current());
+}
+
+::fap::FloatingPointType fap::log(const FloatingPointType &x) {
+  return logImpl(x, ArithmeticContext::current());
+}
+
+::fap::FloatingPointType fap::reciprocal(const FloatingPointType &x) {
+  return reciprocalImpl(x, ArithmeticContext::current());
+}
+
+::fap::FloatingPointType fap::rsqrt(const FloatingPointType &x) {
+  return rsqrtImpl(x, ArithmeticContext::current());
+}
+
+void ::fap::sqrt(const FloatingPointType *in, FloatingPointType *out,
+                 size_t n) {
+  batch(sqrtImpl, in, out, n);
+}
+
+void ::fap::exp(const FloatingPointType *in, FloatingPointType *out,
+                size_t n) {
+  batch(expImpl, in, out, n);
+}
+
+void ::fap::log(const FloatingPointType *in, FloatingPointType *out,
+                size_t n) {
+  batch(logImpl, in, out, n);
+}
+
+void ::fap::reciprocal(const FloatingPointType *in, FloatingPointType *out,
+                       size_t n) {
+  batch(reciprocalImpl, in, out, n);
+}
+
+void ::fap::rsqrt(const FloatingPointType *in, FloatingPointType *out,
+                  size_t n) {
+  batch(rsqrtImpl, in, out, n);
+}
+
+void ::fap::sqrt(const double *in, double *out, size_t n, FloatPrecTy prec) {
+  batch(sqrtImpl, in, out, n, prec);
+}
+
+void ::fap::exp(const double *in, double *out, size_t n, FloatPrecTy prec) {
+  batch(expImpl, in, out, n, prec);
+}
+
+void ::fap::log(const double *in, double *out, size_t n, FloatPrecTy prec) {
+  batch(logImpl, in, out, n, prec);
+}
+
+void ::fap::reciprocal(const double *in, double *out, size_t n,
+                       FloatPrecTy prec) {
+  batch(reciprocalImpl, in, out, n, prec);
+}
+
+void ::fap::rsqrt(const double *in, double *out, size_t n, FloatPrecTy prec) {
+  batch(rsqrtImpl, in, out, n, prec);
+}
@@ -0,0 +1,303 @@
+//===- FapMemo.cpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapMemo.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Memoization of the FloatingPointType operators -
+///        Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapMemo.h"
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+using ::fap::FloatPrecTy;
+using ::fap::MemoKey;
+using ::fap::MemoStats;
+
+/// @brief Word of the settings and of the operator, whose byte is all ones
+/// in the empty entries
+const int SETTINGS_WORD = 6;
+const int OP_SHIFT = 16;
+
+/// @brief Memoized result
+struct Entry {
+  MemoKey key;
+  MantType mant;
+  ExpType exp;
+  FloatPrecTy prec;
+  uint8_t sign;
+  uint8_t grs;
+};
+
+/// @brief Cache of a thread, the counters written only by its thread
+struct ThreadCache {
+  ThreadCache();
+  ~ThreadCache();
+
+  /// @brief Empty the entries, \p entries of them rounded up to a power of
+  /// two sets of two
+  void resize(uint32_t entries);
+
+  ::std::vector<Entry> table;
+  ::std::vector<uint8_t> victim;  ///< Way of each set replaced next
+  uint32_t capacity;  ///< Requested entries
+  size_t setMask;
+  ::std::atomic<uint64_t> lookups;
+  ::std::atomic<uint64_t> hits;
+  ::std::atomic<uint64_t> evictions;
+};
+
+/// @brief Live caches, the lookups of the exited threads are added to
+/// retired
+struct Registry {
+  ::std::mutex lock;
+  ::std::vector<ThreadCache*> live;
+  MemoStats retired;
+};
+
+/// @brief Never destroyed, the threads can exit after the static objects
+Registry& registry() {
+  static Registry* reg = new Registry();
+  return *reg;
+}
+
+/// @brief Increment by the only writer, without a locked instruction
+inline void bump(::std::atomic<uint64_t>& counter) {
+  counter.store(counter.load(::std::memory_order_relaxed) + 1,
+                ::std::memory_order_relaxed);
+}
+
+void addCounters(const ThreadCache& cache, MemoStats& stats) {
+  stats.lookups += cache.lookups.load(::std::memory_order_relaxed);
+  stats.hits += cache.hits.load(::std::memory_order_relaxed);
+  stats.evictions += cache.evictions.load(::std::memory_order_relaxed);
+}
+
+ThreadCache::ThreadCache()
+    : capacity(0),
+      setMask(0),
+      lookups(0),
+      hits(0),
+      evictions(0) {
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  reg.live.push_back(this);
+}
+
+ThreadCache::~ThreadCache() {
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  addCounters(*this, reg.retired);
+  for (size_t t = 0; t < reg.live.size(); ++t) {
+    if (reg.live[t] == this) {
+      reg.live.erase(reg.live.begin() + t);
+      break;
+    }
+  }
+}
+
+void ThreadCache::resize(uint32_t entries) {
+  size_t sets = 1;
+  while (sets * 2 < entries) {
+    sets *= 2;
+  }
+  this->table.resize(sets * 2);
+  this->victim.assign(sets, 0);
+  for (size_t e = 0; e < this->table.size(); ++e) {
+    memset(&this->table[e].key, 0xff, sizeof(MemoKey));
+  }
+  this->capacity = entries;
+  this->setMask = sets - 1;
+}
+
+void freeCache(void* cache) {
+  delete static_cast<ThreadCache*>(cache);
+}
+
+pthread_key_t makeCacheKey() {
+  pthread_key_t key;
+  pthread_key_create(&key, &freeCache);
+  return key;
+}
+
+/// @brief Cache of the calling thread, freed at its exit by a pthread key
+/// as the library is built with -fno-use-cxa-atexit
+inline ThreadCache& threadCache() {
+  static thread_local ThreadCache* cache = nullptr;
+  if (cache == nullptr) {
+    static const pthread_key_t key = makeCacheKey();
+    cache = new ThreadCache();
+    pthread_setspecific(key, cache);
+  }
+  return *cache;
+}
+
+/// @brief Mix of two words, the halves of their full product folded
+inline uint64_t mix(uint64_t lhs, uint64_t rhs) {
+  uint128_t prod = (uint128_t)lhs * rhs;
+  return (uint64_t)prod ^ (uint64_t)(prod >> 64);
+}
+
+/// @brief Hash of the words, mixed in independent pairs as in wyhash
+inline uint64_t hashWords(const uint64_t* words) {
+  static const uint64_t SECRET[FAP_MEMO_KEY_WORDS + 1] = {
+      0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL,
+      0x589965cc75374cc3ULL, 0x1d8e4e27c47d124fULL, 0x9e3779b97f4a7c15ULL,
+      0xbf58476d1ce4e5b9ULL, 0x94d049bb133111ebULL };
+  uint64_t hash = 0;
+  for (int w = 0; w < FAP_MEMO_KEY_WORDS; w += 2) {
+    uint64_t next = w + 1 < FAP_MEMO_KEY_WORDS ? words[w + 1] : 0;
+    hash += mix(words[w] ^ SECRET[w], next ^ SECRET[w + 1]);
+  }
+  return mix(hash ^ SECRET[0], hash ^ SECRET[5]);
+}
+
+/// @brief Word by word, the keys are written by words and a wider load
+/// would wait for the stores
+inline bool sameKey(const MemoKey& lhs, const MemoKey& rhs) {
+  if (lhs.hash != rhs.hash) {
+    return false;
+  }
+  for (int w = 0; w < FAP_MEMO_KEY_WORDS; ++w) {
+    if (lhs.words[w] != rhs.words[w]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool isEmpty(const Entry& entry) {
+  return ((entry.key.words[SETTINGS_WORD] >> OP_SHIFT) & 0xff) == 0xff;
+}
+
+inline uint64_t packPrec(FloatPrecTy prec) {
+  return ((uint64_t)prec.exp_size << 16) | prec.mant_size;
+}
+
+}  // end anonymous namespace
+
+bool fap_memo_key_(FAP_memo_op op, const ::fap::FloatingPointType &lhs,
+                   const ::fap::FloatingPointType &rhs,
+                   const ::fap::ArithmeticState &ctx, ::fap::MemoKey *key) {
+  if (ctx.rounding == FAP_FP_ROUND_STOCHASTIC) {
+    return false;
+  }
+  MantType lhs_mant = lhs.getMant(), rhs_mant = rhs.getMant();
+  uint64_t result_prec = ctx.hasResultPrec ? packPrec(ctx.resultPrec) : 0;
+  key->words[0] = (uint64_t)lhs_mant;
+  key->words[1] = (uint64_t)(lhs_mant >> 64);
+  key->words[2] = (uint64_t)rhs_mant;
+  key->words[3] = (uint64_t)(rhs_mant >> 64);
+  key->words[4] = (packPrec(lhs.getPrec()) << 32) | packPrec(rhs.getPrec());
+  key->words[5] = (result_prec << 32) | ((uint64_t)lhs.getExp() << 16) |
+                  rhs.getExp();
+  key->words[SETTINGS_WORD] =
+      ((uint64_t)lhs.getSign() << 40) | ((uint64_t)rhs.getSign() << 32) |
+      ((uint64_t)ctx.rounding << 24) | ((uint64_t)op << OP_SHIFT) |
+      ((uint64_t)ctx.special << 8) | (ctx.fastMath & FAP_FAST_MATH_ALL);
+  key->hash = hashWords(key->words);
+  return true;
+}
+
+bool fap_memo_lookup_(const ::fap::MemoKey &key,
+                      const ::fap::ArithmeticState &ctx,
+                      ::fap::FloatingPointType *res) {
+  ThreadCache& cache = threadCache();
+  if (cache.capacity != ctx.memoEntries) {
+    cache.resize(ctx.memoEntries);
+  }
+  bump(cache.lookups);
+  Entry* set = &cache.table[(key.hash & cache.setMask) * 2];
+  for (int way = 0; way < 2; ++way) {
+    const Entry& entry = set[way];
+    if (sameKey(entry.key, key)) {
+      bump(cache.hits);
+      res->setPrec(entry.prec);
+      res->setSign(entry.sign);
+      res->setExp(entry.exp);
+      res->setMant(entry.mant);
+      res->setGrs(entry.grs);
+      return true;
+    }
+  }
+  return false;
+}
+
+void fap_memo_store_(const ::fap::MemoKey &key,
+                     const ::fap::FloatingPointType &res) {
+  // The cache has been sized by the lookup of the key
+  ThreadCache& cache = threadCache();
+  size_t set = key.hash & cache.setMask;
+  // An empty way is taken first, then the ways are replaced in turn
+  uint8_t way = cache.victim[set];
+  Entry* ways = &cache.table[set * 2];
+  if (!isEmpty(ways[way])) {
+    if (isEmpty(ways[way ^ 1])) {
+      way ^= 1;
+    } else {
+      bump(cache.evictions);
+    }
+  }
+  cache.victim[set] = way ^ 1;
+  Entry& entry = ways[way];
+  entry.key = key;
+  entry.mant = res.getMant();
+  entry.exp = res.getExp();
+  entry.prec = res.getPrec();
+  entry.sign = res.getSign();
+  entry.grs = res.getGrs();
+}
+
+::fap::MemoStats fap::memoStats() {
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  MemoStats stats = reg.retired;
+  for (size_t t = 0; t < reg.live.size(); ++t) {
+    addCounters(*reg.live[t], stats);
+  }
+  return stats;
+}
+
+void fap::resetMemoStats() {
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  reg.retired = MemoStats();
+  for (size_t t = 0; t < reg.live.size(); ++t) {
+    reg.live[t]->lookups.store(0, ::std::memory_order_relaxed);
+    reg.live[t]->hits.store(0, ::std::memory_order_relaxed);
+    reg.live[t]->evictions.store(0, ::std::memory_order_relaxed);
+  }
+}
+
+void fap::clearMemoCache() {
+  ThreadCache& cache = threadCache();
+  cache.table.clear();
+  cache.victim.clear();
+  cache.capacity = 0;
+}
@@ -0,0 +1,374 @@
+//===- FapProfile.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapProfile.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Value-range profiling - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapProfile.h"
+
+#include <math.h>
+#include <pthread.h>
+
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+using ::fap::IntegerPrecision;
+using ::fap::RangeSummary;
+
+/// @brief Sketch of a site in a thread, written only by its thread
+struct Sketch {
+  ::std::atomic<uint64_t> count;
+  ::std::atomic<uint64_t> zeros;
+  ::std::atomic<uint64_t> subnormals;
+  ::std::atomic<uint64_t> overflows;
+  ::std::atomic<uint64_t> nans;
+  ::std::atomic<int> minExp;
+  ::std::atomic<int> maxExp;
+  ::std::atomic<uint16_t> overflowExpSize;
+  ::std::atomic<uint64_t> intCount;
+  ::std::atomic<int> intBits;
+  ::std::atomic<bool> intNegative;
+  ::std::atomic<IntegerPrecision> intOriPrecision;
+  ::std::atomic<int> intLowBit;
+};
+
+/// @brief Increment by the only writer, without a locked instruction
+inline void bump(::std::atomic<uint64_t>& counter) {
+  counter.store(counter.load(::std::memory_order_relaxed) + 1,
+                ::std::memory_order_relaxed);
+}
+
+template<typename T>
+inline void lower(::std::atomic<T>& bound, T val) {
+  if (val < bound.load(::std::memory_order_relaxed)) {
+    bound.store(val, ::std::memory_order_relaxed);
+  }
+}
+
+template<typename T>
+inline void raise(::std::atomic<T>& bound, T val) {
+  if (val > bound.load(::std::memory_order_relaxed)) {
+    bound.store(val, ::std::memory_order_relaxed);
+  }
+}
+
+void clearSketch(Sketch& sketch) {
+  sketch.count.store(0, ::std::memory_order_relaxed);
+  sketch.zeros.store(0, ::std::memory_order_relaxed);
+  sketch.subnormals.store(0, ::std::memory_order_relaxed);
+  sketch.overflows.store(0, ::std::memory_order_relaxed);
+  sketch.nans.store(0, ::std::memory_order_relaxed);
+  sketch.minExp.store(INT_MAX, ::std::memory_order_relaxed);
+  sketch.maxExp.store(INT_MIN, ::std::memory_order_relaxed);
+  sketch.overflowExpSize.store(0, ::std::memory_order_relaxed);
+  sketch.intCount.store(0, ::std::memory_order_relaxed);
+  sketch.intBits.store(0, ::std::memory_order_relaxed);
+  sketch.intNegative.store(false, ::std::memory_order_relaxed);
+  sketch.intOriPrecision.store(0, ::std::memory_order_relaxed);
+  sketch.intLowBit.store(INT_MAX, ::std::memory_order_relaxed);
+}
+
+void mergeSketch(const Sketch& sketch, RangeSummary& sum) {
+  sum.count += sketch.count.load(::std::memory_order_relaxed);
+  sum.zeros += sketch.zeros.load(::std::memory_order_relaxed);
+  sum.subnormals += sketch.subnormals.load(::std::memory_order_relaxed);
+  sum.overflows += sketch.overflows.load(::std::memory_order_relaxed);
+  sum.nans += sketch.nans.load(::std::memory_order_relaxed);
+  int min_exp = sketch.minExp.load(::std::memory_order_relaxed);
+  int max_exp = sketch.maxExp.load(::std::memory_order_relaxed);
+  sum.minExp = min_exp < sum.minExp ? min_exp : sum.minExp;
+  sum.maxExp = max_exp > sum.maxExp ? max_exp : sum.maxExp;
+  uint16_t exp_size =
+      sketch.overflowExpSize.load(::std::memory_order_relaxed);
+  sum.overflowExpSize =
+      exp_size > sum.overflowExpSize ? exp_size : sum.overflowExpSize;
+  sum.intCount += sketch.intCount.load(::std::memory_order_relaxed);
+  int bits = sketch.intBits.load(::std::memory_order_relaxed);
+  sum.intBits = bits > sum.intBits ? bits : sum.intBits;
+  sum.intNegative |= sketch.intNegative.load(::std::memory_order_relaxed);
+  IntegerPrecision ori_prec =
+      sketch.intOriPrecision.load(::std::memory_order_relaxed);
+  sum.intOriPrecision =
+      ori_prec > sum.intOriPrecision ? ori_prec : sum.intOriPrecision;
+  int low_bit = sketch.intLowBit.load(::std::memory_order_relaxed);
+  sum.intLowBit = low_bit < sum.intLowBit ? low_bit : sum.intLowBit;
+}
+
+/// @brief Sketches of the sites in a thread
+struct ThreadSketches {
+  ThreadSketches();
+  ~ThreadSketches();
+
+  ::std::unique_ptr<Sketch[]> sites;
+};
+
+/// @brief Registered sites and sketches, the sketches of the exited threads
+/// are merged in retired
+struct Registry {
+  ::std::mutex lock;
+  ::std::vector< ::std::string> labels;
+  ::std::map< ::std::string, unsigned> sites;
+  ::std::vector<ThreadSketches*> live;
+  ::std::vector<RangeSummary> retired;
+};
+
+/// @brief Never destroyed, the threads can exit after the static objects
+Registry& registry() {
+  static Registry* reg = new Registry();
+  return *reg;
+}
+
+ThreadSketches::ThreadSketches()
+    : sites(new Sketch[FAP_PROFILE_MAX_SITES]) {
+  for (unsigned s = 0; s < FAP_PROFILE_MAX_SITES; ++s) {
+    clearSketch(this->sites[s]);
+  }
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  reg.live.push_back(this);
+}
+
+ThreadSketches::~ThreadSketches() {
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  for (size_t s = 0; s < reg.retired.size(); ++s) {
+    mergeSketch(this->sites[s], reg.retired[s]);
+  }
+  for (size_t t = 0; t < reg.live.size(); ++t) {
+    if (reg.live[t] == this) {
+      reg.live.erase(reg.live.begin() + t);
+      break;
+    }
+  }
+}
+
+void freeSketches(void* sketches) {
+  delete static_cast<ThreadSketches*>(sketches);
+}
+
+pthread_key_t makeSketchesKey() {
+  pthread_key_t key;
+  pthread_key_create(&key, &freeSketches);
+  return key;
+}
+
+/// @brief Sketch of \p site in the calling thread. The library is built
+/// with -fno-use-cxa-atexit, which leaves no way to destroy a thread_local
+/// object with a destructor, so the sketches are merged and freed at the
+/// exit of the thread by a pthread key
+inline Sketch& threadSketch(unsigned site) {
+  static thread_local Sketch* sites = nullptr;
+  if (sites == nullptr) {
+    static const pthread_key_t key = makeSketchesKey();
+    ThreadSketches* sketches = new ThreadSketches();
+    pthread_setspecific(key, sketches);
+    sites = sketches->sites.get();
+  }
+  return sites[site];
+}
+
+/// @brief Account a finite non-zero value of exponent \p exp
+inline void recordExp(Sketch& sketch, int exp) {
+  lower(sketch.minExp, exp);
+  raise(sketch.maxExp, exp);
+}
+
+}  // end anonymous namespace
+
+::std::atomic<bool> fap::RangeProfiler::enabled(false);
+
+fap::RangeSummary::RangeSummary()
+    : count(0),
+      zeros(0),
+      subnormals(0),
+      overflows(0),
+      nans(0),
+      minExp(INT_MAX),
+      maxExp(INT_MIN),
+      overflowExpSize(0),
+      intCount(0),
+      intBits(0),
+      intNegative(false),
+      intOriPrecision(0),
+      intLowBit(INT_MAX) {
+}
+
+::fap::FloatPrecTy fap::RangeSummary::proposeFloatPrec(
+    uint16_t mant_size, bool allow_subnormal, bool *fits) const {
+  // The normal exponents of exp_size bits are 1 - bias ... bias, the
+  // subnormals go mant_size binades below
+  for (uint16_t exp_size = 2; exp_size <= FAP_MAX_EXP_SIZE; ++exp_size) {
+    int bias = EXPONENT_BIAS(exp_size);
+    int min_exp = 1 - bias - (allow_subnormal ? mant_size : 0);
+    if (exp_size > this->overflowExpSize &&
+        (this->minExp > this->maxExp ||
+         (this->maxExp <= bias && this->minExp >= min_exp))) {
+      if (fits != NULL) {
+        *fits = true;
+      }
+      return FloatPrecTy(exp_size, mant_size);
+    }
+  }
+  if (fits != NULL) {
+    *fits = false;
+  }
+  return FloatPrecTy(FAP_MAX_EXP_SIZE, mant_size);
+}
+
+::fap::IntegerPrecision fap::RangeSummary::proposeIntPrec() const {
+  // Without non-zero values any precision is exact
+  if (this->intLowBit >= this->intOriPrecision) {
+    return 1;
+  }
+  return (IntegerPrecision)(this->intOriPrecision - this->intLowBit);
+}
+
+unsigned fap::RangeProfiler::site(const char *label) {
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  ::std::map< ::std::string, unsigned>::iterator it = reg.sites.find(label);
+  if (it != reg.sites.end()) {
+    return it->second;
+  }
+  if (reg.labels.size() >= FAP_PROFILE_MAX_SITES) {
+    ::std::cerr << "RangeProfiler::site: more than FAP_PROFILE_MAX_SITES "
+                   "sites";
+    exit(1);
+  }
+  unsigned site = reg.labels.size();
+  reg.labels.push_back(label);
+  reg.sites[label] = site;
+  reg.retired.push_back(RangeSummary());
+  reg.retired.back().label = label;
+  return site;
+}
+
+void ::fap::RangeProfiler::recordFloat(unsigned site,
+                                       const FloatingPointType &val) {
+  Sketch& sketch = threadSketch(site);
+  bump(sketch.count);
+  if (val.isNaN()) {
+    bump(sketch.nans);
+    return;
+  }
+  if (val.isInf()) {
+    bump(sketch.overflows);
+    raise(sketch.overflowExpSize, val.getPrec().exp_size);
+    return;
+  }
+  if (val.isZero()) {
+    bump(sketch.zeros);
+    return;
+  }
+  if (val.isSubN()) {
+    bump(sketch.subnormals);
+  }
+  // The exponent of the msb of the significand, exact for the subnormals
+  int exp2;
+  MantType sig = val.getSignificand(exp2);
+  recordExp(sketch, exp2 + (int)(sizeof(MantType) * 8 - 1) - fap_clz_(sig));
+}
+
+void ::fap::RangeProfiler::recordDouble(unsigned site, double val) {
+  Sketch& sketch = threadSketch(site);
+  bump(sketch.count);
+  uint64_t bits;
+  memcpy(&bits, &val, sizeof(bits));
+  int exp = (int)((bits >> DOUBLE_MANT_SIZE) &
+                  MASK_LOWER_HIGH(uint64_t, DOUBLE_EXP_SIZE));
+  uint64_t mant = bits & MASK_LOWER_HIGH(uint64_t, DOUBLE_MANT_SIZE);
+  if (exp == MASK_LOWER_HIGH(int, DOUBLE_EXP_SIZE)) {
+    if (mant != 0) {
+      bump(sketch.nans);
+    } else {
+      bump(sketch.overflows);
+      raise(sketch.overflowExpSize, (uint16_t)DOUBLE_EXP_SIZE);
+    }
+    return;
+  }
+  if (exp == 0) {
+    if (mant == 0) {
+      bump(sketch.zeros);
+      return;
+    }
+    bump(sketch.subnormals);
+    recordExp(sketch, ilogb(val));
+    return;
+  }
+  recordExp(sketch, exp - EXPONENT_BIAS(DOUBLE_EXP_SIZE));
+}
+
+void ::fap::RangeProfiler::recordInt(unsigned site, int128_t val,
+                                     IntegerPrecision ori_prec) {
+  Sketch& sketch = threadSketch(site);
+  bump(sketch.intCount);
+  if (val == 0) {
+    return;
+  }
+  raise(sketch.intOriPrecision, ori_prec);
+  // The two's complement has the trailing zeroes of the magnitude
+  uint64_t low = (uint64_t)val;
+  lower(sketch.intLowBit,
+        low != 0 ? __builtin_ctzll(low)
+                 : 64 + __builtin_ctzll((uint64_t)((uint128_t)val >> 64)));
+  uint128_t mag = val;
+  if (val < 0) {
+    sketch.intNegative.store(true, ::std::memory_order_relaxed);
+    // The two's complement of -2^(n - 1) takes n bits as 2^(n - 1) - 1
+    mag = ~(uint128_t)val;
+  }
+  raise(sketch.intBits, (int)(sizeof(uint128_t) * 8) - fap_clz_(mag));
+}
+
+::std::vector< ::fap::RangeSummary> fap::RangeProfiler::summary() {
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  ::std::vector<RangeSummary> sums = reg.retired;
+  for (size_t t = 0; t < reg.live.size(); ++t) {
+    for (size_t s = 0; s < sums.size(); ++s) {
+      mergeSketch(reg.live[t]->sites[s], sums[s]);
+    }
+  }
+  return sums;
+}
+
+void ::fap::RangeProfiler::reset() {
+  Registry& reg = registry();
+  ::std::lock_guard< ::std::mutex> guard(reg.lock);
+  for (size_t s = 0; s < reg.retired.size(); ++s) {
+    ::std::string label = reg.retired[s].label;
+    reg.retired[s] = RangeSummary();
+    reg.retired[s].label = label;
+  }
+  for (size_t t = 0; t < reg.live.size(); ++t) {
+    for (unsigned s = 0; s < FAP_PROFILE_MAX_SITES; ++s) {
+      clearSketch(reg.live[t]->sites[s]);
+    }
+  }
+}
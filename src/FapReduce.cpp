@@ -0,0 +1,113 @@
+//===- FapReduce.cpp --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapReduce.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Reproducible parallel reductions - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapReduce.h"
+#include "FapContext.h"
+#include "FapMath.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+using ::fap::ArithmeticContext;
+using ::fap::FloatingPointType;
+
+/// @brief Reduce the leaves of \p n values and then their partial results
+/// by the tree. leaf(first, last, acc) reduces the values first ... last - 1
+/// in acc.
+template<typename LeafFnTy>
+FloatingPointType reduce(size_t n, unsigned threads, LeafFnTy leaf) {
+  if (n == 0) {
+    return FloatingPointType();
+  }
+  size_t leaves = (n + FAP_REDUCE_CHUNK - 1) / FAP_REDUCE_CHUNK;
+  // The shares are made of whole leaves
+  ::std::vector<size_t> bounds =
+      ::fap::evenShares(leaves, n / FAP_REDUCE_THREAD_WORK, threads);
+
+  // The leaves draw from generators of their own, seeded by their index
+  bool stochastic =
+      ArithmeticContext::current().rounding == FAP_FP_ROUND_STOCHASTIC;
+  uint64_t seed = stochastic ? fap_stochastic_bits_() : 0;
+  ::std::vector<FloatingPointType> partial(leaves);
+  ::fap::parallelShares(bounds, [&](size_t begin, size_t end) {
+    for (size_t l = begin; l < end; ++l) {
+      if (stochastic) {
+        fap_stochastic_seed(seed, l);
+      }
+      size_t first = l * FAP_REDUCE_CHUNK;
+      leaf(first, ::std::min(n, first + FAP_REDUCE_CHUNK), partial[l]);
+    }
+  });
+
+  if (stochastic) {
+    fap_stochastic_seed(seed, leaves);
+  }
+  // Pairs of each level, the odd one goes up as it is
+  for (size_t level = leaves; level > 1; level = (level + 1) / 2) {
+    for (size_t p = 0; p + 1 < level; p += 2) {
+      partial[p / 2] = partial[p] + partial[p + 1];
+    }
+    if (level % 2 != 0) {
+      partial[level / 2] = partial[level - 1];
+    }
+  }
+  return partial[0];
+}
+
+}  // end anonymous namespace
+
+::fap::FloatingPointType fap::sum(const FloatingPointType *vals, size_t n,
+                                  unsigned threads) {
+  return reduce(n, threads, [vals](size_t first, size_t last,
+                                   FloatingPointType &acc) {
+    acc = vals[first];
+    for (size_t i = first + 1; i < last; ++i) {
+      acc += vals[i];
+    }
+  });
+}
+
+::fap::FloatingPointType fap::dot(const FloatingPointType *x,
+                                  const FloatingPointType *y, size_t n,
+                                  unsigned threads) {
+  return reduce(n, threads, [x, y](size_t first, size_t last,
+                                   FloatingPointType &acc) {
+    acc = x[first] * y[first];
+    for (size_t i = first + 1; i < last; ++i) {
+      acc += x[i] * y[i];
+    }
+  });
+}
+
+::fap::FloatingPointType fap::norm(const FloatingPointType *x, size_t n,
+                                   unsigned threads) {
+  if (n == 0) {
+    return FloatingPointType();
+  }
+  return ::fap::sqrt(::fap::dot(x, x, n, threads));
+}
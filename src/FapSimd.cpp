@@ -0,0 +1,496 @@
+//===- FapSimd.cpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapSimd.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Vectorized operations on packed values - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapSimd.h"
+#include "FapContext.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+/// @brief 64 bit lanes of a vector, a 512 bit register of AVX-512F, split
+/// by the compiler on the narrower instruction sets
+#ifndef FAP_SIMD_LANES
+#define FAP_SIMD_LANES                8
+#endif
+
+/// @brief Values below which a worker is not worth a thread
+#ifndef FAP_SIMD_THREAD_WORK
+#define FAP_SIMD_THREAD_WORK          (1 << 14)
+#endif
+
+/// @brief Versions of the kernels for each instruction set, selected at the
+/// loading by the processor
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define FAP_SIMD_CLONES \
+  __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define FAP_SIMD_CLONES
+#endif
+
+/// @brief The lane operations are inlined in the versions of the kernels
+#define FAP_SIMD_INLINE               inline __attribute__((always_inline))
+
+// The vectors never cross a function boundary
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace {
+
+using ::fap::ArithmeticContext;
+using ::fap::ArithmeticState;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+typedef uint64_t LaneU __attribute__((vector_size(8 * FAP_SIMD_LANES)));
+typedef int64_t LaneI __attribute__((vector_size(8 * FAP_SIMD_LANES)));
+
+/// @brief Constants of the precision
+struct Params {
+  int64_t expSize;
+  int64_t mantSize;
+  int64_t bias;
+  int64_t maxExp;
+  uint64_t expMask;
+  uint64_t mantMask;
+  uint64_t hidden;
+  uint64_t inf;  ///< Exponent and mantissa fields of the infinity
+  uint64_t maxFinite;  ///< Exponent and mantissa fields of the greatest value
+  int64_t mulShift;  ///< Right shift of the products on M + 4 bits
+
+  explicit Params(FloatPrecTy prec)
+      : expSize(prec.exp_size),
+        mantSize(prec.mant_size),
+        bias(EXPONENT_BIAS(prec.exp_size)),
+        maxExp(MASK_LOWER_HIGH(uint64_t, prec.exp_size)),
+        expMask(MASK_LOWER_HIGH(uint64_t, prec.exp_size)),
+        mantMask(MASK_LOWER_HIGH(uint64_t, prec.mant_size)),
+        hidden(MASK_BIT_HIGH(uint64_t, prec.mant_size)),
+        inf(MASK_LOWER_HIGH(uint64_t, prec.exp_size) << prec.mant_size),
+        maxFinite((MASK_LOWER_HIGH(uint64_t, prec.exp_size) <<
+                   prec.mant_size) - 1),
+        mulShift(prec.mant_size > 2 ? prec.mant_size - 2 : 0) {
+  }
+};
+
+/// @brief Fields of the packed values of a vector, the masks have the bits
+/// of a lane all set or all clear
+struct Operand {
+  LaneU sign;  ///< 0 or 1
+  LaneU fields;  ///< Exponent and mantissa
+  LaneU sig;  ///< Significand, with the hidden bit
+  LaneI exp2;  ///< Exponent of the lsb of sig
+  LaneU nan;  ///< Mask of the NaN
+  LaneU special;  ///< Mask of the NaN and infinity
+  LaneU zero;  ///< Mask of the zero
+};
+
+FAP_SIMD_INLINE LaneU splat(uint64_t val) {
+  LaneU lanes = { };
+  return lanes + val;
+}
+
+/// @brief Mask of a comparison. The masks are kept as integer lanes and
+/// the selections are bitwise: the boolean vectors of the comparisons,
+/// stored in variables, are split by the compiler in scalar operations
+FAP_SIMD_INLINE LaneU mask(LaneI cmp) {
+  return (LaneU)cmp;
+}
+
+/// \{
+/// @brief Lanes of \p lhs where \p m is set, of \p rhs elsewhere
+FAP_SIMD_INLINE LaneU sel(LaneU m, LaneU lhs, LaneU rhs) {
+  return (lhs & m) | (rhs & ~m);
+}
+
+FAP_SIMD_INLINE LaneI sel(LaneU m, LaneI lhs, LaneI rhs) {
+  return (LaneI)sel(m, (LaneU)lhs, (LaneU)rhs);
+}
+/// \}
+
+FAP_SIMD_INLINE LaneU bit(LaneU m) {
+  return m & 0x01;
+}
+
+/// @brief Leading zeroes of non zero lanes
+FAP_SIMD_INLINE LaneI clz(LaneU x) {
+  LaneU n = { };
+  LaneU m = mask(x <= 0xffffffffULL);
+  n += m & 32;
+  x = sel(m, x << 32, x);
+  m = mask(x <= 0xffffffffffffULL);
+  n += m & 16;
+  x = sel(m, x << 16, x);
+  m = mask(x <= 0xffffffffffffffULL);
+  n += m & 8;
+  x = sel(m, x << 8, x);
+  m = mask(x <= 0x0fffffffffffffffULL);
+  n += m & 4;
+  x = sel(m, x << 4, x);
+  m = mask(x <= 0x3fffffffffffffffULL);
+  n += m & 2;
+  x = sel(m, x << 2, x);
+  m = mask(x <= 0x7fffffffffffffffULL);
+  n += m & 1;
+  return (LaneI)n;
+}
+
+FAP_SIMD_INLINE Operand decode(const Params& p, LaneU packed) {
+  Operand op;
+  op.sign = (packed >> (p.expSize + p.mantSize)) & 0x01;
+  op.fields = packed & (p.inf | p.mantMask);
+  LaneU exp = (packed >> p.mantSize) & p.expMask;
+  LaneU mant = packed & p.mantMask;
+  LaneU subnormal = mask(exp == 0);
+  op.sig = mant | (~subnormal & p.hidden);
+  op.exp2 = (LaneI)sel(subnormal, splat(1), exp) - p.bias - p.mantSize;
+  op.special = mask(exp == (uint64_t)p.maxExp);
+  op.nan = op.special & mask(mant != 0);
+  op.zero = mask(op.fields == 0);
+  return op;
+}
+
+/// @brief Subnormal significands with the msb on the hidden bit, so that
+/// the products and quotients have M + 1 bit operands
+FAP_SIMD_INLINE void normalize(const Params& p, Operand& op) {
+  LaneI shift = clz(op.sig | bit(op.zero)) - (63 - p.mantSize);
+  shift = (LaneI)(~op.zero & (LaneU)shift);
+  op.sig <<= (LaneU)shift;
+  op.exp2 -= shift;
+}
+
+/// @brief (-1)^sign * sig * 2^exp2 rounded on the precision, as
+/// setSignificand(); sig has its lsb sticky when it is not exact
+template<int R>
+FAP_SIMD_INLINE LaneU round(const Params& p, LaneU sign, LaneU sig,
+                            LaneI exp2) {
+  LaneU zero = mask(sig == 0);
+  LaneI msb = 63 - clz(sig | bit(zero));
+  LaneI biased = exp2 + msb + p.bias;
+  LaneI shift = msb - p.mantSize;
+  LaneU subnormal = mask(biased < 1);
+  // Subnormal, the lsb has the weight of the minimum exponent
+  shift = sel(subnormal, 1 - p.bias - p.mantSize - exp2, shift);
+  biased = (LaneI)(~subnormal & (LaneU)biased);
+
+  LaneU left = mask(shift <= 0), far = mask(shift >= 64);
+  LaneU right = ~left & (LaneU)shift & 63;
+  LaneU kept = sel(left, sig << (left & (LaneU)-shift),
+                   ~far & (sig >> right));
+  LaneU rem = ~left & sel(far, sig, sig & (((uint64_t)1 << right) - 1));
+  LaneU half = sel(far, splat(0x8000000000000000ULL),
+                   (uint64_t)1 << ((right - 1) & 63));
+  LaneU up = { };
+  if (R == FAP_FP_ROUND_NEAREST) {
+    up = mask(rem > half) | (mask(rem == half) & mask((kept & 0x01) != 0));
+  } else if (R == FAP_FP_ROUND_TOWARD_PINF) {
+    up = mask(rem != 0) & mask(sign == 0);
+  } else if (R == FAP_FP_ROUND_TOWARD_NINF) {
+    up = mask(rem != 0) & mask(sign != 0);
+  }
+  // The carry goes on the exponent, up to the infinity
+  LaneU fields = (~mask(biased == 0) & ((LaneU)(biased - 1) << p.mantSize)) +
+                 kept + bit(up);
+
+  LaneU overflow;
+  if (R == FAP_FP_ROUND_NEAREST) {
+    overflow = splat(p.inf);
+  } else if (R == FAP_FP_ROUND_TOWARD_PINF) {
+    overflow = sel(mask(sign != 0), splat(p.maxFinite), splat(p.inf));
+  } else if (R == FAP_FP_ROUND_TOWARD_NINF) {
+    overflow = sel(mask(sign != 0), splat(p.inf), splat(p.maxFinite));
+  } else {
+    overflow = splat(p.maxFinite);
+  }
+  fields = sel(mask(biased >= p.maxExp), overflow, fields);
+  fields &= ~zero;
+  return (sign << (p.expSize + p.mantSize)) | fields;
+}
+
+FAP_SIMD_INLINE LaneU pack(const Params& p, LaneU sign, LaneU fields) {
+  return (sign << (p.expSize + p.mantSize)) | fields;
+}
+
+template<int R>
+FAP_SIMD_INLINE LaneU add(const Params& p, const Operand& lhs,
+                          const Operand& rhs) {
+  // The major one and the minor one
+  LaneU swap = mask(lhs.exp2 < rhs.exp2);
+  LaneU big_sig = sel(swap, rhs.sig, lhs.sig);
+  LaneU small_sig = sel(swap, lhs.sig, rhs.sig);
+  LaneU big_sign = sel(swap, rhs.sign, lhs.sign);
+  LaneU small_sign = sel(swap, lhs.sign, rhs.sign);
+  LaneI big_exp2 = sel(swap, rhs.exp2, lhs.exp2);
+  LaneI exp_diff = big_exp2 - sel(swap, lhs.exp2, rhs.exp2);
+
+  // Three bits for the guard, round and sticky, the minor one is shifted
+  // on the right jamming the lost bits in its lsb
+  big_sig <<= 3;
+  small_sig <<= 3;
+  LaneU far = mask(exp_diff >= 64);
+  LaneU diff = (LaneU)exp_diff & 63;
+  LaneU lost = small_sig & (((uint64_t)1 << diff) - 1);
+  LaneU aligned = sel(far, bit(mask(small_sig != 0)),
+                      (small_sig >> diff) | bit(mask(lost != 0)));
+
+  LaneU same = mask(big_sign == small_sign);
+  LaneU major = mask(big_sig >= aligned);
+  LaneU res_sig = sel(same, big_sig + aligned,
+                      sel(major, big_sig - aligned, aligned - big_sig));
+  LaneU res_sign = sel(same | major, big_sign, small_sign);
+  // The sum of opposite values is +0, but rounding toward -infinity
+  LaneU zero_sign = splat(R == FAP_FP_ROUND_TOWARD_NINF ? 1 : 0);
+  res_sign = sel(mask(res_sig == 0) & ~same, zero_sign, res_sign);
+  LaneU res = round<R>(p, res_sign, res_sig, big_exp2 - 3);
+
+  // Special values
+  LaneU nan = lhs.nan | rhs.nan |
+              (lhs.special & rhs.special & mask(lhs.sign != rhs.sign));
+  res = sel(rhs.special, pack(p, rhs.sign, rhs.fields), res);
+  res = sel(lhs.special & ~rhs.special, pack(p, lhs.sign, lhs.fields), res);
+  res = sel(nan, pack(p, lhs.sign, splat(p.inf | 0x01)), res);
+  return res;
+}
+
+template<int R>
+FAP_SIMD_INLINE LaneU mul(const Params& p, Operand lhs, Operand rhs) {
+  normalize(p, lhs);
+  normalize(p, rhs);
+  LaneU sign = lhs.sign ^ rhs.sign;
+
+  // Product of the M + 1 bit significands on two lanes of 64 bits
+  LaneU lhs_lo = lhs.sig & 0xffffffffULL, lhs_hi = lhs.sig >> 32;
+  LaneU rhs_lo = rhs.sig & 0xffffffffULL, rhs_hi = rhs.sig >> 32;
+  LaneU lo_lo = lhs_lo * rhs_lo;
+  LaneU mid = lhs_lo * rhs_hi + lhs_hi * rhs_lo;
+  LaneU lo = lo_lo + (mid << 32);
+  LaneU hi = lhs_hi * rhs_hi + (mid >> 32) + bit(mask(lo < lo_lo));
+  // Right shift on M + 4 bits, jamming the lost ones in the lsb
+  uint64_t shift = p.mulShift;
+  LaneU prod = lo >> shift;
+  if (shift != 0) {
+    prod |= hi << (64 - shift);
+  }
+  prod |= bit(mask((lo & (((uint64_t)1 << shift) - 1)) != 0));
+  LaneU res = round<R>(p, sign, prod, lhs.exp2 + rhs.exp2 + shift);
+
+  // Special values
+  LaneU zero = lhs.zero | rhs.zero;
+  res = sel(lhs.special | rhs.special,
+            pack(p, sign, sel(zero, splat(p.inf | 0x01), splat(p.inf))), res);
+  res = sel(lhs.nan | rhs.nan, pack(p, lhs.sign, splat(p.inf | 0x01)), res);
+  return res;
+}
+
+template<int R>
+FAP_SIMD_INLINE LaneU div(const Params& p, Operand lhs, Operand rhs) {
+  normalize(p, lhs);
+  normalize(p, rhs);
+  LaneU sign = lhs.sign ^ rhs.sign;
+
+  // Restoring division of the M + 1 bit significands, M + 4 quotient bits
+  // and the remainder for the sticky one
+  LaneU divisor = sel(rhs.zero, splat(1), rhs.sig);
+  LaneU rem = lhs.sig, quot = splat(0);
+  for (int64_t i = 0; i < p.mantSize + 4; ++i) {
+    LaneU ge = mask(rem >= divisor);
+    quot = (quot << 1) | bit(ge);
+    rem = (rem - (divisor & ge)) << 1;
+  }
+  quot |= bit(mask(rem != 0));
+  LaneU res = round<R>(p, sign, quot,
+                       lhs.exp2 - rhs.exp2 - (p.mantSize + 3));
+
+  // Special values
+  LaneU nan = pack(p, sign, splat(p.inf | 0x01));
+  LaneU inf = pack(p, sign, splat(p.inf));
+  LaneU zero = pack(p, sign, splat(0));
+  res = sel(lhs.zero, zero, res);
+  res = sel(rhs.zero, sel(lhs.zero, nan, inf), res);
+  res = sel(rhs.special, zero, res);
+  res = sel(lhs.special, sel(rhs.special, nan, inf), res);
+  res = sel(lhs.nan | rhs.nan, pack(p, lhs.sign, splat(p.inf | 0x01)), res);
+  return res;
+}
+
+template<FAP_batch_op Op, int R>
+FAP_SIMD_INLINE LaneU apply(const Params& p, LaneU lhs, LaneU rhs) {
+  Operand lhs_op = decode(p, lhs), rhs_op = decode(p, rhs);
+  switch (Op) {
+    case FAP_BATCH_ADD:
+      return add<R>(p, lhs_op, rhs_op);
+    case FAP_BATCH_SUB:
+      rhs_op.sign ^= 0x01;
+      return add<R>(p, lhs_op, rhs_op);
+    case FAP_BATCH_MUL:
+      return mul<R>(p, lhs_op, rhs_op);
+    default:
+      return div<R>(p, lhs_op, rhs_op);
+  }
+}
+
+template<FAP_batch_op Op, int R>
+FAP_SIMD_INLINE void loop(const Params& p, const uint64_t* lhs,
+                          const uint64_t* rhs, uint64_t* res, size_t n) {
+  LaneU lhs_lanes, rhs_lanes, res_lanes;
+  size_t i = 0;
+  for (; i + FAP_SIMD_LANES <= n; i += FAP_SIMD_LANES) {
+    memcpy(&lhs_lanes, lhs + i, sizeof(lhs_lanes));
+    memcpy(&rhs_lanes, rhs + i, sizeof(rhs_lanes));
+    res_lanes = apply<Op, R>(p, lhs_lanes, rhs_lanes);
+    memcpy(res + i, &res_lanes, sizeof(res_lanes));
+  }
+  if (i < n) {
+    // Last values on zeroed lanes
+    size_t rest = (n - i) * sizeof(uint64_t);
+    lhs_lanes = splat(0);
+    rhs_lanes = splat(0);
+    memcpy(&lhs_lanes, lhs + i, rest);
+    memcpy(&rhs_lanes, rhs + i, rest);
+    res_lanes = apply<Op, R>(p, lhs_lanes, rhs_lanes);
+    memcpy(res + i, &res_lanes, rest);
+  }
+}
+
+template<FAP_batch_op Op>
+FAP_SIMD_INLINE void loopRounding(FAP_rounding_method rounding,
+                                  const Params& p, const uint64_t* lhs,
+                                  const uint64_t* rhs, uint64_t* res,
+                                  size_t n) {
+  switch (rounding) {
+    case FAP_FP_ROUND_TOWARD_0:
+      loop<Op, FAP_FP_ROUND_TOWARD_0>(p, lhs, rhs, res, n);
+      break;
+    case FAP_FP_ROUND_TOWARD_PINF:
+      loop<Op, FAP_FP_ROUND_TOWARD_PINF>(p, lhs, rhs, res, n);
+      break;
+    case FAP_FP_ROUND_TOWARD_NINF:
+      loop<Op, FAP_FP_ROUND_TOWARD_NINF>(p, lhs, rhs, res, n);
+      break;
+    default:
+      loop<Op, FAP_FP_ROUND_NEAREST>(p, lhs, rhs, res, n);
+      break;
+  }
+}
+
+/// @brief Vectorized kernel, a version for each instruction set
+FAP_SIMD_CLONES
+void simdKernel(FAP_batch_op op, FAP_rounding_method rounding,
+                const Params& p, const uint64_t* lhs, const uint64_t* rhs,
+                uint64_t* res, size_t n) {
+  switch (op) {
+    case FAP_BATCH_ADD:
+      loopRounding<FAP_BATCH_ADD>(rounding, p, lhs, rhs, res, n);
+      break;
+    case FAP_BATCH_SUB:
+      loopRounding<FAP_BATCH_SUB>(rounding, p, lhs, rhs, res, n);
+      break;
+    case FAP_BATCH_MUL:
+      loopRounding<FAP_BATCH_MUL>(rounding, p, lhs, rhs, res, n);
+      break;
+    case FAP_BATCH_DIV:
+      loopRounding<FAP_BATCH_DIV>(rounding, p, lhs, rhs, res, n);
+      break;
+  }
+}
+
+/// @brief Kernel of the operators, for the contexts the lanes do not cover
+void genericKernel(FAP_batch_op op, FloatPrecTy prec, const uint64_t* lhs,
+                   const uint64_t* rhs, uint64_t* res, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    FloatingPointType val = ::fap::unpackValue(lhs[i], prec);
+    FloatingPointType rhs_val = ::fap::unpackValue(rhs[i], prec);
+    switch (op) {
+      case FAP_BATCH_ADD:
+        val += rhs_val;
+        break;
+      case FAP_BATCH_SUB:
+        val -= rhs_val;
+        break;
+      case FAP_BATCH_MUL:
+        val *= rhs_val;
+        break;
+      case FAP_BATCH_DIV:
+        val /= rhs_val;
+        break;
+    }
+    res[i] = ::fap::packValue(val);
+  }
+}
+
+}  // end anonymous namespace
+
+uint64_t fap::packValue(const FloatingPointType& val) {
+  FloatPrecTy prec = val.getPrec();
+  if (prec.exp_size > DOUBLE_EXP_SIZE || prec.mant_size > DOUBLE_MANT_SIZE) {
+    ::std::cerr << "packValue: precision greater than 11:52";
+    exit(1);
+  }
+  return ((uint64_t)val.getSign() << (prec.exp_size + prec.mant_size)) |
+         ((uint64_t)val.getExp() << prec.mant_size) |
+         (uint64_t)val.getMant();
+}
+
+::fap::FloatingPointType fap::unpackValue(uint64_t bits, FloatPrecTy prec) {
+  FloatingPointType val;
+  val.setPrec(prec);
+  val.setSign(bits >> (prec.exp_size + prec.mant_size));
+  val.setExp(bits >> prec.mant_size);
+  val.setMant(bits);
+  val.setGrs(0x00);
+  return val;
+}
+
+void fap::batchOp(FAP_batch_op op, FloatPrecTy prec, const uint64_t* lhs,
+                  const uint64_t* rhs, uint64_t* res, size_t n,
+                  unsigned threads) {
+  if (prec.exp_size < 2 || prec.exp_size > DOUBLE_EXP_SIZE ||
+      prec.mant_size < 1 || prec.mant_size > DOUBLE_MANT_SIZE) {
+    ::std::cerr << "batchOp: precision out of 2:1 - 11:52";
+    exit(1);
+  }
+  ::std::vector<size_t> bounds =
+      evenShares(n, n / FAP_SIMD_THREAD_WORK, threads);
+
+  // The results are on the precision of the values
+  ArithmeticState state = ArithmeticContext::current();
+  state.hasResultPrec = false;
+  ArithmeticContext ctx(state);
+  if (state.rounding == FAP_FP_ROUND_STOCHASTIC ||
+      state.fastMath != FAP_FAST_MATH_NONE ||
+      state.special != FAP_SPECIAL_IEEE) {
+    parallelShares(bounds, [&](size_t begin, size_t end) {
+      genericKernel(op, prec, lhs + begin, rhs + begin, res + begin,
+                    end - begin);
+    });
+    return;
+  }
+
+  Params params(prec);
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    simdKernel(op, state.rounding, params, lhs + begin, rhs + begin,
+               res + begin, end - begin);
+  });
+}
@@ -0,0 +1,363 @@
+//===- FapSparse.cpp --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapSparse.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Sparse matrices with bit-packed values - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapSparse.h"
+#include "FapContext.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+/// @brief Non-zeroes below which a worker is not worth a thread
+#ifndef FAP_SPARSE_THREAD_WORK
+#define FAP_SPARSE_THREAD_WORK        (1 << 16)
+#endif
+
+namespace {
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+/// @brief Bits of the value \p pos of width \p width, the padding word
+/// allows to read the word after the last one
+inline uint64_t loadBits(const uint64_t *words, size_t pos, int width,
+                         uint64_t mask) {
+  size_t bit = pos * width;
+  size_t word = bit >> 6;
+  int off = bit & 63;
+  // The high part is shifted in two steps, not to shift by 64
+  uint64_t lo = words[word] >> off;
+  uint64_t hi = (words[word + 1] << 1) << (63 - off);
+  return (lo | hi) & mask;
+}
+
+/// @brief Constants to unpack the values of a precision into doubles
+struct Unpacker {
+  int mantSize;
+  int signShift;
+  uint64_t mantMask;
+  uint64_t magMask;  ///< Exponent and mantissa
+  uint64_t expMask;
+  uint64_t expOffset;  ///< From the biased exponent to the double one
+  double subnormalScale;  ///< Weight of the lsb of the subnormals
+  uint64_t valueMask;
+};
+
+Unpacker makeUnpacker(FloatPrecTy prec) {
+  Unpacker u;
+  u.mantSize = prec.mant_size;
+  u.signShift = prec.exp_size + prec.mant_size;
+  u.mantMask = MASK_LOWER_HIGH(uint64_t, prec.mant_size);
+  u.magMask = MASK_LOWER_HIGH(uint64_t, (prec.exp_size + prec.mant_size));
+  u.expMask = MASK_LOWER_HIGH(uint64_t, prec.exp_size);
+  u.expOffset = EXPONENT_BIAS(DOUBLE_EXP_SIZE) - EXPONENT_BIAS(prec.exp_size);
+  u.subnormalScale = ldexp(1.0, 1 - EXPONENT_BIAS(prec.exp_size) -
+                                    prec.mant_size);
+  int width = 1 + prec.exp_size + prec.mant_size;
+  u.valueMask = width < 64 ? MASK_LOWER_HIGH(uint64_t, width) : ~(uint64_t)0;
+  return u;
+}
+
+/// @brief Exact double of the raw bits of a value
+inline double unpackDouble(uint64_t bits, const Unpacker &u) {
+  uint64_t exp = (bits >> u.mantSize) & u.expMask;
+  uint64_t sign = (bits >> u.signShift) << 63;
+  uint64_t raw;
+  if (exp - 1 < u.expMask - 1) {
+    // Normal, the exponent and the mantissa move together and the exponent
+    // is biased again
+    raw = ((bits & u.magMask) << (DOUBLE_MANT_SIZE - u.mantSize)) +
+          (u.expOffset << DOUBLE_MANT_SIZE);
+  } else if (exp == 0) {
+    // Subnormal or zero, exact on the normals of a double
+    double res = (double)(bits & u.mantMask) * u.subnormalScale;
+    return sign != 0 ? -res : res;
+  } else {
+    // Infinity or NaN, the mantissa keeps the NaN a NaN
+    raw = (MASK_LOWER_HIGH(uint64_t, DOUBLE_EXP_SIZE) << DOUBLE_MANT_SIZE) |
+          ((bits & u.mantMask) << (DOUBLE_MANT_SIZE - u.mantSize));
+  }
+  raw |= sign;
+  double res;
+  memcpy(&res, &raw, sizeof(res));
+  return res;
+}
+
+/// @brief Raw bits of \p val rounded on \p prec
+uint64_t packValue(const FloatingPointType &val, FloatPrecTy prec,
+                   FAP_rounding_method method) {
+  uint64_t sign = val.getSign();
+  uint64_t exp = 0, mant = 0;
+  if (val.isNaN() || val.isInf()) {
+    exp = MASK_LOWER_HIGH(uint64_t, prec.exp_size);
+    mant = val.isNaN() ? 1 : 0;
+  } else {
+    int exp2;
+    MantType sig = val.getSignificand(exp2);
+    FloatingPointType res = FloatingPointType::fromSignificand(
+        val.getSign(), sig, exp2, false, prec, method);
+    exp = res.getExp();
+    mant = res.getMant();
+  }
+  return (((sign << prec.exp_size) | exp) << prec.mant_size) | mant;
+}
+
+}  // end anonymous namespace
+
+::fap::SparseMatrix::SparseMatrix(FloatPrecTy prec, FAP_sparse_format format)
+    : prec(prec),
+      format(format),
+      rows(0),
+      cols(0),
+      nnz(0),
+      ellWidth(0),
+      rowPtr(1, 0),
+      words(1, 0) {
+  // The values are unpacked into doubles, NaN needs a mantissa bit
+  if (prec.exp_size < 2 || prec.exp_size > DOUBLE_EXP_SIZE ||
+      prec.mant_size < 1 || prec.mant_size > DOUBLE_MANT_SIZE) {
+    ::std::cerr << "SparseMatrix precision does not enter in a double";
+    exit(1);
+  }
+}
+
+size_t ::fap::SparseMatrix::getStorageSize() const {
+  return this->words.size() * sizeof(uint64_t) +
+         this->colIdx.size() * sizeof(uint32_t) +
+         this->rowPtr.size() * sizeof(size_t) +
+         this->rowLen.size() * sizeof(uint32_t);
+}
+
+size_t ::fap::SparseMatrix::getRowSize(size_t row) const {
+  if (this->format == FAP_SPARSE_ELL) {
+    return this->rowLen[row];
+  }
+  return this->rowPtr[row + 1] - this->rowPtr[row];
+}
+
+size_t ::fap::SparseMatrix::position(size_t row, size_t j) const {
+  if (this->format == FAP_SPARSE_ELL) {
+    return j * this->rows + row;
+  }
+  return this->rowPtr[row] + j;
+}
+
+uint32_t ::fap::SparseMatrix::getCol(size_t row, size_t j) const {
+  return this->colIdx[this->position(row, j)];
+}
+
+::fap::FloatingPointType fap::SparseMatrix::get(size_t row, size_t j) const {
+  uint64_t bits = this->getBits(this->position(row, j));
+  FloatingPointType res;
+  res.setPrec(this->prec);
+  res.setMant(bits);
+  res.setExp(bits >> this->prec.mant_size);
+  res.setSign((bits >> this->prec.mant_size) >> this->prec.exp_size);
+  return res;
+}
+
+uint64_t ::fap::SparseMatrix::getBits(size_t pos) const {
+  int width = this->getValueSize();
+  uint64_t mask = width < 64 ? MASK_LOWER_HIGH(uint64_t, width)
+                             : ~(uint64_t)0;
+  return loadBits(this->words.data(), pos, width, mask);
+}
+
+void ::fap::SparseMatrix::setBits(size_t pos, uint64_t bits) {
+  int width = this->getValueSize();
+  size_t bit = pos * width;
+  size_t word = bit >> 6;
+  int off = bit & 63;
+  // The words start at zero, the bits are only or-ed in
+  this->words[word] |= bits << off;
+  if (off + width > 64) {
+    this->words[word + 1] |= bits >> (64 - off);
+  }
+}
+
+void ::fap::SparseMatrix::assignBits(size_t rows, size_t cols,
+                                     const size_t *row_ptr,
+                                     const uint32_t *col_idx,
+                                     const uint64_t *bits) {
+  this->rows = rows;
+  this->cols = cols;
+  this->nnz = row_ptr[rows] - row_ptr[0];
+  this->rowPtr.assign(1, 0);
+  this->rowLen.clear();
+  this->ellWidth = 0;
+  size_t slots = this->nnz;
+  if (this->format == FAP_SPARSE_ELL) {
+    this->rowLen.resize(rows);
+    for (size_t i = 0; i < rows; ++i) {
+      this->rowLen[i] = row_ptr[i + 1] - row_ptr[i];
+      this->ellWidth = ::std::max(this->ellWidth, (size_t)this->rowLen[i]);
+    }
+    slots = this->ellWidth * rows;
+  } else {
+    this->rowPtr.resize(rows + 1);
+    for (size_t i = 0; i <= rows; ++i) {
+      this->rowPtr[i] = row_ptr[i] - row_ptr[0];
+    }
+  }
+
+  // The padding of the ELL rows is column 0 and value +0
+  this->colIdx.assign(slots, 0);
+  this->words.assign((slots * this->getValueSize() + 63) / 64 + 1, 0);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < row_ptr[i + 1] - row_ptr[i]; ++j) {
+      size_t src = row_ptr[i] + j;
+      size_t pos = this->position(i, j);
+      this->colIdx[pos] = col_idx[src];
+      this->setBits(pos, bits[src - row_ptr[0]]);
+    }
+  }
+}
+
+void ::fap::SparseMatrix::assign(size_t rows, size_t cols,
+                                 const size_t *row_ptr,
+                                 const uint32_t *col_idx, const double *vals,
+                                 FAP_rounding_method method) {
+  size_t n = row_ptr[rows] - row_ptr[0];
+  ::std::vector<uint64_t> bits(n);
+  for (size_t i = 0; i < n; ++i) {
+    bits[i] = packValue(FloatingPointType(vals[row_ptr[0] + i]), this->prec,
+                        method);
+  }
+  this->assignBits(rows, cols, row_ptr, col_idx, bits.data());
+}
+
+void ::fap::SparseMatrix::assign(size_t rows, size_t cols,
+                                 const size_t *row_ptr,
+                                 const uint32_t *col_idx,
+                                 const FloatingPointType *vals,
+                                 FAP_rounding_method method) {
+  size_t n = row_ptr[rows] - row_ptr[0];
+  ::std::vector<uint64_t> bits(n);
+  for (size_t i = 0; i < n; ++i) {
+    bits[i] = packValue(vals[row_ptr[0] + i], this->prec, method);
+  }
+  this->assignBits(rows, cols, row_ptr, col_idx, bits.data());
+}
+
+namespace {
+
+/// @brief Row shares of the workers: balanced on the non-zeroes for CSR,
+/// on the rows for ELL, whose rows all have the same slots
+::std::vector<size_t> rowBounds(FAP_sparse_format format, size_t rows,
+                                size_t nnz, const ::std::vector<size_t> &ptr,
+                                unsigned threads) {
+  size_t workers =
+      ::fap::shareWorkers(rows, nnz / FAP_SPARSE_THREAD_WORK, threads);
+  ::std::vector<size_t> bounds(workers + 1, rows);
+  bounds[0] = 0;
+  for (size_t w = 1; w < workers; ++w) {
+    if (format == FAP_SPARSE_ELL) {
+      bounds[w] = rows * w / workers;
+    } else {
+      bounds[w] = ::std::lower_bound(ptr.begin(), ptr.end() - 1,
+                                     nnz * w / workers) - ptr.begin();
+    }
+  }
+  return bounds;
+}
+
+}  // end anonymous namespace
+
+void ::fap::SparseMatrix::spmv(const double *x, double *y,
+                               unsigned threads) const {
+  const Unpacker u = makeUnpacker(this->prec);
+  const int width = this->getValueSize();
+  const uint64_t *words = this->words.data();
+  const uint32_t *col_idx = this->colIdx.data();
+  ::std::vector<size_t> bounds = rowBounds(this->format, this->rows,
+                                           this->nnz, this->rowPtr, threads);
+
+  if (this->format == FAP_SPARSE_ELL) {
+    const uint32_t *row_len = this->rowLen.data();
+    size_t ld = this->rows;
+    size_t ell_width = this->ellWidth;
+    parallelShares(bounds, [=](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        y[i] = 0.0;
+      }
+      // Slot by slot, the values of consecutive rows are contiguous
+      for (size_t j = 0; j < ell_width; ++j) {
+        for (size_t i = begin; i < end; ++i) {
+          if (j < row_len[i]) {
+            size_t pos = j * ld + i;
+            y[i] += unpackDouble(loadBits(words, pos, width, u.valueMask),
+                                 u) * x[col_idx[pos]];
+          }
+        }
+      }
+    });
+    return;
+  }
+
+  const size_t *row_ptr = this->rowPtr.data();
+  parallelShares(bounds, [=](size_t begin, size_t end) {
+    // The values are read in order, the bit position only advances
+    size_t bit = row_ptr[begin] * width;
+    for (size_t i = begin; i < end; ++i) {
+      double sum = 0.0;
+      for (size_t pos = row_ptr[i]; pos < row_ptr[i + 1]; ++pos) {
+        const uint64_t *word = words + (bit >> 6);
+        int off = bit & 63;
+        uint64_t bits = ((word[0] >> off) | ((word[1] << 1) << (63 - off))) &
+                        u.valueMask;
+        bit += width;
+        sum += unpackDouble(bits, u) * x[col_idx[pos]];
+      }
+      y[i] = sum;
+    }
+  });
+}
+
+void ::fap::SparseMatrix::spmv(const FloatingPointType *x,
+                               FloatingPointType *y, unsigned threads) const {
+  ::std::vector<size_t> bounds = rowBounds(this->format, this->rows,
+                                           this->nnz, this->rowPtr, threads);
+  const FloatingPointType zero = FloatingPointType::fromSignificand(
+      0, 0, 0, false, this->prec);
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      size_t len = this->getRowSize(i);
+      if (len == 0) {
+        y[i] = zero;
+        continue;
+      }
+      FloatingPointType sum = this->get(i, 0);
+      sum *= x[this->getCol(i, 0)];
+      for (size_t j = 1; j < len; ++j) {
+        FloatingPointType prod = this->get(i, j);
+        prod *= x[this->getCol(i, j)];
+        sum += prod;
+      }
+      y[i] = sum;
+    }
+  });
+}
@@ -0,0 +1,444 @@
+//===- FapSweep.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapSweep.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Sharded design space sweeps - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapSweep.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace {
+
+using ::fap::SweepResult;
+
+/// @brief Version of the files of a sweep, in its manifest
+const int SWEEP_VERSION = 1;
+
+bool exists(const ::std::string& path) {
+  return access(path.c_str(), F_OK) == 0;
+}
+
+/// @brief Content of the file \p path, false if it cannot be read
+bool readFile(const ::std::string& path, ::std::string* text) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (file == NULL) {
+    return false;
+  }
+  text->clear();
+  char buf[4096];
+  size_t read;
+  while ((read = fread(buf, 1, sizeof(buf), file)) != 0) {
+    text->append(buf, read);
+  }
+  fclose(file);
+  return true;
+}
+
+/// @brief Parse the lines of a checkpoint, "index metric ..." with the
+/// metrics in hexadecimal, in \p results. It returns the length of the
+/// complete lines, the last one of a crashed worker can be cut.
+size_t parseCheckpoint(const ::std::string& text,
+                       ::std::vector<SweepResult>* results) {
+  size_t begin = 0, end;
+  while ((end = text.find('\n', begin)) != ::std::string::npos) {
+    ::std::string line = text.substr(begin, end - begin);
+    begin = end + 1;
+    const char* cur = line.c_str();
+    char* next;
+    errno = 0;
+    SweepResult res;
+    res.config.index = strtoull(cur, &next, 10);
+    if (next == cur || errno != 0) {
+      continue;
+    }
+    for (cur = next; *cur != '\0'; cur = next) {
+      double metric = strtod(cur, &next);
+      if (next == cur) {
+        break;
+      }
+      res.metrics.push_back(metric);
+    }
+    if (*cur == '\0') {
+      results->push_back(res);
+    }
+  }
+  return begin;
+}
+
+/// @brief Create the claim \p path for \p worker, or take it over when it is
+/// of \p worker or older than \p lease seconds. The stale claim is renamed
+/// away before, so that only one worker takes it over.
+bool takeClaim(const ::std::string& path, const ::std::string& worker,
+               unsigned lease) {
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+    if (fd >= 0) {
+      bool written = write(fd, worker.data(), worker.size()) ==
+                     (ssize_t)worker.size();
+      close(fd);
+      if (!written) {
+        ::std::cerr << "Sweep: cannot write " << path;
+        exit(1);
+      }
+      return true;
+    }
+    if (errno != EEXIST) {
+      ::std::cerr << "Sweep: cannot create " << path;
+      exit(1);
+    }
+
+    ::std::string owner;
+    struct stat info;
+    if (!readFile(path, &owner) || stat(path.c_str(), &info) != 0) {
+      // Released meanwhile
+      continue;
+    }
+    if (owner == worker) {
+      // Left by a previous run of this worker
+      utimes(path.c_str(), NULL);
+      return true;
+    }
+    if (time(NULL) - info.st_mtime <= (time_t)lease) {
+      return false;
+    }
+    ::std::string stale = path + "." + worker;
+    if (rename(path.c_str(), stale.c_str()) != 0) {
+      return false;
+    }
+    unlink(stale.c_str());
+  }
+  return false;
+}
+
+}  // end anonymous namespace
+
+uint64_t fap::SweepSpace::size() const {
+  uint64_t configs = 1;
+  for (size_t v = 0; v < this->floatChoices.size(); ++v) {
+    configs *= this->floatChoices[v].size();
+  }
+  for (size_t v = 0; v < this->intChoices.size(); ++v) {
+    configs *= this->intChoices[v].size();
+  }
+  return configs;
+}
+
+::fap::SweepConfig fap::SweepSpace::config(uint64_t index) const {
+  SweepConfig config;
+  config.index = index;
+  for (size_t v = 0; v < this->floatChoices.size(); ++v) {
+    uint64_t choices = this->floatChoices[v].size();
+    config.floatPrecs.push_back(this->floatChoices[v][index % choices]);
+    index /= choices;
+  }
+  for (size_t v = 0; v < this->intChoices.size(); ++v) {
+    uint64_t choices = this->intChoices[v].size();
+    config.intPrecs.push_back(this->intChoices[v][index % choices]);
+    index /= choices;
+  }
+  return config;
+}
+
+::std::string fap::SweepSpace::describe() const {
+  ::std::string text;
+  char buf[32];
+  for (size_t v = 0; v < this->floatChoices.size(); ++v) {
+    text += "f";
+    for (size_t c = 0; c < this->floatChoices[v].size(); ++c) {
+      snprintf(buf, sizeof(buf), "%c%u:%u", c == 0 ? ' ' : ',',
+               this->floatChoices[v][c].exp_size,
+               this->floatChoices[v][c].mant_size);
+      text += buf;
+    }
+    text += "\n";
+  }
+  for (size_t v = 0; v < this->intChoices.size(); ++v) {
+    text += "i";
+    for (size_t c = 0; c < this->intChoices[v].size(); ++c) {
+      snprintf(buf, sizeof(buf), "%c%u", c == 0 ? ' ' : ',',
+               this->intChoices[v][c]);
+      text += buf;
+    }
+    text += "\n";
+  }
+  return text;
+}
+
+fap::Sweep::Sweep(const SweepSpace &space, const ::std::string &dir,
+                  const ::std::string &worker, uint64_t shard_size)
+    : space(space),
+      dir(dir),
+      worker(worker),
+      shardSize(shard_size),
+      numShards(0),
+      lease(FAP_SWEEP_LEASE),
+      part(NULL) {
+  uint64_t configs = space.size();
+  if (configs == 0 || shard_size == 0) {
+    ::std::cerr << "Sweep: the space and the shards cannot be empty";
+    exit(1);
+  }
+  if (worker.empty() || worker.find('/') != ::std::string::npos) {
+    ::std::cerr << "Sweep: invalid worker name " << worker;
+    exit(1);
+  }
+  this->numShards = (configs + shard_size - 1) / shard_size;
+  if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST) {
+    ::std::cerr << "Sweep: cannot create " << dir;
+    exit(1);
+  }
+
+  // The manifest is published by a link, so that the first process writes
+  // it whole and the others compare theirs
+  char buf[64];
+  snprintf(buf, sizeof(buf), "fap-sweep %d\nshard %llu\n", SWEEP_VERSION,
+           (unsigned long long)shard_size);
+  ::std::string manifest = buf + space.describe();
+  ::std::string path = dir + "/MANIFEST";
+  ::std::string tmp = path + "." + worker;
+  FILE* file = fopen(tmp.c_str(), "w");
+  if (file == NULL ||
+      fwrite(manifest.data(), 1, manifest.size(), file) != manifest.size() ||
+      fclose(file) != 0) {
+    ::std::cerr << "Sweep: cannot write " << tmp;
+    exit(1);
+  }
+  bool linked = link(tmp.c_str(), path.c_str()) == 0;
+  int link_errno = errno;
+  unlink(tmp.c_str());
+  if (!linked) {
+    ::std::string existing;
+    if (link_errno != EEXIST || !readFile(path, &existing)) {
+      ::std::cerr << "Sweep: cannot create " << path;
+      exit(1);
+    }
+    if (existing != manifest) {
+      ::std::cerr << "Sweep: " << dir
+                  << " holds a sweep of another space or shard size";
+      exit(1);
+    }
+  }
+}
+
+fap::Sweep::~Sweep() {
+  // An interrupted shard is left claimed, this worker takes it back
+  if (this->part != NULL) {
+    fclose(this->part);
+  }
+}
+
+::std::string fap::Sweep::shardPath(uint64_t shard,
+                                    const char *suffix) const {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "/shard-%06llu", (unsigned long long)shard);
+  return this->dir + buf + suffix;
+}
+
+bool fap::Sweep::claim(uint64_t *shard, ::std::vector<bool> *done) {
+  for (uint64_t s = 0; s < this->numShards; ++s) {
+    ::std::string done_path = this->shardPath(s, ".done");
+    if (exists(done_path)) {
+      continue;
+    }
+    ::std::string claim_path = this->shardPath(s, ".claim");
+    if (!takeClaim(claim_path, this->worker, this->lease)) {
+      continue;
+    }
+    if (exists(done_path)) {
+      // Finished between the check and the claim
+      unlink(claim_path.c_str());
+      continue;
+    }
+
+    // Resume the checkpoint, without the cut line of a crashed worker
+    ::std::string part_path = this->shardPath(s, ".part");
+    ::std::string text;
+    ::std::vector<SweepResult> results;
+    if (readFile(part_path, &text)) {
+      size_t valid = parseCheckpoint(text, &results);
+      if (valid < text.size() &&
+          truncate(part_path.c_str(), (off_t)valid) != 0) {
+        ::std::cerr << "Sweep: cannot truncate " << part_path;
+        exit(1);
+      }
+    }
+    uint64_t first = s * this->shardSize;
+    uint64_t count = ::std::min(this->shardSize, this->space.size() - first);
+    done->assign(count, false);
+    for (size_t r = 0; r < results.size(); ++r) {
+      uint64_t index = results[r].config.index;
+      if (index >= first && index - first < count) {
+        (*done)[index - first] = true;
+      }
+    }
+    this->part = fopen(part_path.c_str(), "a");
+    if (this->part == NULL) {
+      ::std::cerr << "Sweep: cannot open " << part_path;
+      exit(1);
+    }
+    this->claimPath = claim_path;
+    *shard = s;
+    return true;
+  }
+  return false;
+}
+
+bool fap::Sweep::ownsClaim() const {
+  ::std::string owner;
+  return readFile(this->claimPath, &owner) && owner == this->worker;
+}
+
+bool fap::Sweep::checkpoint(uint64_t index,
+                            const ::std::vector<double> &metrics) {
+  // The claim taken over by another worker, the checkpoint is now its one
+  if (!this->ownsClaim()) {
+    return false;
+  }
+  // The metrics are exact in hexadecimal, the line is written at once
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%llu", (unsigned long long)index);
+  ::std::string line = buf;
+  for (size_t m = 0; m < metrics.size(); ++m) {
+    snprintf(buf, sizeof(buf), " %a", metrics[m]);
+    line += buf;
+  }
+  line += "\n";
+  if (fwrite(line.data(), 1, line.size(), this->part) != line.size() ||
+      fflush(this->part) != 0 || fsync(fileno(this->part)) != 0) {
+    ::std::cerr << "Sweep: cannot write the checkpoint of " << index;
+    exit(1);
+  }
+  // Renew the lease
+  utimes(this->claimPath.c_str(), NULL);
+  return true;
+}
+
+void fap::Sweep::finish(uint64_t shard) {
+  fclose(this->part);
+  this->part = NULL;
+  ::std::string part_path = this->shardPath(shard, ".part");
+  ::std::string done_path = this->shardPath(shard, ".done");
+  // A worker that took the claim over is still on the shard, or has
+  // already renamed the checkpoint as done
+  bool owned = this->ownsClaim();
+  if (owned && !exists(done_path) &&
+      rename(part_path.c_str(), done_path.c_str()) != 0 &&
+      !exists(done_path)) {
+    ::std::cerr << "Sweep: cannot rename " << part_path;
+    exit(1);
+  }
+  if (owned) {
+    unlink(this->claimPath.c_str());
+  }
+  this->claimPath.clear();
+}
+
+uint64_t fap::Sweep::getDoneShards() const {
+  uint64_t done = 0;
+  for (uint64_t s = 0; s < this->numShards; ++s) {
+    done += exists(this->shardPath(s, ".done")) ? 1 : 0;
+  }
+  return done;
+}
+
+::std::vector<SweepResult> fap::Sweep::merge() const {
+  ::std::vector<SweepResult> results;
+  ::std::string text;
+  for (uint64_t s = 0; s < this->numShards; ++s) {
+    if (readFile(this->shardPath(s, ".done"), &text) ||
+        readFile(this->shardPath(s, ".part"), &text)) {
+      parseCheckpoint(text, &results);
+    }
+  }
+  // A shard taken over from a slow worker can hold a configuration twice,
+  // with the same metrics
+  ::std::stable_sort(results.begin(), results.end(),
+                     [](const SweepResult& lhs, const SweepResult& rhs) {
+                       return lhs.config.index < rhs.config.index;
+                     });
+  size_t merged = 0;
+  uint64_t configs = this->space.size();
+  for (size_t r = 0; r < results.size(); ++r) {
+    uint64_t index = results[r].config.index;
+    if (index >= configs ||
+        (merged != 0 && results[merged - 1].config.index == index)) {
+      continue;
+    }
+    results[merged].config = this->space.config(index);
+    results[merged].metrics.swap(results[r].metrics);
+    ++merged;
+  }
+  results.resize(merged);
+  return results;
+}
+
+void fap::Sweep::writeReport(
+    const ::std::string &path,
+    const ::std::vector< ::std::string> &metric_names) const {
+  ::std::vector<SweepResult> results = this->merge();
+  ::std::string tmp = path + ".tmp";
+  FILE* file = fopen(tmp.c_str(), "w");
+  if (file == NULL) {
+    ::std::cerr << "Sweep: cannot write " << tmp;
+    exit(1);
+  }
+  fprintf(file, "index");
+  for (size_t v = 0; v < this->space.floatChoices.size(); ++v) {
+    fprintf(file, ",float%zu", v);
+  }
+  for (size_t v = 0; v < this->space.intChoices.size(); ++v) {
+    fprintf(file, ",int%zu", v);
+  }
+  for (size_t m = 0; m < metric_names.size(); ++m) {
+    fprintf(file, ",%s", metric_names[m].c_str());
+  }
+  fprintf(file, "\n");
+  for (size_t r = 0; r < results.size(); ++r) {
+    const SweepConfig& config = results[r].config;
+    fprintf(file, "%llu", (unsigned long long)config.index);
+    for (size_t v = 0; v < config.floatPrecs.size(); ++v) {
+      fprintf(file, ",%u:%u", config.floatPrecs[v].exp_size,
+              config.floatPrecs[v].mant_size);
+    }
+    for (size_t v = 0; v < config.intPrecs.size(); ++v) {
+      fprintf(file, ",%u", config.intPrecs[v]);
+    }
+    for (size_t m = 0; m < results[r].metrics.size(); ++m) {
+      fprintf(file, ",%.17g", results[r].metrics[m]);
+    }
+    fprintf(file, "\n");
+  }
+  if (fclose(file) != 0 || rename(tmp.c_str(), path.c_str()) != 0) {
+    ::std::cerr << "Sweep: cannot write " << path;
+    exit(1);
+  }
+}
@@ -0,0 +1,350 @@
+//===- FapTape.cpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file FapTape.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Operation tapes - Implementation File
+//===----------------------------------------------------------------------===//
+
+#include "FapTape.h"
+#include "FapContext.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+/// @brief Operations below which a worker is not worth a thread
+#ifndef FAP_TAPE_THREAD_WORK
+#define FAP_TAPE_THREAD_WORK          (1 << 14)
+#endif
+
+namespace {
+
+using ::fap::ArithmeticContext;
+using ::fap::ArithmeticState;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::fap::IntegerPrecision;
+using ::fap::IntegerType;
+
+/// @brief Operations of the tapes which depend on the value type
+template<typename T>
+struct TapeTraits;
+
+template<>
+struct TapeTraits<FloatingPointType> {
+  static FloatPrecTy precOf(const FloatingPointType& val) {
+    return val.getPrec();
+  }
+
+  /// @brief \p src rounded on \p prec, with the rounding of the context
+  static FloatingPointType load(const FloatingPointType& src,
+                                FloatPrecTy prec) {
+    if (src.isNaN() || src.isInf()) {
+      FloatingPointType res;
+      res.setPrec(prec);
+      res.setSign(src.getSign());
+      res.setExp(MASK_LOWER_HIGH(ExpType, prec.exp_size));
+      res.setMant(src.isNaN() ? 1 : 0);
+      return res;
+    }
+    int exp2;
+    MantType sig = src.getSignificand(exp2);
+    return FloatingPointType::fromSignificand(
+        src.getSign(), sig, exp2, false, prec,
+        ArithmeticContext::current().rounding);
+  }
+
+  static bool same(const FloatingPointType& lhs,
+                   const FloatingPointType& rhs) {
+    FloatPrecTy lhs_prec = lhs.getPrec(), rhs_prec = rhs.getPrec();
+    return lhs.getSign() == rhs.getSign() && lhs.getExp() == rhs.getExp() &&
+           lhs.getMant() == rhs.getMant() &&
+           lhs_prec.exp_size == rhs_prec.exp_size &&
+           lhs_prec.mant_size == rhs_prec.mant_size;
+  }
+
+  /// @brief The operators of the scope round once on the slot precision
+  class Scope {
+   public:
+    explicit Scope(FloatPrecTy prec)
+        : ctx(withPrec(prec)) {
+    }
+
+    void fit(FloatingPointType&) const {
+    }
+
+   private:
+    static ArithmeticState withPrec(FloatPrecTy prec) {
+      ArithmeticState state = ArithmeticContext::current();
+      state.hasResultPrec = true;
+      state.resultPrec = prec;
+      return state;
+    }
+
+    ArithmeticContext ctx;
+  };
+};
+
+template<>
+struct TapeTraits<IntegerType> {
+  static IntegerPrecision precOf(const IntegerType& val) {
+    return val.getActualPrecision();
+  }
+
+  static IntegerType load(const IntegerType& src, IntegerPrecision prec) {
+    IntegerType res = src;
+    res.changePrec(prec);
+    return res;
+  }
+
+  static bool same(const IntegerType& lhs, const IntegerType& rhs) {
+    return lhs.getBits() == rhs.getBits() &&
+           lhs.getActualPrecision() == rhs.getActualPrecision() &&
+           lhs.getNeglectedBitsStatus() == rhs.getNeglectedBitsStatus();
+  }
+
+  /// @brief The results neglect the bits of the slot precision
+  class Scope {
+   public:
+    explicit Scope(IntegerPrecision prec)
+        : prec(prec) {
+    }
+
+    void fit(IntegerType& val) const {
+      val.changePrec(this->prec);
+    }
+
+   private:
+    IntegerPrecision prec;
+  };
+};
+
+template<typename T>
+inline T apply(FAP_tape_op op, const T& lhs, const T& rhs) {
+  switch (op) {
+  case FAP_TAPE_ADD:
+    return lhs + rhs;
+  case FAP_TAPE_SUB:
+    return lhs - rhs;
+  case FAP_TAPE_MUL:
+    return lhs * rhs;
+  default:
+    return lhs / rhs;
+  }
+}
+
+}  // end anonymous namespace
+
+template<typename T>
+typename ::fap::Tape<T>::Slot fap::Tape<T>::append(FAP_tape_op op, Slot lhs,
+                                                   Slot rhs, PrecTy prec,
+                                                   const T &value) {
+  Node node = { (uint8_t)op, lhs, rhs };
+  this->nodes.push_back(node);
+  this->precs.push_back(prec);
+  this->values.push_back(value);
+  this->changed.push_back(0);
+  return this->nodes.size() - 1;
+}
+
+template<typename T>
+::fap::TapeVar<T> fap::Tape<T>::input(const T &val) {
+  Slot slot = this->append(FAP_TAPE_INPUT, this->sources.size(), 0,
+                           TapeTraits<T>::precOf(val), val);
+  this->sources.push_back(val);
+  this->inputs.push_back(slot);
+  return TapeVar<T>(this, slot);
+}
+
+template<typename T>
+::fap::TapeVar<T> fap::Tape<T>::constant(const T &val) {
+  Slot slot = this->append(FAP_TAPE_CONST, this->sources.size(), 0,
+                           TapeTraits<T>::precOf(val), val);
+  this->sources.push_back(val);
+  return TapeVar<T>(this, slot);
+}
+
+template<typename T>
+::fap::TapeVar<T> fap::Tape<T>::record(FAP_tape_op op, const TapeVar<T> &lhs,
+                                       const TapeVar<T> &rhs) {
+  if (lhs.tape != this || rhs.tape != this || op < FAP_TAPE_ADD ||
+      op > FAP_TAPE_DIV) {
+    ::std::cerr << "Tape operation on values of another tape";
+    exit(1);
+  }
+  T res = apply(op, this->values[lhs.slot], this->values[rhs.slot]);
+  Slot slot = this->append(op, lhs.slot, rhs.slot, TapeTraits<T>::precOf(res),
+                           res);
+  return TapeVar<T>(this, slot);
+}
+
+template<typename T>
+void ::fap::Tape<T>::touch(Slot slot) {
+  if (!this->changed[slot]) {
+    this->changed[slot] = 1;
+    this->pending.push_back(slot);
+  }
+}
+
+template<typename T>
+void ::fap::Tape<T>::setPrec(Slot slot, PrecTy prec) {
+  this->precs[slot] = prec;
+  this->touch(slot);
+}
+
+template<typename T>
+void ::fap::Tape<T>::setInput(size_t input, const T &val) {
+  Slot slot = this->inputs[input];
+  this->sources[this->nodes[slot].lhs] = val;
+  this->touch(slot);
+}
+
+template<typename T>
+void ::fap::Tape<T>::buildUsers() {
+  size_t size = this->nodes.size();
+  if (this->userPtr.size() == size + 1) {
+    return;
+  }
+  this->userPtr.assign(size + 1, 0);
+  for (size_t s = 0; s < size; ++s) {
+    const Node &node = this->nodes[s];
+    if (node.op >= FAP_TAPE_ADD) {
+      this->userPtr[node.lhs + 1]++;
+      this->userPtr[node.rhs + 1] += node.rhs != node.lhs ? 1 : 0;
+    }
+  }
+  for (size_t s = 0; s < size; ++s) {
+    this->userPtr[s + 1] += this->userPtr[s];
+  }
+  this->users.resize(this->userPtr[size]);
+  ::std::vector<size_t> next(this->userPtr.begin(), this->userPtr.end() - 1);
+  for (size_t s = 0; s < size; ++s) {
+    const Node &node = this->nodes[s];
+    if (node.op >= FAP_TAPE_ADD) {
+      this->users[next[node.lhs]++] = s;
+      if (node.rhs != node.lhs) {
+        this->users[next[node.rhs]++] = s;
+      }
+    }
+  }
+}
+
+template<typename T>
+size_t ::fap::Tape<T>::update() {
+  this->buildUsers();
+  // The users follow their operands, so the smallest slot first evaluates
+  // each slot after all its operands
+  ::std::priority_queue<Slot, ::std::vector<Slot>, ::std::greater<Slot> >
+      queue(this->pending.begin(), this->pending.end());
+  this->pending.clear();
+  size_t evaluated = 0;
+  while (!queue.empty()) {
+    Slot slot = queue.top();
+    queue.pop();
+    this->changed[slot] = 0;
+    const Node &node = this->nodes[slot];
+    T res;
+    if (node.op < FAP_TAPE_ADD) {
+      res = TapeTraits<T>::load(this->sources[node.lhs], this->precs[slot]);
+    } else {
+      typename TapeTraits<T>::Scope scope(this->precs[slot]);
+      res = apply((FAP_tape_op)node.op, this->values[node.lhs],
+                  this->values[node.rhs]);
+      scope.fit(res);
+    }
+    evaluated++;
+    if (TapeTraits<T>::same(res, this->values[slot])) {
+      continue;
+    }
+    this->values[slot] = res;
+    for (size_t u = this->userPtr[slot]; u < this->userPtr[slot + 1]; ++u) {
+      Slot user = this->users[u];
+      if (!this->changed[user]) {
+        this->changed[user] = 1;
+        queue.push(user);
+      }
+    }
+  }
+  return evaluated;
+}
+
+template<typename T>
+void ::fap::Tape<T>::evaluate() {
+  for (Slot slot = 0; slot < this->nodes.size(); ++slot) {
+    this->touch(slot);
+  }
+  this->update();
+}
+
+template<typename T>
+void ::fap::Tape<T>::replay(const T *inputs, size_t batch,
+                            const Slot *outputs, size_t num_outputs,
+                            T *results, unsigned threads) const {
+  size_t chunks = (batch + FAP_TAPE_LANES - 1) / FAP_TAPE_LANES;
+  ::std::vector<size_t> bounds = evenShares(
+      chunks, batch * this->nodes.size() / FAP_TAPE_THREAD_WORK, threads);
+
+  size_t num_inputs = this->inputs.size();
+  parallelShares(bounds, [&](size_t begin, size_t end) {
+    // Values of the slots, the lanes of a slot are contiguous
+    ::std::vector<T> lanes(this->nodes.size() * FAP_TAPE_LANES);
+    for (size_t chunk = begin; chunk < end; ++chunk) {
+      size_t first = chunk * FAP_TAPE_LANES;
+      size_t count = ::std::min((size_t)FAP_TAPE_LANES, batch - first);
+      size_t input = 0;
+      for (Slot slot = 0; slot < this->nodes.size(); ++slot) {
+        const Node &node = this->nodes[slot];
+        T *res = &lanes[slot * FAP_TAPE_LANES];
+        if (node.op == FAP_TAPE_INPUT) {
+          for (size_t l = 0; l < count; ++l) {
+            res[l] = TapeTraits<T>::load(
+                inputs[(first + l) * num_inputs + input], this->precs[slot]);
+          }
+          input++;
+        } else if (node.op == FAP_TAPE_CONST) {
+          T val = TapeTraits<T>::load(this->sources[node.lhs],
+                                      this->precs[slot]);
+          for (size_t l = 0; l < count; ++l) {
+            res[l] = val;
+          }
+        } else {
+          typename TapeTraits<T>::Scope scope(this->precs[slot]);
+          const T *lhs = &lanes[node.lhs * FAP_TAPE_LANES];
+          const T *rhs = &lanes[node.rhs * FAP_TAPE_LANES];
+          for (size_t l = 0; l < count; ++l) {
+            res[l] = apply((FAP_tape_op)node.op, lhs[l], rhs[l]);
+            scope.fit(res[l]);
+          }
+        }
+      }
+      for (size_t l = 0; l < count; ++l) {
+        for (size_t o = 0; o < num_outputs; ++o) {
+          results[(first + l) * num_outputs + o] =
+              lanes[outputs[o] * FAP_TAPE_LANES + l];
+        }
+      }
+    }
+  });
+}
+
+template class ::fap::Tape<FloatingPointType>;
+template class ::fap::Tape<IntegerType>;
@@ -0,0 +1,56 @@
+//===- UnitBlockFloat.cpp ---------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitBlockFloat.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the block floating point arrays.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapBlockFloat.h"
+
+#include <math.h>
+
+using ::fap::BlockFloat;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+/// The specials are quantized to zero, leaving the exponent to the others
+FAP_TEST(blockfloat, specials) {
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+  FloatingPointType vals[] = { FloatingPointType(1e300, prec),
+                               FloatingPointType(1.5, prec),
+                               FloatingPointType(1.0, prec),
+                               FloatingPointType(-2.0, prec) };
+  vals[2].setInf();
+  vals[3].setNaN();
+  // The exponent of 1e300 is left behind by the first block
+  BlockFloat<int16_t> block(4, 2);
+  block.assign(vals, 4);
+  FAP_CHECK(block.getDouble(1) == 0.0);
+  FAP_CHECK(block.getMant(2) == 0 && block.getMant(3) == 0);
+  FAP_CHECK(block.getBlockExp(1) == FAP_BLOCK_ZERO_EXP);
+
+  const double natives[] = { 1.5, HUGE_VAL, NAN, -0.25 };
+  block.assign(natives, 4);
+  FAP_CHECK(block.getDouble(0) == 1.5 && block.getMant(1) == 0);
+  FAP_CHECK(block.getMant(2) == 0 && block.getDouble(3) == -0.25);
+}
@@ -0,0 +1,110 @@
+//===- UnitCodegen.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitCodegen.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the generated kernels against the replays of their
+///        tapes.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapCodegen.h"
+#include "FapContext.h"
+#include "FapSimd.h"
+
+#include <string.h>
+
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+namespace {
+
+/// @brief Sets of the kernels, not a multiple of the lanes
+const size_t batch_size = 203;
+
+FloatingPointType fromDouble(double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  return ::fap::unpackValue(
+      bits, FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE));
+}
+
+double toDouble(const FloatingPointType& val) {
+  uint64_t bits = ::fap::packValue(val);
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+/// @brief Tape of \p inputs, returning the slots of its operations
+vector<uint32_t> recordTape(::fap::Tape<FloatingPointType>& tape,
+                            const FloatingPointType* inputs) {
+  ::fap::TapeVar<FloatingPointType> x = tape.input(inputs[0]);
+  ::fap::TapeVar<FloatingPointType> y = tape.input(inputs[1]);
+  ::fap::TapeVar<FloatingPointType> z = tape.input(inputs[2]);
+  ::fap::TapeVar<FloatingPointType> a = x * y;
+  ::fap::TapeVar<FloatingPointType> b = a - z;
+  ::fap::TapeVar<FloatingPointType> c = b / y;
+  ::fap::TapeVar<FloatingPointType> d = c + x;
+  vector<uint32_t> slots = { a.getSlot(), b.getSlot(), c.getSlot(),
+                             d.getSlot() };
+  return slots;
+}
+
+}  // end anonymous namespace
+
+FAP_TEST(codegen, kernel) {
+  ::std::mt19937_64 rng(15);
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+  vector<double> sets(3 * batch_size);
+  vector<FloatingPointType> inputs(sets.size());
+  for (size_t i = 0; i < sets.size(); ++i) {
+    inputs[i] = ::fap::unit::randomValue(rng, prec);
+    sets[i] = toDouble(inputs[i]);
+  }
+  for (FAP_rounding_method method : ::fap::unit::roundings) {
+    ::fap::ArithmeticContext ctx(method);
+    ::fap::Tape<FloatingPointType> tape;
+    vector<uint32_t> slots = recordTape(tape, inputs.data());
+    // Narrower slots, on the exponent of a double
+    tape.setPrec(tape.getInputSlot(0), FloatPrecTy(DOUBLE_EXP_SIZE, 24));
+    tape.setPrec(slots[0], FloatPrecTy(DOUBLE_EXP_SIZE, 20));
+    tape.setPrec(slots[1], FloatPrecTy(DOUBLE_EXP_SIZE, 40));
+    tape.setPrec(slots[2], FloatPrecTy(DOUBLE_EXP_SIZE, 10));
+    tape.update();
+
+    ::fap::CompiledKernel kernel(tape, slots.data(), slots.size());
+    vector<double> results(slots.size() * batch_size);
+    kernel.run(sets.data(), batch_size, results.data(), 2);
+    vector<FloatingPointType> ref(results.size());
+    tape.replay(inputs.data(), batch_size, slots.data(), slots.size(),
+                ref.data(), 2);
+    for (size_t i = 0; i < results.size(); ++i) {
+      FAP_CHECK_VALUE(fromDouble(results[i]),
+                      ::fap::unit::quantize(ref[i], prec),
+                      ::std::string("kernel ")
+                      + ::fap::unit::roundingName(method));
+    }
+  }
+}
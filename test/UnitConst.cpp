@@ -0,0 +1,120 @@
+//===- UnitConst.cpp --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitConst.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of ConstFloat against FloatingPointType.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapConst.h"
+#include "FapContext.h"
+#include "FapSimd.h"
+
+#include <string.h>
+
+using ::fap::ConstFloat;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+namespace {
+
+/// @brief Narrower and wider precisions than a double
+const FloatPrecTy precs[] = { FloatPrecTy(5, 10), FloatPrecTy(8, 23),
+                              FloatPrecTy(8, 7), FloatPrecTy(11, 30),
+                              FloatPrecTy(11, 52), FloatPrecTy(11, 80),
+                              FloatPrecTy(15, 112) };
+
+double randomDouble(::std::mt19937_64& rng) {
+  uint64_t bits = ::fap::packValue(::fap::unit::randomValue(
+      rng, FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE)));
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+// Quantized by the compiler
+constexpr double coefficients[] = { 0.1, -0.75, 1.0 / 3.0, 1e-300 };
+constexpr ::fap::ConstFloatTable<4> table =
+    ::fap::quantizeTable(coefficients, FloatPrecTy(11, 7));
+static_assert(table[1].getMant() == 0x40 && table[1].getSign() == 1,
+              "-0.75 is exact on 7 bits of mantissa");
+static_assert((double)(ConstFloat(1.0) / ConstFloat(3.0)) == 1.0 / 3.0,
+              "the quotient of doubles rounds to nearest");
+
+}  // end anonymous namespace
+
+FAP_TEST(const, conversions) {
+  ::std::mt19937_64 rng(21);
+  for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+    double d = randomDouble(rng);
+    float f = (float)d;
+    for (FloatPrecTy prec : precs) {
+      for (FAP_rounding_method method : ::fap::unit::roundings) {
+        ::fap::ArithmeticContext ctx(method);
+        FAP_CHECK_VALUE(FloatingPointType(ConstFloat(d, prec, method)),
+                        FloatingPointType(d, prec),
+                        ::std::string("from double, ")
+                        + ::fap::unit::roundingName(method));
+        FAP_CHECK_VALUE(FloatingPointType(ConstFloat(f, prec, method)),
+                        FloatingPointType(f, prec),
+                        ::std::string("from float, ")
+                        + ::fap::unit::roundingName(method));
+      }
+      ConstFloat val(d, prec);
+      FloatingPointType ref(d, prec);
+      FAP_CHECK_VALUE(FloatingPointType((double)val),
+                      FloatingPointType((double)ref), "to double");
+      FAP_CHECK_VALUE(FloatingPointType((float)val),
+                      FloatingPointType((float)ref), "to float");
+    }
+  }
+}
+
+FAP_TEST(const, operators) {
+  ::std::mt19937_64 rng(22);
+  for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+    double lhs = randomDouble(rng), rhs = randomDouble(rng);
+    for (FloatPrecTy prec : precs) {
+      ConstFloat a(lhs, prec), b(rhs, prec);
+      FloatingPointType x(lhs, prec), y(rhs, prec);
+      FAP_CHECK_VALUE(FloatingPointType(a + b), x + y, "add");
+      FAP_CHECK_VALUE(FloatingPointType(a - b), x - y, "sub");
+      FAP_CHECK_VALUE(FloatingPointType(a * b), x * y, "mul");
+      FAP_CHECK_VALUE(FloatingPointType(a / b), x / y, "div");
+    }
+  }
+}
+
+FAP_TEST(const, table) {
+  for (size_t i = 0; i < table.size(); ++i) {
+    FAP_CHECK_VALUE(FloatingPointType(table[i]),
+                    FloatingPointType(coefficients[i], FloatPrecTy(11, 7)),
+                    "quantizeTable");
+  }
+}
+
+FAP_TEST(const, subnormal_guard) {
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, 80);
+  ConstFloat res = ConstFloat(-0x1.91eff4bb9770cp-425, prec)
+      / ConstFloat(0x1.40f098989a2d5p+678, prec);
+  FAP_CHECK(res.getSign() == 1 && res.getExp() == 0 && res.getMant() == 1);
+}
@@ -0,0 +1,212 @@
+//===- UnitDecimal.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitDecimal.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the decimal formatting and parsing, against the C
+///        library conversions.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapDecimal.h"
+
+#include <fenv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::string;
+
+namespace {
+
+const FloatPrecTy decimal_precs[] = { FloatPrecTy(8, 23), FloatPrecTy(11, 52),
+                                      FloatPrecTy(5, 10), FloatPrecTy(4, 3),
+                                      FloatPrecTy(15, 64),
+                                      ::fap::PREC_BINARY128 };
+
+/// @brief Significant digits of a decimal string, without the leading and
+/// trailing zeroes
+size_t significantDigits(const string& str) {
+  string digits;
+  for (char c : str) {
+    if (c == 'e' || c == 'E') {
+      break;
+    }
+    if (c >= '0' && c <= '9') {
+      digits += c;
+    }
+  }
+  size_t first = digits.find_first_not_of('0');
+  if (first == string::npos) {
+    return 0;
+  }
+  return digits.find_last_not_of('0') - first + 1;
+}
+
+/// @brief Rounding mode of the C library for \p method
+int fenvRounding(FAP_rounding_method method) {
+  switch (method) {
+  case FAP_FP_ROUND_TOWARD_0:
+    return FE_TOWARDZERO;
+  case FAP_FP_ROUND_TOWARD_PINF:
+    return FE_UPWARD;
+  case FAP_FP_ROUND_TOWARD_NINF:
+    return FE_DOWNWARD;
+  default:
+    return FE_TONEAREST;
+  }
+}
+
+/// @brief Random decimal string of up to 30 digits, with an exponent in
+/// [\p min_exp, \p max_exp]
+string randomDecimal(::std::mt19937_64& rng, int min_exp, int max_exp) {
+  string str = (rng() & 0x01) ? "-" : "";
+  size_t n_digits = 1 + rng() % 30;
+  str += (char)('1' + rng() % 9);
+  str += '.';
+  for (size_t i = 1; i < n_digits; ++i) {
+    // Runs of nines and zeroes give the values close to the boundaries
+    switch (rng() % 4) {
+    case 0:
+      str += '0';
+      break;
+    case 1:
+      str += '9';
+      break;
+    default:
+      str += (char)('0' + rng() % 10);
+      break;
+    }
+  }
+  int exp = min_exp + (int)(rng() % (uint64_t)(max_exp - min_exp + 1));
+  return str + "e" + ::std::to_string(exp);
+}
+
+}  // end anonymous namespace
+
+/// The shortest strings are parsed back to the same value, on any precision
+FAP_TEST(decimal, round_trip) {
+  ::std::mt19937_64 rng(26);
+  for (FloatPrecTy prec : decimal_precs) {
+    for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+      FloatingPointType val = ::fap::unit::randomValue(rng, prec);
+      string str = ::fap::toDecimalString(val);
+      const char* end;
+      FloatingPointType back = ::fap::parseDecimal(str.c_str(), prec,
+                                                   FAP_FP_ROUND_NEAREST, &end);
+      FAP_CHECK_VALUE(back, val, "\"" + str + "\"");
+      FAP_CHECK(end == str.c_str() + str.size());
+    }
+  }
+}
+
+/// On double no decimal string with a digit less parses back to the same
+/// value: neither of the two around it, printed toward -inf and +inf
+FAP_TEST(decimal, shortest) {
+  ::std::mt19937_64 rng(27);
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+  const int directions[] = { FE_DOWNWARD, FE_UPWARD };
+  for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+    FloatingPointType val = ::fap::unit::randomValue(rng, prec);
+    if (val.isNaN() || val.isInf() || val.isZero()) {
+      continue;
+    }
+    double ref = (double)val;
+    char buf[FAP_DECIMAL_BUFFER_SIZE];
+    size_t len = ::fap::formatDecimal(val, buf);
+    FAP_CHECK(len == strlen(buf));
+    FAP_CHECK(strtod(buf, nullptr) == ref);
+    int digits = (int)significantDigits(buf);
+    FAP_CHECK_MSG(digits <= 17, buf);
+    for (int direction : directions) {
+      if (digits <= 1) {
+        break;
+      }
+      char shorter[FAP_DECIMAL_BUFFER_SIZE];
+      fesetround(direction);
+      snprintf(shorter, sizeof(shorter), "%.*e", digits - 2, ref);
+      fesetround(FE_TONEAREST);
+      FAP_CHECK_MSG(strtod(shorter, nullptr) != ref,
+                    string(buf) + " is longer than " + shorter);
+    }
+  }
+}
+
+/// The parsing is correctly rounded in each rounding, as strtof and strtod
+FAP_TEST(decimal, parse) {
+  ::std::mt19937_64 rng(28);
+  for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+    string flt_str = randomDecimal(rng, -47, 39);
+    string dbl_str = randomDecimal(rng, -326, 309);
+    for (FAP_rounding_method method : ::fap::unit::roundings) {
+      fesetround(fenvRounding(method));
+      float flt_ref = strtof(flt_str.c_str(), nullptr);
+      double dbl_ref = strtod(dbl_str.c_str(), nullptr);
+      fesetround(FE_TONEAREST);
+      float flt = (float)(double)::fap::parseDecimal(
+          flt_str.c_str(), FloatPrecTy(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE),
+          method);
+      double dbl = (double)::fap::parseDecimal(
+          dbl_str.c_str(), FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE),
+          method);
+      FAP_CHECK_MSG(memcmp(&flt, &flt_ref, sizeof(float)) == 0,
+                    flt_str + " " + ::fap::unit::roundingName(method));
+      FAP_CHECK_MSG(memcmp(&dbl, &dbl_ref, sizeof(double)) == 0,
+                    dbl_str + " " + ::fap::unit::roundingName(method));
+    }
+  }
+}
+
+FAP_TEST(decimal, specials) {
+  FloatPrecTy prec(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE);
+  const char* rest;
+  FAP_CHECK(::fap::parseDecimal("inf", prec).isInf());
+  FloatingPointType neg_inf = ::fap::parseDecimal("-Infinity", prec);
+  FAP_CHECK(neg_inf.isInf() && neg_inf.getSign() != 0);
+  FAP_CHECK(::fap::parseDecimal("NaN", prec).isNaN());
+  FloatingPointType neg_zero = ::fap::parseDecimal("-0.0e12", prec);
+  FAP_CHECK(neg_zero.isZero() && neg_zero.getSign() != 0);
+  const char* bad = "e5";
+  ::fap::parseDecimal(bad, prec, FAP_FP_ROUND_NEAREST, &rest);
+  FAP_CHECK(rest == bad);
+  FAP_CHECK(::fap::toDecimalString(neg_inf)[0] == '-');
+}
+
+/// The lists are written and read back with their separator
+FAP_TEST(decimal, lists) {
+  ::std::mt19937_64 rng(29);
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+  ::std::vector<FloatingPointType> vals, back;
+  for (int i = 0; i < 100; ++i) {
+    vals.push_back(::fap::unit::randomValue(rng, prec));
+  }
+  string out;
+  ::fap::formatDecimal(vals.data(), vals.size(), out, ';');
+  FAP_CHECK(::fap::parseDecimal(out.c_str(), out.size(), prec, back, ';') ==
+            vals.size());
+  FAP_CHECK(back.size() == vals.size());
+  for (size_t i = 0; i < vals.size() && i < back.size(); ++i) {
+    FAP_CHECK_VALUE(back[i], vals[i], "list");
+  }
+}
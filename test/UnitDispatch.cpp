@@ -0,0 +1,158 @@
+//===- UnitDispatch.cpp -----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitDispatch.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the batches dispatched to the precision-specialized
+///        kernels against the operators.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapDispatch.h"
+
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::fap::IntegerPrecision;
+using ::fap::IntegerType;
+using ::std::vector;
+
+namespace {
+
+/// @brief Precisions with a specialized kernel, and others
+const FloatPrecTy precs[] = { FloatPrecTy(5, 10), FloatPrecTy(8, 23),
+                              FloatPrecTy(11, 52), FloatPrecTy(8, 7),
+                              FloatPrecTy(11, 30), FloatPrecTy(4, 3),
+                              FloatPrecTy(6, 20) };
+
+/// @brief Size of the batches, split on two workers
+const size_t batch_size = 203;
+
+/// @brief Actual precisions of the 64 bits IntegerType operands
+const IntegerPrecision int_precs[] = { 64, 63, 59, 48, 24 };
+
+/// @brief Random IntegerType of \p prec, with few significant bits and
+/// zeroes once in a while
+IntegerType randomInteger(::std::mt19937_64& rng, IntegerPrecision prec) {
+  int64_t val = (int64_t)(rng() >> (1 + rng() % 63));
+  switch (rng() % 8) {
+  case 0:
+    val = 0;
+    break;
+  case 1:
+    // Zero once the neglected bits are cleared
+    val &= 0xff;
+    break;
+  default:
+    break;
+  }
+  if (rng() & 0x01) {
+    val = -val;
+  }
+  return IntegerType(val, prec, (rng() % 4) != 0);
+}
+
+::std::string describe(const IntegerType& val) {
+  return ::std::to_string((long long)val.getBits()) + " [" +
+         ::std::to_string(val.getOriPrecision()) + "->" +
+         ::std::to_string(val.getActualPrecision()) + "][" +
+         ::std::to_string(val.getNeglectedBitsStatus()) +
+         (val.isCompensate() ? "][c]" : "]");
+}
+
+bool sameInteger(const IntegerType& lhs, const IntegerType& rhs) {
+  return lhs.getBits() == rhs.getBits() &&
+         lhs.getOriPrecision() == rhs.getOriPrecision() &&
+         lhs.getActualPrecision() == rhs.getActualPrecision() &&
+         lhs.getNeglectedBitsStatus() == rhs.getNeglectedBitsStatus() &&
+         lhs.isCompensate() == rhs.isCompensate();
+}
+
+}  // end anonymous namespace
+
+FAP_TEST(dispatch, float) {
+  ::std::mt19937_64 rng(11);
+  for (FloatPrecTy prec : precs) {
+    vector<FloatingPointType> lhs, rhs;
+    for (size_t i = 0; i < batch_size; ++i) {
+      lhs.push_back(::fap::unit::randomValue(rng, prec));
+      rhs.push_back(::fap::unit::randomValue(rng, prec));
+    }
+    vector<FloatingPointType> res(batch_size);
+    for (FAP_rounding_method method : ::fap::unit::roundings) {
+      ::fap::ArithmeticContext ctx(method);
+      for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+        ::fap::batchOp((FAP_batch_op)op, lhs.data(), rhs.data(), res.data(),
+                       batch_size, 2);
+        for (size_t i = 0; i < batch_size; ++i) {
+          FloatingPointType ref =
+              ::fap::unit::apply((FAP_batch_op)op, lhs[i], rhs[i]);
+          FAP_CHECK_VALUE(res[i], ref, ::std::string("batchOp ")
+                          + ::fap::unit::roundingName(method));
+        }
+      }
+    }
+  }
+}
+
+/// The kernel is selected by the first element, the others have its
+/// precision or fall back on the operators
+FAP_TEST(dispatch, integer) {
+  ::std::mt19937_64 rng(12);
+  const size_t n_precs = sizeof(int_precs) / sizeof(int_precs[0]);
+  for (IntegerPrecision prec : int_precs) {
+    vector<IntegerType> lhs, rhs;
+    for (size_t i = 0; i < batch_size; ++i) {
+      bool same = i == 0 || rng() % 4 != 0;
+      lhs.push_back(randomInteger(rng, same ? prec
+                                            : int_precs[rng() % n_precs]));
+      rhs.push_back(randomInteger(rng, same ? prec
+                                            : int_precs[rng() % n_precs]));
+    }
+    vector<IntegerType> res(batch_size);
+    for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+      ::fap::batchOp((FAP_batch_op)op, lhs.data(), rhs.data(), res.data(),
+                     batch_size, 2);
+      for (size_t i = 0; i < batch_size; ++i) {
+        IntegerType ref = lhs[i];
+        switch (op) {
+        case FAP_BATCH_ADD:
+          ref += rhs[i];
+          break;
+        case FAP_BATCH_SUB:
+          ref -= rhs[i];
+          break;
+        case FAP_BATCH_MUL:
+          ref *= rhs[i];
+          break;
+        default:
+          ref /= rhs[i];
+          break;
+        }
+        FAP_CHECK_MSG(sameInteger(res[i], ref),
+                      "batchOp " + ::std::to_string(op) + ": " +
+                          describe(res[i]) + " instead of " + describe(ref));
+      }
+    }
+  }
+}
@@ -0,0 +1,187 @@
+//===- UnitErrorStats.cpp ---------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitErrorStats.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the error statistics: merged shares against a single
+///        pass and against exact moments, non finite errors, parallel measures.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapErrorStats.h"
+
+#include <math.h>
+#include <vector>
+
+using ::fap::ErrorStats;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+namespace {
+
+/// @brief Relative tolerance of the moments summed in other orders
+const double moment_tol = 1e-12;
+
+bool closeTo(double val, double ref) {
+  return val == ref || fabs(val - ref) <= moment_tol * fabs(ref);
+}
+
+/// @brief Outputs of \p n references with errors of a few ULPs of a
+/// binary32, spread on the ULP bins, a tenth of them exact
+void randomStream(::std::mt19937_64& rng, size_t n, vector<double>& out,
+                  vector<double>& ref) {
+  ::std::uniform_real_distribution<double> unit(-1.0, 1.0);
+  ::std::uniform_int_distribution<int> scale(-10, 6);
+  for (size_t i = 0; i < n; ++i) {
+    double val = ldexp(unit(rng), scale(rng));
+    ref.push_back(val);
+    out.push_back(rng() % 10 == 0
+                      ? val
+                      : val + ldexp(unit(rng) * fabs(val), scale(rng) - 24));
+  }
+}
+
+/// @brief Check that \p merged has the counts, the maximums and the
+/// histogram of \p single, and its moments up to the summation order
+void checkSame(const ErrorStats& merged, const ErrorStats& single,
+               const ::std::string& what) {
+  FAP_CHECK_MSG(merged.getCount() == single.getCount(), what + ": count");
+  FAP_CHECK_MSG(merged.getNonFinite() == single.getNonFinite(),
+                what + ": non finite");
+  FAP_CHECK_MSG(merged.getMaxAbs() == single.getMaxAbs(), what + ": max abs");
+  FAP_CHECK_MSG(merged.getMaxRel() == single.getMaxRel(), what + ": max rel");
+  for (int bin = 0; bin < FAP_ERROR_ULP_BINS; ++bin) {
+    FAP_CHECK_MSG(merged.getUlpCount(bin) == single.getUlpCount(bin),
+                  what + ": ULP bin " + ::std::to_string(bin));
+  }
+  FAP_CHECK_MSG(closeTo(merged.getMeanError(), single.getMeanError()),
+                what + ": mean");
+  FAP_CHECK_MSG(closeTo(merged.getErrorVariance(),
+                        single.getErrorVariance()),
+                what + ": variance");
+  FAP_CHECK_MSG(closeTo(merged.getMse(), single.getMse()), what + ": mse");
+  FAP_CHECK_MSG(closeTo(merged.getNormRel(), single.getNormRel()),
+                what + ": norm rel");
+}
+
+}  // end anonymous namespace
+
+/// The moments of a single pass against the exact ones, in long double
+FAP_TEST(errorstats, moments) {
+  ::std::mt19937_64 rng(71);
+  vector<double> out, ref;
+  randomStream(rng, 10000, out, ref);
+  ErrorStats stats(FloatPrecTy(8, 23));
+  long double sum = 0.0L, sum_sq = 0.0L, sum_ref_sq = 0.0L;
+  double max_abs = 0.0;
+  for (size_t i = 0; i < out.size(); ++i) {
+    stats.add(out[i], ref[i]);
+    long double err = (long double)out[i] - ref[i];
+    sum += err;
+    sum_sq += err * err;
+    sum_ref_sq += (long double)ref[i] * ref[i];
+    max_abs = fabs(out[i] - ref[i]) > max_abs ? fabs(out[i] - ref[i])
+                                              : max_abs;
+  }
+  long double n = out.size();
+  long double mean = sum / n;
+  long double var = (sum_sq - n * mean * mean) / (n - 1);
+  FAP_CHECK(stats.getCount() == out.size());
+  FAP_CHECK(stats.getMaxAbs() == max_abs);
+  FAP_CHECK(closeTo(stats.getMeanError(), (double)mean));
+  FAP_CHECK(closeTo(stats.getErrorVariance(), (double)var));
+  FAP_CHECK(closeTo(stats.getMse(), (double)(sum_sq / n)));
+  FAP_CHECK(closeTo(stats.getNormRel(), (double)sqrtl(sum_sq / sum_ref_sq)));
+  uint64_t binned = 0;
+  for (int bin = 0; bin < FAP_ERROR_ULP_BINS; ++bin) {
+    binned += stats.getUlpCount(bin);
+  }
+  FAP_CHECK(binned == out.size());
+}
+
+/// Shares of random sizes, accounted one by one or in blocks and merged,
+/// against a single pass
+FAP_TEST(errorstats, merge) {
+  ::std::mt19937_64 rng(73);
+  for (int round = 0; round < 20; ++round) {
+    vector<double> out, ref;
+    randomStream(rng, 5000, out, ref);
+    if (round % 2) {
+      // A NaN and an infinity of error, and an exact infinity
+      out[rng() % out.size()] = NAN;
+      out[rng() % out.size()] = INFINITY;
+      ref[0] = out[0] = -INFINITY;
+    }
+    ErrorStats single(FloatPrecTy(8, 23));
+    for (size_t i = 0; i < out.size(); ++i) {
+      single.add(out[i], ref[i]);
+    }
+    ErrorStats merged(FloatPrecTy(8, 23));
+    ErrorStats blocks(FloatPrecTy(8, 23));
+    size_t begin = 0;
+    while (begin < out.size()) {
+      size_t end = ::std::min(out.size(), begin + 1 + rng() % 1200);
+      ErrorStats share(FloatPrecTy(8, 23));
+      for (size_t i = begin; i < end; ++i) {
+        share.add(out[i], ref[i]);
+      }
+      merged.merge(share);
+      blocks.add(out.data() + begin, ref.data() + begin, end - begin);
+      begin = end;
+    }
+    ::std::string what = "round " + ::std::to_string(round);
+    checkSame(merged, single, what + ", merged");
+    checkSame(blocks, single, what + ", blocks");
+    if (round % 2) {
+      FAP_CHECK(single.getNonFinite() == 2);
+      FAP_CHECK(isinf(single.getMse()) && isinf(single.getMaxAbs()));
+    }
+  }
+}
+
+/// The statistics do not depend on the workers of measureError()
+FAP_TEST(errorstats, measure) {
+  const uint64_t samples = 3 * FAP_ERROR_THREAD_WORK;
+  auto reference = [](uint64_t first, size_t n, double* out) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = sin((double)(first + i));
+    }
+  };
+  auto approx = [](uint64_t first, size_t n, double* out) {
+    for (size_t i = 0; i < n; ++i) {
+      // sin() rounded to nearest on 16 bits of significand
+      int exp2;
+      double frac = frexp(sin((double)(first + i)), &exp2);
+      out[i] = (double)FloatingPointType::fromSignificand(
+          frac < 0, (MantType)ldexp(fabs(frac), 53), exp2 - 53, false,
+          FloatPrecTy(8, 15));
+    }
+  };
+  ErrorStats single = ::fap::measureError(samples, 1, FloatPrecTy(8, 15),
+                                          reference, approx, 1);
+  ErrorStats shared = ::fap::measureError(samples, 1, FloatPrecTy(8, 15),
+                                          reference, approx, 3);
+  FAP_CHECK(single.getCount() == samples);
+  // Rounded to nearest, within 1/2 ULP
+  FAP_CHECK(single.getUlpCount(0) + single.getUlpCount(1) == samples);
+  checkSame(shared, single, "3 workers");
+}
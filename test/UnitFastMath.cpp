@@ -0,0 +1,151 @@
+//===- UnitFastMath.cpp -----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitFastMath.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the fast math flags of the context against the
+///        operators without flags, on flushed operands and results.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+
+#include <vector>
+
+using ::fap::ArithmeticContext;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+namespace {
+
+const FloatPrecTy fast_precs[] = { FloatPrecTy(5, 10), FloatPrecTy(8, 23),
+                                   FloatPrecTy(11, 52), FloatPrecTy(6, 17) };
+
+/// @brief \p val, a subnormal flushed to the zero of its sign
+FloatingPointType flushed(const FloatingPointType& val) {
+  FloatingPointType res = val;
+  if (res.isSubN()) {
+    res.setZero();
+  }
+  return res;
+}
+
+/// @brief lhs op rhs with the fast math \p flags, built from the operators
+/// without flags
+FloatingPointType reference(FAP_batch_op op, const FloatingPointType& lhs,
+                            const FloatingPointType& rhs, uint8_t flags) {
+  FloatingPointType lhs_in = lhs;
+  FloatingPointType rhs_in = rhs;
+  if (flags & FAP_FAST_MATH_DAZ) {
+    lhs_in = flushed(lhs);
+    rhs_in = flushed(rhs);
+  }
+  FloatingPointType res = ::fap::unit::apply(op, lhs_in, rhs_in);
+  if (flags & FAP_FAST_MATH_FTZ) {
+    res = flushed(res);
+  }
+  if (flags & FAP_FAST_MATH_FINITE) {
+    if (res.isNaN()) {
+      // Only 0/0 on finite operands, it gives 0
+      res.setSign(lhs.getSign() != rhs.getSign());
+      res.setZero();
+    } else if (res.isInf()) {
+      // Greatest finite value
+      res.setExp(MASK_LOWER_HIGH(ExpType, res.getPrec().exp_size) - 1);
+      res.setMant(MASK_LOWER_HIGH(MantType, res.getPrec().mant_size));
+    }
+  }
+  return res;
+}
+
+/// @brief Random operands of \p prec, finite when the fast math \p flags
+/// assume them
+FloatingPointType randomOperand(::std::mt19937_64& rng, FloatPrecTy prec,
+                                uint8_t flags) {
+  FloatingPointType val = ::fap::unit::randomValue(rng, prec);
+  while ((flags & FAP_FAST_MATH_FINITE) && (val.isNaN() || val.isInf())) {
+    val = ::fap::unit::randomValue(rng, prec);
+  }
+  return val;
+}
+
+}  // end anonymous namespace
+
+/// Each combination of the flags, in each rounding, against the reference
+FAP_TEST(fastmath, operators) {
+  ::std::mt19937_64 rng(61);
+  for (FloatPrecTy prec : fast_precs) {
+    for (uint8_t flags = 1; flags <= FAP_FAST_MATH_ALL; ++flags) {
+      for (FAP_rounding_method method : ::fap::unit::roundings) {
+        for (int i = 0; i < FAP_UNIT_CASES / 4; ++i) {
+          FloatingPointType lhs = randomOperand(rng, prec, flags);
+          FloatingPointType rhs = randomOperand(rng, prec, flags);
+          for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+            FAP_batch_op batch_op = (FAP_batch_op)op;
+            FloatingPointType ref;
+            FloatingPointType res;
+            {
+              ArithmeticContext ctx(method);
+              ref = reference(batch_op, lhs, rhs, flags);
+            }
+            {
+              ArithmeticContext ctx(method);
+              ctx.setFastMath(flags);
+              res = ::fap::unit::apply(batch_op, lhs, rhs);
+            }
+            FAP_CHECK_VALUE(res, ref,
+                            ::fap::unit::describe(lhs) + " op " +
+                                ::std::to_string(op) + " " +
+                                ::fap::unit::describe(rhs) + ", flags " +
+                                ::std::to_string(flags) + ", " +
+                                ::fap::unit::roundingName(method));
+          }
+        }
+      }
+    }
+  }
+}
+
+/// The batches give the results of the operators under the same flags
+FAP_TEST(fastmath, batch) {
+  const size_t n = 1024;
+  ::std::mt19937_64 rng(67);
+  for (uint8_t flags = 1; flags <= FAP_FAST_MATH_ALL; ++flags) {
+    vector<FloatingPointType> lhs, rhs;
+    for (size_t i = 0; i < n; ++i) {
+      lhs.push_back(randomOperand(rng, FloatPrecTy(8, 23), flags));
+      rhs.push_back(randomOperand(rng, FloatPrecTy(8, 23), flags));
+    }
+    ArithmeticContext ctx(FAP_FP_ROUND_NEAREST);
+    ctx.setFastMath(flags);
+    for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+      vector<FloatingPointType> res(n);
+      ::fap::batchOp((FAP_batch_op)op, lhs.data(), rhs.data(), res.data(), n);
+      for (size_t i = 0; i < n; ++i) {
+        FAP_CHECK_VALUE(res[i],
+                        ::fap::unit::apply((FAP_batch_op)op, lhs[i], rhs[i]),
+                        "element " + ::std::to_string(i) + ", flags " +
+                            ::std::to_string(flags));
+      }
+    }
+  }
+}
@@ -0,0 +1,56 @@
+//===- UnitFft.cpp ----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitFft.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the fast Fourier transforms.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapFft.h"
+
+#include <math.h>
+
+#include <vector>
+
+using ::fap::Complex;
+using ::fap::FixedPoint;
+using ::fap::FixedPrecTy;
+using ::std::vector;
+
+/// The transform of a unit impulse at 1 gives the twiddles, rounded once
+/// from the long double values on a format wider than a double
+FAP_TEST(fft, fixed_twiddles) {
+  const size_t n = 8;
+  FixedPrecTy prec(2, 60);
+  FixedPoint zero(0.0, prec), one(1.0, prec);
+  vector<Complex<FixedPoint> > data(n, Complex<FixedPoint>(zero, zero));
+  data[1].setReal(one);
+  ::fap::fft(data.data(), n);
+  for (size_t k = 0; k < n; ++k) {
+    long double angle = -2.0L * 3.141592653589793238462643383279502884L *
+                        (long double)k / (long double)n;
+    long double re = ldexpl(cosl(angle), prec.frac_size);
+    long double im = ldexpl(sinl(angle), prec.frac_size);
+    FAP_CHECK(fabsl((long double)data[k].real().getBits() - re) <= 0.5L);
+    FAP_CHECK(fabsl((long double)data[k].imag().getBits() - im) <= 0.5L);
+  }
+}
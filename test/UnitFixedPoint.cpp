@@ -0,0 +1,217 @@
+//===- UnitFixedPoint.cpp ---------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitFixedPoint.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the fixed point conversions, operators and batch
+///        kernels against exact references, in each rounding.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapFixedPoint.h"
+
+#include <math.h>
+#include <vector>
+
+using ::fap::FixedPoint;
+using ::fap::FixedPrecTy;
+using ::std::vector;
+
+namespace {
+
+/// @brief Formats whose products are exact on a long double
+const FixedPrecTy fixed_precs[] = { FixedPrecTy(7, 8), FixedPrecTy(15, 16),
+                                    FixedPrecTy(0, 31), FixedPrecTy(20, 3) };
+
+int64_t maxBits(FixedPrecTy prec) {
+  return (int64_t)((1ULL << (prec.int_size + prec.frac_size)) - 1);
+}
+
+/// @brief Exact \p val saturated on \p prec
+int64_t saturate(int128_t val, FixedPrecTy prec) {
+  int64_t max = maxBits(prec);
+  return val > max ? max : (val < -max - 1 ? -max - 1 : (int64_t)val);
+}
+
+/// @brief \p val rounded to an integer with \p method
+long double roundInteger(long double val, FAP_rounding_method method) {
+  switch (method) {
+  case FAP_FP_ROUND_TOWARD_0:
+    return truncl(val);
+  case FAP_FP_ROUND_TOWARD_PINF:
+    return ceill(val);
+  case FAP_FP_ROUND_TOWARD_NINF:
+    return floorl(val);
+  default:
+    // The default environment rounds to nearest even
+    return nearbyintl(val);
+  }
+}
+
+/// @brief Exact quotient \p num / \p den rounded with \p method
+int128_t roundQuotient(int128_t num, int128_t den,
+                       FAP_rounding_method method) {
+  int128_t floor = num / den;
+  if (num % den != 0 && ((num % den < 0) != (den < 0))) {
+    --floor;
+  }
+  int128_t rem = num - floor * den;
+  if (rem == 0) {
+    return floor;
+  }
+  // rem / den in (0, 1)
+  int128_t twice = 2 * (rem < 0 ? -rem : rem);
+  int128_t mag = den < 0 ? -den : den;
+  switch (method) {
+  case FAP_FP_ROUND_TOWARD_0:
+    return floor < 0 ? floor + 1 : floor;
+  case FAP_FP_ROUND_TOWARD_PINF:
+    return floor + 1;
+  case FAP_FP_ROUND_TOWARD_NINF:
+    return floor;
+  default:
+    return twice > mag || (twice == mag && (floor & 0x01) != 0) ? floor + 1
+                                                                : floor;
+  }
+}
+
+/// @brief Random bits of \p prec, with few significant bits and zeroes
+/// once in a while
+int64_t randomBits(::std::mt19937_64& rng, FixedPrecTy prec) {
+  if (rng() % 8 == 0) {
+    return 0;
+  }
+  int size = prec.int_size + prec.frac_size;
+  int64_t bits = (int64_t)(rng() >> (64 - size + rng() % size));
+  return (rng() & 0x01) ? -bits - (int64_t)(rng() & 0x01) : bits;
+}
+
+::std::string context(FixedPrecTy prec, FAP_rounding_method method,
+                      const char* what) {
+  return ::std::string(what) + " Q" + ::std::to_string(prec.int_size) +
+         "." + ::std::to_string(prec.frac_size) + " " +
+         ::fap::unit::roundingName(method);
+}
+
+}  // end anonymous namespace
+
+FAP_TEST(fixed, conversion) {
+  ::std::mt19937_64 rng(29);
+  for (FixedPrecTy prec : fixed_precs) {
+    for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+      // Magnitudes around the format, out of it once in a while
+      double val = ldexp((double)(int64_t)rng(),
+                         (int)(rng() % 48) - 63 - prec.frac_size);
+      for (FAP_rounding_method method : ::fap::unit::roundings) {
+        long double scaled = roundInteger(ldexpl(val, prec.frac_size),
+                                          method);
+        int64_t ref = fabsl(scaled) > ldexpl(1.0L, 62)
+                          ? (scaled < 0 ? -maxBits(prec) - 1 : maxBits(prec))
+                          : saturate((int128_t)scaled, prec);
+        FixedPoint fx(val, prec, method);
+        FAP_CHECK_MSG(fx.getBits() == ref, context(prec, method, "double"));
+        FixedPoint from_fp(::fap::FloatingPointType(val), prec, method);
+        FAP_CHECK_MSG(from_fp.getBits() == ref,
+                      context(prec, method, "FloatingPointType"));
+        FAP_CHECK_MSG((double)FixedPoint::fromBits(ref, prec) ==
+                          ldexp((double)ref, -prec.frac_size),
+                      context(prec, method, "to double"));
+      }
+    }
+  }
+}
+
+FAP_TEST(fixed, operators) {
+  ::std::mt19937_64 rng(30);
+  for (FixedPrecTy prec : fixed_precs) {
+    for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+      int64_t a = randomBits(rng, prec), b = randomBits(rng, prec);
+      for (FAP_rounding_method method : ::fap::unit::roundings) {
+        FixedPoint lhs = FixedPoint::fromBits(a, prec, method);
+        FixedPoint rhs = FixedPoint::fromBits(b, prec, method);
+        FAP_CHECK_MSG((lhs + rhs).getBits() == saturate((int128_t)a + b, prec),
+                      context(prec, method, "add"));
+        FAP_CHECK_MSG((lhs - rhs).getBits() == saturate((int128_t)a - b, prec),
+                      context(prec, method, "sub"));
+        long double prod = roundInteger(
+            ldexpl((long double)((int128_t)a * b), -prec.frac_size), method);
+        FAP_CHECK_MSG((lhs * rhs).getBits() == saturate((int128_t)prod, prec),
+                      context(prec, method, "mul"));
+        int64_t quot;
+        if (b == 0) {
+          // Division by zero saturates, 0/0 gives 0
+          quot = a == 0 ? 0 : (a < 0 ? -maxBits(prec) - 1 : maxBits(prec));
+        } else {
+          quot = saturate(roundQuotient((int128_t)a << prec.frac_size, b,
+                                        method),
+                          prec);
+        }
+        FAP_CHECK_MSG((lhs / rhs).getBits() == quot,
+                      context(prec, method, "div"));
+      }
+    }
+  }
+}
+
+FAP_TEST(fixed, wrap) {
+  FixedPrecTy prec(7, 8);
+  FixedPoint max = FixedPoint::fromBits(maxBits(prec), prec,
+                                        FAP_FP_ROUND_NEAREST,
+                                        FAP_FX_OVERFLOW_WRAP);
+  FixedPoint lsb = FixedPoint::fromBits(1, prec, FAP_FP_ROUND_NEAREST,
+                                        FAP_FX_OVERFLOW_WRAP);
+  FAP_CHECK((max + lsb).getBits() == -maxBits(prec) - 1);
+  FAP_CHECK((-max - lsb - lsb).getBits() == maxBits(prec));
+  FixedPoint two(2.0, prec, FAP_FP_ROUND_NEAREST, FAP_FX_OVERFLOW_WRAP);
+  FAP_CHECK((max * two).getBits() == -2);
+}
+
+/// The batch kernels give the results of the operators, the dot product is
+/// rounded once
+FAP_TEST(fixed, batch) {
+  ::std::mt19937_64 rng(31);
+  const size_t n = 100;
+  for (FixedPrecTy prec : fixed_precs) {
+    vector<int64_t> a(n), b(n), res(n);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = randomBits(rng, prec);
+      b[i] = randomBits(rng, prec);
+    }
+    for (FAP_rounding_method method : ::fap::unit::roundings) {
+      ::fap::fixedMul(a.data(), b.data(), res.data(), n, prec, method);
+      int128_t sum = 0;
+      for (size_t i = 0; i < n; ++i) {
+        FixedPoint prod = FixedPoint::fromBits(a[i], prec, method) *
+                          FixedPoint::fromBits(b[i], prec, method);
+        FAP_CHECK_MSG(res[i] == prod.getBits(),
+                      context(prec, method, "fixedMul"));
+        sum += (int128_t)a[i] * b[i];
+      }
+      int64_t dot = ::fap::fixedDot(a.data(), b.data(), n, prec, method);
+      FAP_CHECK_MSG(dot == saturate(roundQuotient(sum,
+                                                  (int128_t)1
+                                                      << prec.frac_size,
+                                                  method),
+                                    prec),
+                    context(prec, method, "fixedDot"));
+    }
+  }
+}
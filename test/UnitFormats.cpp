@@ -0,0 +1,108 @@
+//===- UnitFormats.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitFormats.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the fp16, bfloat16 and FP8 batches and conversions
+///        against the operators.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapFormats.h"
+#include "FapSimd.h"
+
+#include <string.h>
+
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+FAP_TEST(formats, batches) {
+  ::std::mt19937_64 rng(13);
+  const FAP_format formats[] = { FAP_FORMAT_FP16, FAP_FORMAT_BF16,
+                                 FAP_FORMAT_FP8_E4M3, FAP_FORMAT_FP8_E5M2 };
+  for (FAP_format format : formats) {
+    FloatPrecTy prec = ::fap::formatPrec(format);
+    bool wide = prec.exp_size + prec.mant_size + 1 == 16;
+    // Every FP8 value against random ones
+    size_t n = wide ? FAP_UNIT_CASES : 256 * 16;
+    vector<uint64_t> lhs(n), rhs(n), res(n);
+    for (size_t i = 0; i < n; ++i) {
+      lhs[i] = wide ? (uint16_t)rng() : i % 256;
+      rhs[i] = wide ? (uint16_t)rng() : (uint8_t)rng();
+    }
+    vector<uint16_t> lhs16(lhs.begin(), lhs.end()), rhs16(rhs.begin(),
+                                                         rhs.end()), res16(n);
+    vector<uint8_t> lhs8(lhs.begin(), lhs.end()), rhs8(rhs.begin(),
+                                                      rhs.end()), res8(n);
+    for (FAP_rounding_method method : ::fap::unit::roundings) {
+      ::fap::ArithmeticContext ctx(method);
+      for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+        if (wide) {
+          ::fap::batchOp((FAP_batch_op)op, format, lhs16.data(),
+                         rhs16.data(), res16.data(), n, 2);
+          res.assign(res16.begin(), res16.end());
+        } else {
+          ::fap::batchOp((FAP_batch_op)op, format, lhs8.data(), rhs8.data(),
+                         res8.data(), n, 2);
+          res.assign(res8.begin(), res8.end());
+        }
+        for (size_t i = 0; i < n; ++i) {
+          FloatingPointType ref = ::fap::unit::apply(
+              (FAP_batch_op)op, ::fap::unpackValue(lhs[i], prec),
+              ::fap::unpackValue(rhs[i], prec));
+          FAP_CHECK_VALUE(::fap::unpackValue(res[i], prec), ref,
+                          ::std::string("format batchOp ")
+                          + ::fap::unit::roundingName(method));
+        }
+      }
+
+      // Conversions of floats, exact from the format
+      vector<float> in(n), out(n);
+      for (size_t i = 0; i < n; ++i) {
+        uint32_t bits = (uint32_t)::fap::packValue(::fap::unit::randomValue(
+            rng, FloatPrecTy(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE)));
+        memcpy(&in[i], &bits, sizeof(bits));
+      }
+      if (wide) {
+        ::fap::encode(format, in.data(), res16.data(), n);
+        res.assign(res16.begin(), res16.end());
+        ::fap::decode(format, res16.data(), out.data(), n);
+      } else {
+        ::fap::encode(format, in.data(), res8.data(), n);
+        res.assign(res8.begin(), res8.end());
+        ::fap::decode(format, res8.data(), out.data(), n);
+      }
+      for (size_t i = 0; i < n; ++i) {
+        FloatingPointType ref =
+            ::fap::unit::quantize(FloatingPointType(in[i]), prec);
+        FloatingPointType val = ::fap::unpackValue(res[i], prec);
+        FAP_CHECK_VALUE(val, ref, ::std::string("encode ")
+                        + ::fap::unit::roundingName(method));
+        FAP_CHECK_VALUE(FloatingPointType(out[i]),
+                        FloatingPointType((float)val), "decode");
+      }
+    }
+  }
+}
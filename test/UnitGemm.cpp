@@ -0,0 +1,59 @@
+//===- UnitGemm.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitGemm.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the matrix multiply.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapGemm.h"
+
+#include <math.h>
+
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+/// Empty matrices and empty sums, without reading the operands
+FAP_TEST(gemm, empty) {
+  FloatPrecTy prec(5, 10);
+  vector<FloatingPointType> c(
+      4, FloatingPointType::fromSignificand(1, 3, 0, false, prec));
+  ::fap::gemm(2, 2, 0, (const FloatingPointType*)NULL, 0,
+              (const FloatingPointType*)NULL, 2, c.data(), 2);
+  for (const FloatingPointType& val : c) {
+    FAP_CHECK_VALUE(val, FloatingPointType::fromSignificand(0, 0, 0, false,
+                                                            prec),
+                    "k = 0");
+  }
+  ::fap::gemm(0, 2, 3, (const FloatingPointType*)NULL, 3,
+              (const FloatingPointType*)NULL, 2, c.data(), 2);
+  ::fap::gemm(2, 0, 3, (const FloatingPointType*)NULL, 3,
+              (const FloatingPointType*)NULL, 0, c.data(), 0);
+  double d[4] = { 1.0, 1.0, 1.0, 1.0 };
+  ::fap::gemm(2, 2, 0, NULL, 0, NULL, 2, d, 2, prec);
+  for (double val : d) {
+    FAP_CHECK(val == 0.0 && !signbit(val));
+  }
+}
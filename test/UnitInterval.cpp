@@ -0,0 +1,97 @@
+//===- UnitInterval.cpp -----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitInterval.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the interval bounds against the directed roundings.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapInterval.h"
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+/// @brief Check the bounds of the interval operations on \p prec against
+/// the operators rounded toward -infinity and +infinity, and that they
+/// enclose the result rounded to nearest
+static void checkBounds(::std::mt19937_64& rng, FloatPrecTy prec) {
+  for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+    FloatingPointType lhs = ::fap::unit::randomValue(rng, prec);
+    FloatingPointType rhs = ::fap::unit::randomValue(rng, prec);
+    if (lhs.isNaN() || rhs.isNaN() || lhs.isInf() || rhs.isInf()) {
+      continue;
+    }
+    for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+      if (op == FAP_BATCH_DIV && rhs.isZero()) {
+        continue;
+      }
+      ::fap::Interval a(lhs), b(rhs), res;
+      switch (op) {
+      case FAP_BATCH_ADD:
+        res = a + b;
+        break;
+      case FAP_BATCH_SUB:
+        res = a - b;
+        break;
+      case FAP_BATCH_MUL:
+        res = a * b;
+        break;
+      default:
+        res = a / b;
+        break;
+      }
+      FloatingPointType lower, upper;
+      {
+        ::fap::ArithmeticContext ctx(FAP_FP_ROUND_TOWARD_NINF);
+        lower = ::fap::unit::apply((FAP_batch_op)op, lhs, rhs);
+      }
+      {
+        ::fap::ArithmeticContext ctx(FAP_FP_ROUND_TOWARD_PINF);
+        upper = ::fap::unit::apply((FAP_batch_op)op, lhs, rhs);
+      }
+      FAP_CHECK_VALUE(res.getLower(), lower, "lower bound");
+      FAP_CHECK_VALUE(res.getUpper(), upper, "upper bound");
+      ::fap::ArithmeticContext ctx(FAP_FP_ROUND_NEAREST);
+      FAP_CHECK(res.contains(::fap::unit::apply((FAP_batch_op)op, lhs, rhs)));
+    }
+  }
+}
+
+FAP_TEST(interval, bounds) {
+  ::std::mt19937_64 rng(16);
+  const FloatPrecTy interval_precs[] = { FloatPrecTy(8, 23),
+                                         FloatPrecTy(11, 52),
+                                         FloatPrecTy(5, 10) };
+  for (FloatPrecTy prec : interval_precs) {
+    checkBounds(rng, prec);
+  }
+}
+
+FAP_TEST(interval, binary128) {
+  // Over 62 bits of mantissa the exact products and quotients are computed
+  // on the wide paths of the operators
+  ::std::mt19937_64 rng(17);
+  checkBounds(rng, FloatPrecTy(15, 63));
+  checkBounds(rng, ::fap::PREC_BINARY128);
+}
+
@@ -0,0 +1,72 @@
+//===- UnitLazy.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitLazy.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the lazily normalized additions against the operators.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapLazy.h"
+#include "FapSimd.h"
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::fap::LazyFloatingPointType;
+
+/// An exact cancellation is -0 only rounding toward -inf, as the operators
+FAP_TEST(lazy, signed_zeroes) {
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+  FloatingPointType val = ::fap::unpackValue(0x3ff8000000000000ull, prec);
+  FloatingPointType zero = ::fap::unpackValue(0, prec);
+  for (FAP_rounding_method method : ::fap::unit::roundings) {
+    ::fap::ArithmeticContext ctx(method);
+    LazyFloatingPointType from_zero(zero), from_val(val);
+    from_zero += val;
+    from_zero += -val;
+    from_val -= val;
+    FAP_CHECK_VALUE(from_zero.getValue(), val - val,
+                    ::fap::unit::roundingName(method));
+    FAP_CHECK_VALUE(from_val.getValue(), val - val,
+                    ::fap::unit::roundingName(method));
+  }
+}
+
+/// Once the lower bits of an addend are lost aligning it with a larger one,
+/// the lsb of the accumulator stays put: cancelling both leaves at most the
+/// sticky bit, not the bits of the opposite addend below that lsb
+FAP_TEST(lazy, sticky_cancellation) {
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+  FloatingPointType large = ::fap::unpackValue(0xc310c3b7eb6114b8ull, prec);
+  FloatingPointType small = ::fap::unpackValue(0xbb6c95e3575b6aecull, prec);
+  for (FAP_rounding_method method : ::fap::unit::roundings) {
+    ::fap::ArithmeticContext ctx(method);
+    LazyFloatingPointType sum(large);
+    sum += small;
+    sum -= large;
+    sum -= small;
+    FloatingPointType res = sum.getValue();
+    FAP_CHECK_MSG(res.getExp() == 0 && res.getMant() <= 1,
+                  ::std::string(::fap::unit::roundingName(method)) + ": " +
+                      ::fap::unit::describe(res));
+  }
+}
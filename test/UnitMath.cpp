@@ -0,0 +1,218 @@
+//===- UnitMath.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitMath.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the elementary functions against exact checks and
+///        references, in each rounding.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapMath.h"
+
+#include <math.h>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+namespace {
+
+const FloatPrecTy math_precs[] = { FloatPrecTy(8, 23), FloatPrecTy(11, 52),
+                                   FloatPrecTy(5, 10) };
+
+/// @brief Random positive finite non-zero value of \p prec
+FloatingPointType positiveValue(::std::mt19937_64& rng, FloatPrecTy prec) {
+  FloatingPointType val;
+  do {
+    val = ::fap::unit::randomValue(rng, prec);
+  } while (val.isNaN() || val.isInf() || val.isZero());
+  val.setSign(0);
+  return val;
+}
+
+/// @brief The positive value after (\p dir 1) or before (\p dir -1) \p val
+FloatingPointType neighbour(FloatingPointType val, int dir) {
+  MantType max_mant = MASK_LOWER_HIGH(MantType, val.getPrec().mant_size);
+  if (dir > 0 && val.getMant() == max_mant) {
+    val.setExp(val.getExp() + 1);
+    val.setMant(0);
+  } else if (dir < 0 && val.getMant() == 0) {
+    val.setExp(val.getExp() - 1);
+    val.setMant(max_mant);
+  } else {
+    val.setMant(val.getMant() + dir);
+  }
+  return val;
+}
+
+/// @brief Exact square of the mean of \p lhs and \p rhs, on binary128
+FloatingPointType meanSquare(FloatingPointType lhs, FloatingPointType rhs) {
+  lhs.changePrec(::fap::PREC_BINARY128);
+  rhs.changePrec(::fap::PREC_BINARY128);
+  FloatingPointType half = FloatingPointType::fromSignificand(
+      0, 1, -1, false, ::fap::PREC_BINARY128);
+  FloatingPointType mean = (lhs + rhs) * half;
+  return mean * mean;
+}
+
+/// @brief Sign of \p lhs - \p rhs, which the rounding of the difference
+/// keeps, the relational operators compare on double
+int compare(const FloatingPointType& lhs, const FloatingPointType& rhs) {
+  FloatingPointType diff = lhs - rhs;
+  return diff.isZero() ? 0 : (diff.getSign() != 0 ? -1 : 1);
+}
+
+/// @brief If \p root is sqrt(\p x) rounded with \p method, from the exact
+/// squares of the root, its neighbours and the midpoints between them
+bool isRoundedRoot(const FloatingPointType& x, const FloatingPointType& root,
+                   FAP_rounding_method method) {
+  ::fap::ArithmeticContext exact(FAP_FP_ROUND_NEAREST);
+  FloatingPointType val = x;
+  val.changePrec(::fap::PREC_BINARY128);
+  FloatingPointType prev = neighbour(root, -1), next = neighbour(root, 1);
+  switch (method) {
+  case FAP_FP_ROUND_TOWARD_0:
+  case FAP_FP_ROUND_TOWARD_NINF:
+    return compare(meanSquare(root, root), val) <= 0 &&
+           compare(val, meanSquare(next, next)) < 0;
+  case FAP_FP_ROUND_TOWARD_PINF:
+    return compare(meanSquare(prev, prev), val) < 0 &&
+           compare(val, meanSquare(root, root)) <= 0;
+  default:
+    // A root is never a midpoint
+    return compare(meanSquare(prev, root), val) < 0 &&
+           compare(val, meanSquare(root, next)) < 0;
+  }
+}
+
+/// @brief Check \p res against the long double \p ref, the error of \p ref
+/// a few ulps of long double: \p res is \p ref rounded with \p method when
+/// it is far enough from a rounding boundary, faithful otherwise
+void checkApprox(const FloatingPointType& res, long double ref,
+                 FloatPrecTy prec, FAP_rounding_method method,
+                 const char* what) {
+  int e;
+  long double frac = frexpl(fabsl(ref), &e);
+  MantType sig = (MantType)(uint64_t)ldexpl(frac, 64);
+  MantType margin = sig >> 54;
+  SignType sign = ref < 0 ? 1 : 0;
+  FloatingPointType lower = FloatingPointType::fromSignificand(
+      sign, sig - margin, e - 64, true, prec, method);
+  FloatingPointType upper = FloatingPointType::fromSignificand(
+      sign, sig + margin, e - 64, true, prec, method);
+  ::std::string context = ::std::string(what) + " " +
+                          ::fap::unit::roundingName(method);
+  if (::fap::unit::sameValue(lower, upper)) {
+    FAP_CHECK_VALUE(res, lower, context);
+  } else {
+    FAP_CHECK_MSG(::fap::unit::sameValue(res, lower) ||
+                      ::fap::unit::sameValue(res, upper),
+                  context + ": " + ::fap::unit::describe(res) +
+                      " is not faithful");
+  }
+}
+
+}  // end anonymous namespace
+
+FAP_TEST(math, sqrt) {
+  ::std::mt19937_64 rng(33);
+  for (FloatPrecTy prec : math_precs) {
+    for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+      FloatingPointType x = positiveValue(rng, prec);
+      for (FAP_rounding_method method : ::fap::unit::roundings) {
+        FloatingPointType root;
+        {
+          ::fap::ArithmeticContext ctx(method);
+          root = ::fap::sqrt(x);
+        }
+        FAP_CHECK_MSG(isRoundedRoot(x, root, method),
+                      ::std::string(::fap::unit::roundingName(method)) +
+                          ": sqrt " + ::fap::unit::describe(x) + " is " +
+                          ::fap::unit::describe(root));
+      }
+    }
+  }
+}
+
+/// On a narrower result precision the operand bits shifted out of the
+/// integer root are sticky
+FAP_TEST(math, sqrt_result_prec) {
+  ::std::mt19937_64 rng(34);
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+  FloatPrecTy result_prec(DOUBLE_EXP_SIZE, 23);
+  for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+    FloatingPointType x = positiveValue(rng, prec);
+    for (FAP_rounding_method method : ::fap::unit::roundings) {
+      FloatingPointType root;
+      {
+        ::fap::ArithmeticContext ctx(method, result_prec);
+        root = ::fap::sqrt(x);
+      }
+      FAP_CHECK(root.getPrec().mant_size == result_prec.mant_size);
+      FAP_CHECK_MSG(isRoundedRoot(x, root, method),
+                    ::std::string(::fap::unit::roundingName(method)) +
+                        ": sqrt " + ::fap::unit::describe(x) + " is " +
+                        ::fap::unit::describe(root));
+    }
+  }
+}
+
+/// The reciprocal is the quotient of the division operator
+FAP_TEST(math, reciprocal) {
+  ::std::mt19937_64 rng(35);
+  for (FloatPrecTy prec : math_precs) {
+    for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+      FloatingPointType x = ::fap::unit::randomValue(rng, prec);
+      for (FAP_rounding_method method : ::fap::unit::roundings) {
+        ::fap::ArithmeticContext ctx(method);
+        FAP_CHECK_VALUE(::fap::reciprocal(x),
+                        FloatingPointType::fromSignificand(0, 1, 0, false,
+                                                           prec) / x,
+                        ::fap::unit::roundingName(method));
+      }
+    }
+  }
+}
+
+FAP_TEST(math, approx) {
+  ::std::mt19937_64 rng(36);
+  const FloatPrecTy approx_precs[] = { FloatPrecTy(8, 23),
+                                       FloatPrecTy(11, 52) };
+  for (FloatPrecTy prec : approx_precs) {
+    for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+      // The exponentials stay in the normal range of both precisions
+      FloatingPointType x = ::fap::unit::randomValue(rng, prec, -30, 5);
+      FloatingPointType y = positiveValue(rng, prec);
+      long double exp_ref = expl((long double)(double)x);
+      long double log_ref = logl((long double)(double)y);
+      long double rsqrt_ref = 1.0L / sqrtl((long double)(double)y);
+      for (FAP_rounding_method method : ::fap::unit::roundings) {
+        ::fap::ArithmeticContext ctx(method);
+        checkApprox(::fap::exp(x), exp_ref, prec, method, "exp");
+        if (log_ref != 0) {
+          checkApprox(::fap::log(y), log_ref, prec, method, "log");
+        }
+        checkApprox(::fap::rsqrt(y), rsqrt_ref, prec, method, "rsqrt");
+      }
+    }
+  }
+}
@@ -0,0 +1,216 @@
+//===- UnitMemo.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitMemo.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the memoization of the operators: results bit identical
+///        to the ones computed, in nested contexts of any setting.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapMemo.h"
+
+#include <vector>
+
+using ::fap::ArithmeticContext;
+using ::fap::ArithmeticState;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+namespace {
+
+/// @brief Operands of few values, so that the operations repeat, of three
+/// precisions, mixed in the operations
+void randomOperands(::std::mt19937_64& rng, size_t n,
+                    vector<FloatingPointType>& lhs,
+                    vector<FloatingPointType>& rhs) {
+  const FloatPrecTy precs[] = { FloatPrecTy(8, 23), FloatPrecTy(11, 52),
+                                FloatPrecTy(5, 10) };
+  vector<FloatingPointType> pool;
+  for (int i = 0; i < 48; ++i) {
+    pool.push_back(::fap::unit::randomValue(rng, precs[i % 3]));
+  }
+  for (size_t i = 0; i < n; ++i) {
+    lhs.push_back(pool[rng() % pool.size()]);
+    rhs.push_back(pool[rng() % pool.size()]);
+  }
+}
+
+/// @brief Settings of the contexts of the tests, each rounding with each
+/// special values policy, fast math flags and result precision
+vector<ArithmeticState> settingsList() {
+  const uint8_t fast_math[] = { FAP_FAST_MATH_NONE, FAP_FAST_MATH_FTZ,
+                                FAP_FAST_MATH_ALL };
+  vector<ArithmeticState> list;
+  for (FAP_rounding_method method : ::fap::unit::roundings) {
+    for (int special = FAP_SPECIAL_IEEE; special <= FAP_SPECIAL_SATURATE;
+         ++special) {
+      for (uint8_t flags : fast_math) {
+        for (int result_prec = 0; result_prec < 2; ++result_prec) {
+          ArithmeticState settings = ArithmeticContext::current();
+          settings.rounding = method;
+          settings.special = (FAP_special_policy)special;
+          settings.fastMath = flags;
+          settings.hasResultPrec = result_prec != 0;
+          settings.resultPrec = FloatPrecTy(5, 10);
+          list.push_back(settings);
+        }
+      }
+    }
+  }
+  return list;
+}
+
+/// @brief lhs op rhs of each operation in a context nested in the one of
+/// the caller, built with the ctors from \p settings, so that it keeps the
+/// memoization of the caller
+FloatingPointType nestedOp(const ArithmeticState& settings, FAP_batch_op op,
+                           const FloatingPointType& lhs,
+                           const FloatingPointType& rhs) {
+  if (settings.hasResultPrec) {
+    ArithmeticContext ctx(settings.rounding, settings.resultPrec,
+                          settings.special);
+    ctx.setFastMath(settings.fastMath);
+    return ::fap::unit::apply(op, lhs, rhs);
+  }
+  ArithmeticContext ctx(settings.rounding, settings.special);
+  ctx.setFastMath(settings.fastMath);
+  return ::fap::unit::apply(op, lhs, rhs);
+}
+
+/// @brief Results of the operations, indexed by settings, operands and
+/// operation, without memoization
+vector<FloatingPointType> references(const vector<ArithmeticState>& list,
+                                     const vector<FloatingPointType>& lhs,
+                                     const vector<FloatingPointType>& rhs) {
+  vector<FloatingPointType> ref;
+  ArithmeticContext ctx(FAP_FP_ROUND_NEAREST);
+  ctx.setMemoization(0);
+  for (const ArithmeticState& settings : list) {
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+        ref.push_back(nestedOp(settings, (FAP_batch_op)op, lhs[i], rhs[i]));
+      }
+    }
+  }
+  return ref;
+}
+
+::std::string describeCase(const ArithmeticState& settings, int op,
+                           const FloatingPointType& lhs,
+                           const FloatingPointType& rhs) {
+  return ::fap::unit::describe(lhs) + " op " + ::std::to_string(op) + " " +
+         ::fap::unit::describe(rhs) + ", " +
+         ::fap::unit::roundingName(settings.rounding) + ", special " +
+         ::std::to_string(settings.special) + ", flags " +
+         ::std::to_string(settings.fastMath) +
+         (settings.hasResultPrec ? ", result 5:10" : "");
+}
+
+}  // end anonymous namespace
+
+/// The settings run one after the other, twice, in a context nested in the
+/// memoizing one
+FAP_TEST(memo, nested) {
+  ::std::mt19937_64 rng(79);
+  vector<FloatingPointType> lhs, rhs;
+  randomOperands(rng, 300, lhs, rhs);
+  vector<ArithmeticState> list = settingsList();
+  vector<FloatingPointType> ref = references(list, lhs, rhs);
+
+  ::fap::clearMemoCache();
+  ::fap::resetMemoStats();
+  ArithmeticContext outer(FAP_FP_ROUND_NEAREST);
+  outer.setMemoization(1024);
+  size_t idx = 0;
+  for (const ArithmeticState& settings : list) {
+    for (int pass = 0; pass < 2; ++pass) {
+      size_t pass_idx = idx;
+      for (size_t i = 0; i < lhs.size(); ++i) {
+        for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+          FAP_CHECK_VALUE(nestedOp(settings, (FAP_batch_op)op, lhs[i],
+                                   rhs[i]),
+                          ref[pass_idx++],
+                          describeCase(settings, op, lhs[i], rhs[i]));
+        }
+      }
+      if (pass == 1) {
+        idx = pass_idx;
+      }
+    }
+  }
+  ::fap::MemoStats stats = ::fap::memoStats();
+  FAP_CHECK(stats.lookups != 0 && stats.hits != 0);
+}
+
+/// The settings alternate on each operation, twice, in a small cache whose
+/// entries are replaced by the ones of the other settings
+FAP_TEST(memo, interleaved) {
+  ::std::mt19937_64 rng(83);
+  vector<FloatingPointType> lhs, rhs;
+  randomOperands(rng, 200, lhs, rhs);
+  vector<ArithmeticState> list = settingsList();
+  vector<FloatingPointType> ref = references(list, lhs, rhs);
+  size_t per_settings = lhs.size() * 4;
+
+  ::fap::clearMemoCache();
+  ::fap::resetMemoStats();
+  ArithmeticContext outer(FAP_FP_ROUND_TOWARD_0);
+  outer.setMemoization(64);
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+      for (int pass = 0; pass < 2; ++pass) {
+        for (size_t s = 0; s < list.size(); ++s) {
+          FAP_CHECK_VALUE(nestedOp(list[s], (FAP_batch_op)op, lhs[i],
+                                   rhs[i]),
+                          ref[s * per_settings + i * 4 + op],
+                          describeCase(list[s], op, lhs[i], rhs[i]));
+        }
+      }
+    }
+  }
+  ::fap::MemoStats stats = ::fap::memoStats();
+  FAP_CHECK(stats.hits != 0 && stats.evictions != 0);
+}
+
+/// The stochastic rounding is not memoized: the same operation keeps
+/// rounding both ways
+FAP_TEST(memo, stochastic) {
+  FloatPrecTy prec(8, 23);
+  FloatingPointType one = FloatingPointType::fromSignificand(0, 1, 0, false,
+                                                             prec);
+  // Half an ULP of one
+  FloatingPointType half = FloatingPointType::fromSignificand(
+      0, 1, -(int)prec.mant_size - 1, false, prec);
+  FloatingPointType down = one;
+
+  ArithmeticContext outer(FAP_FP_ROUND_NEAREST);
+  outer.setMemoization(1024);
+  ArithmeticContext ctx(FAP_FP_ROUND_STOCHASTIC);
+  fap_stochastic_seed(89);
+  int ups = 0;
+  for (int i = 0; i < 1000; ++i) {
+    ups += !::fap::unit::sameValue(one + half, down);
+  }
+  FAP_CHECK_MSG(ups > 0 && ups < 1000,
+                ::std::to_string(ups) + " round ups of 1000");
+}
@@ -0,0 +1,254 @@
+//===- UnitOperators.cpp ----------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitOperators.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the operators against the native float and double
+///        arithmetic, under the rounding modes of the processor.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapSimd.h"
+
+#include <fenv.h>
+#include <string.h>
+
+#include <algorithm>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+
+namespace {
+
+const char* op_names[] = { "add", "sub", "mul", "div" };
+
+int nativeRounding(FAP_rounding_method method) {
+  switch (method) {
+  case FAP_FP_ROUND_TOWARD_0:
+    return FE_TOWARDZERO;
+  case FAP_FP_ROUND_TOWARD_PINF:
+    return FE_UPWARD;
+  case FAP_FP_ROUND_TOWARD_NINF:
+    return FE_DOWNWARD;
+  default:
+    return FE_TONEAREST;
+  }
+}
+
+/// @brief Conversions between FloatingPointType and the native types of
+/// the same bits
+template<typename NativeTy>
+struct Native;
+
+template<>
+struct Native<float> {
+  static float to(const FloatingPointType& val) {
+    uint32_t bits = (uint32_t)::fap::packValue(val);
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+  }
+
+  static FloatingPointType from(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return ::fap::unpackValue(bits,
+                              FloatPrecTy(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE));
+  }
+};
+
+template<>
+struct Native<double> {
+  static double to(const FloatingPointType& val) {
+    uint64_t bits = ::fap::packValue(val);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+  }
+
+  static FloatingPointType from(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return ::fap::unpackValue(
+        bits, FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE));
+  }
+};
+
+/// @brief The IEEE 754 binary128 of GCC, on the precision PREC_BINARY128
+template<>
+struct Native<__float128> {
+  static __float128 to(const FloatingPointType& val) {
+    uint128_t bits = ((uint128_t)val.getSign() << 127)
+        | ((uint128_t)val.getExp() << FAP_MAX_MANT_SIZE) | val.getMant();
+    __float128 q;
+    memcpy(&q, &bits, sizeof(q));
+    return q;
+  }
+
+  static FloatingPointType from(__float128 q) {
+    uint128_t bits;
+    memcpy(&bits, &q, sizeof(bits));
+    FloatingPointType val;
+    val.setPrec(::fap::PREC_BINARY128);
+    val.setSign((SignType)(bits >> 127));
+    val.setExp((ExpType)(bits >> FAP_MAX_MANT_SIZE));
+    val.setMant(bits);
+    val.setGrs(0);
+    return val;
+  }
+};
+
+/// @brief lhs op rhs on NativeTy, rounded by the processor with \p method
+template<typename NativeTy>
+FloatingPointType native(FAP_batch_op op, const FloatingPointType& lhs,
+                         const FloatingPointType& rhs,
+                         FAP_rounding_method method) {
+  volatile NativeTy a = Native<NativeTy>::to(lhs);
+  volatile NativeTy b = Native<NativeTy>::to(rhs);
+  fesetround(nativeRounding(method));
+  volatile NativeTy res;
+  switch (op) {
+  case FAP_BATCH_ADD:
+    res = a + b;
+    break;
+  case FAP_BATCH_SUB:
+    res = a - b;
+    break;
+  case FAP_BATCH_MUL:
+    res = a * b;
+    break;
+  default:
+    res = a / b;
+    break;
+  }
+  fesetround(FE_TONEAREST);
+  return Native<NativeTy>::from(res);
+}
+
+/// @brief Operands of \p prec whose exact lhs op rhs is around the
+/// smallest normal and in the subnormal range
+void thresholdOperands(::std::mt19937_64& rng, FloatPrecTy prec,
+                       FAP_batch_op op, FloatingPointType& lhs,
+                       FloatingPointType& rhs) {
+  int emax = (1 << (prec.exp_size - 1)) - 1;
+  int emin = 1 - emax;
+  int target = emin - prec.mant_size - 2
+      + (int)(rng() % (uint64_t)(prec.mant_size + 4));
+  int lo, hi;
+  if (op == FAP_BATCH_MUL) {
+    lo = ::std::max(emin, target - emax);
+    hi = ::std::min(emax, target - emin);
+  } else {
+    lo = ::std::max(emin, target + emin);
+    hi = ::std::min(emax, target + emax);
+  }
+  lhs = ::fap::unit::randomValue(rng, prec, lo, hi);
+  int lhs_exp = (int)lhs.getExp() - emax;
+  int rhs_exp = op == FAP_BATCH_MUL ? target - lhs_exp : lhs_exp - target;
+  rhs = ::fap::unit::randomValue(rng, prec, rhs_exp, rhs_exp);
+}
+
+template<typename NativeTy>
+void checkOperator(const FloatingPointType& lhs, const FloatingPointType& rhs,
+                   FAP_batch_op op) {
+  for (FAP_rounding_method method : ::fap::unit::roundings) {
+    FloatingPointType ref = native<NativeTy>(op, lhs, rhs, method);
+    ::fap::ArithmeticContext ctx(method);
+    FloatingPointType res = ::fap::unit::apply(op, lhs, rhs);
+    FAP_CHECK_VALUE(res, ref,
+                    ::fap::unit::describe(lhs) + " " + op_names[op] + " "
+                    + ::fap::unit::describe(rhs) + ", "
+                    + ::fap::unit::roundingName(method));
+  }
+}
+
+/// @brief The operators on \p prec, the one of NativeTy, against it
+template<typename NativeTy>
+void checkNative(FloatPrecTy prec, uint64_t seed) {
+  ::std::mt19937_64 rng(seed);
+  for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+    FloatingPointType lhs = ::fap::unit::randomValue(rng, prec);
+    FloatingPointType rhs = ::fap::unit::randomValue(rng, prec);
+    for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+      checkOperator<NativeTy>(lhs, rhs, (FAP_batch_op)op);
+    }
+  }
+}
+
+/// @brief Products and quotients on \p prec rounded on the subnormals
+template<typename NativeTy>
+void checkThreshold(FloatPrecTy prec, uint64_t seed) {
+  ::std::mt19937_64 rng(seed);
+  for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+    for (int op = FAP_BATCH_MUL; op <= FAP_BATCH_DIV; ++op) {
+      FloatingPointType lhs, rhs;
+      thresholdOperands(rng, prec, (FAP_batch_op)op, lhs, rhs);
+      checkOperator<NativeTy>(lhs, rhs, (FAP_batch_op)op);
+    }
+  }
+}
+
+}  // end anonymous namespace
+
+FAP_TEST(operators, float) {
+  checkNative<float>(FloatPrecTy(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE), 1);
+}
+
+FAP_TEST(operators, double) {
+  checkNative<double>(FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE), 2);
+}
+
+FAP_TEST(operators, float_subnormals) {
+  checkThreshold<float>(FloatPrecTy(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE), 3);
+}
+
+FAP_TEST(operators, double_subnormals) {
+  checkThreshold<double>(FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE), 4);
+}
+
+FAP_TEST(operators, binary128) {
+  checkNative<__float128>(::fap::PREC_BINARY128, 5);
+}
+
+FAP_TEST(operators, binary128_subnormals) {
+  checkThreshold<__float128>(::fap::PREC_BINARY128, 6);
+}
+
+/// Quotient rounded on the smallest subnormal by its msb alone
+FAP_TEST(operators, subnormal_guard) {
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, 80);
+  FloatingPointType lhs(-0x1.91eff4bb9770cp-425, prec);
+  FloatingPointType rhs(0x1.40f098989a2d5p+678, prec);
+  FloatingPointType res = lhs / rhs;
+  FAP_CHECK(res.getSign() == 1 && res.getExp() == 0 && res.getMant() == 1);
+}
+
+FAP_TEST(operators, signed_zeroes) {
+  FloatPrecTy prec(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE);
+  FloatingPointType one = ::fap::unpackValue(0x3ff0000000000000ull, prec);
+  for (FAP_rounding_method method : ::fap::unit::roundings) {
+    ::fap::ArithmeticContext ctx(method);
+    FloatingPointType res = one - one;
+    FAP_CHECK(res.isZero());
+    FAP_CHECK(res.getSign() == (method == FAP_FP_ROUND_TOWARD_NINF));
+  }
+}
@@ -0,0 +1,102 @@
+//===- UnitProfile.cpp ------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitProfile.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the precisions proposed by the range profiler.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapProfile.h"
+
+#include <string.h>
+
+using ::fap::RangeProfiler;
+using ::fap::RangeSummary;
+
+namespace {
+
+/// @brief Summary of the site \p label
+RangeSummary siteSummary(const char* label) {
+  ::std::vector<RangeSummary> sums = RangeProfiler::summary();
+  for (size_t s = 0; s < sums.size(); ++s) {
+    if (sums[s].label == label) {
+      return sums[s];
+    }
+  }
+  return RangeSummary();
+}
+
+}  // end anonymous namespace
+
+FAP_TEST(profile, int_prec) {
+  RangeProfiler::reset();
+  RangeProfiler::setEnabled(true);
+  const int vals[] = { 3, 20, -17, 100 };
+  for (int val : vals) {
+    FAP_PROFILE("int_prec.odd", val);
+    FAP_PROFILE("int_prec.even", val * 16);
+    FAP_PROFILE("int_prec.wide", ::fap::IntegerType((int64_t)val * 4));
+  }
+  FAP_PROFILE("int_prec.zero", 0);
+  RangeProfiler::setEnabled(false);
+
+  FAP_CHECK(siteSummary("int_prec.odd").proposeIntPrec() == 32);
+  FAP_CHECK(siteSummary("int_prec.even").proposeIntPrec() == 28);
+  FAP_CHECK(siteSummary("int_prec.wide").proposeIntPrec() == 62);
+  FAP_CHECK(siteSummary("int_prec.zero").proposeIntPrec() == 1);
+  // The proposed precision keeps the values
+  for (int val : vals) {
+    ::fap::IntegerType exact(val * 16, 28);
+    FAP_CHECK((int)exact.getBits() == val * 16);
+  }
+}
+
+FAP_TEST(profile, float_prec) {
+  RangeProfiler::reset();
+  RangeProfiler::setEnabled(true);
+  FAP_PROFILE("float_prec.float", 1e30);
+  FAP_PROFILE("float_prec.float", 1e-30);
+  FAP_PROFILE("float_prec.double", 1e300);
+  // The smallest subnormal of binary128, normal on no exponent
+  ::fap::FloatingPointType tiny;
+  tiny.setPrec(::fap::PREC_BINARY128);
+  tiny.setExp(0);
+  tiny.setMant(1);
+  FAP_PROFILE("float_prec.tiny", tiny);
+  RangeProfiler::setEnabled(false);
+
+  bool fits = false;
+  ::fap::FloatPrecTy prec =
+      siteSummary("float_prec.float").proposeFloatPrec(23, false, &fits);
+  FAP_CHECK(fits && prec.exp_size == 8 && prec.mant_size == 23);
+  prec = siteSummary("float_prec.double").proposeFloatPrec(52, false, &fits);
+  FAP_CHECK(fits && prec.exp_size == 11);
+  prec = siteSummary("float_prec.tiny").proposeFloatPrec(112, true, &fits);
+  FAP_CHECK(fits && prec.exp_size == FAP_MAX_EXP_SIZE);
+  prec = siteSummary("float_prec.tiny").proposeFloatPrec(10, false, &fits);
+  FAP_CHECK(!fits && prec.exp_size == FAP_MAX_EXP_SIZE);
+  RangeSummary wide;
+  wide.minExp = -20000;
+  wide.maxExp = 0;
+  prec = wide.proposeFloatPrec(52, true, &fits);
+  FAP_CHECK(!fits && prec.exp_size == FAP_MAX_EXP_SIZE);
+}
@@ -0,0 +1,91 @@
+//===- UnitReduce.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitReduce.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the parallel reductions against their reduction tree.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapReduce.h"
+
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+namespace {
+
+/// @brief Reference of sum() and dot(): the leaves in order, then the
+/// pairs of each level
+FloatingPointType treeSum(const vector<FloatingPointType>& terms) {
+  vector<FloatingPointType> partial;
+  for (size_t first = 0; first < terms.size(); first += FAP_REDUCE_CHUNK) {
+    FloatingPointType acc = terms[first];
+    for (size_t i = first + 1;
+        i < terms.size() && i < first + FAP_REDUCE_CHUNK; ++i) {
+      acc += terms[i];
+    }
+    partial.push_back(acc);
+  }
+  while (partial.size() > 1) {
+    vector<FloatingPointType> level;
+    for (size_t p = 0; p < partial.size(); p += 2) {
+      level.push_back(p + 1 < partial.size() ? partial[p] + partial[p + 1]
+                                             : partial[p]);
+    }
+    partial.swap(level);
+  }
+  return partial[0];
+}
+
+}  // end anonymous namespace
+
+FAP_TEST(reduce, threads) {
+  ::std::mt19937_64 rng(17);
+  FloatPrecTy prec(8, 23);
+  // Enough values for three workers
+  size_t n = 3 * FAP_REDUCE_THREAD_WORK + 17;
+  vector<FloatingPointType> x(n), y(n);
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = ::fap::unit::randomValue(rng, prec, -8, 8);
+    y[i] = ::fap::unit::randomValue(rng, prec, -8, 8);
+  }
+  for (FAP_rounding_method method : ::fap::unit::roundings) {
+    ::fap::ArithmeticContext ctx(method);
+    vector<FloatingPointType> products(n);
+    for (size_t i = 0; i < n; ++i) {
+      products[i] = x[i] * y[i];
+    }
+    FloatingPointType sum_ref = treeSum(x);
+    FloatingPointType dot_ref = treeSum(products);
+    for (unsigned threads = 1; threads <= 3; ++threads) {
+      FAP_CHECK_VALUE(::fap::sum(x.data(), n, threads), sum_ref,
+                      ::std::string("sum ")
+                      + ::fap::unit::roundingName(method));
+      FAP_CHECK_VALUE(::fap::dot(x.data(), y.data(), n, threads), dot_ref,
+                      ::std::string("dot ")
+                      + ::fap::unit::roundingName(method));
+    }
+  }
+}
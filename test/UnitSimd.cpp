@@ -0,0 +1,75 @@
+//===- UnitSimd.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitSimd.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the batches of packed values against the operators.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapSimd.h"
+
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+namespace {
+
+/// @brief Precisions with a vectorized kernel, and others
+const FloatPrecTy precs[] = { FloatPrecTy(5, 10), FloatPrecTy(8, 23),
+                              FloatPrecTy(11, 52), FloatPrecTy(8, 7),
+                              FloatPrecTy(11, 30), FloatPrecTy(4, 3),
+                              FloatPrecTy(6, 20) };
+
+/// @brief Size of the batches, not a multiple of the lanes
+const size_t batch_size = 203;
+
+}  // end anonymous namespace
+
+FAP_TEST(simd, packed) {
+  ::std::mt19937_64 rng(12);
+  for (FloatPrecTy prec : precs) {
+    vector<uint64_t> lhs, rhs;
+    for (size_t i = 0; i < batch_size; ++i) {
+      lhs.push_back(::fap::packValue(::fap::unit::randomValue(rng, prec)));
+      rhs.push_back(::fap::packValue(::fap::unit::randomValue(rng, prec)));
+    }
+    vector<uint64_t> res(batch_size);
+    for (FAP_rounding_method method : ::fap::unit::roundings) {
+      ::fap::ArithmeticContext ctx(method);
+      for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+        ::fap::batchOp((FAP_batch_op)op, prec, lhs.data(), rhs.data(),
+                       res.data(), batch_size, 2);
+        for (size_t i = 0; i < batch_size; ++i) {
+          FloatingPointType ref = ::fap::unit::apply(
+              (FAP_batch_op)op, ::fap::unpackValue(lhs[i], prec),
+              ::fap::unpackValue(rhs[i], prec));
+          FAP_CHECK_VALUE(::fap::unpackValue(res[i], prec), ref,
+                          ::std::string("packed batchOp ")
+                          + ::fap::unit::roundingName(method));
+        }
+      }
+    }
+  }
+}
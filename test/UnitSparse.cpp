@@ -0,0 +1,197 @@
+//===- UnitSparse.cpp -------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitSparse.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the sparse matrix products against a dense
+///        reference, in each format and rounding.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapSparse.h"
+
+#include <string.h>
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::fap::SparseMatrix;
+using ::std::vector;
+
+namespace {
+
+/// @brief Precisions of the packed values, of any width
+const FloatPrecTy sparse_precs[] = { FloatPrecTy(8, 23), FloatPrecTy(11, 52),
+                                     FloatPrecTy(5, 10), FloatPrecTy(6, 9) };
+
+/// @brief Dense matrix, with the structure of the non-zeroes
+struct DenseMatrix {
+  size_t rows;
+  size_t cols;
+  vector<FloatingPointType> vals;
+  vector<bool> nonZero;
+};
+
+/// @brief Random matrix of \p prec, a row on \p max_density having about
+/// half of the columns and some rows empty
+DenseMatrix randomMatrix(::std::mt19937_64& rng, FloatPrecTy prec,
+                         size_t rows, size_t cols, size_t max_density) {
+  DenseMatrix dense = { rows, cols, vector<FloatingPointType>(rows * cols),
+                        vector<bool>(rows * cols) };
+  for (size_t i = 0; i < rows; ++i) {
+    size_t density = rng() % (max_density + 1);
+    for (size_t j = 0; j < cols; ++j) {
+      if (density != 0 && rng() % (2 * max_density) < density) {
+        dense.vals[i * cols + j] = ::fap::unit::randomValue(rng, prec);
+        dense.nonZero[i * cols + j] = true;
+      }
+    }
+  }
+  return dense;
+}
+
+/// @brief \p dense on \p format, from its CSR arrays
+SparseMatrix toSparse(const DenseMatrix& dense, FloatPrecTy prec,
+                      FAP_sparse_format format) {
+  vector<size_t> row_ptr(1, 0);
+  vector<uint32_t> col_idx;
+  vector<FloatingPointType> vals;
+  for (size_t i = 0; i < dense.rows; ++i) {
+    for (size_t j = 0; j < dense.cols; ++j) {
+      if (dense.nonZero[i * dense.cols + j]) {
+        col_idx.push_back((uint32_t)j);
+        vals.push_back(dense.vals[i * dense.cols + j]);
+      }
+    }
+    row_ptr.push_back(col_idx.size());
+  }
+  SparseMatrix mat(prec, format);
+  mat.assign(dense.rows, dense.cols, row_ptr.data(), col_idx.data(),
+             vals.data());
+  return mat;
+}
+
+/// @brief Products of the rows of \p dense by \p x, summed over the
+/// non-zeroes in the order of the columns with the operators
+vector<FloatingPointType> reference(const DenseMatrix& dense,
+                                    const vector<FloatingPointType>& x,
+                                    FloatPrecTy prec) {
+  vector<FloatingPointType> ref(dense.rows);
+  for (size_t i = 0; i < dense.rows; ++i) {
+    bool first = true;
+    ref[i] = FloatingPointType::fromSignificand(0, 0, 0, false, prec);
+    for (size_t j = 0; j < dense.cols; ++j) {
+      if (!dense.nonZero[i * dense.cols + j]) {
+        continue;
+      }
+      FloatingPointType prod = dense.vals[i * dense.cols + j] * x[j];
+      ref[i] = first ? prod : ref[i] + prod;
+      first = false;
+    }
+  }
+  return ref;
+}
+
+/// @brief Check spmv of \p dense on both formats and \p threads workers
+void checkSpmv(const DenseMatrix& dense, FloatPrecTy prec,
+               const vector<FloatingPointType>& x,
+               FAP_rounding_method method, unsigned threads) {
+  const FAP_sparse_format formats[] = { FAP_SPARSE_CSR, FAP_SPARSE_ELL };
+  ::fap::ArithmeticContext ctx(method);
+  vector<FloatingPointType> ref = reference(dense, x, prec);
+  for (FAP_sparse_format format : formats) {
+    SparseMatrix mat = toSparse(dense, prec, format);
+    vector<FloatingPointType> y(dense.rows);
+    mat.spmv(x.data(), y.data(), threads);
+    for (size_t i = 0; i < dense.rows; ++i) {
+      FAP_CHECK_VALUE(y[i], ref[i],
+                      ::std::string(format == FAP_SPARSE_CSR ? "CSR "
+                                                             : "ELL ") +
+                          ::fap::unit::roundingName(method) + " on " +
+                          ::std::to_string(threads));
+    }
+  }
+}
+
+vector<FloatingPointType> randomVector(::std::mt19937_64& rng,
+                                       FloatPrecTy prec, size_t n) {
+  vector<FloatingPointType> x;
+  for (size_t j = 0; j < n; ++j) {
+    x.push_back(::fap::unit::randomValue(rng, prec));
+  }
+  return x;
+}
+
+}  // end anonymous namespace
+
+/// Both formats against the dense products
+FAP_TEST(sparse, spmv) {
+  ::std::mt19937_64 rng(35);
+  for (FloatPrecTy prec : sparse_precs) {
+    DenseMatrix dense = randomMatrix(rng, prec, 67, 45, 4);
+    vector<FloatingPointType> x = randomVector(rng, prec, dense.cols);
+    for (FAP_rounding_method method : ::fap::unit::roundings) {
+      checkSpmv(dense, prec, x, method, 1);
+    }
+  }
+}
+
+/// Enough non-zeroes for two workers, which take the context of the caller
+FAP_TEST(sparse, spmv_threads) {
+  ::std::mt19937_64 rng(37);
+  FloatPrecTy prec(FLOAT_EXP_SIZE, FLOAT_MANT_SIZE);
+  DenseMatrix dense = randomMatrix(rng, prec, 1536, 512, 1);
+  vector<FloatingPointType> x = randomVector(rng, prec, dense.cols);
+  checkSpmv(dense, prec, x, FAP_FP_ROUND_NEAREST, 2);
+  checkSpmv(dense, prec, x, FAP_FP_ROUND_TOWARD_NINF, 2);
+}
+
+/// On doubles the values are unpacked exactly and summed in double
+FAP_TEST(sparse, spmv_double) {
+  ::std::mt19937_64 rng(36);
+  const FAP_sparse_format formats[] = { FAP_SPARSE_CSR, FAP_SPARSE_ELL };
+  for (FloatPrecTy prec : sparse_precs) {
+    DenseMatrix dense = randomMatrix(rng, prec, 67, 45, 4);
+    vector<double> x;
+    for (size_t j = 0; j < dense.cols; ++j) {
+      x.push_back((double)::fap::unit::randomValue(
+          rng, FloatPrecTy(DOUBLE_EXP_SIZE, DOUBLE_MANT_SIZE), -8, 8));
+    }
+    vector<double> ref(dense.rows, 0.0);
+    for (size_t i = 0; i < dense.rows; ++i) {
+      for (size_t j = 0; j < dense.cols; ++j) {
+        if (dense.nonZero[i * dense.cols + j]) {
+          ref[i] += (double)dense.vals[i * dense.cols + j] * x[j];
+        }
+      }
+    }
+    for (FAP_sparse_format format : formats) {
+      SparseMatrix mat = toSparse(dense, prec, format);
+      vector<double> y(dense.rows);
+      mat.spmv(x.data(), y.data(), 4);
+      for (size_t i = 0; i < dense.rows; ++i) {
+        FAP_CHECK(memcmp(&y[i], &ref[i], sizeof(double)) == 0 ||
+                  (y[i] != y[i] && ref[i] != ref[i]));
+      }
+    }
+  }
+}
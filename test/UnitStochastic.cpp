@@ -0,0 +1,179 @@
+//===- UnitStochastic.cpp ---------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitStochastic.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the stochastic rounding: results between the directed
+///        roundings, unbiased on average and reproducible from the seed.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+
+#include <math.h>
+#include <vector>
+
+using ::fap::ArithmeticContext;
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+namespace {
+
+const FloatPrecTy stochastic_precs[] = { FloatPrecTy(5, 10),
+                                         FloatPrecTy(8, 23),
+                                         FloatPrecTy(11, 52) };
+
+/// @brief lhs op rhs rounded with \p method
+FloatingPointType roundedOp(FAP_batch_op op, const FloatingPointType& lhs,
+                            const FloatingPointType& rhs,
+                            FAP_rounding_method method) {
+  ArithmeticContext ctx(method);
+  return ::fap::unit::apply(op, lhs, rhs);
+}
+
+/// @brief Results of \p n random operations, from the seed \p seed of the
+/// stream \p stream
+vector<FloatingPointType> stochasticRun(uint64_t seed, uint64_t stream,
+                                        size_t n) {
+  ::std::mt19937_64 rng(41);
+  vector<FloatingPointType> res;
+  ArithmeticContext ctx(FAP_FP_ROUND_STOCHASTIC);
+  fap_stochastic_seed(seed, stream);
+  for (size_t i = 0; i < n; ++i) {
+    FloatingPointType lhs = ::fap::unit::randomValue(rng, FloatPrecTy(8, 23),
+                                                     -8, 8);
+    FloatingPointType rhs = ::fap::unit::randomValue(rng, FloatPrecTy(8, 23),
+                                                     -8, 8);
+    res.push_back(::fap::unit::apply((FAP_batch_op)(i % 4), lhs, rhs));
+  }
+  return res;
+}
+
+}  // end anonymous namespace
+
+/// The stochastic result is one of the two neighbours of the exact one, and
+/// the exact results are kept
+FAP_TEST(stochastic, bracket) {
+  ::std::mt19937_64 rng(37);
+  fap_stochastic_seed(37);
+  for (FloatPrecTy prec : stochastic_precs) {
+    for (int i = 0; i < FAP_UNIT_CASES; ++i) {
+      FloatingPointType lhs = ::fap::unit::randomValue(rng, prec, -12, 12);
+      FloatingPointType rhs = ::fap::unit::randomValue(rng, prec, -12, 12);
+      for (int op = FAP_BATCH_ADD; op <= FAP_BATCH_DIV; ++op) {
+        FAP_batch_op batch_op = (FAP_batch_op)op;
+        FloatingPointType down = roundedOp(batch_op, lhs, rhs,
+                                           FAP_FP_ROUND_TOWARD_NINF);
+        FloatingPointType up = roundedOp(batch_op, lhs, rhs,
+                                         FAP_FP_ROUND_TOWARD_PINF);
+        FloatingPointType res = roundedOp(batch_op, lhs, rhs,
+                                          FAP_FP_ROUND_STOCHASTIC);
+        ::std::string what = ::fap::unit::describe(lhs) + " op " +
+                             ::std::to_string(op) + " " +
+                             ::fap::unit::describe(rhs);
+        if (::fap::unit::sameValue(down, up)) {
+          FAP_CHECK_VALUE(res, down, what);
+        } else {
+          FAP_CHECK_MSG(::fap::unit::sameValue(res, down) ||
+                            ::fap::unit::sameValue(res, up),
+                        what + ": " + ::fap::unit::describe(res));
+        }
+      }
+    }
+  }
+}
+
+/// 1 + f ulp is rounded up with probability f, the number of round ups is
+/// checked within 5 standard deviations of the binomial
+FAP_TEST(stochastic, unbiased) {
+  const int trials = 20000;
+  fap_stochastic_seed(43);
+  for (FloatPrecTy prec : stochastic_precs) {
+    FloatingPointType one = FloatingPointType::fromSignificand(
+        0, 1, 0, false, prec);
+    for (unsigned eighths = 1; eighths < 8; ++eighths) {
+      // f = eighths / 8 of the ulp of one, 2^-mant_size
+      FloatingPointType frac = FloatingPointType::fromSignificand(
+          0, eighths, -(int)prec.mant_size - 3, false, prec);
+      FloatingPointType down = roundedOp(FAP_BATCH_ADD, one, frac,
+                                         FAP_FP_ROUND_TOWARD_NINF);
+      FloatingPointType up = roundedOp(FAP_BATCH_ADD, one, frac,
+                                       FAP_FP_ROUND_TOWARD_PINF);
+      int ups = 0;
+      ArithmeticContext ctx(FAP_FP_ROUND_STOCHASTIC);
+      for (int i = 0; i < trials; ++i) {
+        FloatingPointType res = one + frac;
+        if (::fap::unit::sameValue(res, up)) {
+          ++ups;
+        } else {
+          FAP_CHECK_VALUE(res, down, "1 + " + ::fap::unit::describe(frac));
+        }
+      }
+      double p = eighths / 8.0;
+      double mean = trials * p;
+      double dev = 5 * sqrt(trials * p * (1 - p));
+      FAP_CHECK_MSG(fabs(ups - mean) <= dev,
+                    ::std::to_string(ups) + " round ups of 1 + " +
+                        ::std::to_string(eighths) + "/8 ulp");
+    }
+  }
+}
+
+/// The same seed and stream give the same results, another stream others
+FAP_TEST(stochastic, seed) {
+  const size_t n = 512;
+  vector<FloatingPointType> first = stochasticRun(47, 0, n);
+  vector<FloatingPointType> again = stochasticRun(47, 0, n);
+  vector<FloatingPointType> other = stochasticRun(47, 1, n);
+  size_t differ = 0;
+  for (size_t i = 0; i < n; ++i) {
+    FAP_CHECK_VALUE(again[i], first[i], "result " + ::std::to_string(i));
+    differ += !::fap::unit::sameValue(other[i], first[i]);
+  }
+  FAP_CHECK_MSG(differ > 0, "the stream 1 repeats the stream 0");
+}
+
+/// The batches split among workers are reproducible from the seed
+FAP_TEST(stochastic, batch) {
+  const size_t n = 1 << 14;
+  ::std::mt19937_64 rng(53);
+  vector<FloatingPointType> lhs, rhs;
+  for (size_t i = 0; i < n; ++i) {
+    lhs.push_back(::fap::unit::randomValue(rng, FloatPrecTy(11, 52), -8, 8));
+    rhs.push_back(::fap::unit::randomValue(rng, FloatPrecTy(11, 52), -8, 8));
+  }
+  ArithmeticContext ctx(FAP_FP_ROUND_STOCHASTIC);
+  for (unsigned threads = 1; threads <= 2; ++threads) {
+    vector<FloatingPointType> first(n), again(n);
+    fap_stochastic_seed(59);
+    ::fap::batchOp(FAP_BATCH_MUL, lhs.data(), rhs.data(), first.data(), n,
+                   threads);
+    fap_stochastic_seed(59);
+    ::fap::batchOp(FAP_BATCH_MUL, lhs.data(), rhs.data(), again.data(), n,
+                   threads);
+    for (size_t i = 0; i < n; ++i) {
+      FAP_CHECK_VALUE(again[i], first[i], ::std::to_string(threads) +
+                                              " workers, element " +
+                                              ::std::to_string(i));
+    }
+  }
+}
@@ -0,0 +1,155 @@
+//===- UnitSweep.cpp --------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitSweep.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the sweeps shared by workers.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapSweep.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+using ::fap::Sweep;
+using ::fap::SweepConfig;
+using ::fap::SweepSpace;
+using ::std::vector;
+
+namespace {
+
+/// @brief 8 configurations, 2 shards of 4
+SweepSpace smallSpace() {
+  SweepSpace space;
+  space.floatChoices.push_back({ ::fap::FloatPrecTy(8, 23),
+                                 ::fap::FloatPrecTy(11, 52) });
+  space.intChoices.push_back({ 8, 16, 24, 32 });
+  return space;
+}
+
+/// @brief Directory of a sweep, removed at the end of the test
+class TempDir {
+ public:
+  TempDir() {
+    char path[] = "/tmp/fap_unit_XXXXXX";
+    if (mkdtemp(path) == NULL) {
+      perror("mkdtemp");
+      exit(1);
+    }
+    this->path = path;
+  }
+
+  ~TempDir() {
+    DIR* dir = opendir(this->path.c_str());
+    if (dir != NULL) {
+      for (struct dirent* entry = readdir(dir); entry != NULL;
+          entry = readdir(dir)) {
+        unlink((this->path + "/" + entry->d_name).c_str());
+      }
+      closedir(dir);
+    }
+    rmdir(this->path.c_str());
+  }
+
+  ::std::string path;
+};
+
+}  // end anonymous namespace
+
+FAP_TEST(sweep, single) {
+  TempDir dir;
+  Sweep sweep(smallSpace(), dir.path, "a", 4);
+  uint64_t evaluated = sweep.run([](const SweepConfig& config) {
+    return vector<double>(1, (double)config.index);
+  });
+  FAP_CHECK(evaluated == 8);
+  FAP_CHECK(sweep.isComplete());
+  vector< ::fap::SweepResult> results = sweep.merge();
+  FAP_CHECK(results.size() == 8);
+  for (size_t r = 0; r < results.size(); ++r) {
+    FAP_CHECK(results[r].config.index == r);
+    FAP_CHECK(results[r].metrics.size() == 1 && results[r].metrics[0] == r);
+  }
+}
+
+/// Worker a stalls on its first configuration, b takes its claim over and
+/// does the whole sweep, then a resumes: it has to drop the shard without
+/// appending to the checkpoint of b
+FAP_TEST(sweep, takeover) {
+  TempDir dir;
+  ::std::atomic<int> stage(0);
+  uint64_t a_evaluated = 0;
+  ::std::thread a([&]() {
+    Sweep sweep(smallSpace(), dir.path, "a", 4);
+    a_evaluated = sweep.run([&](const SweepConfig&) {
+      stage = 1;
+      while (stage != 2) {
+        usleep(1000);
+      }
+      return vector<double>(1, -1.0);
+    });
+  });
+  while (stage != 1) {
+    usleep(1000);
+  }
+
+  // The claim of a is made stale
+  struct timeval old[2];
+  gettimeofday(&old[0], NULL);
+  old[0].tv_sec -= 10;
+  old[1] = old[0];
+  FAP_CHECK(utimes((dir.path + "/shard-000000.claim").c_str(), old) == 0);
+  Sweep sweep(smallSpace(), dir.path, "b", 4);
+  sweep.setLease(0);
+  uint64_t b_evaluated = sweep.run([](const SweepConfig& config) {
+    return vector<double>(1, (double)config.index);
+  });
+  stage = 2;
+  a.join();
+
+  FAP_CHECK(b_evaluated == 8);
+  FAP_CHECK(a_evaluated == 1);
+  FAP_CHECK(sweep.isComplete());
+  vector< ::fap::SweepResult> results = sweep.merge();
+  FAP_CHECK(results.size() == 8);
+  for (size_t r = 0; r < results.size(); ++r) {
+    FAP_CHECK(results[r].metrics.size() == 1 && results[r].metrics[0] == r);
+  }
+  FAP_CHECK(access((dir.path + "/shard-000000.claim").c_str(), F_OK) != 0);
+  // Only the lines of b
+  FILE* done = fopen((dir.path + "/shard-000000.done").c_str(), "r");
+  FAP_CHECK(done != NULL);
+  if (done != NULL) {
+    int lines = 0;
+    for (int c = fgetc(done); c != EOF; c = fgetc(done)) {
+      lines += c == '\n' ? 1 : 0;
+    }
+    fclose(done);
+    FAP_CHECK(lines == 4);
+  }
+}
@@ -0,0 +1,113 @@
+//===- UnitTape.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitTape.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests of the tapes, their updates and replays against the
+///        operators.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+#include "FapTape.h"
+
+#include <vector>
+
+using ::fap::FloatingPointType;
+using ::fap::FloatPrecTy;
+using ::std::vector;
+
+namespace {
+
+/// @brief Sets of the replays, not a multiple of the lanes
+const size_t batch_size = 203;
+
+/// @brief Tape of \p inputs, returning the slots of its operations
+vector<uint32_t> recordTape(::fap::Tape<FloatingPointType>& tape,
+                            const FloatingPointType* inputs) {
+  ::fap::TapeVar<FloatingPointType> x = tape.input(inputs[0]);
+  ::fap::TapeVar<FloatingPointType> y = tape.input(inputs[1]);
+  ::fap::TapeVar<FloatingPointType> z = tape.input(inputs[2]);
+  ::fap::TapeVar<FloatingPointType> a = x * y;
+  ::fap::TapeVar<FloatingPointType> b = a + z;
+  ::fap::TapeVar<FloatingPointType> c = b / x;
+  ::fap::TapeVar<FloatingPointType> d = c - y;
+  vector<uint32_t> slots = { a.getSlot(), b.getSlot(), c.getSlot(),
+                             d.getSlot() };
+  return slots;
+}
+
+/// @brief The operations of recordTape() with the operators
+vector<FloatingPointType> direct(const FloatingPointType* inputs) {
+  FloatingPointType a = inputs[0] * inputs[1];
+  FloatingPointType b = a + inputs[2];
+  FloatingPointType c = b / inputs[0];
+  FloatingPointType d = c - inputs[1];
+  vector<FloatingPointType> res = { a, b, c, d };
+  return res;
+}
+
+}  // end anonymous namespace
+
+FAP_TEST(tape, replay) {
+  ::std::mt19937_64 rng(14);
+  const FloatPrecTy input_precs[] = { FloatPrecTy(8, 23),
+                                      FloatPrecTy(11, 52),
+                                      FloatPrecTy(8, 30) };
+  for (FAP_rounding_method method : ::fap::unit::roundings) {
+    ::fap::ArithmeticContext ctx(method);
+    FloatingPointType inputs[3];
+    for (int i = 0; i < 3; ++i) {
+      inputs[i] = ::fap::unit::randomValue(rng, input_precs[i]);
+    }
+    ::fap::Tape<FloatingPointType> tape;
+    vector<uint32_t> slots = recordTape(tape, inputs);
+    vector<FloatingPointType> ref = direct(inputs);
+    for (size_t s = 0; s < slots.size(); ++s) {
+      FAP_CHECK_VALUE(tape.getValue(slots[s]), ref[s], "record");
+    }
+
+    // A new input, propagated by update()
+    inputs[2] = ::fap::unit::randomValue(rng, input_precs[2]);
+    tape.setInput(2, inputs[2]);
+    tape.update();
+    ref = direct(inputs);
+    for (size_t s = 0; s < slots.size(); ++s) {
+      FAP_CHECK_VALUE(tape.getValue(slots[s]), ref[s], "update");
+    }
+
+    vector<FloatingPointType> sets(3 * batch_size);
+    for (size_t i = 0; i < sets.size(); ++i) {
+      sets[i] = ::fap::unit::randomValue(rng, input_precs[i % 3]);
+    }
+    vector<FloatingPointType> results(slots.size() * batch_size);
+    tape.replay(sets.data(), batch_size, slots.data(), slots.size(),
+                results.data(), 2);
+    for (size_t set = 0; set < batch_size; ++set) {
+      ref = direct(&sets[3 * set]);
+      for (size_t s = 0; s < slots.size(); ++s) {
+        FAP_CHECK_VALUE(results[set * slots.size() + s], ref[s],
+                        ::std::string("replay ")
+                        + ::fap::unit::roundingName(method));
+      }
+    }
+  }
+}
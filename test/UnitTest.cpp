@@ -0,0 +1,253 @@
+//===- UnitTest.cpp ---------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitTest.cpp
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests main.
+///        Usage: fap_unit [group|group.name ...]
+///        Runs the tests of the given groups, all of them without
+///        arguments; the exit status is 1 if a check fails.
+//===----------------------------------------------------------------------===//
+
+#include "UnitTest.h"
+#include "FapContext.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+/// @brief Failures reported for each test, the following are only counted
+#ifndef FAP_UNIT_MAX_REPORTS
+#define FAP_UNIT_MAX_REPORTS          8
+#endif
+
+using namespace std;
+
+namespace {
+
+struct Test {
+  const char* group;
+  const char* name;
+  ::fap::unit::TestFnTy fn;
+};
+
+/// @brief Registered tests, built by the static initializers
+vector<Test>& tests() {
+  static vector<Test>* registry = new vector<Test>();
+  return *registry;
+}
+
+size_t failures = 0;  ///< Failed checks of the running test
+
+bool selected(const Test& test, int argc, const char *argv[]) {
+  if (argc < 2) {
+    return true;
+  }
+  string full = string(test.group) + "." + test.name;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], test.group) == 0 || full == argv[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // end anonymous namespace
+
+namespace fap {
+namespace unit {
+
+const FAP_rounding_method roundings[4] = { FAP_FP_ROUND_TOWARD_0,
+                                           FAP_FP_ROUND_TOWARD_PINF,
+                                           FAP_FP_ROUND_TOWARD_NINF,
+                                           FAP_FP_ROUND_NEAREST };
+
+const char* roundingName(FAP_rounding_method method) {
+  switch (method) {
+  case FAP_FP_ROUND_TOWARD_0:
+    return "zero";
+  case FAP_FP_ROUND_TOWARD_PINF:
+    return "pinf";
+  case FAP_FP_ROUND_TOWARD_NINF:
+    return "ninf";
+  case FAP_FP_ROUND_NEAREST:
+    return "nearest";
+  default:
+    return "stochastic";
+  }
+}
+
+bool registerTest(const char* group, const char* name, TestFnTy fn) {
+  Test test = { group, name, fn };
+  tests().push_back(test);
+  return true;
+}
+
+void fail(const char* file, int line, const string& what) {
+  if (++failures <= FAP_UNIT_MAX_REPORTS) {
+    fprintf(stderr, "  %s:%d: %s\n", file, line, what.c_str());
+  }
+}
+
+string describe(const FloatingPointType& val) {
+  char buf[96];
+  MantType mant = val.getMant();
+  snprintf(buf, sizeof(buf), "%c e=0x%x m=0x%llx%016llx (%u:%u, %a)",
+           val.getSign() ? '-' : '+', (unsigned)val.getExp(),
+           (unsigned long long)(uint64_t)(mant >> 64),
+           (unsigned long long)(uint64_t)mant,
+           (unsigned)val.getPrec().exp_size,
+           (unsigned)val.getPrec().mant_size, (double)val);
+  return buf;
+}
+
+bool sameValue(const FloatingPointType& lhs, const FloatingPointType& rhs) {
+  if (lhs.getPrec().exp_size != rhs.getPrec().exp_size
+      || lhs.getPrec().mant_size != rhs.getPrec().mant_size) {
+    return false;
+  }
+  if (lhs.isNaN() || rhs.isNaN()) {
+    return lhs.isNaN() && rhs.isNaN();
+  }
+  return lhs.getSign() == rhs.getSign() && lhs.getExp() == rhs.getExp()
+      && lhs.getMant() == rhs.getMant();
+}
+
+FloatingPointType apply(FAP_batch_op op, const FloatingPointType& lhs,
+                        const FloatingPointType& rhs) {
+  switch (op) {
+  case FAP_BATCH_ADD:
+    return lhs + rhs;
+  case FAP_BATCH_SUB:
+    return lhs - rhs;
+  case FAP_BATCH_MUL:
+    return lhs * rhs;
+  default:
+    return lhs / rhs;
+  }
+}
+
+FloatingPointType quantize(const FloatingPointType& val, FloatPrecTy prec) {
+  if (val.isNaN() || val.isInf()) {
+    FloatingPointType res;
+    res.setPrec(prec);
+    res.setSign(val.getSign());
+    if (val.isNaN()) {
+      res.setNaN();
+    } else {
+      res.setInf();
+    }
+    return res;
+  }
+  int exp2;
+  MantType sig = val.getSignificand(exp2);
+  return FloatingPointType::fromSignificand(
+      val.getSign(), sig, exp2, false, prec,
+      ArithmeticContext::current().rounding);
+}
+
+FloatingPointType randomValue(mt19937_64& rng, FloatPrecTy prec) {
+  ExpType max_exp = (ExpType)((1u << prec.exp_size) - 1);
+  ExpType bias = (ExpType)(max_exp >> 1);
+  ExpType exp;
+  switch (rng() % 16) {
+  case 0:
+    exp = 0;
+    break;
+  case 1:
+    exp = max_exp;
+    break;
+  case 2:
+    exp = (ExpType)(1 + rng() % 2);
+    break;
+  case 3:
+    exp = (ExpType)(max_exp - 1 - rng() % 2);
+    break;
+  case 4:
+  case 5:
+  case 6:
+    exp = (ExpType)(rng() % (max_exp + 1));
+    break;
+  default:
+    exp = (ExpType)(bias - 4 + rng() % 9);
+    break;
+  }
+  MantType mant;
+  switch (rng() % 6) {
+  case 0:
+    mant = 0;
+    break;
+  case 1:
+    mant = (MantType)1 << (rng() % prec.mant_size);
+    break;
+  case 2:
+    mant = ~(MantType)0;
+    break;
+  default:
+    mant = ((MantType)rng() << 64) | rng();
+    break;
+  }
+  FloatingPointType val;
+  val.setPrec(prec);
+  val.setSign((SignType)(rng() & 0x01));
+  val.setExp(exp);
+  val.setMant(mant);
+  val.setGrs(0);
+  return val;
+}
+
+FloatingPointType randomValue(mt19937_64& rng, FloatPrecTy prec,
+                              int min_exp, int max_exp) {
+  int bias = (1 << (prec.exp_size - 1)) - 1;
+  int exp = min_exp + (int)(rng() % (uint64_t)(max_exp - min_exp + 1));
+  FloatingPointType val;
+  val.setPrec(prec);
+  val.setSign((SignType)(rng() & 0x01));
+  val.setExp((ExpType)(exp + bias));
+  val.setMant(((MantType)rng() << 64) | rng());
+  val.setGrs(0);
+  return val;
+}
+
+}  // end unit namespace
+}  // end fap namespace
+
+int main(int argc, const char *argv[]) {
+  size_t failed = 0, run = 0;
+  for (const Test& test : tests()) {
+    if (!selected(test, argc, argv)) {
+      continue;
+    }
+    failures = 0;
+    test.fn();
+    ++run;
+    printf("[%s] %s.%s", failures == 0 ? "  OK  " : " FAIL ", test.group,
+           test.name);
+    if (failures != 0) {
+      printf(", %zu failed checks", failures);
+      ++failed;
+    }
+    printf("\n");
+  }
+  printf("%zu tests, %zu failed\n", run, failed);
+  return run == 0 || failed != 0 ? 1 : 0;
+}
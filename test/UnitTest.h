@@ -0,0 +1,111 @@
+//===- UnitTest.h -----------------------------------------------*- C++ -*-===//
+//
+//  Copyright (C) 2015, 2016  Federico Iannucci (fed.iannucci@gmail.com)
+//
+//  This file is part of Fap.
+//
+//  Fap is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU Affero General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  Fap is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU Affero General Public License for more details.
+//
+//  You should have received a copy of the GNU Affero General Public License
+//  along with Fap. If not, see <http://www.gnu.org/licenses/>.
+//
+//===----------------------------------------------------------------------===//
+/// \file UnitTest.h
+/// \author Federico Iannucci
+/// \brief Flexible Arbitrary Precision Library.
+///        Unit tests - C++
+//===----------------------------------------------------------------------===//
+
+#ifndef TEST_UNITTEST_H_
+#define TEST_UNITTEST_H_
+
+#include "Fap.h"
+#include "FapDispatch.h"
+
+#include <random>
+#include <string>
+
+/// @brief Random cases of each randomized test
+#ifndef FAP_UNIT_CASES
+#define FAP_UNIT_CASES                2000
+#endif
+
+namespace fap {
+namespace unit {
+
+typedef void (*TestFnTy)();
+
+/// @brief Register \p fn as the test \p name of \p group, the groups are
+/// the ctest entries
+bool registerTest(const char* group, const char* name, TestFnTy fn);
+
+/// @brief Report a failed check of the running test
+void fail(const char* file, int line, const ::std::string& what);
+
+/// @brief Sign, exponent, mantissa and precision of \p val
+::std::string describe(const FloatingPointType& val);
+
+/// @brief If \p lhs and \p rhs have the same precision and the same bits,
+/// any NaN being equal to any other NaN
+bool sameValue(const FloatingPointType& lhs, const FloatingPointType& rhs);
+
+/// @brief Random value of \p prec. The exponents favour the zeroes, the
+/// subnormals, the specials and the extremes of the range, where the
+/// roundings differ, the mantissas the patterns of few set bits.
+FloatingPointType randomValue(::std::mt19937_64& rng, FloatPrecTy prec);
+
+/// @brief Random value of \p prec between 2^(\p min_exp) and
+/// 2^(\p max_exp + 1), unbiased exponents, of random sign
+FloatingPointType randomValue(::std::mt19937_64& rng, FloatPrecTy prec,
+                              int min_exp, int max_exp);
+
+/// @brief lhs op rhs with the operators of FloatingPointType
+FloatingPointType apply(FAP_batch_op op, const FloatingPointType& lhs,
+                        const FloatingPointType& rhs);
+
+/// @brief \p val rounded on \p prec with the rounding of the context, the
+/// NaNs and the infinities kept
+FloatingPointType quantize(const FloatingPointType& val, FloatPrecTy prec);
+
+/// @brief The deterministic rounding methods
+extern const FAP_rounding_method roundings[4];
+
+/// @brief Name of \p method
+const char* roundingName(FAP_rounding_method method);
+
+}  // end unit namespace
+}  // end fap namespace
+
+/// @brief Define the test \p name of \p group
+#define FAP_TEST(group, name)                                                \
+  static void fap_test_##group##_##name();                                   \
+  static const bool fap_test_reg_##group##_##name =                          \
+      ::fap::unit::registerTest(#group, #name, &fap_test_##group##_##name);  \
+  static void fap_test_##group##_##name()
+
+/// @brief Check \p cond, reporting \p what when it fails
+#define FAP_CHECK_MSG(cond, what)                                            \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      ::fap::unit::fail(__FILE__, __LINE__, what);                           \
+    }                                                                        \
+  } while (0)
+
+#define FAP_CHECK(cond)               FAP_CHECK_MSG(cond, #cond)
+
+/// @brief Check that \p val is \p ref, as sameValue(), with \p what as the
+/// context of the failure
+#define FAP_CHECK_VALUE(val, ref, what)                                      \
+  FAP_CHECK_MSG(::fap::unit::sameValue(val, ref),                            \
+                ::std::string(what) + ": " + ::fap::unit::describe(val) +    \
+                " instead of " + ::fap::unit::describe(ref))
+
+#endif /* TEST_UNITTEST_H_ */